@@ -81,8 +81,8 @@ class CaptureBufferCollector: public terminal::NullParserEvents
 
     void startPM() override { capturedBuffer.clear(); }
 
-    void putPM(char t) override { capturedBuffer += t; }
-    void execute(char ch) override { putPM(ch); }
+    void putPM(string_view chars) override { capturedBuffer += chars; }
+    void execute(char ch) override { capturedBuffer += ch; }
 
     void dispatchPM() override
     {
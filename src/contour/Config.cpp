@@ -73,6 +73,7 @@ using terminal::Width;
 using terminal::CellRGBColorAndAlphaPair;
 using terminal::ColumnCount;
 using terminal::Infinite;
+using terminal::InfiniteDiskBacked;
 using terminal::LineCount;
 using terminal::PageSize;
 
@@ -1594,8 +1595,12 @@ namespace
 
         auto intValue = LineCount();
         tryLoadChildRelative(_usedKeys, _profile, basePath, "history.limit", intValue);
+        auto diskBacked = false;
+        tryLoadChildRelative(_usedKeys, _profile, basePath, "history.disk_backed", diskBacked);
         // value -1 is used for infinite grid
-        if (unbox<int>(intValue) == -1)
+        if (unbox<int>(intValue) == -1 && diskBacked)
+            profile.maxHistoryLineCount = InfiniteDiskBacked();
+        else if (unbox<int>(intValue) == -1)
             profile.maxHistoryLineCount = Infinite();
         else if (unbox<int>(intValue) > -1)
             profile.maxHistoryLineCount = LineCount(intValue);
@@ -1939,6 +1944,8 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
         _config.ptyBufferObjectSize = 1024 * 256;
     }
 
+    tryLoadValue(usedKeys, doc, "pipelined_parsing", _config.pipelinedParsing);
+
     tryLoadValue(usedKeys, doc, "reflow_on_resize", _config.reflowOnResize);
 
     if (auto profiles = doc["profiles"]; profiles)
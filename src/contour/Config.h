@@ -249,6 +249,9 @@ struct Config
     // Defaults to 1 MB, that's roughly 10k lines when column count is 100.
     size_t ptyBufferObjectSize = 1024lu * 1024lu;
 
+    // Splits processing of PTY output into a parser thread and a thread applying it to the screen.
+    bool pipelinedParsing = false;
+
     bool reflowOnResize = true;
 
     std::unordered_map<std::string, terminal::ColorPalette> colorschemes;
@@ -115,6 +115,7 @@ namespace
 
         settings.ptyBufferObjectSize = config.ptyBufferObjectSize;
         settings.ptyReadBufferSize = config.ptyReadBufferSize;
+        settings.pipelinedParsing = config.pipelinedParsing;
         settings.maxHistoryLineCount = profile.maxHistoryLineCount;
         settings.copyLastMarkRangeOffset = profile.copyLastMarkRangeOffset;
         settings.cursorBlinkInterval = profile.inputModes.insert.cursor.cursorBlinkInterval;
@@ -925,10 +925,12 @@ void TerminalWidget::doDumpState()
 
     // TODO: use this file store for everything that needs to be dumped.
     {
+        auto const metrics = terminal().metrics();
         auto const screenStateDump = [&]() {
             auto os = std::stringstream {};
             terminal().currentScreen().inspect("Screen state dump.", os);
             renderer_->inspect(os);
+            metrics.inspect(os);
             return os.str();
         }();
 
@@ -938,6 +940,10 @@ void TerminalWidget::doDumpState()
         auto fs = ofstream { screenStateDumpFilePath.string(), ios::trunc };
         fs << screenStateDump;
         fs.close();
+
+        auto const metricsFilePath = targetDir / "vt-metrics.json";
+        auto metricsFile = ofstream { metricsFilePath.string(), ios::trunc };
+        metricsFile << metrics.toJson();
     }
 
     enum class ImageBufferFormat
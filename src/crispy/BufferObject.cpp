@@ -19,5 +19,6 @@ namespace crispy
 template class BufferObject<char>;
 template class BufferFragment<char>;
 template class BufferObjectPool<char>;
+template class BufferFragmentCompactor<char>;
 
 } // namespace crispy
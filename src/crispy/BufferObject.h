@@ -21,6 +21,7 @@
 #include <gsl/span_ext>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
@@ -30,6 +31,7 @@
 #include <memory>
 #include <mutex>
 #include <string_view>
+#include <unordered_map>
 
 #define BUFFER_OBJECT_INLINE 1
 
@@ -155,13 +157,20 @@ class BufferObjectPool
 
     void releaseUnusedBuffers();
     [[nodiscard]] size_t unusedBuffers() const noexcept;
+
+    /// @returns the number of buffer objects created by this pool so far, not counting recycled ones.
+    [[nodiscard]] size_t createdBuffers() const noexcept { return _createdBuffers; }
+
     [[nodiscard]] BufferObjectPtr<T> allocateBufferObject();
 
   private:
     void release(BufferObject<T>* ptr);
 
-    bool _reuseBuffers = true;
+    std::atomic<bool> _reuseBuffers = true;
+    std::atomic<size_t> _createdBuffers = 0;
     size_t _bufferSize;
+    // Buffer objects may be released on a different thread than the one allocating them.
+    mutable std::mutex _mutex;
     std::list<BufferObjectPtr<T>> _unusedBuffers;
 };
 
@@ -219,6 +228,71 @@ BufferFragment(BufferObjectPtr<T>, gsl::span<T const>) -> BufferFragment<T>;
 template <typename T>
 BufferFragment(BufferObjectPtr<T>, std::basic_string_view<T>) -> BufferFragment<T>;
 
+/// Memory held by the buffer objects a set of buffer fragments refers to.
+struct BufferObjectUsage
+{
+    /// Number of distinct buffer objects referred to.
+    size_t bufferCount = 0;
+
+    /// Number of bytes referred to by the fragments.
+    size_t liveBytes = 0;
+
+    /// Number of bytes of the buffer objects referred to, that is, the memory kept alive by the fragments.
+    size_t pinnedBytes = 0;
+};
+
+/**
+ * BufferFragmentCompactor releases buffer objects that are kept alive by a few small fragments only.
+ *
+ * A buffer object filled by a PTY read stays alive as long as any fragment refers to it,
+ * such as the text of a single line that survived in the scrollback, while the text of all
+ * the other lines in that buffer object is gone already.
+ *
+ * All fragments are passed to collect() first, accounting the bytes each buffer object is still
+ * used for. Then all fragments are passed to compact(), which copies the ones referring to sparsely
+ * used buffer objects into a dense archive buffer object, such that the sparsely used ones get
+ * released (or returned to their pool) as soon as the last fragment referring to them is replaced.
+ */
+template <typename T>
+class BufferFragmentCompactor
+{
+  public:
+    /// @param maxLoadFactor  fragments of buffer objects with less than this fraction of their
+    ///                       used bytes still being referred to are copied
+    explicit BufferFragmentCompactor(float maxLoadFactor) noexcept: _maxLoadFactor { maxLoadFactor } {}
+
+    /// Accounts the bytes the given fragment refers to.
+    void collect(BufferFragment<T> const& fragment);
+
+    /// @returns the memory held by the buffer objects of all collected fragments.
+    ///
+    /// @note Must not be called after compact(), as the buffer objects may have been released already.
+    [[nodiscard]] BufferObjectUsage usage() const noexcept;
+
+    /// Copies the given fragment into the archive if it refers to a sparsely used buffer object.
+    void compact(BufferFragment<T>& fragment);
+
+    /// @returns the number of bytes copied into the archive so far.
+    [[nodiscard]] size_t compactedBytes() const noexcept { return _compactedBytes; }
+
+  private:
+    struct Usage
+    {
+        size_t liveBytes = 0;
+        bool sparse = false;
+    };
+
+    /// Determines the sparsely used buffer objects, before any of them may get released.
+    void prepare();
+
+    float _maxLoadFactor;
+    std::unordered_map<BufferObject<T> const*, Usage> _usage;
+    bool _prepared = false;
+    BufferObjectPtr<T> _archive;
+    size_t _archiveSize = 0;
+    size_t _compactedBytes = 0;
+};
+
 // {{{ BufferObject implementation
 template <typename T>
 BufferObject<T>::BufferObject(size_t capacity) noexcept:
@@ -255,8 +329,16 @@ BufferObjectPtr<T> BufferObject<T>::create(size_t capacity, BufferObjectRelease<
     auto const nettoCapacity = totalCapacity - sizeof(BufferObject);
     auto ptr = (BufferObject*) malloc(totalCapacity);
     new (ptr) BufferObject(nettoCapacity);
+    // Buffer objects not owned by a pool are simply destroyed once released.
+    if (!release)
+        release = [](BufferObject* p) {
+            std::destroy_n(p, 1);
+            free(p);
+        };
     return BufferObjectPtr<T>(ptr, std::move(release));
 #else
+    if (!release)
+        release = [](BufferObject* p) { delete p; };
     return BufferObjectPtr<T>(new BufferObject<T>(nextPowerOfTwo(capacity)), std::move(release));
 #endif
 }
@@ -345,6 +427,76 @@ inline std::size_t BufferFragment<T>::endOffset() const noexcept
 }
 // }}}
 
+// {{{ BufferFragmentCompactor implementation
+template <typename T>
+void BufferFragmentCompactor<T>::collect(BufferFragment<T> const& fragment)
+{
+    // NB: Even an empty fragment keeps its buffer object alive.
+    if (fragment.owner())
+        _usage[fragment.owner().get()].liveBytes += fragment.size();
+}
+
+template <typename T>
+BufferObjectUsage BufferFragmentCompactor<T>::usage() const noexcept
+{
+    auto result = BufferObjectUsage {};
+    result.bufferCount = _usage.size();
+    for (auto const& [buffer, usage]: _usage)
+    {
+        result.liveBytes += usage.liveBytes;
+        result.pinnedBytes += buffer->capacity();
+    }
+    return result;
+}
+
+template <typename T>
+void BufferFragmentCompactor<T>::prepare()
+{
+    for (auto& [buffer, usage]: _usage)
+    {
+        usage.sparse = static_cast<float>(usage.liveBytes)
+                       < _maxLoadFactor * static_cast<float>(buffer->bytesUsed());
+        if (usage.sparse)
+            _archiveSize += usage.liveBytes;
+    }
+    _prepared = true;
+}
+
+template <typename T>
+void BufferFragmentCompactor<T>::compact(BufferFragment<T>& fragment)
+{
+    if (!fragment.owner())
+        return;
+
+    if (!_prepared)
+        prepare();
+
+    auto const i = _usage.find(fragment.owner().get());
+    if (i == _usage.end() || !i->second.sparse)
+        return;
+
+    if (fragment.empty())
+    {
+        fragment = BufferFragment<T> {};
+        return;
+    }
+
+    // The archive is sized to hold all fragments to be copied, such that it is densely used itself.
+    // Only fragments referring to the same bytes more than once (such as copied lines) may exceed it.
+    if (!_archive || _archive->bytesAvailable() < fragment.size())
+    {
+        auto const remaining = _archiveSize > _compactedBytes ? _archiveSize - _compactedBytes : 0;
+        _archive = BufferObject<T>::create(std::max(fragment.size(), remaining));
+    }
+
+    auto const offset = _archive->bytesUsed();
+    _archive->writeAtEnd(fragment.span());
+    _archive->advance(fragment.size());
+    _compactedBytes += fragment.size();
+    fragment = _archive->ref(offset, fragment.size());
+}
+// }}}
+
 // {{{ BufferObjectPool implementation
 template <typename T>
 BufferObjectPool<T>::BufferObjectPool(size_t bufferSize): _bufferSize { bufferSize }
@@ -362,22 +514,33 @@ BufferObjectPool<T>::~BufferObjectPool()
 template <typename T>
 size_t BufferObjectPool<T>::unusedBuffers() const noexcept
 {
+    auto const _ = std::lock_guard { _mutex };
     return _unusedBuffers.size();
 }
 
 template <typename T>
 void BufferObjectPool<T>::releaseUnusedBuffers()
 {
+    auto unusedBuffers = std::list<BufferObjectPtr<T>> {};
+    {
+        auto const _ = std::lock_guard { _mutex };
+        unusedBuffers.swap(_unusedBuffers);
+    }
     _reuseBuffers = false;
-    _unusedBuffers.clear();
+    unusedBuffers.clear();
     _reuseBuffers = true;
 }
 
 template <typename T>
 BufferObjectPtr<T> BufferObjectPool<T>::allocateBufferObject()
 {
+    auto lock = std::unique_lock { _mutex };
     if (_unusedBuffers.empty())
+    {
+        lock.unlock();
+        ++_createdBuffers;
         return BufferObject<T>::create(_bufferSize, [this](auto p) { release(p); });
+    }
 
     BufferObjectPtr<T> buffer = std::move(_unusedBuffers.front());
     if (BufferObjectLog)
@@ -394,6 +557,7 @@ void BufferObjectPool<T>::release(BufferObject<T>* ptr)
         if (BufferObjectLog)
             BufferObjectLog()("Releasing BufferObject from pool: @{}", (void*) ptr);
         ptr->reset();
+        auto const _ = std::lock_guard { _mutex };
         _unusedBuffers.emplace_back(ptr, [this](auto p) { release(p); });
     }
     else
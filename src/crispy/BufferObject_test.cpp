@@ -16,7 +16,46 @@
 
 #include <catch2/catch.hpp>
 
+#include <string>
+#include <vector>
+
 TEST_CASE("BufferObject", "[BufferObject]")
 {
     // TODO
 }
+
+TEST_CASE("BufferFragmentCompactor", "[BufferObject]")
+{
+    auto pool = crispy::BufferObjectPool<char>(64);
+    auto sparse = pool.allocateBufferObject();
+    auto dense = pool.allocateBufferObject();
+    for (auto* buffer: { sparse.get(), dense.get() })
+    {
+        buffer->writeAtEnd(std::string(buffer->capacity(), 'x'));
+        buffer->advance(buffer->capacity());
+    }
+
+    auto fragments = std::vector { sparse->ref(0, 2), dense->ref(0, dense->capacity()), sparse->ref(8, 0) };
+    auto const* const sparseBuffer = sparse.get();
+    sparse.reset();
+
+    auto compactor = crispy::BufferFragmentCompactor<char>(0.5f);
+    for (auto const& fragment: fragments)
+        compactor.collect(fragment);
+
+    auto const usage = compactor.usage();
+    CHECK(usage.bufferCount == 2);
+    CHECK(usage.liveBytes == 2 + dense->capacity());
+    CHECK(usage.pinnedBytes == 2 * dense->capacity());
+
+    for (auto& fragment: fragments)
+        compactor.compact(fragment);
+
+    // The sparsely used buffer object has been released to the pool, with its text moved to the archive.
+    CHECK(compactor.compactedBytes() == 2);
+    CHECK(pool.unusedBuffers() == 1);
+    CHECK(fragments[0].view() == "xx");
+    CHECK(fragments[0].owner().get() != sparseBuffer);
+    CHECK(fragments[1].owner() == dense);
+    CHECK(!fragments[2].owner());
+}
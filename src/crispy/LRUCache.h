@@ -25,7 +25,7 @@ namespace crispy
 {
 
 /// Implements LRU (Least recently used) cache.
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class LRUCache
 {
   public:
@@ -182,10 +182,10 @@ class LRUCache
         return newItemIterator;
     }
 
+    /// Moves the item to the front, keeping references to its value valid.
     [[nodiscard]] iterator moveItemToFront(iterator i)
     {
-        _items.emplace_front(std::move(*i));
-        _items.erase(i);
+        _items.splice(_items.begin(), _items, i);
         return _items.begin();
     }
 
@@ -199,7 +199,7 @@ class LRUCache
     // private data
     //
     std::list<Item> _items;
-    std::unordered_map<Key, iterator> _itemByKeyMapping;
+    std::unordered_map<Key, iterator, Hash> _itemByKeyMapping;
     std::size_t _capacity;
 };
 
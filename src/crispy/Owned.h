@@ -31,7 +31,7 @@ struct CRISPY_PACKED Owned
     Owned(Owned&& v) noexcept: _ptr { v.release() } {}
     Owned& operator=(Owned&& v) noexcept
     {
-        _ptr = v.release();
+        reset(v.release());
         return *this;
     }
 
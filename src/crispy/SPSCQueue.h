@@ -0,0 +1,185 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * Bounded lock-free single-producer/single-consumer queue.
+ *
+ * Elements are pushed by exactly one producer thread and consumed by exactly one consumer thread.
+ * Neither side touches a lock as long as it does not have to wait, i.e. as long as the queue
+ * is neither full (producer) nor empty (consumer).
+ *
+ * Pushed elements only become visible to the consumer once they have been published,
+ * which allows the producer to hand over elements in batches.
+ *
+ * Consumed slots are not destroyed but reused, so that element types owning heap storage
+ * (such as strings) can recycle their capacity on the next assignment.
+ */
+template <typename T>
+class SPSCQueue
+{
+  public:
+    explicit SPSCQueue(size_t capacity):
+        _slots(nextPowerOfTwo(static_cast<uint32_t>(std::max<size_t>(capacity, 2)))),
+        _mask { _slots.size() - 1 }
+    {
+    }
+
+    SPSCQueue(SPSCQueue const&) = delete;
+    SPSCQueue(SPSCQueue&&) = delete;
+    SPSCQueue& operator=(SPSCQueue const&) = delete;
+    SPSCQueue& operator=(SPSCQueue&&) = delete;
+    ~SPSCQueue() = default;
+
+    [[nodiscard]] size_t capacity() const noexcept { return _slots.size(); }
+
+    /// @returns the number of published elements not yet consumed.
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // {{{ producer API
+    /// Appends the given value, waiting for the consumer to make room if the queue is full.
+    ///
+    /// The value is not visible to the consumer before the next call to publish().
+    template <typename U>
+    void push(U&& value)
+    {
+        if (_pendingTail - _cachedHead == capacity())
+            waitForSpace();
+        _slots[_pendingTail & _mask] = std::forward<U>(value);
+        ++_pendingTail;
+    }
+
+    /// Makes all pushed elements visible to the consumer.
+    void publish()
+    {
+        if (_pendingTail == _tail.load(std::memory_order_relaxed))
+            return;
+
+        _tail.store(_pendingTail, std::memory_order_seq_cst);
+        if (_consumerWaiting.load(std::memory_order_seq_cst))
+        {
+            auto const _ = std::lock_guard { _mutex };
+            _dataAvailable.notify_one();
+        }
+    }
+
+    /// Publishes all pushed elements and waits until the consumer has consumed all of them.
+    void waitUntilConsumed()
+    {
+        publish();
+        waitFor([this]() { return _head.load(std::memory_order_acquire) == _pendingTail; });
+        _cachedHead = _pendingTail;
+    }
+    // }}}
+
+    // {{{ consumer API
+    /// Waits until at least one published element is available for consumption.
+    void waitForData()
+    {
+        auto lock = std::unique_lock { _mutex };
+        _consumerWaiting.store(true, std::memory_order_seq_cst);
+        _dataAvailable.wait(lock, [this]() {
+            return _tail.load(std::memory_order_seq_cst) != _head.load(std::memory_order_relaxed);
+        });
+        _consumerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    /// Invokes @p consumer on up to @p maxCount published elements, in order.
+    ///
+    /// @returns the number of elements consumed.
+    template <typename Consumer>
+    size_t consume(size_t maxCount, Consumer&& consumer)
+    {
+        auto const head = _head.load(std::memory_order_relaxed);
+        auto const count = std::min(_tail.load(std::memory_order_acquire) - head, maxCount);
+        if (!count)
+            return 0;
+
+        for (size_t i = 0; i < count; ++i)
+            consumer(_slots[(head + i) & _mask]);
+
+        _head.store(head + count, std::memory_order_seq_cst);
+        if (_producerWaiting.load(std::memory_order_seq_cst))
+        {
+            auto const _ = std::lock_guard { _mutex };
+            _spaceAvailable.notify_one();
+        }
+        return count;
+    }
+    // }}}
+
+  private:
+    void waitForSpace()
+    {
+        _cachedHead = _head.load(std::memory_order_acquire);
+        if (_pendingTail - _cachedHead != capacity())
+            return;
+
+        // Hand over what we have, or the consumer will never make room for us.
+        publish();
+        waitFor([this]() { return _pendingTail - _head.load(std::memory_order_seq_cst) != capacity(); });
+        _cachedHead = _head.load(std::memory_order_acquire);
+    }
+
+    template <typename Predicate>
+    void waitFor(Predicate predicate)
+    {
+        if (predicate())
+            return;
+
+        auto lock = std::unique_lock { _mutex };
+        _producerWaiting.store(true, std::memory_order_seq_cst);
+        _spaceAvailable.wait(lock, predicate);
+        _producerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    std::vector<T> _slots;
+    size_t const _mask;
+
+    // Written by the consumer only.
+    alignas(64) std::atomic<size_t> _head = 0;
+
+    // Written by the producer only.
+    alignas(64) std::atomic<size_t> _tail = 0;
+    size_t _pendingTail = 0;
+    size_t _cachedHead = 0;
+
+    // Only used when either side has to wait for the other one.
+    alignas(64) std::atomic<bool> _consumerWaiting = false;
+    std::atomic<bool> _producerWaiting = false;
+    std::mutex _mutex;
+    std::condition_variable _dataAvailable;
+    std::condition_variable _spaceAvailable;
+};
+
+} // namespace crispy
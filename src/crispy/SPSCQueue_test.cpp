@@ -0,0 +1,93 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/SPSCQueue.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using crispy::SPSCQueue;
+
+TEST_CASE("SPSCQueue.capacity")
+{
+    CHECK(SPSCQueue<int>(0).capacity() == 2);
+    CHECK(SPSCQueue<int>(8).capacity() == 8);
+    CHECK(SPSCQueue<int>(9).capacity() == 16);
+}
+
+TEST_CASE("SPSCQueue.publish")
+{
+    auto queue = SPSCQueue<int>(4);
+    queue.push(1);
+    queue.push(2);
+    CHECK(queue.empty()); // Nothing published yet.
+
+    queue.publish();
+    CHECK(queue.size() == 2);
+
+    auto consumed = std::vector<int> {};
+    CHECK(queue.consume(8, [&](int value) { consumed.push_back(value); }) == 2);
+    CHECK(consumed == std::vector<int> { 1, 2 });
+    CHECK(queue.empty());
+}
+
+TEST_CASE("SPSCQueue.wrap_around")
+{
+    auto queue = SPSCQueue<std::string>(4);
+    auto consumed = std::vector<std::string> {};
+    for (int round = 0; round < 5; ++round)
+    {
+        queue.push(std::to_string(round * 3));
+        queue.push(std::to_string(round * 3 + 1));
+        queue.push(std::to_string(round * 3 + 2));
+        queue.publish();
+        CHECK(queue.consume(2, [&](std::string const& value) { consumed.push_back(value); }) == 2);
+        CHECK(queue.consume(2, [&](std::string const& value) { consumed.push_back(value); }) == 1);
+    }
+    REQUIRE(consumed.size() == 15);
+    for (size_t i = 0; i < consumed.size(); ++i)
+        CHECK(consumed[i] == std::to_string(i));
+}
+
+TEST_CASE("SPSCQueue.threaded")
+{
+    // A tiny queue forces both sides to wait for each other a lot.
+    auto constexpr Count = 100'000;
+    auto queue = SPSCQueue<int>(16);
+    auto consumed = std::vector<int> {};
+    consumed.reserve(Count);
+
+    auto consumer = std::thread([&]() {
+        while (consumed.size() != Count)
+        {
+            queue.waitForData();
+            queue.consume(5, [&](int value) { consumed.push_back(value); });
+        }
+    });
+
+    for (int i = 0; i < Count; ++i)
+    {
+        queue.push(i);
+        if (i % 7 == 0)
+            queue.publish();
+    }
+    queue.waitUntilConsumed();
+    consumer.join();
+
+    REQUIRE(consumed.size() == Count);
+    for (int i = 0; i < Count; ++i)
+        REQUIRE(consumed[static_cast<size_t>(i)] == i);
+}
@@ -0,0 +1,182 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/compress.h>
+
+#include <array>
+#include <cstring>
+
+namespace crispy
+{
+
+namespace
+{
+    // Each sequence starts with a token byte, holding the number of literals in the upper nibble
+    // and the match length (minus MinMatch) in the lower nibble. A nibble of 15 is followed by
+    // extension bytes, each adding up to 255, with the last one being less than 255.
+    // The literals follow, and then the match's offset as 16-bit little endian.
+    // The last sequence consists of literals only.
+
+    constexpr size_t MinMatch = 4;
+    constexpr size_t MaxOffset = 0xFFFF;
+    constexpr unsigned HashBits = 12;
+    constexpr unsigned NibbleMax = 15;
+
+    uint32_t read32(uint8_t const* p) noexcept
+    {
+        uint32_t value = 0;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t value) noexcept
+    {
+        return (value * 2654435761u) >> (32 - HashBits);
+    }
+
+    void writeLengthExtension(std::vector<uint8_t>& output, size_t length)
+    {
+        length -= NibbleMax;
+        while (length >= 0xFF)
+        {
+            output.push_back(0xFF);
+            length -= 0xFF;
+        }
+        output.push_back(static_cast<uint8_t>(length));
+    }
+
+    /// Writes a sequence of literals, followed by a back reference unless @p matchLength is 0.
+    void writeSequence(std::vector<uint8_t>& output,
+                       uint8_t const* literals,
+                       size_t literalCount,
+                       size_t matchLength,
+                       size_t offset)
+    {
+        auto const matchCode = matchLength ? matchLength - MinMatch : 0;
+        output.push_back(static_cast<uint8_t>((std::min<size_t>(literalCount, NibbleMax) << 4)
+                                              | std::min<size_t>(matchCode, NibbleMax)));
+        if (literalCount >= NibbleMax)
+            writeLengthExtension(output, literalCount);
+        output.insert(output.end(), literals, literals + literalCount);
+
+        if (!matchLength)
+            return;
+
+        output.push_back(static_cast<uint8_t>(offset & 0xFF));
+        output.push_back(static_cast<uint8_t>(offset >> 8));
+        if (matchCode >= NibbleMax)
+            writeLengthExtension(output, matchCode);
+    }
+
+    bool readLengthExtension(gsl::span<uint8_t const> input, size_t& pos, size_t& length) noexcept
+    {
+        uint8_t byte = 0xFF;
+        while (byte == 0xFF)
+        {
+            if (pos == input.size())
+                return false;
+            byte = input[pos++];
+            length += byte;
+        }
+        return true;
+    }
+} // namespace
+
+std::vector<uint8_t> compress(gsl::span<uint8_t const> input)
+{
+    auto output = std::vector<uint8_t> {};
+    output.reserve(input.size() / 2 + 16);
+
+    // Maps the hash of 4 bytes to the position (plus one) at which they have been seen last.
+    auto table = std::array<uint32_t, 1u << HashBits> {};
+
+    auto const* const data = input.data();
+    auto const size = input.size();
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (pos + MinMatch <= size)
+    {
+        auto const value = read32(data + pos);
+        auto& slot = table[hash(value)];
+        auto const candidate = static_cast<size_t>(slot);
+        slot = static_cast<uint32_t>(pos + 1);
+
+        if (candidate == 0 || pos - (candidate - 1) > MaxOffset || read32(data + candidate - 1) != value)
+        {
+            ++pos;
+            continue;
+        }
+
+        auto const matchStart = candidate - 1;
+        auto matchLength = MinMatch;
+        while (pos + matchLength < size && data[matchStart + matchLength] == data[pos + matchLength])
+            ++matchLength;
+
+        writeSequence(output, data + anchor, pos - anchor, matchLength, pos - matchStart);
+        pos += matchLength;
+        anchor = pos;
+    }
+
+    writeSequence(output, data + anchor, size - anchor, 0, 0);
+    return output;
+}
+
+bool decompress(gsl::span<uint8_t const> input, gsl::span<uint8_t> output) noexcept
+{
+    size_t ip = 0;
+    size_t op = 0;
+    bool terminated = false;
+
+    while (ip < input.size())
+    {
+        auto const token = input[ip++];
+
+        auto literalCount = static_cast<size_t>(token >> 4);
+        if (literalCount == NibbleMax && !readLengthExtension(input, ip, literalCount))
+            return false;
+        if (literalCount > input.size() - ip || literalCount > output.size() - op)
+            return false;
+        std::memcpy(output.data() + op, input.data() + ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        if (ip == input.size())
+        {
+            // The last sequence has no back reference.
+            terminated = true;
+            break;
+        }
+
+        if (input.size() - ip < 2)
+            return false;
+        auto const offset = static_cast<size_t>(input[ip]) | (static_cast<size_t>(input[ip + 1]) << 8);
+        ip += 2;
+
+        auto matchLength = static_cast<size_t>(token & NibbleMax);
+        if (matchLength == NibbleMax && !readLengthExtension(input, ip, matchLength))
+            return false;
+        matchLength += MinMatch;
+
+        if (offset == 0 || offset > op || matchLength > output.size() - op)
+            return false;
+
+        // Matches may overlap with their own output, hence copying byte by byte.
+        for (size_t i = 0; i < matchLength; ++i, ++op)
+            output[op] = output[op - offset];
+    }
+
+    return terminated && op == output.size();
+}
+
+} // namespace crispy
@@ -0,0 +1,37 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <vector>
+
+namespace crispy
+{
+
+/// Compresses the given block of data with a simple and fast LZ77 byte-oriented scheme.
+///
+/// The block is encoded as a sequence of (literals, back reference) pairs, much like LZ4's block format,
+/// trading compression ratio for speed.
+/// The uncompressed size is not stored and must be known by the caller in order to decompress.
+[[nodiscard]] std::vector<uint8_t> compress(gsl::span<uint8_t const> input);
+
+/// Decompresses a block produced by compress() into @p output.
+///
+/// @retval true  @p input has been decompressed, filling exactly all of @p output.
+/// @retval false @p input is malformed or does not decompress to exactly the size of @p output.
+[[nodiscard]] bool decompress(gsl::span<uint8_t const> input, gsl::span<uint8_t> output) noexcept;
+
+} // namespace crispy
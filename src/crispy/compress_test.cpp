@@ -0,0 +1,111 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/compress.h>
+
+#include <catch2/catch.hpp>
+
+#include <string_view>
+#include <vector>
+
+using std::string_view;
+using std::vector;
+
+namespace
+{
+
+vector<uint8_t> bytes(string_view text)
+{
+    return vector<uint8_t>(text.begin(), text.end());
+}
+
+vector<uint8_t> roundtrip(vector<uint8_t> const& input)
+{
+    auto const compressed = crispy::compress(input);
+    auto output = vector<uint8_t>(input.size());
+    REQUIRE(crispy::decompress(compressed, output));
+    return output;
+}
+
+} // namespace
+
+TEST_CASE("compress.empty")
+{
+    auto const compressed = crispy::compress({});
+    auto output = vector<uint8_t> {};
+    CHECK(crispy::decompress(compressed, output));
+}
+
+TEST_CASE("compress.literals_only")
+{
+    auto const input = bytes("abc");
+    CHECK(roundtrip(input) == input);
+}
+
+TEST_CASE("compress.repetitive")
+{
+    auto input = vector<uint8_t> {};
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto const line = bytes("user@host:~$ ls -l /usr/share/doc\n");
+        input.insert(input.end(), line.begin(), line.end());
+    }
+
+    auto const compressed = crispy::compress(input);
+    CHECK(compressed.size() < input.size() / 10);
+    CHECK(roundtrip(input) == input);
+}
+
+TEST_CASE("compress.overlapping_match")
+{
+    // A run of the same byte is encoded as a back reference overlapping with its own output.
+    auto const input = vector<uint8_t>(4000, 'x');
+    CHECK(crispy::compress(input).size() < 32);
+    CHECK(roundtrip(input) == input);
+}
+
+TEST_CASE("compress.random")
+{
+    auto input = vector<uint8_t>(70000);
+    auto seed = uint32_t { 42 };
+    for (auto& byte: input)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+    CHECK(roundtrip(input) == input);
+}
+
+TEST_CASE("compress.malformed")
+{
+    auto const compressed = crispy::compress(bytes("hello hello hello hello"));
+
+    SECTION("output too small")
+    {
+        auto output = vector<uint8_t>(10);
+        CHECK_FALSE(crispy::decompress(compressed, output));
+    }
+
+    SECTION("output too large")
+    {
+        auto output = vector<uint8_t>(100);
+        CHECK_FALSE(crispy::decompress(compressed, output));
+    }
+
+    SECTION("truncated")
+    {
+        auto const truncated = vector<uint8_t>(compressed.begin(), compressed.end() - 1);
+        auto output = vector<uint8_t>(23);
+        CHECK_FALSE(crispy::decompress(truncated, output));
+    }
+}
@@ -57,20 +57,20 @@ class basic_ring // NOLINT(readability-identifier-naming)
 
     [[nodiscard]] value_type const& operator[](offset_type i) const noexcept
     {
-        return _storage[size_t(offset_type(_zero + size()) + i) % size()];
+        return _storage[storage_index(i)];
     }
     [[nodiscard]] value_type& operator[](offset_type i) noexcept
     {
-        return _storage[size_t(offset_type(_zero + size()) + i) % size()];
+        return _storage[storage_index(i)];
     }
 
     [[nodiscard]] value_type const& at(offset_type i) const noexcept
     {
-        return _storage[size_t(_zero + size() + i) % size()];
+        return _storage[storage_index(i)];
     }
     [[nodiscard]] value_type& at(offset_type i) noexcept
     {
-        return _storage[size_t(offset_type(_zero + size()) + i) % size()];
+        return _storage[storage_index(i)];
     }
 
     [[nodiscard]] Vector& storage() noexcept { return _storage; }
@@ -145,6 +145,23 @@ class basic_ring // NOLINT(readability-identifier-naming)
     }
 
   protected:
+    /// Maps the logical index @p i to the index into the underlying storage.
+    ///
+    /// The ring's size is generally not a power of two, so wrapping around is done by
+    /// a conditional add or subtract, only falling back to a division if @p i is out of range.
+    [[nodiscard]] std::size_t storage_index(offset_type i) const noexcept
+    {
+        auto const n = static_cast<offset_type>(size());
+        auto const j = static_cast<offset_type>(_zero) + i;
+        if (0 <= j && j < n)
+            return static_cast<std::size_t>(j);
+        if (n <= j && j < 2 * n)
+            return static_cast<std::size_t>(j - n);
+        if (-n <= j && j < 0)
+            return static_cast<std::size_t>(j + n);
+        return static_cast<std::size_t>(((j % n) + n) % n);
+    }
+
     Vector _storage;
     std::size_t _zero = 0;
 };
@@ -179,6 +196,19 @@ class ring: public basic_ring<T, Container<T, Allocator>> // NOLINT(readability-
     }
     void push_back(T const& value) { this->_storage.push_back(value); }
 
+    /// Inserts @p count copies of @p value before offset @p i, with 0 < i <= size(),
+    /// such that the offsets below @p i, as well as the negative offsets, keep referring
+    /// to the same elements.
+    void insert(long i, size_t count, T const& value)
+    {
+        assert(0 < i && i <= static_cast<long>(size()));
+        auto const storageIndex = this->storage_index(i);
+        auto const pos = std::next(this->_storage.begin(), static_cast<long>(storageIndex));
+        this->_storage.insert(pos, count, value);
+        if (storageIndex <= this->_zero)
+            this->_zero += count;
+    }
+
     void push_back(T&& value) { this->emplace_back(std::move(value)); }
 
     template <typename... Args>
@@ -409,7 +439,11 @@ void basic_ring<T, Vector>::rezero()
 template <typename T, typename Vector>
 void basic_ring<T, Vector>::rezero(iterator i)
 {
-    std::rotate(begin(), std::next(begin(), i.current), end()); // shift-left
+    // Rotating the logical elements left by the current zero index restores the storage order,
+    // thus rotating these further makes the element at i come first.
+    auto const n = static_cast<difference_type>(size());
+    auto const offset = (static_cast<difference_type>(_zero) + i.current) % n;
+    std::rotate(begin(), std::next(begin(), offset), end()); // shift-left
     _zero = 0;
 }
 // }}}
@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include <crispy/ring.h>
+#include <crispy/segmented_vector.h>
 
 #include <fmt/format.h>
 
@@ -21,6 +22,7 @@
 
 using crispy::fixed_size_ring;
 using crispy::ring;
+using crispy::segmented_vector;
 using std::generate_n;
 
 namespace
@@ -148,6 +150,21 @@ TEST_CASE("ring.rezero.iterator")
     REQUIRE(r[5] == 'b');
 }
 
+TEST_CASE("ring.rezero.iterator_rotated")
+{
+    ring<char> r(6);
+    generate_n(r.begin(), r.size(), [c = 'a']() mutable { return c++; });
+    r.rotate_left(3);
+    r.rezero(std::next(r.begin(), 2));
+    REQUIRE(r.zero_index() == 0);
+    REQUIRE(r[0] == 'f');
+    REQUIRE(r[1] == 'a');
+    REQUIRE(r[2] == 'b');
+    REQUIRE(r[3] == 'c');
+    REQUIRE(r[4] == 'd');
+    REQUIRE(r[5] == 'e');
+}
+
 TEST_CASE("ring.fixed_size")
 {
     fixed_size_ring<char, 6> r;
@@ -174,3 +191,96 @@ TEST_CASE("ring.offset_negative")
     REQUIRE(r[-2] == 'b');
     REQUIRE(r[-3] == 'a');
 }
+
+TEST_CASE("ring.segmented.across_segments")
+{
+    auto constexpr Count = 3 * segmented_vector<int>::segment_size + 7;
+    ring<int, segmented_vector> r(Count, 0);
+    generate_n(r.begin(), r.size(), [i = 0]() mutable { return i++; });
+
+    r.rotate_left(300);
+    REQUIRE(r[0] == 300);
+    REQUIRE(r[-1] == 299);
+    REQUIRE(r[static_cast<long>(Count) - 300] == 0);
+    REQUIRE(r[static_cast<long>(Count)] == 300); // wraps around once
+
+    r.rezero();
+    REQUIRE(r.zero_index() == 0);
+    REQUIRE(r[0] == 300);
+    REQUIRE(r.storage()[0] == 300);
+}
+
+TEST_CASE("ring.segmented.grow_keeps_addresses")
+{
+    ring<int, segmented_vector> r;
+    r.emplace_back(42);
+    auto const* first = &r[0];
+
+    for (int i = 1; i < 1000; ++i)
+        r.emplace_back(i);
+
+    REQUIRE(&r[0] == first);
+    REQUIRE(r[0] == 42);
+    REQUIRE(r[999] == 999);
+    REQUIRE(r.storage().capacity() == 4 * segmented_vector<int>::segment_size);
+}
+
+TEST_CASE("ring.segmented.resize")
+{
+    auto constexpr SegmentSize = segmented_vector<int>::segment_size;
+    ring<int, segmented_vector> r(2 * SegmentSize + 1, 7);
+
+    r.resize(SegmentSize);
+    REQUIRE(r.size() == SegmentSize);
+    REQUIRE(r.storage().capacity() == SegmentSize);
+    REQUIRE(r[-1] == 7);
+
+    r.resize(SegmentSize + 2);
+    REQUIRE(r.size() == SegmentSize + 2);
+    REQUIRE(r.storage().capacity() == 2 * SegmentSize);
+    REQUIRE(r[-1] == 0);
+}
+
+TEST_CASE("ring.segmented.pop_front")
+{
+    ring<int, segmented_vector> r;
+    for (int i = 0; i < 300; ++i)
+        r.emplace_back(i);
+
+    r.pop_front();
+    REQUIRE(r.size() == 299);
+    REQUIRE(r[0] == 1);
+    REQUIRE(r[-1] == 299);
+}
+
+TEST_CASE("ring.segmented.insert")
+{
+    auto constexpr SegmentSize = segmented_vector<int>::segment_size;
+    auto constexpr Size = 3 * SegmentSize + 10;
+
+    // Whole segments are inserted at the next segment boundary, other counts take the slow path.
+    for (auto const count: { SegmentSize, 2 * SegmentSize, size_t { 5 } })
+        for (auto const zero: { 0, 100, 600, 700, 3 * 256 + 9 })
+            for (auto const offset: { 1L, 20L, 300L, 3 * 256L + 10 })
+            {
+                INFO(fmt::format("count {}, zero {}, offset {}", count, zero, offset));
+                ring<int, segmented_vector> r;
+                for (int i = 0; i < static_cast<int>(Size); ++i)
+                    r.emplace_back(i);
+                r.rotate_left(static_cast<size_t>(zero));
+
+                r.insert(offset, count, -1);
+
+                // Offsets below the inserted elements, as well as negative ones, are kept.
+                auto const expected = [&](long i) {
+                    return static_cast<int>((static_cast<long>(zero + Size) + i) % static_cast<long>(Size));
+                };
+                REQUIRE(r.size() == Size + count);
+                for (long i = 0; i < offset; ++i)
+                    REQUIRE(r[i] == expected(i));
+                for (long i = offset; i < offset + static_cast<long>(count); ++i)
+                    REQUIRE(r[i] == -1);
+                for (long i = 1; i <= static_cast<long>(Size) - offset; ++i)
+                    REQUIRE(r[-i] == expected(-i));
+            }
+}
@@ -0,0 +1,282 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace crispy
+{
+
+template <typename T, typename Container>
+struct SegmentedIterator;
+
+/**
+ * Dynamic array of T, stored in fixed-size segments of a power-of-two number of elements.
+ *
+ * Elements are addressed by shift and mask. Appending and removing at the end (push_back,
+ * emplace_back, pop_back, resize) only allocates or releases the segment at the end,
+ * so references to all other elements stay valid, unlike with std::vector.
+ *
+ * insert() and erase() however move element values across segments: references to elements
+ * at or behind the position (up to the end, or up to the next segment boundary when inserting
+ * whole segments) then refer to different values, and erase() invalidates the last element.
+ * clear() invalidates all references.
+ *
+ * This is meant as a drop-in replacement for std::vector as the storage of crispy::ring,
+ * for containers too large to be reallocated and copied as a whole.
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class segmented_vector // NOLINT(readability-identifier-naming)
+{
+  public:
+    static constexpr std::size_t segment_shift = 8;
+    static constexpr std::size_t segment_size = std::size_t { 1 } << segment_shift;
+    static constexpr std::size_t segment_mask = segment_size - 1;
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = long;
+    using reference = T&;
+    using const_reference = T const&;
+    using iterator = SegmentedIterator<T, segmented_vector>;
+    using const_iterator = SegmentedIterator<T const, segmented_vector const>;
+
+    segmented_vector() = default;
+    segmented_vector(size_type count, T const& value) { resize(count, value); }
+    explicit segmented_vector(size_type count) { resize(count); }
+
+    segmented_vector(segmented_vector const& other) { *this = other; }
+    segmented_vector& operator=(segmented_vector const& other)
+    {
+        if (this == &other)
+            return *this;
+        clear();
+        reserve(other.size());
+        for (auto const& value: other)
+            push_back(value);
+        return *this;
+    }
+
+    segmented_vector(segmented_vector&&) noexcept = default;
+    segmented_vector& operator=(segmented_vector&&) noexcept = default;
+    ~segmented_vector() = default;
+
+    [[nodiscard]] size_type size() const noexcept { return _size; }
+    [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+    [[nodiscard]] size_type capacity() const noexcept { return _segments.size() * segment_size; }
+
+    [[nodiscard]] reference operator[](size_type i) noexcept
+    {
+        return _segments[i >> segment_shift][i & segment_mask];
+    }
+
+    [[nodiscard]] const_reference operator[](size_type i) const noexcept
+    {
+        return _segments[i >> segment_shift][i & segment_mask];
+    }
+
+    [[nodiscard]] reference front() noexcept { return (*this)[0]; }
+    [[nodiscard]] const_reference front() const noexcept { return (*this)[0]; }
+    [[nodiscard]] reference back() noexcept { return _segments.back().back(); }
+    [[nodiscard]] const_reference back() const noexcept { return _segments.back().back(); }
+
+    [[nodiscard]] iterator begin() noexcept { return iterator { this, 0 }; }
+    [[nodiscard]] iterator end() noexcept { return iterator { this, static_cast<difference_type>(_size) }; }
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator { this, 0 }; }
+    [[nodiscard]] const_iterator end() const noexcept
+    {
+        return const_iterator { this, static_cast<difference_type>(_size) };
+    }
+
+    /// Reserves the segment table only, as segments are allocated as they are needed.
+    void reserve(size_type count) { _segments.reserve((count + segment_mask) >> segment_shift); }
+
+    void resize(size_type count)
+    {
+        while (_size > count)
+            pop_back();
+        while (_size < count)
+            emplace_back();
+    }
+
+    void resize(size_type count, T const& value)
+    {
+        while (_size > count)
+            pop_back();
+        while (_size < count)
+            push_back(value);
+    }
+
+    void clear() noexcept
+    {
+        _segments.clear();
+        _size = 0;
+    }
+
+    void push_back(T const& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        if (_size == capacity())
+        {
+            // The segment's capacity is reserved up front, so that its elements are never relocated.
+            _segments.emplace_back();
+            _segments.back().reserve(segment_size);
+        }
+        auto& value = _segments.back().emplace_back(std::forward<Args>(args)...);
+        ++_size;
+        return value;
+    }
+
+    void pop_back()
+    {
+        _segments.back().pop_back();
+        if (_segments.back().empty())
+            _segments.pop_back();
+        --_size;
+    }
+
+    /// Inserts @p count copies of @p value before @p pos.
+    ///
+    /// If @p count is a whole number of segments, these are inserted into the segment table at the
+    /// segment boundary following @p pos, such that only the elements up to that boundary are moved,
+    /// rather than all elements behind @p pos.
+    iterator insert(iterator pos, size_type count, T const& value)
+    {
+        auto const index = static_cast<size_type>(pos.current);
+        auto const boundary = (index + segment_mask) & ~segment_mask;
+        if ((count & segment_mask) != 0 || boundary > _size)
+        {
+            auto const oldSize = _size;
+            for (size_type i = 0; i < count; ++i)
+                emplace_back(value);
+            std::rotate(std::next(begin(), pos.current), begin() + static_cast<long>(oldSize), end());
+            return pos;
+        }
+
+        auto const segmentCount = count >> segment_shift;
+        auto const segmentIndex = static_cast<long>(boundary >> segment_shift);
+        auto const newSegments =
+            _segments.insert(std::next(_segments.begin(), segmentIndex), segmentCount, Segment {});
+        for (auto i = newSegments; i != std::next(newSegments, static_cast<long>(segmentCount)); ++i)
+        {
+            i->reserve(segment_size);
+            i->assign(segment_size, value);
+        }
+        _size += count;
+
+        // Moves the elements between pos and the boundary behind the inserted ones.
+        for (auto i = index; i < boundary; ++i)
+            std::swap((*this)[i], (*this)[i + count]);
+
+        return pos;
+    }
+
+    iterator erase(iterator pos)
+    {
+        std::move(std::next(pos), end(), pos);
+        pop_back();
+        return pos;
+    }
+
+  private:
+    using Segment = std::vector<T, Allocator>;
+    using SegmentAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Segment>;
+
+    std::vector<Segment, SegmentAllocator> _segments;
+    size_type _size = 0;
+};
+
+template <typename T, typename Container>
+struct SegmentedIterator
+{
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<T>;
+    using difference_type = long;
+    using pointer = T*;
+    using reference = T&;
+
+    Container* container {};
+    difference_type current {};
+
+    SegmentedIterator() = default;
+    SegmentedIterator(Container* aContainer, difference_type aCurrent):
+        container { aContainer }, current { aCurrent }
+    {
+    }
+
+    SegmentedIterator& operator++() noexcept
+    {
+        ++current;
+        return *this;
+    }
+
+    SegmentedIterator operator++(int) noexcept
+    {
+        auto old = *this;
+        ++current;
+        return old;
+    }
+
+    SegmentedIterator& operator--() noexcept
+    {
+        --current;
+        return *this;
+    }
+
+    SegmentedIterator operator--(int) noexcept
+    {
+        auto old = *this;
+        --current;
+        return old;
+    }
+
+    SegmentedIterator& operator+=(difference_type n) noexcept
+    {
+        current += n;
+        return *this;
+    }
+
+    SegmentedIterator& operator-=(difference_type n) noexcept
+    {
+        current -= n;
+        return *this;
+    }
+
+    SegmentedIterator operator+(difference_type n) const noexcept { return { container, current + n }; }
+    SegmentedIterator operator-(difference_type n) const noexcept { return { container, current - n }; }
+    difference_type operator-(SegmentedIterator const& rhs) const noexcept { return current - rhs.current; }
+
+    friend SegmentedIterator operator+(difference_type n, SegmentedIterator a) { return a + n; }
+
+    bool operator==(SegmentedIterator const& rhs) const noexcept { return current == rhs.current; }
+    bool operator!=(SegmentedIterator const& rhs) const noexcept { return current != rhs.current; }
+    bool operator<(SegmentedIterator const& rhs) const noexcept { return current < rhs.current; }
+    bool operator>(SegmentedIterator const& rhs) const noexcept { return current > rhs.current; }
+    bool operator<=(SegmentedIterator const& rhs) const noexcept { return current <= rhs.current; }
+    bool operator>=(SegmentedIterator const& rhs) const noexcept { return current >= rhs.current; }
+
+    T& operator*() const noexcept { return (*container)[static_cast<std::size_t>(current)]; }
+    T* operator->() const noexcept { return &(*container)[static_cast<std::size_t>(current)]; }
+    T& operator[](difference_type n) const noexcept { return *(*this + n); }
+};
+
+} // namespace crispy
@@ -0,0 +1,245 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/ColdLineChunk.h>
+
+#include <crispy/assert.h>
+#include <crispy/compress.h>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+using std::string;
+using std::vector;
+
+namespace terminal
+{
+
+namespace
+{
+    // A chunk decompresses into the metadata of all of its lines, followed by the text of all of its lines.
+    //
+    // chunk     := metadataSize:u32 line* text
+    // line      := kind:u8 displayWidth usedColumns (trivial | attributed)
+    // trivial   := textAttributes fillAttributes hyperlink textSize
+    // attributed:= fillAttributes runCount (columns attributes hyperlink textSize)*
+    //
+    // with all numbers but metadataSize being variable-length encoded, and attributes copied as is.
+    // The text of each line (or run) directly follows the one of the preceding line (or run).
+
+    enum class LineKind : uint8_t
+    {
+        Trivial = 0,
+        Attributed = 1,
+    };
+
+    static_assert(std::is_trivially_copyable_v<GraphicsAttributes>);
+
+    class Writer
+    {
+      public:
+        void number(uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                _metadata.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            _metadata.push_back(static_cast<uint8_t>(value));
+        }
+
+        void attributes(GraphicsAttributes const& value)
+        {
+            auto const* bytes = reinterpret_cast<uint8_t const*>(&value);
+            _metadata.insert(_metadata.end(), bytes, bytes + sizeof(value));
+        }
+
+        void text(std::string_view value)
+        {
+            number(value.size());
+            _text += value;
+        }
+
+        void line(TrivialLineBuffer const& buffer)
+        {
+            _metadata.push_back(static_cast<uint8_t>(LineKind::Trivial));
+            number(unbox<uint64_t>(buffer.displayWidth));
+            number(unbox<uint64_t>(buffer.usedColumns));
+            attributes(buffer.textAttributes);
+            attributes(buffer.fillAttributes);
+            number(unbox<uint64_t>(buffer.hyperlink));
+            text(buffer.text.view());
+        }
+
+        void line(AttributedLineBuffer const& buffer)
+        {
+            _metadata.push_back(static_cast<uint8_t>(LineKind::Attributed));
+            number(unbox<uint64_t>(buffer.displayWidth));
+            number(unbox<uint64_t>(buffer.usedColumns));
+            attributes(buffer.fillAttributes);
+            number(buffer.runs.size());
+            for (auto const& run: buffer.runs)
+            {
+                number(unbox<uint64_t>(run.columns));
+                attributes(run.attributes);
+                number(unbox<uint64_t>(run.hyperlink));
+                text(run.text.view());
+            }
+        }
+
+        [[nodiscard]] vector<uint8_t> finish() const
+        {
+            auto const metadataSize = static_cast<uint32_t>(_metadata.size());
+            auto block = vector<uint8_t>(sizeof(metadataSize));
+            std::memcpy(block.data(), &metadataSize, sizeof(metadataSize));
+            block.insert(block.end(), _metadata.begin(), _metadata.end());
+            block.insert(block.end(), _text.begin(), _text.end());
+            return block;
+        }
+
+      private:
+        vector<uint8_t> _metadata;
+        string _text;
+    };
+
+    class Reader
+    {
+      public:
+        explicit Reader(crispy::BufferObjectPtr<char> block): _block { std::move(block) }
+        {
+            auto metadataSize = uint32_t { 0 };
+            std::memcpy(&metadataSize, _block->data(), sizeof(metadataSize));
+            _metadata = sizeof(metadataSize);
+            _text = _metadata + metadataSize;
+        }
+
+        uint64_t number() noexcept
+        {
+            auto value = uint64_t { 0 };
+            auto shift = 0u;
+            auto byte = uint8_t { 0x80 };
+            while (byte & 0x80)
+            {
+                byte = static_cast<uint8_t>(_block->data()[_metadata++]);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                shift += 7;
+            }
+            return value;
+        }
+
+        GraphicsAttributes attributes() noexcept
+        {
+            auto value = GraphicsAttributes {};
+            std::memcpy(&value, _block->data() + _metadata, sizeof(value));
+            _metadata += sizeof(value);
+            return value;
+        }
+
+        crispy::BufferFragment<char> text(bool skip)
+        {
+            auto const size = static_cast<size_t>(number());
+            auto fragment = skip ? crispy::BufferFragment<char> {} : _block->ref(_text, size);
+            _text += size;
+            return fragment;
+        }
+
+        /// Reads the next line, or only skips it if @p skip is set.
+        PackedLineBuffer line(bool skip)
+        {
+            auto const kind = static_cast<LineKind>(_block->data()[_metadata++]);
+            auto const displayWidth = ColumnCount::cast_from(number());
+            auto const usedColumns = ColumnCount::cast_from(number());
+
+            if (kind == LineKind::Trivial)
+            {
+                auto buffer = TrivialLineBuffer { displayWidth, attributes(), attributes() };
+                buffer.hyperlink = HyperlinkId::cast_from(number());
+                buffer.usedColumns = usedColumns;
+                buffer.text = text(skip);
+                return buffer;
+            }
+
+            auto buffer = AttributedLineBuffer { displayWidth, attributes(), usedColumns };
+            auto const runCount = static_cast<size_t>(number());
+            if (!skip)
+                buffer.runs.reserve(runCount);
+            for (size_t i = 0; i < runCount; ++i)
+            {
+                auto run = AttributedLineRun { ColumnCount::cast_from(number()), attributes() };
+                run.hyperlink = HyperlinkId::cast_from(number());
+                run.text = text(skip);
+                if (!skip)
+                    buffer.runs.emplace_back(std::move(run));
+            }
+            return buffer;
+        }
+
+      private:
+        crispy::BufferObjectPtr<char> _block;
+        size_t _metadata = 0;
+        size_t _text = 0;
+    };
+} // namespace
+
+vector<uint8_t> serializeLines(gsl::span<PackedLineBuffer const> lines)
+{
+    auto writer = Writer {};
+    for (auto const& line: lines)
+        std::visit([&](auto const& buffer) { writer.line(buffer); }, line);
+    return writer.finish();
+}
+
+PackedLineBuffer deserializeLine(crispy::BufferObjectPtr<char> block, size_t index)
+{
+    auto reader = Reader { std::move(block) };
+    for (size_t i = 0; i < index; ++i)
+        reader.line(true);
+    return reader.line(false);
+}
+
+std::shared_ptr<ColdLineChunk const> ColdLineChunk::create(gsl::span<PackedLineBuffer const> lines)
+{
+    Require(lines.size() <= MaxLines);
+
+    auto const block = serializeLines(lines);
+
+    // NB: std::make_shared cannot access the private constructor.
+    auto chunk = std::shared_ptr<ColdLineChunk>(new ColdLineChunk());
+    chunk->_compressed = crispy::compress(block);
+    chunk->_compressed.shrink_to_fit();
+    chunk->_uncompressedSize = static_cast<uint32_t>(block.size());
+    chunk->_lineCount = static_cast<uint32_t>(lines.size());
+    return chunk;
+}
+
+PackedLineBuffer ColdLineChunk::unpack(size_t index) const
+{
+    Require(index < _lineCount);
+
+    auto const _ = std::lock_guard { _mutex };
+    auto block = _decompressed.lock();
+    if (!block)
+    {
+        block = crispy::BufferObject<char>::create(_uncompressedSize);
+        auto const output = gsl::span<uint8_t>(reinterpret_cast<uint8_t*>(block->data()), _uncompressedSize);
+        auto const decompressed = crispy::decompress(_compressed, output);
+        Guarantee(decompressed);
+        block->advance(_uncompressedSize);
+        _decompressed = block;
+    }
+
+    return deserializeLine(std::move(block), index);
+}
+
+} // namespace terminal
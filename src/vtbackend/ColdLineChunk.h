@@ -0,0 +1,81 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vtbackend/Line.h>
+
+#include <crispy/BufferObject.h>
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace terminal
+{
+
+/// Serializes the given lines into a single block of their text and their runs of SGR attributes
+/// and hyperlinks, as stored (compressed) by ColdLineChunk.
+[[nodiscard]] std::vector<uint8_t> serializeLines(gsl::span<PackedLineBuffer const> lines);
+
+/// Deserializes the line at the given index of a block created by serializeLines().
+///
+/// The text of the returned line refers to the given block.
+[[nodiscard]] PackedLineBuffer deserializeLine(crispy::BufferObjectPtr<char> block, size_t index);
+
+/**
+ * Block of compressed history lines, the cold tier of the grid's history.
+ *
+ * Each line is serialized into its UTF-8 text and its runs of SGR attributes and hyperlinks.
+ * All lines of a chunk are compressed together, and decompressed together again as soon as
+ * any of them is accessed.
+ */
+class ColdLineChunk
+{
+  public:
+    /// Maximum number of lines packed into a single chunk.
+    static constexpr size_t MaxLines = 64;
+
+    /// Serializes and compresses the given lines into a new chunk.
+    [[nodiscard]] static std::shared_ptr<ColdLineChunk const> create(gsl::span<PackedLineBuffer const> lines);
+
+    [[nodiscard]] size_t lineCount() const noexcept { return _lineCount; }
+
+    /// @returns the number of bytes of the compressed lines.
+    [[nodiscard]] size_t compressedSize() const noexcept { return _compressed.size(); }
+
+    /// @returns the number of bytes of the serialized lines.
+    [[nodiscard]] size_t uncompressedSize() const noexcept { return _uncompressedSize; }
+
+    /// Unpacks the line at the given index.
+    ///
+    /// The text of the unpacked line refers to the decompressed chunk, which is shared
+    /// with all other lines of this chunk unpacked while it is still in use.
+    /// Lines of the same chunk may be unpacked on different threads.
+    [[nodiscard]] PackedLineBuffer unpack(size_t index) const;
+
+  private:
+    ColdLineChunk() = default;
+
+    std::vector<uint8_t> _compressed;
+    uint32_t _uncompressedSize = 0;
+    uint32_t _lineCount = 0;
+
+    mutable std::mutex _mutex; // guards _decompressed
+    mutable std::weak_ptr<crispy::BufferObject<char>> _decompressed;
+};
+
+} // namespace terminal
@@ -44,32 +44,174 @@ using std::stringstream;
 namespace terminal
 {
 
-FunctionDefinition const* select(FunctionSelector const& selector) noexcept
+namespace
 {
-    auto static const& funcs = functions();
+    // {{{ constant-time function lookup
+    //
+    // ESC, CSI and DCS functions are looked up by their (category, final, leader, intermediate) tuple,
+    // packed into a small integer that directly indexes a bucket of candidates.
+    // The candidates of a bucket only differ in their number of parameters.
+    //
+    // OSC functions are looked up directly by their numeric code, and C0 functions by their final symbol.
+
+    constexpr size_t CategoryCount = 3;      // ESC, CSI, DCS
+    constexpr size_t FinalCount = 0x4F;      // 0x30 .. 0x7E
+    constexpr size_t LeaderCount = 5;        // none, 0x3C .. 0x3F
+    constexpr size_t IntermediateCount = 17; // none, 0x20 .. 0x2F
+    constexpr size_t KeyCount = CategoryCount * FinalCount * LeaderCount * IntermediateCount;
+    constexpr size_t C0Count = 0x20;
+
+    /// Marks the absence of a function in the direct-indexed tables.
+    constexpr uint8_t NoFunction = 0xFF;
+
+    static_assert(functions().size() < NoFunction, "Function indices must fit into the lookup tables.");
+
+    /// Packs the given selector fields into a bucket index.
+    ///
+    /// @returns the bucket index or KeyCount if no function can exist for the given fields.
+    constexpr size_t packKey(FunctionCategory category,
+                             char leader,
+                             char intermediate,
+                             char finalSymbol) noexcept
+    {
+        auto const categoryIndex = [&]() -> size_t {
+            switch (category)
+            {
+                case FunctionCategory::ESC: return 0;
+                case FunctionCategory::CSI: return 1;
+                case FunctionCategory::DCS: return 2;
+                default: return CategoryCount;
+            }
+        }();
+        auto const finalIndex = static_cast<size_t>(static_cast<uint8_t>(finalSymbol)) - 0x30;
+        auto const leaderIndex = leader ? static_cast<size_t>(static_cast<uint8_t>(leader)) - 0x3C + 1 : 0;
+        auto const intermediateIndex =
+            intermediate ? static_cast<size_t>(static_cast<uint8_t>(intermediate)) - 0x20 + 1 : 0;
 
-    // std::cout << fmt::format("select: {}\n", selector);
+        // Out of range values wrapped around above, so they all fail the upper bound checks.
+        if (categoryIndex >= CategoryCount || finalIndex >= FinalCount || leaderIndex >= LeaderCount
+            || intermediateIndex >= IntermediateCount)
+            return KeyCount;
 
-    auto a = size_t { 0 };
-    auto b = funcs.size() - 1;
-    while (a <= b)
+        return ((categoryIndex * FinalCount + finalIndex) * LeaderCount + leaderIndex) * IntermediateCount
+               + intermediateIndex;
+    }
+
+    constexpr size_t packKey(FunctionDefinition const& f) noexcept
+    {
+        return packKey(f.category, f.leader, f.intermediate, f.finalSymbol);
+    }
+
+    constexpr size_t maxOSCode() noexcept
     {
-        auto const i = (a + b) / 2;
-        auto const& I = funcs[i];
-        auto const rel = compare(selector, I);
-        // std::cout << fmt::format(" - a:{:>2} b:{:>2} i:{} rel:{} I: {}\n", a, b, i, rel < 0 ? '<' : rel > 0
-        // ? '>' : '=', I);
-        if (rel > 0)
-            a = i + 1;
-        else if (rel < 0)
+        auto result = size_t { 0 };
+        for (auto const& f: functions())
+            if (f.category == FunctionCategory::OSC)
+                result = std::max(result, static_cast<size_t>(f.maximumParameters));
+        return result;
+    }
+
+    struct FunctionLookupTable
+    {
+        /// Bucket k consists of candidates[buckets[k] .. buckets[k + 1]].
+        std::array<uint8_t, KeyCount + 1> buckets {};
+
+        /// Indices into functions(), grouped by bucket, in the order of functions().
+        std::array<uint8_t, functions().size()> candidates {};
+
+        /// Maps an OSC code to the index into functions().
+        std::array<uint8_t, maxOSCode() + 1> osc {};
+
+        /// Maps a C0 final symbol to the index into functions().
+        std::array<uint8_t, C0Count> c0 {};
+    };
+
+    constexpr FunctionLookupTable createLookupTable() noexcept
+    {
+        auto const& funcs = functions();
+        auto table = FunctionLookupTable {};
+
+        for (auto& index: table.osc)
+            index = NoFunction;
+        for (auto& index: table.c0)
+            index = NoFunction;
+
+        // Counting sort of the function indices by bucket.
+        for (auto const& f: funcs)
+            if (auto const key = packKey(f); key != KeyCount)
+                ++table.buckets[key + 1];
+        for (size_t key = 0; key < KeyCount; ++key)
+            table.buckets[key + 1] += table.buckets[key];
+
+        auto fill = table.buckets;
+        for (size_t i = 0; i < funcs.size(); ++i)
         {
-            if (i == 0)
-                return nullptr;
-            b = i - 1;
+            auto const& f = funcs[i];
+            switch (f.category)
+            {
+                case FunctionCategory::C0: table.c0[static_cast<uint8_t>(f.finalSymbol)] = uint8_t(i); break;
+                case FunctionCategory::OSC: table.osc[f.maximumParameters] = uint8_t(i); break;
+                default: table.candidates[fill[packKey(f)]++] = uint8_t(i); break;
+            }
         }
-        else
-            return &I;
+
+        return table;
+    }
+
+    constexpr bool isSelectable(FunctionDefinition const& f) noexcept
+    {
+        switch (f.category)
+        {
+            case FunctionCategory::C0: return static_cast<uint8_t>(f.finalSymbol) < C0Count;
+            case FunctionCategory::OSC: return true;
+            default: return packKey(f) != KeyCount;
+        }
+    }
+
+    static_assert(std::all_of(functions().begin(), functions().end(), isSelectable),
+                  "All functions must be reachable through the lookup table.");
+
+    constexpr auto LookupTable = createLookupTable();
+
+    [[nodiscard]] FunctionDefinition const* selectByIndex(FunctionSelector const& selector,
+                                                          uint8_t index) noexcept
+    {
+        if (index == NoFunction)
+            return nullptr;
+
+        auto const& f = functions()[index];
+        return compare(selector, f) == 0 ? &f : nullptr;
     }
+    // }}}
+} // namespace
+
+FunctionDefinition const* select(FunctionSelector const& selector) noexcept
+{
+    switch (selector.category)
+    {
+        case FunctionCategory::C0:
+            if (static_cast<uint8_t>(selector.finalSymbol) >= C0Count)
+                return nullptr;
+            return selectByIndex(selector, LookupTable.c0[static_cast<uint8_t>(selector.finalSymbol)]);
+        case FunctionCategory::OSC:
+            if (selector.argc < 0 || static_cast<size_t>(selector.argc) >= LookupTable.osc.size())
+                return nullptr;
+            return selectByIndex(selector, LookupTable.osc[static_cast<size_t>(selector.argc)]);
+        case FunctionCategory::ESC:
+        case FunctionCategory::CSI:
+        case FunctionCategory::DCS: break;
+    }
+
+    auto const key =
+        packKey(selector.category, selector.leader, selector.intermediate, selector.finalSymbol);
+    if (key == KeyCount)
+        return nullptr;
+
+    // The candidates only differ in the number of parameters they accept.
+    for (auto i = LookupTable.buckets[key]; i != LookupTable.buckets[key + 1]; ++i)
+        if (auto const* f = selectByIndex(selector, LookupTable.candidates[i]))
+            return f;
+
     return nullptr;
 }
 
@@ -21,6 +21,7 @@
 #include <fmt/format.h>
 
 #include <array>
+#include <cassert>
 #include <optional>
 #include <string>
 #include <vector>
@@ -473,9 +474,9 @@ constexpr inline auto CaptureBufferCode = 314;
 
 // clang-format on
 
-inline auto const& functions() noexcept
+namespace detail
 {
-    static auto const funcs = []() constexpr { // {{{
+    constexpr inline auto AllFunctions = []() constexpr { // {{{
         auto f = std::array {
             // C0
             EOT,
@@ -621,6 +622,12 @@ inline auto const& functions() noexcept
         });
         return f;
     }(); // }}}
+} // namespace detail
+
+/// @returns all known functions, sorted by category, final symbol, leader, intermediate and parameter count.
+constexpr inline auto const& functions() noexcept
+{
+    auto const& funcs = detail::AllFunctions;
 
 #if 0
     for (auto [a, b] : crispy::indexed(funcs))
@@ -630,6 +637,16 @@ inline auto const& functions() noexcept
     return funcs;
 }
 
+/// @returns the dense index of the given function within functions(), e.g. for indexing flat tables.
+///
+/// @p function must refer to an element of functions(), such as returned by select().
+inline size_t functionIndex(FunctionDefinition const& function) noexcept
+{
+    auto const index = static_cast<size_t>(&function - functions().data());
+    assert(index < functions().size());
+    return index;
+}
+
 /// Selects a FunctionDefinition based on a FunctionSelector.
 ///
 /// @return the matching FunctionDefinition or nullptr if none matched.
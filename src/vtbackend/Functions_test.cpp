@@ -29,6 +29,34 @@ inline std::ostream& operator<<(std::ostream& os, FunctionDefinition const& f)
 using namespace std;
 using namespace terminal;
 
+namespace
+{
+// The binary search select() used before the constant-time lookup table, as a reference.
+FunctionDefinition const* selectByBinarySearch(FunctionSelector const& selector) noexcept
+{
+    auto const& funcs = functions();
+
+    auto a = size_t { 0 };
+    auto b = funcs.size() - 1;
+    while (a <= b)
+    {
+        auto const i = (a + b) / 2;
+        auto const rel = compare(selector, funcs[i]);
+        if (rel > 0)
+            a = i + 1;
+        else if (rel < 0)
+        {
+            if (i == 0)
+                return nullptr;
+            b = i - 1;
+        }
+        else
+            return &funcs[i];
+    }
+    return nullptr;
+}
+} // namespace
+
 TEST_CASE("Functions.SCOSC", "[Functions]")
 {
     FunctionDefinition const* f = terminal::selectControl(0, 0, 0, 's');
@@ -71,3 +99,44 @@ TEST_CASE("Functions.OSC777", "[Functions]")
     REQUIRE(osc);
     CHECK(*osc == NOTIFY);
 }
+
+TEST_CASE("Functions.select_all", "[Functions]")
+{
+    // Every function in the table must be found again by select() for all its accepted parameter counts,
+    // as the very same definition the binary search found, including functions whose ranges of
+    // parameter counts overlap with another one's. Parameter counts out of range must not match either.
+    for (FunctionDefinition const& function: functions())
+    {
+        auto const isOSC = function.category == FunctionCategory::OSC;
+        for (int argc = 0; argc <= (isOSC ? 0 : 32); ++argc)
+        {
+            auto const selector = FunctionSelector {
+                function.category,
+                function.leader,
+                isOSC ? function.maximumParameters : argc,
+                function.intermediate,
+                function.finalSymbol,
+            };
+            INFO(fmt::format("{} with {} parameters", function, argc));
+            FunctionDefinition const* expected = selectByBinarySearch(selector);
+            FunctionDefinition const* f = terminal::select(selector);
+            CHECK(f == expected);
+            if (isOSC || (function.minimumParameters <= argc && argc <= function.maximumParameters))
+            {
+                REQUIRE(f);
+                CHECK(compare(selector, *f) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Functions.select_unknown", "[Functions]")
+{
+    CHECK(terminal::selectControl('?', 0, '/', 'm') == nullptr);
+    CHECK(terminal::selectControl(0, 0, 0, '\x7F') == nullptr);
+    CHECK(terminal::selectEscape(0, '\x01') == nullptr);
+    CHECK(terminal::selectOSCommand(-1) == nullptr);
+    CHECK(terminal::selectOSCommand(5) == nullptr);
+    CHECK(terminal::selectOSCommand(100000) == nullptr);
+    CHECK(terminal::select({ FunctionCategory::C0, 0, 0, 0, '\x7F' }) == nullptr);
+}
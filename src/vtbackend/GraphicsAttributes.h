@@ -16,6 +16,7 @@
 #include <vtbackend/CellFlags.h>
 #include <vtbackend/Color.h>
 
+#include <optional>
 #include <type_traits>
 #include <utility>
 
@@ -44,4 +45,58 @@ constexpr bool operator!=(GraphicsAttributes const& a, GraphicsAttributes const&
     return !(a == b);
 }
 
+/// Precompiled change to GraphicsAttributes, such as described by all parameters of a single SGR.
+///
+/// Applying the delta once is equivalent to applying each of the described changes one after another.
+struct GraphicsAttributesDelta
+{
+    /// Resets all attributes before applying the remaining changes.
+    bool reset = false;
+
+    /// Flags to be cleared, before setFlags are being set.
+    CellFlags clearFlags {};
+    CellFlags setFlags {};
+
+    std::optional<Color> foregroundColor {};
+    std::optional<Color> backgroundColor {};
+    std::optional<Color> underlineColor {};
+
+    /// Appends a reset of all attributes, discarding any prior changes.
+    constexpr void resetAll() noexcept
+    {
+        *this = GraphicsAttributesDelta {};
+        reset = true;
+    }
+
+    /// Appends a change of flags, first clearing @p clear and then setting @p set.
+    constexpr void changeFlags(CellFlags clear, CellFlags set) noexcept
+    {
+        clearFlags |= clear;
+        setFlags &= ~clear;
+        setFlags |= set;
+    }
+
+    [[nodiscard]] constexpr CellFlags applyTo(CellFlags flags) const noexcept
+    {
+        if (reset)
+            flags = CellFlags::None;
+        flags &= ~clearFlags;
+        flags |= setFlags;
+        return flags;
+    }
+
+    constexpr void applyTo(GraphicsAttributes& attributes) const noexcept
+    {
+        if (reset)
+            attributes = GraphicsAttributes {};
+        attributes.flags = applyTo(attributes.flags);
+        if (foregroundColor)
+            attributes.foregroundColor = *foregroundColor;
+        if (backgroundColor)
+            attributes.backgroundColor = *backgroundColor;
+        if (underlineColor)
+            attributes.underlineColor = *underlineColor;
+    }
+};
+
 } // namespace terminal
@@ -11,6 +11,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtbackend/ColdLineChunk.h>
 #include <vtbackend/Grid.h>
 #include <vtbackend/primitives.h>
 
@@ -20,7 +21,15 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 
 using std::max;
 using std::min;
@@ -36,6 +45,21 @@ auto const inline GridLog = logstore::Category(
 
 namespace detail
 {
+    /// Number of lines read from the history file to be kept in memory, for rendering and
+    /// otherwise accessing them repeatedly.
+    constexpr size_t HistoryFileCacheSize = 1024;
+
+    /// Number of history lines right above the main page that are reflowed along with it on resize,
+    /// with any older history line being reflowed on demand.
+    constexpr auto EagerReflowLineCount = LineCount(1000);
+
+    /// Minimum number of unreflowed history lines for reflowing all of these on multiple threads.
+    constexpr size_t ParallelReflowMinLineCount = 4096;
+
+    /// Number of chunks of unreflowed history lines per thread reflowing these,
+    /// such that threads done early take over the remaining chunks.
+    constexpr size_t ReflowChunksPerThread = 4;
+
     template <typename... Args>
     void logf([[maybe_unused]] Args&&... args)
     {
@@ -45,6 +69,22 @@ namespace detail
 #endif
     }
 
+    /// Invokes @p visit with each fragment of text of the given line.
+    ///
+    /// Cold lines are skipped rather than unpacked, as they do not refer to any text buffer object.
+    template <typename LineT, typename Visitor>
+    void visitTextFragments(LineT& line, Visitor visit)
+    {
+        if (line.isColdBuffer())
+            return;
+
+        if (line.isTrivialBuffer())
+            visit(line.trivialBuffer().text);
+        else if (line.isAttributedBuffer())
+            for (auto& run: line.attributedBuffer().runs)
+                visit(run.text);
+    }
+
     template <typename Cell>
     gsl::span<Cell> trimRight(gsl::span<Cell> cells)
     {
@@ -54,14 +94,12 @@ namespace detail
         return cells.subspan(0, n);
     }
 
+    /// Creates the lines of the main page only, as history lines are allocated on demand.
     template <typename Cell>
-    Lines<Cell> createLines(PageSize pageSize,
-                            LineCount maxHistoryLineCount,
-                            bool reflowOnResize,
-                            GraphicsAttributes initialSGR)
+    Lines<Cell> createLines(PageSize pageSize, bool reflowOnResize, GraphicsAttributes initialSGR)
     {
         auto const defaultLineFlags = reflowOnResize ? LineFlags::Wrappable : LineFlags::None;
-        auto const totalLineCount = unbox<size_t>(pageSize.lines + maxHistoryLineCount);
+        auto const totalLineCount = unbox<size_t>(pageSize.lines);
 
         Lines<Cell> lines;
         lines.reserve(totalLineCount);
@@ -83,16 +121,17 @@ namespace detail
      *
      * @returns number of inserted lines
      */
-    template <typename Cell>
+    template <typename TargetLines>
     LineCount addNewWrappedLines(
-        Lines<Cell>& targetLines,
+        TargetLines& targetLines,
         ColumnCount newColumnCount,
-        typename Line<Cell>::InflatedBuffer&& logicalLineBuffer, // TODO: don't move, do (c)ref instead
+        typename TargetLines::value_type::InflatedBuffer&&
+            logicalLineBuffer, // TODO: don't move, do (c)ref instead
         LineFlags baseFlags,
         bool initialNoWrap // TODO: pass `LineFlags defaultLineFlags` instead?
     )
     {
-        using LineBuffer = typename Line<Cell>::InflatedBuffer;
+        using LineBuffer = typename TargetLines::value_type::InflatedBuffer;
 
         // TODO: avoid unnecessary copies via erase() by incrementally updating (from, to)
         int i = 0;
@@ -117,6 +156,172 @@ namespace detail
         return LineCount::cast_from(i);
     }
 
+    /// Joins the text of the given trivial @p lines, making up a logical line, without copying it
+    /// if the text of all lines is adjacent in the same buffer object (such as when written at once).
+    ///
+    /// @returns nothing if any of the lines is not a trivial line, their text differs in attributes,
+    ///          or any but the last line has not been written up to its end before wrapping.
+    template <typename Cell>
+    std::optional<TrivialLineBuffer> joinTrivialLines(gsl::span<Line<Cell> const> lines)
+    {
+        auto const& first = lines.front();
+        if (!first.isTrivialBuffer())
+            return std::nullopt;
+
+        auto joined = TrivialLineBuffer { first.trivialBuffer() };
+        auto textSize = joined.text.size();
+        auto adjacent = true;
+        for (auto i = size_t { 1 }; i < lines.size(); ++i)
+        {
+            if (!lines[i].isTrivialBuffer())
+                return std::nullopt;
+
+            auto const& previous = lines[i - 1].trivialBuffer();
+            auto const& buffer = lines[i].trivialBuffer();
+            if (previous.usedColumns != previous.displayWidth
+                || buffer.textAttributes != joined.textAttributes || buffer.hyperlink != joined.hyperlink)
+                return std::nullopt;
+
+            adjacent = adjacent
+                       && (buffer.text.empty()
+                           || (buffer.text.owner() == joined.text.owner()
+                               && joined.text.data() + textSize == buffer.text.data()));
+            textSize += buffer.text.size();
+            joined.usedColumns += buffer.usedColumns;
+            joined.fillAttributes = buffer.fillAttributes;
+        }
+
+        if (adjacent)
+        {
+            joined.text.growBy(textSize - joined.text.size());
+            return joined;
+        }
+
+        auto text = crispy::BufferObject<char>::create(textSize);
+        for (auto const& line: lines)
+        {
+            if (auto const& lineText = line.trivialBuffer().text; !lineText.empty())
+            {
+                text->writeAtEnd(lineText.span());
+                text->advance(lineText.size());
+            }
+        }
+        joined.text = text->ref(0, textSize);
+        return joined;
+    }
+
+    /// Reflows the logical line made of the given trivial @p lines into trivial lines referring to
+    /// slices of the same text, rather than inflating them, appending these to @p targetLines.
+    ///
+    /// @returns false, leaving @p targetLines untouched, if the lines cannot be reflowed that way.
+    template <typename Cell, typename TargetLines>
+    bool reflowTrivialLogicalLine(TargetLines& targetLines,
+                                  gsl::span<Line<Cell> const> lines,
+                                  ColumnCount newColumnCount)
+    {
+        auto const& first = lines.front();
+        if (!first.wrappable())
+            return false;
+
+        auto const joined = joinTrivialLines<Cell>(lines);
+        if (!joined)
+            return false;
+
+        auto reflowed = reflow(*joined, newColumnCount);
+        if (reflowed.empty())
+            return false;
+
+        auto const baseFlags = first.flags() & ~LineFlags::Wrapped;
+        auto wrappedFlag = first.wrapped() ? LineFlags::Wrapped : LineFlags::None;
+        for (auto& buffer: reflowed)
+        {
+            targetLines.emplace_back(baseFlags | wrappedFlag, std::move(buffer));
+            wrappedFlag = LineFlags::Wrapped;
+        }
+        return true;
+    }
+
+    /// Reflows the logical line made of the given @p lines, that is, a line followed by the lines
+    /// wrapped from it, appending the resulting lines to @p targetLines.
+    ///
+    /// The lines may be of any width, such as when written before resizing over and over.
+    template <typename Cell, typename TargetLines>
+    void reflowLogicalLine(TargetLines& targetLines, gsl::span<Line<Cell>> lines, ColumnCount newColumnCount)
+    {
+        auto& first = lines.front();
+
+        // Single trivial lines whose text fits into the new width by its bytes are kept as they are below.
+        auto const needsCutting =
+            lines.size() > 1
+            || (first.isTrivialBuffer() && first.trivialBuffer().text.size() > unbox<size_t>(newColumnCount));
+        if (needsCutting && reflowTrivialLogicalLine<Cell>(targetLines, lines, newColumnCount))
+            return;
+
+        if (lines.size() == 1)
+        {
+            // Lines fitting into the new width keep their storage.
+            auto const flags = first.inheritableFlags();
+            auto wrappedColumns = first.reflow(newColumnCount);
+            targetLines.emplace_back(std::move(first));
+            if (!wrappedColumns.empty())
+                addNewWrappedLines(targetLines, newColumnCount, std::move(wrappedColumns), flags, false);
+            return;
+        }
+
+        if (!first.wrappable())
+        {
+            for (auto& line: lines)
+            {
+                line.resize(newColumnCount);
+                targetLines.emplace_back(std::move(line));
+            }
+            return;
+        }
+
+        // All but the last line have been written up to their end before wrapping.
+        auto logicalLineBuffer = typename Line<Cell>::InflatedBuffer {};
+        for (auto const& line: lines.first(lines.size() - 1))
+            logicalLineBuffer.insert(logicalLineBuffer.end(), line.cells().begin(), line.cells().end());
+        auto const lastCells = lines.back().trim_blank_right();
+        logicalLineBuffer.insert(logicalLineBuffer.end(), lastCells.begin(), lastCells.end());
+
+        // The first line may be wrapped, too, if the lines it has been wrapped from are gone.
+        addNewWrappedLines(targetLines,
+                           newColumnCount,
+                           std::move(logicalLineBuffer),
+                           first.flags() & ~LineFlags::Wrapped,
+                           !first.wrapped());
+    }
+
+    /// Reflows the logical lines made of the given @p lines, starting with a logical line's first line,
+    /// appending the resulting lines to @p targetLines.
+    template <typename Cell, typename TargetLines>
+    void reflowLogicalLines(TargetLines& targetLines, gsl::span<Line<Cell>> lines, ColumnCount newColumnCount)
+    {
+        while (!lines.empty())
+        {
+            auto lineCount = size_t { 1 };
+            while (lineCount < lines.size() && lines[lineCount].wrapped())
+                ++lineCount;
+            reflowLogicalLine<Cell>(targetLines, lines.first(lineCount), newColumnCount);
+            lines = lines.subspan(lineCount);
+        }
+    }
+
+    /// Makes the given @p line allocate its cells from the heap rather than from its grid's cell arena,
+    /// moving the cells already allocated from the arena to the heap.
+    template <typename Cell>
+    void moveCellsToHeap(Line<Cell>& line)
+    {
+        line.setCellArena(nullptr);
+        if (line.isColdBuffer() || !line.isInflatedBuffer())
+            return;
+
+        auto const& cells = std::as_const(line).inflatedBuffer();
+        if (cells.get_allocator().arena())
+            line.setBuffer(typename Line<Cell>::InflatedBuffer(cells.begin(), cells.end()));
+    }
+
 } // namespace detail
 // {{{ Grid impl
 template <typename Cell>
@@ -127,18 +332,12 @@ Grid<Cell>::Grid(PageSize pageSize, bool reflowOnResize, MaxHistoryLineCount max
               Margin::Horizontal { {}, _pageSize.columns.as<ColumnOffset>() - ColumnOffset(1) } },
     _reflowOnResize { reflowOnResize },
     _historyLimit { maxHistoryLineCount },
-    _lines { detail::createLines<Cell>(
-        pageSize,
-        [maxHistoryLineCount]() -> LineCount {
-            if (auto const* maxLineCount = std::get_if<LineCount>(&maxHistoryLineCount))
-                return *maxLineCount;
-            else
-                return LineCount::cast_from(0);
-        }(),
-        reflowOnResize,
-        GraphicsAttributes {}) },
+    _cellArena { std::make_unique<CellArena>() },
+    _lines { detail::createLines<Cell>(pageSize, reflowOnResize, GraphicsAttributes {}) },
     _linesUsed { pageSize.lines }
 {
+    assignCellArena();
+    updateHistoryFile();
     verifyState();
 }
 
@@ -149,8 +348,12 @@ void Grid<Cell>::setMaxHistoryLineCount(MaxHistoryLineCount maxHistoryLineCount)
     verifyState();
     rezeroBuffers();
     _historyLimit = maxHistoryLineCount;
-    _lines.resize(unbox<size_t>(_pageSize.lines + this->maxHistoryLineCount()));
-    _linesUsed = min(_linesUsed, _pageSize.lines + this->maxHistoryLineCount());
+    updateHistoryFile();
+    makeRoomForHistory(LineCount(0));
+    if (LineCount::cast_from(_lines.size()) > totalLineCount())
+        _lines.resize(unbox<size_t>(totalLineCount()));
+    _linesUsed = min(_linesUsed, totalLineCount());
+    spillExcessHistory();
     verifyState();
 }
 
@@ -159,16 +362,99 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clearHistory()
 {
     _linesUsed = _pageSize.lines;
+    _hotHistoryLineCount = LineCount(0);
+    evictUnreflowedLineCache();
+    _unreflowedLines.clear();
+    if (_historyFile)
+    {
+        _historyFile->clear();
+        _modifiedHistoryFileLines.clear();
+        clearHistoryFileCache();
+    }
     verifyState();
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::setColdHistoryDistance(std::optional<LineCount> distance)
+{
+    _coldHistoryDistance = distance;
+    _hotHistoryLineCount = inMemoryHistoryLineCount();
+    packColdHistory();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+crispy::BufferObjectUsage Grid<Cell>::bufferObjectUsage() const
+{
+    auto compactor = crispy::BufferFragmentCompactor<char>(0.0f);
+    for (auto const& line: _lines)
+        detail::visitTextFragments(line, [&](auto const& text) { compactor.collect(text); });
+    for (auto const& line: _unreflowedLines)
+        detail::visitTextFragments(line, [&](auto const& text) { compactor.collect(text); });
+    return compactor.usage();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+crispy::BufferObjectUsage Grid<Cell>::compactBufferObjects(float maxLoadFactor)
+{
+    auto compactor = crispy::BufferFragmentCompactor<char>(maxLoadFactor);
+    for (auto const& line: _lines)
+        detail::visitTextFragments(line, [&](auto const& text) { compactor.collect(text); });
+    for (auto const& line: _unreflowedLines)
+        detail::visitTextFragments(line, [&](auto const& text) { compactor.collect(text); });
+
+    auto const usage = compactor.usage();
+
+    for (auto& line: _lines)
+        detail::visitTextFragments(line, [&](auto& text) { compactor.compact(text); });
+    for (auto& line: _unreflowedLines)
+        detail::visitTextFragments(line, [&](auto& text) { compactor.compact(text); });
+
+    GridLog()("Compacted {} of {} live bytes, pinning {} in {} buffer objects.",
+              compactor.compactedBytes(),
+              usage.liveBytes,
+              usage.pinnedBytes,
+              usage.bufferCount);
+
+    return usage;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::markCellExtras(PodCellExtras::Marker& marker) const
+{
+    if constexpr (std::is_same_v<Cell, PodCell>)
+    {
+        // Only inflated lines consist of cells, and testing cold ones for that would unpack them.
+        auto const markLine = [&](Line<Cell> const& line) {
+            if (!line.isColdBuffer() && line.isInflatedBuffer())
+                for (Cell const& cell: line.inflatedBuffer())
+                    cell.markExtra(marker);
+        };
+        for (auto const& line: _lines)
+            markLine(line);
+        for (auto const& line: _unreflowedLines)
+            markLine(line);
+        for (auto const& [index, line]: _historyFileCache)
+            if (line)
+                markLine(*line);
+        for (auto const& [index, line]: _unreflowedLineCache)
+            if (line)
+                markLine(*line);
+        for (auto const& line: _evictedHistoryLines)
+            markLine(*line);
+        for (auto const& [index, line]: _modifiedHistoryFileLines)
+            markLine(line);
+    }
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::verifyState() const noexcept
 {
 #if !defined(NDEBUG)
-    // _maxHistoryLineCount + _pageSize.lines
-    Require(LineCount::cast_from(_lines.size()) >= totalLineCount());
     Require(LineCount::cast_from(_lines.size()) >= _linesUsed);
     Require(_linesUsed >= _pageSize.lines);
 #endif
@@ -210,6 +496,19 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 Line<Cell>& Grid<Cell>::lineAt(LineOffset line) noexcept
 {
     // Require(*line < *_pageSize.lines);
+    if (line < -boxed_cast<LineOffset>(inMemoryHistoryLineCount()))
+    {
+        // Reflowing on demand may leave fewer history lines than counted before,
+        // thus any offset beyond the top of the history then refers to its top line.
+        if (!_unreflowedLines.empty())
+        {
+            reflowHistory(boxed_cast<LineCount>(-line));
+            line = std::max(line, -boxed_cast<LineOffset>(historyLineCount()));
+        }
+        if (_historyFile && line < -boxed_cast<LineOffset>(inMemoryHistoryLineCount()))
+            return modifiableHistoryFileLineAt(
+                unbox<size_t>(line + boxed_cast<LineOffset>(historyLineCount())));
+    }
     return _lines[unbox<long>(line)];
 }
 
@@ -218,7 +517,22 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 Line<Cell> const& Grid<Cell>::lineAt(LineOffset line) const noexcept
 {
     // Require(*line < *_pageSize.lines);
-    return const_cast<Grid&>(*this).lineAt(line);
+    if (line < -boxed_cast<LineOffset>(inMemoryHistoryLineCount()))
+    {
+        if (!_unreflowedLines.empty())
+        {
+            // Offsets beyond the top of the history, as reflowing may leave fewer history lines than
+            // counted before, refer to its top line.
+            line = std::max(line, -boxed_cast<LineOffset>(historyLineCount()));
+            auto const unreflowedTop =
+                -boxed_cast<LineOffset>(inMemoryHistoryLineCount() + unreflowedHistoryLineCount());
+            if (unreflowedTop <= line)
+                return unreflowedHistoryLineAt(unbox<size_t>(line - unreflowedTop));
+        }
+        if (_historyFile)
+            return historyFileLineAt(unbox<size_t>(line + boxed_cast<LineOffset>(historyLineCount())));
+    }
+    return _lines[unbox<long>(line)];
 }
 
 template <typename Cell>
@@ -239,45 +553,42 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 Cell const& Grid<Cell>::at(LineOffset line, ColumnOffset column) const noexcept
 {
-    return const_cast<Grid&>(*this).at(line, column);
+    // Not using useCellAt(), as reading a cell must not change the line's generation.
+    auto const cells = lineAt(line).cells();
+    Require(unbox<size_t>(column) <= cells.size()); // Allow off-by-one for sentinel.
+    return cells.data()[unbox<size_t>(column)];
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell>> Grid<Cell>::pageAtScrollOffset(ScrollOffset scrollOffset)
+typename Grid<Cell>::PageLines Grid<Cell>::pageAtScrollOffset(ScrollOffset scrollOffset)
 {
-    Require(unbox<LineCount>(scrollOffset) <= historyLineCount());
+    Require(unbox<LineCount>(scrollOffset) <= inMemoryHistoryLineCount());
 
-    int const offset = -*scrollOffset;
-    Line<Cell>* startLine = &_lines[offset];
-    auto const count = unbox<size_t>(_pageSize.lines);
-
-    return gsl::span<Line<Cell>> { startLine, count };
+    auto const first = std::next(_lines.begin(), -*scrollOffset);
+    return PageLines { first, std::next(first, unbox<long>(_pageSize.lines)) };
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell> const> Grid<Cell>::pageAtScrollOffset(ScrollOffset scrollOffset) const
+typename Grid<Cell>::ConstPageLines Grid<Cell>::pageAtScrollOffset(ScrollOffset scrollOffset) const
 {
-    Require(unbox<LineCount>(scrollOffset) <= historyLineCount());
-
-    int const offset = -*scrollOffset;
-    Line<Cell> const* startLine = &_lines[offset];
-    auto const count = unbox<size_t>(_pageSize.lines);
+    Require(unbox<LineCount>(scrollOffset) <= inMemoryHistoryLineCount());
 
-    return gsl::span<Line<Cell> const> { startLine, count };
+    auto const first = std::next(_lines.cbegin(), -*scrollOffset);
+    return ConstPageLines { first, std::next(first, unbox<long>(_pageSize.lines)) };
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell> const> Grid<Cell>::mainPage() const
+typename Grid<Cell>::ConstPageLines Grid<Cell>::mainPage() const
 {
     return pageAtScrollOffset({});
 }
 
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
-gsl::span<Line<Cell>> Grid<Cell>::mainPage()
+typename Grid<Cell>::PageLines Grid<Cell>::mainPage()
 {
     return pageAtScrollOffset({});
 }
@@ -386,21 +697,284 @@ int Grid<Cell>::computeLogicalLineNumberFromBottom(LineCount n) const noexcept
 }
 // }}}
 // {{{ Grid impl: scrolling
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::growBuffers(LineCount count)
+{
+    // Grow geometrically, such that the cost of growing amortizes, but not beyond the history limit.
+    auto const currentSize = _lines.size();
+    auto const grownSize = currentSize + currentSize / 2;
+    auto newSize = currentSize + unbox<size_t>(count);
+    if (auto const maxLineCount = inMemoryHistoryLimit())
+        newSize = std::max(newSize, std::min(grownSize, unbox<size_t>(_pageSize.lines + *maxLineCount)));
+    else
+        newSize = std::max(newSize, grownSize);
+
+    // Whole segments are inserted without moving the lines behind them, so grow by these,
+    // unless that would exceed the history limit.
+    auto constexpr SegmentMask = crispy::segmented_vector<Line<Cell>>::segment_mask;
+    auto const segmentAlignedSize = currentSize + ((newSize - currentSize + SegmentMask) & ~SegmentMask);
+    if (auto const maxLineCount = inMemoryHistoryLimit();
+        !maxLineCount || segmentAlignedSize <= unbox<size_t>(_pageSize.lines + *maxLineCount))
+        newSize = segmentAlignedSize;
+
+    // The new lines become the unused lines right below the main page,
+    // with the history lines keeping their (negative) offsets.
+    auto newLine = Line<Cell>(defaultLineFlags(), TrivialLineBuffer { _pageSize.columns, {} });
+    newLine.setCellArena(_cellArena.get());
+    _lines.insert(unbox<long>(_pageSize.lines), newSize - currentSize, newLine);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::assignCellArena() noexcept
+{
+    for (auto& line: _lines)
+        line.setCellArena(_cellArena.get());
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::packColdHistory()
+{
+    _hotHistoryLineCount = std::min(_hotHistoryLineCount, inMemoryHistoryLineCount());
+
+    // History lines are either packed in memory, or kept on disk, where they are packed as well.
+    if (!_coldHistoryDistance || _historyFile)
+        return;
+
+    auto const ChunkLineCount = LineCount::cast_from(ColdLineChunk::MaxLines);
+    while (_hotHistoryLineCount >= *_coldHistoryDistance + ChunkLineCount)
+    {
+        // Pack the oldest hot lines.
+        packHistoryLines(-boxed_cast<LineOffset>(_hotHistoryLineCount), ChunkLineCount);
+        _hotHistoryLineCount -= ChunkLineCount;
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::packHistoryLines(LineOffset top, LineCount count)
+{
+    auto packedLines = std::vector<PackedLineBuffer> {};
+    auto lines = std::vector<Line<Cell>*> {};
+
+    for (auto y = top; y < top + boxed_cast<LineOffset>(count); ++y)
+    {
+        auto& line = lineAt(y);
+        if (auto packed = line.pack())
+        {
+            packedLines.emplace_back(std::move(*packed));
+            lines.emplace_back(&line);
+        }
+    }
+
+    if (lines.empty())
+        return;
+
+    auto const chunk = ColdLineChunk::create(packedLines);
+    for (size_t i = 0; i < lines.size(); ++i)
+        lines[i]->setBuffer(ColdLineBuffer { lines[i]->size(), chunk, static_cast<uint32_t>(i) });
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::updateHistoryFile()
+{
+    if (!std::holds_alternative<InfiniteDiskBacked>(_historyLimit))
+    {
+        _historyFile.reset();
+        _historyFileCache.clear();
+        _evictedHistoryLines.clear();
+        _modifiedHistoryFileLines.clear();
+        return;
+    }
+
+    if (_historyFile)
+        return;
+
+    _historyFile = HistoryFile::create();
+    if (!_historyFile)
+    {
+        // Keep all history lines in memory instead.
+        _historyLimit = Infinite {};
+        return;
+    }
+
+    _historyFileCache.resize(detail::HistoryFileCacheSize);
+    clearHistoryFileCache();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::appendToHistoryFile(LineOffset top, LineCount count)
+{
+    for (auto y = top; y < top + boxed_cast<LineOffset>(count); ++y)
+    {
+        auto const& line = _lines[unbox<long>(y)];
+        _historyFile->append(line.flags(), line.packLossy());
+    }
+    dropFailedHistoryFile();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::dropFailedHistoryFile()
+{
+    if (!_historyFile || !_historyFile->failed())
+        return;
+
+    // The lines in the file are the oldest ones, thus the ones to be dropped first anyway.
+    if (auto const* diskBacked = std::get_if<InfiniteDiskBacked>(&_historyLimit))
+        _historyLimit = diskBacked->inMemoryLineCount;
+    _historyFile.reset();
+    _historyFileCache.clear();
+    _evictedHistoryLines.clear();
+    _modifiedHistoryFileLines.clear();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::spillHistory(LineCount count)
+{
+    appendToHistoryFile(-boxed_cast<LineOffset>(inMemoryHistoryLineCount()), count);
+
+    // The oldest history lines are right next to the unused lines, thus simply becoming unused as well.
+    _linesUsed -= count;
+    _hotHistoryLineCount = std::min(_hotHistoryLineCount, inMemoryHistoryLineCount());
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::spillExcessHistory()
+{
+    auto const* diskBacked = std::get_if<InfiniteDiskBacked>(&_historyLimit);
+    if (!_historyFile || !diskBacked)
+        return;
+
+    // Unreflowed history lines are the oldest ones in memory, thus the first to go.
+    makeRoomForHistory(LineCount(0));
+    if (inMemoryHistoryLineCount() > diskBacked->inMemoryLineCount)
+        spillHistory(inMemoryHistoryLineCount() - diskBacked->inMemoryLineCount);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+Line<Cell> const& Grid<Cell>::historyFileLineAt(size_t index) const
+{
+    if (auto const modified = _modifiedHistoryFileLines.find(index);
+        modified != _modifiedHistoryFileLines.end())
+        return modified->second;
+
+    auto& entry = _historyFileCache[index % _historyFileCache.size()];
+    if (entry.second && entry.first == index)
+        return *entry.second;
+
+    auto line = Line<Cell> {};
+    if (auto stored = _historyFile->read(index))
+        std::visit([&](auto& buffer) { line = Line<Cell>(stored->flags, std::move(buffer)); },
+                   stored->buffer);
+    else
+        line = Line<Cell>(defaultLineFlags(), TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} });
+
+    if (line.size() != _pageSize.columns)
+        line.resize(_pageSize.columns);
+
+    if (entry.second)
+        _evictedHistoryLines.emplace_back(std::move(entry.second));
+    entry = { index, std::make_shared<Line<Cell> const>(std::move(line)) };
+    return *entry.second;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+Line<Cell> const& Grid<Cell>::unreflowedHistoryLineAt(size_t index) const
+{
+    auto const& unreflowedLine = _unreflowedLines[index];
+    if (unreflowedLine.size() == _pageSize.columns)
+        return unreflowedLine;
+
+    if (_unreflowedLineCache.empty())
+        _unreflowedLineCache.resize(detail::HistoryFileCacheSize);
+    auto& entry = _unreflowedLineCache[index % _unreflowedLineCache.size()];
+    if (entry.second && entry.first == index)
+        return *entry.second;
+
+    auto line = unreflowedLine;
+    line.resize(_pageSize.columns);
+
+    if (entry.second)
+        _evictedHistoryLines.emplace_back(std::move(entry.second));
+    entry = { index, std::make_shared<Line<Cell> const>(std::move(line)) };
+    return *entry.second;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::evictUnreflowedLineCache()
+{
+    for (auto& entry: _unreflowedLineCache)
+        if (entry.second)
+            _evictedHistoryLines.emplace_back(std::exchange(entry, {}).second);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+Line<Cell>& Grid<Cell>::modifiableHistoryFileLineAt(size_t index)
+{
+    if (auto const modified = _modifiedHistoryFileLines.find(index);
+        modified != _modifiedHistoryFileLines.end())
+        return modified->second;
+
+    auto& line = _modifiedHistoryFileLines.emplace(index, historyFileLineAt(index)).first->second;
+    line.setCellArena(_cellArena.get());
+    return line;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::clearHistoryFileCache()
+{
+    for (auto& entry: _historyFileCache)
+        entry = {};
+    _evictedHistoryLines.clear();
+
+    // Lines read from disk are resized (without reflow) to the page's width, and so are modified ones.
+    for (auto& [index, line]: _modifiedHistoryFileLines)
+        if (line.size() != _pageSize.columns)
+            line.resize(_pageSize.columns);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttributes defaultAttributes) noexcept
 {
     verifyState();
+    releaseEvictedHistoryLines();
+
+    if (!_unreflowedLines.empty())
+        makeRoomForHistory(linesCountToScrollUp);
+
+    // History lines are allocated as lines scroll into history, until the history limit is reached.
+    if (unbox<size_t>(_linesUsed) == _lines.size())
+    {
+        auto const maxLineCount = inMemoryHistoryLimit();
+        auto const growCount =
+            maxLineCount
+                ? std::min(linesCountToScrollUp,
+                           *maxLineCount - unreflowedHistoryLineCount() + _pageSize.lines - _linesUsed)
+                : linesCountToScrollUp;
+        if (*growCount > 0)
+            growBuffers(growCount);
+    }
+
     if (unbox<size_t>(_linesUsed) == _lines.size()) // with all grid lines in-use
     {
-        if (std::get_if<Infinite>(&_historyLimit))
-        {
-            for ([[maybe_unused]] auto const _: ranges::views::iota(0, unbox<int>(linesCountToScrollUp)))
-                _lines.emplace_back(defaultLineFlags(),
-                                    TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} });
-            return scrollUp(linesCountToScrollUp, defaultAttributes);
-        }
         // TODO: ensure explicit test for this case
+        if (_historyFile)
+            appendToHistoryFile(-boxed_cast<LineOffset>(inMemoryHistoryLineCount()),
+                                std::min(linesCountToScrollUp, _linesUsed));
         rotateBuffersLeft(linesCountToScrollUp);
 
         // Initialize (/reset) new lines.
@@ -409,6 +983,8 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
              ++y)
             lineAt(y).reset(defaultLineFlags(), defaultAttributes);
 
+        _hotHistoryLineCount += linesCountToScrollUp;
+        packColdHistory();
         return linesCountToScrollUp;
     }
     else
@@ -435,6 +1011,9 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
         if (linesAppendCount < linesCountToScrollUp)
         {
             auto const incrementCount = linesCountToScrollUp - linesAppendCount;
+            if (_historyFile)
+                appendToHistoryFile(-boxed_cast<LineOffset>(inMemoryHistoryLineCount()),
+                                    std::min(incrementCount, _linesUsed));
             rotateBuffersLeft(incrementCount);
 
             // Initialize (/reset) new lines.
@@ -443,6 +1022,8 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
                  ++y)
                 lineAt(y).reset(defaultLineFlags(), defaultAttributes);
         }
+        _hotHistoryLineCount += linesCountToScrollUp;
+        packColdHistory();
         return LineCount::cast_from(linesAppendCount);
     }
 }
@@ -471,7 +1052,7 @@ LineCount Grid<Cell>::scrollUp(LineCount n, GraphicsAttributes defaultAttributes
         // scroll up only inside vertical margin with full horizontal extend
         auto const marginHeight = LineCount(margin.vertical.length());
         auto const n2 = std::min(n, marginHeight);
-        if (*n2 && n2 < marginHeight)
+        if (*n2 && n2 < marginHeight && !rotateBuffersWithinMargin(margin.vertical, unbox<int>(n2)))
         {
             // rotate line attribs
             for (auto topLineOffset = *margin.vertical.from; topLineOffset <= *margin.vertical.to - *n2;
@@ -509,11 +1090,7 @@ LineCount Grid<Cell>::scrollUp(LineCount n, GraphicsAttributes defaultAttributes
         {
             auto a = &useCellAt(line, margin.horizontal.from);
             auto b = a + unbox<int>(margin.horizontal.length());
-            while (a != b)
-            {
-                a->reset(defaultAttributes);
-                a++;
-            }
+            std::fill(a, b, Cell { defaultAttributes });
         }
     }
     verifyState();
@@ -549,7 +1126,7 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
 
         rotateBuffersRight(n);
 
-        for (Line<Cell>& line: mainPage().subspan(0, unbox<size_t>(n)))
+        for (Line<Cell>& line: mainPage().subrange(0, unbox<size_t>(n)))
             line.reset(defaultLineFlags(), defaultAttributes);
         return;
     }
@@ -557,10 +1134,15 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
     if (fullHorizontal) // => but ont fully vertical
     {
         // scroll down only inside vertical margin with full horizontal extend
-        auto a = std::next(begin(_lines), *margin.vertical.from);
-        auto b = std::next(begin(_lines), *margin.vertical.to + 1 - *n);
-        auto c = std::next(begin(_lines), *margin.vertical.to + 1);
-        std::rotate(a, b, c);
+        auto const rotated =
+            *n && n < margin.vertical.length() && rotateBuffersWithinMargin(margin.vertical, -unbox<int>(n));
+        if (!rotated)
+        {
+            auto a = std::next(begin(_lines), *margin.vertical.from);
+            auto b = std::next(begin(_lines), *margin.vertical.to + 1 - *n);
+            auto c = std::next(begin(_lines), *margin.vertical.to + 1);
+            std::rotate(a, b, c);
+        }
         for (auto const i: ranges::views::iota(*margin.vertical.from, *margin.vertical.from + *n))
             _lines[i].reset(defaultLineFlags(), defaultAttributes);
     }
@@ -580,11 +1162,7 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
             {
                 auto a = &at(line, margin.horizontal.from);
                 auto b = &at(line, margin.horizontal.to + 1);
-                while (a != b)
-                {
-                    *a = Cell { defaultAttributes };
-                    a++;
-                }
+                std::fill(a, b, Cell { defaultAttributes });
             }
         }
     }
@@ -600,7 +1178,7 @@ void Grid<Cell>::scrollLeft(GraphicsAttributes defaultAttributes, Margin margin)
         auto column0 = line.inflatedBuffer().begin() + *margin.horizontal.from;
         auto column1 = line.inflatedBuffer().begin() + *margin.horizontal.from + 1;
         auto column2 = line.inflatedBuffer().begin() + *margin.horizontal.to + 1;
-        std::rotate(column0, column1, column2);
+        std::move(column1, column2, column0);
 
         auto const emptyCell = Cell { defaultAttributes };
         auto const emptyCellsBegin = line.inflatedBuffer().begin() + *margin.horizontal.to;
@@ -608,6 +1186,36 @@ void Grid<Cell>::scrollLeft(GraphicsAttributes defaultAttributes, Margin margin)
     }
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Grid<Cell>::rotateBuffersWithinMargin(Margin::Vertical margin, int count) noexcept
+{
+    auto const height = unbox<int>(margin.length());
+    auto const outsideLineCount = unbox<int>(_pageSize.lines) - height;
+    auto const n = std::abs(count);
+    Require(0 < n && n < height);
+
+    if (_lines.size() != unbox<size_t>(_pageSize.lines) || outsideLineCount + n >= height)
+        return false;
+
+    // With the whole ring buffer rotated, the lines within the margin are in place already. The lines
+    // scrolled out of the margin, and the lines outside of it, follow each other around the margin's
+    // bottom, from where they are rotated back by the lines scrolled out of the margin.
+    if (count > 0)
+    {
+        _lines.rotate_left(static_cast<size_t>(n));
+        auto const first = std::next(begin(_lines), *margin.to + 1 - n);
+        std::rotate(first, std::next(first, outsideLineCount), std::next(first, outsideLineCount + n));
+    }
+    else
+    {
+        _lines.rotate_right(static_cast<size_t>(n));
+        auto const first = std::next(begin(_lines), *margin.to + 1);
+        std::rotate(first, std::next(first, n), std::next(first, n + outsideLineCount));
+    }
+    return true;
+}
+
 // }}}
 // {{{ Grid impl: resize
 template <typename Cell>
@@ -615,6 +1223,15 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::reset()
 {
     _linesUsed = _pageSize.lines;
+    _hotHistoryLineCount = LineCount(0);
+    evictUnreflowedLineCache();
+    _unreflowedLines.clear();
+    if (_historyFile)
+    {
+        _historyFile->clear();
+        _modifiedHistoryFileLines.clear();
+        clearHistoryFileCache();
+    }
     _lines.rotate_right(_lines.zero_index());
     for (int i = 0; i < unbox<int>(_pageSize.lines); ++i)
         _lines[i].reset(defaultLineFlags(), GraphicsAttributes {});
@@ -636,7 +1253,7 @@ CellLocation Grid<Cell>::growLines(LineCount newHeight, CellLocation cursor)
     if (*cursor.line + 1 == *_pageSize.lines)
     {
         auto const totalLinesToExtend = newHeight - _pageSize.lines;
-        auto const linesToTakeFromSavedLines = std::min(totalLinesToExtend, historyLineCount());
+        auto const linesToTakeFromSavedLines = std::min(totalLinesToExtend, inMemoryHistoryLineCount());
         Require(totalLinesToExtend >= linesToTakeFromSavedLines);
         Require(*linesToTakeFromSavedLines >= 0);
         rotateBuffersRight(linesToTakeFromSavedLines);
@@ -644,23 +1261,19 @@ CellLocation Grid<Cell>::growLines(LineCount newHeight, CellLocation cursor)
         cursorMove.line += boxed_cast<LineOffset>(linesToTakeFromSavedLines);
     }
 
-    auto const wrappableFlag = _lines.back().wrappableFlag();
     auto const totalLinesToExtend = newHeight - _pageSize.lines;
     Require(*totalLinesToExtend >= 0);
     // ? Require(linesToTakeFromSavedLines == LineCount(0));
 
-    auto const newTotalLineCount = maxHistoryLineCount() + newHeight;
-    auto const currentTotalLineCount = LineCount::cast_from(_lines.size());
-    auto const linesToFill = max(0, *newTotalLineCount - *currentTotalLineCount);
-
-    for ([[maybe_unused]] auto const _: ranges::views::iota(0, linesToFill))
-        _lines.emplace_back(wrappableFlag, TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} });
+    auto const linesAvailable = LineCount::cast_from(_lines.size()) - _linesUsed;
+    if (totalLinesToExtend > linesAvailable)
+        growBuffers(totalLinesToExtend - linesAvailable);
 
     _pageSize.lines += totalLinesToExtend;
-    _linesUsed = min(_linesUsed + totalLinesToExtend, LineCount::cast_from(_lines.size()));
+    _linesUsed += totalLinesToExtend;
 
     Ensures(_pageSize.lines == newHeight);
-    Ensures(_lines.size() >= unbox<size_t>(maxHistoryLineCount() + _pageSize.lines));
+    Ensures(_lines.size() >= unbox<size_t>(_linesUsed));
     verifyState();
 
     return cursorMove;
@@ -734,7 +1347,29 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
         return CellLocation {};
     };
 
-    auto const growColumns = [this, wrapPending](ColumnCount newColumnCount) -> CellLocation {
+    // Reflows the logical line starting at the given line into trivial lines referring to slices of its
+    // text, see detail::reflowTrivialLogicalLine(), returning the number of lines it has been made of,
+    // or 0 if it cannot be reflowed that way.
+    auto const reflowTrivialLines = [this](Lines<Cell>& targetLines, int top, ColumnCount newColumnCount) {
+        auto bottom = top + 1;
+        while (bottom < *_pageSize.lines && _lines[bottom].wrapped())
+            ++bottom;
+
+        auto logicalLine = std::vector<Line<Cell>> {};
+        for (auto y = top; y < bottom; ++y)
+        {
+            if (!_lines[y].isTrivialBuffer())
+                return 0;
+            logicalLine.emplace_back(_lines[y]);
+        }
+
+        if (!detail::reflowTrivialLogicalLine<Cell>(targetLines, logicalLine, newColumnCount))
+            return 0;
+        return bottom - top;
+    };
+
+    auto const growColumns = [this, wrapPending, &reflowTrivialLines](
+                                 ColumnCount newColumnCount) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!_reflowOnResize)
@@ -780,7 +1415,7 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
                     GridLog()("{} |> \"{}\"", msg, Line<Cell>(lineFlags, logicalLineBuffer).toUtf8());
                 };
 
-            for (int i = -*historyLineCount(); i < *_pageSize.lines; ++i)
+            for (int i = -*inMemoryHistoryLineCount(); i < *_pageSize.lines; ++i)
             {
                 auto& line = _lines[i];
                 // logLogicalLine(line.flags(), fmt::format("Line[{:>2}]: next line: \"{}\"", i,
@@ -796,12 +1431,27 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
                 else // line is not wrapped
                 {
                     flushLogicalLine();
+                    if (line.isTrivialBuffer() && i + 1 < *_pageSize.lines && _lines[i + 1].wrapped())
+                    {
+                        // Logical lines of plain text are joined by their text, rather than inflated.
+                        if (auto const reflowedLineCount = reflowTrivialLines(grownLines, i, newColumnCount))
+                        {
+                            i += reflowedLineCount - 1;
+                            continue;
+                        }
+                    }
+
                     if (line.isTrivialBuffer())
                     {
                         auto& buffer = line.trivialBuffer();
                         buffer.displayWidth = newColumnCount;
                         grownLines.emplace_back(line);
                     }
+                    else if (line.isAttributedBuffer())
+                    {
+                        line.resize(newColumnCount);
+                        grownLines.emplace_back(line);
+                    }
                     else
                     {
                         // logLogicalLine(line.flags(), " - start new logical line");
@@ -828,15 +1478,8 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
                 Ensures(LineCount::cast_from(grownLines.size()) == _pageSize.lines);
             }
 
+            // Unused lines are allocated again on demand.
             _linesUsed = LineCount::cast_from(grownLines.size());
-
-            // Fill scrollback lines.
-            auto const totalLineCount = unbox<size_t>(_pageSize.lines + maxHistoryLineCount());
-            while (grownLines.size() < totalLineCount)
-                grownLines.emplace_back(
-                    defaultLineFlags(),
-                    TrivialLineBuffer { newColumnCount, GraphicsAttributes {}, GraphicsAttributes {} });
-
             _lines = std::move(grownLines);
             _pageSize.columns = newColumnCount;
 
@@ -848,8 +1491,9 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
         }
     };
 
-    auto const shrinkColumns =
-        [this](ColumnCount newColumnCount, LineCount /*newLineCount*/, CellLocation cursor) -> CellLocation {
+    auto const shrinkColumns = [this, &reflowTrivialLines](ColumnCount newColumnCount,
+                                                           LineCount /*newLineCount*/,
+                                                           CellLocation cursor) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!_reflowOnResize)
@@ -893,15 +1537,26 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
             LineBuffer wrappedColumns;
             LineFlags previousFlags = _lines.front().inheritableFlags();
 
-            auto const totalLineCount = unbox<size_t>(_pageSize.lines + maxHistoryLineCount());
-            shrinkedLines.reserve(totalLineCount);
-            Require(totalLineCount == unbox<size_t>(this->totalLineCount()));
+            shrinkedLines.reserve(unbox<size_t>(_linesUsed));
 
             auto numLinesWritten = LineCount(0);
-            for (auto i = -*historyLineCount(); i < *_pageSize.lines; ++i)
+            for (auto i = -*inMemoryHistoryLineCount(); i < *_pageSize.lines; ++i)
             {
                 auto& line = _lines[i];
 
+                // Logical lines of plain text are cut into slices of their text, rather than inflated.
+                if (wrappedColumns.empty() && line.isTrivialBuffer()
+                    && line.trivialBuffer().text.size() > unbox<size_t>(newColumnCount))
+                {
+                    auto const previousLineCount = shrinkedLines.size();
+                    if (auto const reflowedLineCount = reflowTrivialLines(shrinkedLines, i, newColumnCount))
+                    {
+                        numLinesWritten += LineCount::cast_from(shrinkedLines.size() - previousLineCount);
+                        i += reflowedLineCount - 1;
+                        continue;
+                    }
+                }
+
                 // do we have previous columns carried?
                 if (!wrappedColumns.empty())
                 {
@@ -936,11 +1591,7 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
             Require(unbox<size_t>(numLinesWritten) == shrinkedLines.size());
             Require(numLinesWritten >= _pageSize.lines);
 
-            while (shrinkedLines.size() < totalLineCount)
-                shrinkedLines.emplace_back(
-                    LineFlags::None,
-                    TrivialLineBuffer { newColumnCount, GraphicsAttributes {}, GraphicsAttributes {} });
-
+            // Unused lines are allocated again on demand.
             shrinkedLines.rotate_left(
                 unbox<size_t>(numLinesWritten - _pageSize.lines)); // maybe to be done outisde?
             _linesUsed = LineCount::cast_from(numLinesWritten);
@@ -963,6 +1614,10 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
 
     CellLocation cursor = currentCursorPos;
 
+    // Older history lines are reflowed on demand, and only to the width they are needed at.
+    if (_reflowOnResize && newSize.columns != _pageSize.columns)
+        deferHistoryReflow();
+
     // grow/shrink columns
     using crispy::Comparison;
     switch (crispy::strongCompare(newSize.columns, _pageSize.columns))
@@ -975,7 +1630,11 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
     // grow/shrink lines
     switch (crispy::strongCompare(newSize.lines, _pageSize.lines))
     {
-        case Comparison::Greater: cursor += growLines(newSize.lines, cursor); break;
+        case Comparison::Greater:
+            // Lines pulled down from history into the main page need to be reflowed.
+            reflowHistory(newSize.lines - _pageSize.lines);
+            cursor += growLines(newSize.lines, cursor);
+            break;
         case Comparison::Less: cursor += shrinkLines(newSize.lines, cursor); break;
         case Comparison::Equal: break;
     }
@@ -983,9 +1642,220 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
     Ensures(_pageSize == newSize);
     verifyState();
 
+    // Lines may have moved into (or been reflowed within) the history.
+    // NB: Lines on disk keep their width, and are resized (without reflow) as they are read back.
+    spillExcessHistory();
+    clearHistoryFileCache();
+    _hotHistoryLineCount = inMemoryHistoryLineCount();
+    packColdHistory();
+
+    // Lines have been recreated by reflowing, and cells of the previous width are not reused.
+    assignCellArena();
+    _cellArena->releaseUnusedSlabs();
+
     return cursor;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::deferHistoryReflow()
+{
+    // The lines reflowed right away start with the first line of a logical line.
+    auto reflowedLineCount = std::min(inMemoryHistoryLineCount(), detail::EagerReflowLineCount);
+    while (reflowedLineCount < inMemoryHistoryLineCount()
+           && _lines[-unbox<long>(reflowedLineCount)].wrapped())
+        ++reflowedLineCount;
+
+    auto const deferredLineCount = inMemoryHistoryLineCount() - reflowedLineCount;
+    evictUnreflowedLineCache();
+    for (auto y = -unbox<long>(inMemoryHistoryLineCount()); y < -unbox<long>(reflowedLineCount); ++y)
+        _unreflowedLines.emplace_back(std::move(_lines[y]));
+
+    // The oldest history lines are right next to the unused lines, thus simply becoming unused as well.
+    _linesUsed -= deferredLineCount;
+    _hotHistoryLineCount = std::min(_hotHistoryLineCount, inMemoryHistoryLineCount());
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::reflowHistory(LineCount count)
+{
+    if (_unreflowedLines.empty() || inMemoryHistoryLineCount() >= count)
+        return;
+
+    evictUnreflowedLineCache();
+    auto const previousLineCount = inMemoryHistoryLineCount();
+    auto logicalLine = std::vector<Line<Cell>> {};
+    auto reflowedLines = std::vector<Line<Cell>> {};
+
+    while (!_unreflowedLines.empty() && inMemoryHistoryLineCount() < count)
+    {
+        // Take the most recent logical line, right above the lines reflowed already.
+        auto top = _unreflowedLines.size() - 1;
+        while (top > 0 && _unreflowedLines[top].wrapped())
+            --top;
+        auto const first = std::next(_unreflowedLines.begin(), static_cast<long>(top));
+        logicalLine.assign(std::make_move_iterator(first), std::make_move_iterator(_unreflowedLines.end()));
+        _unreflowedLines.erase(first, _unreflowedLines.end());
+
+        reflowedLines.clear();
+        detail::reflowLogicalLine<Cell>(reflowedLines, gsl::span(logicalLine), _pageSize.columns);
+        auto reflowedLineCount = LineCount::cast_from(reflowedLines.size());
+
+        // Reflowed lines exceeding the history limit are dropped, along with all lines older than these.
+        if (auto const maxLineCount = inMemoryHistoryLimit();
+            maxLineCount && inMemoryHistoryLineCount() + reflowedLineCount > *maxLineCount)
+        {
+            dropUnreflowedHistory(unreflowedHistoryLineCount());
+            auto const excessLineCount = inMemoryHistoryLineCount() + reflowedLineCount - *maxLineCount;
+            if (_historyFile)
+            {
+                for (auto i = size_t { 0 }; i < unbox<size_t>(excessLineCount); ++i)
+                    _historyFile->append(reflowedLines[i].flags(), reflowedLines[i].packLossy());
+                dropFailedHistoryFile();
+            }
+            reflowedLineCount -= excessLineCount;
+        }
+
+        // The reflowed lines become the oldest history lines in the ring buffer, taking over the unused
+        // lines right above these, such that none of the lines reflowed already needs to be moved.
+        auto const totalLineCount = _linesUsed + reflowedLineCount;
+        if (totalLineCount > LineCount::cast_from(_lines.size()))
+            growBuffers(totalLineCount - LineCount::cast_from(_lines.size()));
+        auto const placedLines = std::next(reflowedLines.rbegin(), unbox<long>(reflowedLineCount));
+        for (auto line = reflowedLines.rbegin(); line != placedLines; ++line)
+        {
+            _lines[-unbox<long>(inMemoryHistoryLineCount()) - 1] = std::move(*line);
+            ++_linesUsed;
+        }
+    }
+
+    // The reflowed lines inflating later on allocate their cells from the arena again.
+    assignCellArena();
+    packReflowedHistory(previousLineCount);
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::reflowAllHistory(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Lines dropped to the history file are dropped one by one, just as they are reflowed one by one.
+    if (threadCount == 1 || _historyFile || _unreflowedLines.size() < detail::ParallelReflowMinLineCount)
+    {
+        reflowHistory(LineCount::cast_from(std::numeric_limits<int>::max()));
+        return;
+    }
+
+    evictUnreflowedLineCache();
+    auto const previousLineCount = inMemoryHistoryLineCount();
+    auto lines = std::vector<Line<Cell>>(std::make_move_iterator(_unreflowedLines.begin()),
+                                         std::make_move_iterator(_unreflowedLines.end()));
+    _unreflowedLines.clear();
+
+    // The cell arena is not thread-safe, thus the lines are reflowed with cells allocated from the heap.
+    for (auto& line: lines)
+        detail::moveCellsToHeap(line);
+
+    // Partition the lines into chunks of logical lines, to be reflowed by whichever thread is idle.
+    auto chunks = std::vector<gsl::span<Line<Cell>>> {};
+    auto const chunkCount = std::min<size_t>(threadCount * detail::ReflowChunksPerThread, lines.size());
+    for (size_t i = 0, top = 0; i < chunkCount; ++i)
+    {
+        auto bottom = i + 1 == chunkCount ? lines.size() : lines.size() * (i + 1) / chunkCount;
+        while (bottom < lines.size() && lines[bottom].wrapped())
+            ++bottom;
+        if (bottom > top)
+            chunks.emplace_back(gsl::span(lines).subspan(top, bottom - top));
+        top = std::max(top, bottom);
+    }
+
+    auto reflowedChunks = std::vector<std::vector<Line<Cell>>>(chunks.size());
+    auto nextChunk = std::atomic<size_t> { 0 };
+    auto const reflowChunks = [&]() {
+        for (auto i = nextChunk++; i < chunks.size(); i = nextChunk++)
+            detail::reflowLogicalLines<Cell>(reflowedChunks[i], chunks[i], _pageSize.columns);
+    };
+    auto workers = std::vector<std::thread> {};
+    for (size_t i = 1; i < std::min<size_t>(threadCount, chunks.size()); ++i)
+        workers.emplace_back(reflowChunks);
+    reflowChunks();
+    for (auto& worker: workers)
+        worker.join();
+
+    // Splice the reflowed lines into the ring buffer, most recent ones first, up to the history limit.
+    auto lineCount = LineCount(0);
+    for (auto const& reflowedLines: reflowedChunks)
+        lineCount += LineCount::cast_from(reflowedLines.size());
+    if (auto const maxLineCount = inMemoryHistoryLimit())
+        lineCount = std::min(lineCount, std::max(*maxLineCount - previousLineCount, LineCount(0)));
+    auto const totalLineCount = _linesUsed + lineCount;
+    if (totalLineCount > LineCount::cast_from(_lines.size()))
+        growBuffers(totalLineCount - LineCount::cast_from(_lines.size()));
+
+    auto const historyLineCount = previousLineCount + lineCount;
+    for (auto chunk = reflowedChunks.rbegin(); chunk != reflowedChunks.rend(); ++chunk)
+    {
+        for (auto line = chunk->rbegin();
+             line != chunk->rend() && inMemoryHistoryLineCount() < historyLineCount;
+             ++line)
+        {
+            _lines[-unbox<long>(inMemoryHistoryLineCount()) - 1] = std::move(*line);
+            ++_linesUsed;
+        }
+    }
+
+    packReflowedHistory(previousLineCount);
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::packReflowedHistory(LineCount previousLineCount)
+{
+    // The reflowed lines are as cold as the lines they have been reflowed from.
+    if (!_coldHistoryDistance || _historyFile)
+        return;
+
+    auto const ChunkLineCount = LineCount::cast_from(ColdLineChunk::MaxLines);
+    auto const bottom = -boxed_cast<LineOffset>(std::max(previousLineCount, *_coldHistoryDistance));
+    for (auto top = -boxed_cast<LineOffset>(inMemoryHistoryLineCount()); top < bottom;
+         top += boxed_cast<LineOffset>(ChunkLineCount))
+        packHistoryLines(top, std::min(ChunkLineCount, boxed_cast<LineCount>(bottom - top)));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::dropUnreflowedHistory(LineCount count)
+{
+    evictUnreflowedLineCache();
+    for (auto i = LineCount(0); i < count; ++i)
+    {
+        auto const& line = _unreflowedLines.front();
+        if (_historyFile)
+            _historyFile->append(line.flags(), line.packLossy());
+        _unreflowedLines.pop_front();
+    }
+    dropFailedHistoryFile();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::makeRoomForHistory(LineCount count)
+{
+    auto const maxLineCount = inMemoryHistoryLimit();
+    if (_unreflowedLines.empty() || !maxLineCount)
+        return;
+
+    auto const lineCount = inMemoryHistoryLineCount() + unreflowedHistoryLineCount() + count;
+    if (lineCount > *maxLineCount)
+        dropUnreflowedHistory(std::min(lineCount - *maxLineCount, unreflowedHistoryLineCount()));
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clampHistory()
@@ -1197,3 +2067,7 @@ template std::string terminal::dumpGrid<terminal::CompactCell>(terminal::Grid<te
 #include <vtbackend/cell/SimpleCell.h>
 template class terminal::Grid<terminal::SimpleCell>;
 template std::string terminal::dumpGrid<terminal::SimpleCell>(terminal::Grid<terminal::SimpleCell> const&);
+
+#include <vtbackend/cell/PodCell.h>
+template class terminal::Grid<terminal::PodCell>;
+template std::string terminal::dumpGrid<terminal::PodCell>(terminal::Grid<terminal::PodCell> const&);
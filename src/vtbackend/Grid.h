@@ -14,14 +14,17 @@
 #pragma once
 
 #include <vtbackend/GraphicsAttributes.h>
+#include <vtbackend/HistoryFile.h>
 #include <vtbackend/Line.h>
 #include <vtbackend/cell/CellConcept.h>
+#include <vtbackend/cell/PodCell.h>
 #include <vtbackend/primitives.h>
 
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
 #include <crispy/defines.h>
 #include <crispy/ring.h>
+#include <crispy/segmented_vector.h>
 
 #include <unicode/convert.h>
 
@@ -34,10 +37,16 @@
 
 #include <algorithm>
 #include <array>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace terminal
 {
@@ -106,8 +115,35 @@ constexpr bool operator!=(Margin const& a, PageSize b) noexcept
 }
 // }}}
 
+/// Ring of grid lines, stored in fixed-size segments,
+/// so that growing the history never reallocates (and moves) the lines already stored.
 template <typename Cell>
-using Lines = crispy::ring<Line<Cell>>;
+using Lines = crispy::ring<Line<Cell>, crispy::segmented_vector>;
+
+/// Range of consecutive lines of a Lines<Cell> ring, such as a page.
+///
+/// The lines are not contiguous in memory, as the ring wraps around and stores its lines in segments.
+template <typename Iterator>
+struct LineRange
+{
+    Iterator first;
+    Iterator last;
+
+    [[nodiscard]] Iterator begin() const noexcept { return first; }
+    [[nodiscard]] Iterator end() const noexcept { return last; }
+    [[nodiscard]] size_t size() const noexcept { return static_cast<size_t>(last - first); }
+    [[nodiscard]] auto& operator[](size_t i) const noexcept
+    {
+        return *std::next(first, static_cast<long>(i));
+    }
+
+    /// @returns the @p count lines starting at line @p offset of this range.
+    [[nodiscard]] LineRange subrange(size_t offset, size_t count) const noexcept
+    {
+        auto const from = std::next(first, static_cast<long>(offset));
+        return LineRange { from, std::next(from, static_cast<long>(count)) };
+    }
+};
 
 struct RenderPassHints
 {
@@ -604,7 +640,8 @@ class Grid
         if (auto const* maxLineCount = std::get_if<LineCount>(&_historyLimit))
             return *maxLineCount;
         else
-            return LineCount::cast_from(_lines.size()) - _pageSize.lines;
+            return LineCount::cast_from(_lines.size()) - _pageSize.lines + unreflowedHistoryLineCount()
+                   + diskHistoryLineCount();
     }
 
     void setMaxHistoryLineCount(MaxHistoryLineCount maxHistoryLineCount);
@@ -614,7 +651,48 @@ class Grid
         return maxHistoryLineCount() + _pageSize.lines;
     }
 
-    [[nodiscard]] LineCount historyLineCount() const noexcept { return _linesUsed - _pageSize.lines; }
+    [[nodiscard]] LineCount historyLineCount() const noexcept
+    {
+        return inMemoryHistoryLineCount() + unreflowedHistoryLineCount() + diskHistoryLineCount();
+    }
+
+    /// @returns the number of (oldest) history lines stored on disk rather than in memory.
+    [[nodiscard]] LineCount diskHistoryLineCount() const noexcept
+    {
+        return _historyFile ? LineCount::cast_from(_historyFile->lineCount()) : LineCount(0);
+    }
+
+    /// Releases the history lines read from disk, or resized to the page's width before being reflowed,
+    /// and evicted from the cache of these since, invalidating any reference to these.
+    void releaseEvictedHistoryLines() noexcept { _evictedHistoryLines.clear(); }
+
+    /// @returns the number of history lines right above the main page that are never packed
+    ///          into compressed chunks, or std::nullopt if history lines are never packed.
+    [[nodiscard]] std::optional<LineCount> coldHistoryDistance() const noexcept
+    {
+        return _coldHistoryDistance;
+    }
+
+    /// Sets the number of history lines right above the main page that are kept as they are,
+    /// with any history line beyond being packed into compressed chunks (see ColdLineChunk).
+    void setColdHistoryDistance(std::optional<LineCount> distance);
+
+    /// @returns statistics of the arena the cells of inflated lines are allocated from.
+    [[nodiscard]] CellArena::Stats const& cellArenaStats() const noexcept { return _cellArena->stats(); }
+
+    /// @returns the memory held by the buffer objects the text of the lines in memory refers to.
+    [[nodiscard]] crispy::BufferObjectUsage bufferObjectUsage() const;
+
+    /// Copies the text of lines referring to sparsely used buffer objects (such as PTY buffers
+    /// with most of their lines gone) into a dense buffer object, such that the former get released.
+    ///
+    /// @returns the memory held by the buffer objects referred to before compacting them.
+    crispy::BufferObjectUsage compactBufferObjects(float maxLoadFactor);
+
+    /// Marks the extra data of all cells held by this grid as still in use (for PodCell only).
+    ///
+    /// @see PodCellExtras::collect()
+    void markCellExtras(PodCellExtras::Marker& marker) const;
 
     [[nodiscard]] bool reflowOnResize() const noexcept { return _reflowOnResize; }
     void setReflowOnResize(bool enabled) { _reflowOnResize = enabled; }
@@ -625,16 +703,52 @@ class Grid
 
     /// Resizes the main page area of the grid and adapts the scrollback area's width accordingly.
     ///
+    /// When reflowing, only the main page and the history lines right above it are reflowed right away.
+    /// Older history lines keep the width they have been written with until reflowed by reflowHistory(),
+    /// such that resizing over and over only reflows these once, to the final width.
+    ///
     /// @param pageSize          new size of the main page area
     /// @param currentCursorPos  current cursor position
     /// @param wrapPending       AutoWrap is on and a wrap is pending
     ///
     /// @returns updated cursor position.
     [[nodiscard]] CellLocation resize(PageSize newSize, CellLocation currentCursorPos, bool wrapPending);
+
+    /// @returns the number of (oldest) history lines in memory not reflowed to the page's width yet.
+    ///
+    /// These lines are counted with the width they have been written with. Accessing any of these for
+    /// modification reflows it on demand, along with all more recent ones, whereas reading it through
+    /// the const lineAt() overload merely resizes a copy of it (see unreflowedHistoryLineAt()).
+    [[nodiscard]] LineCount unreflowedHistoryLineCount() const noexcept
+    {
+        return LineCount::cast_from(_unreflowedLines.size());
+    }
+
+    /// Reflows history lines not reflowed to the page's width yet, most recent ones first, until
+    /// at least @p count history lines right above the main page are reflowed, or all of them are.
+    ///
+    /// Reflowing may change the number of history lines, but not the offsets of the lines reflowed before.
+    void reflowHistory(LineCount count);
+
+    /// Reflows at least @p count more history lines not reflowed to the page's width yet, if any.
+    void reflowMoreHistory(LineCount count) { reflowHistory(inMemoryHistoryLineCount() + count); }
+
+    /// Reflows all history lines not reflowed to the page's width yet.
+    ///
+    /// Logical lines are reflowed independently of each other, thus many of these are reflowed
+    /// on up to @p threadCount threads, or as many as there are hardware threads if 0,
+    /// with the same result as reflowing these one by one.
+    void reflowAllHistory(unsigned threadCount = 0);
     // }}}
 
     // {{{ Line API
     /// @returns reference to Line at given relative offset @p line.
+    ///
+    /// Accessing a history line not reflowed to the page's width yet for modification reflows it first
+    /// (see reflowHistory()), and a history line stored on disk is kept in memory from then on.
+    /// The const overload never modifies the grid, reading such lines through a cache instead
+    /// (see unreflowedHistoryLineAt() and historyFileLineAt()), thus readers wanting these lines reflowed
+    /// reflow them beforehand.
     [[nodiscard]] Line<Cell>& lineAt(LineOffset line) noexcept;
     [[nodiscard]] Line<Cell> const& lineAt(LineOffset line) const noexcept;
 
@@ -668,33 +782,40 @@ class Grid
     [[nodiscard]] Cell const& at(LineOffset line, ColumnOffset column) const noexcept;
 
     // page view API
-    [[nodiscard]] gsl::span<Line<Cell>> pageAtScrollOffset(ScrollOffset scrollOffset);
-    [[nodiscard]] gsl::span<Line<Cell> const> pageAtScrollOffset(ScrollOffset scrollOffset) const;
-    [[nodiscard]] gsl::span<Line<Cell>> mainPage();
-    [[nodiscard]] gsl::span<Line<Cell> const> mainPage() const;
+    using PageLines = LineRange<typename Lines<Cell>::iterator>;
+    using ConstPageLines = LineRange<typename Lines<Cell>::const_iterator>;
+    [[nodiscard]] PageLines pageAtScrollOffset(ScrollOffset scrollOffset);
+    [[nodiscard]] ConstPageLines pageAtScrollOffset(ScrollOffset scrollOffset) const;
+    [[nodiscard]] PageLines mainPage();
+    [[nodiscard]] ConstPageLines mainPage() const;
+
+    // NB: Logical lines only span the history lines in memory, excluding the ones on disk.
 
     [[nodiscard]] LogicalLines<Cell> logicalLines()
     {
-        return LogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()),
+        return LogicalLines<Cell> { boxed_cast<LineOffset>(-inMemoryHistoryLineCount()),
                                     boxed_cast<LineOffset>(_pageSize.lines - 1),
                                     _lines };
     }
 
     [[nodiscard]] LogicalLines<Cell> logicalLinesFrom(LineOffset offset)
     {
-        return LogicalLines<Cell> { offset, boxed_cast<LineOffset>(_pageSize.lines - 1), _lines };
+        return LogicalLines<Cell> { std::max(offset, boxed_cast<LineOffset>(-inMemoryHistoryLineCount())),
+                                    boxed_cast<LineOffset>(_pageSize.lines - 1),
+                                    _lines };
     }
 
     [[nodiscard]] ReverseLogicalLines<Cell> logicalLinesReverse()
     {
-        return ReverseLogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()),
+        return ReverseLogicalLines<Cell> { boxed_cast<LineOffset>(-inMemoryHistoryLineCount()),
                                            boxed_cast<LineOffset>(_pageSize.lines - 1),
                                            _lines };
     }
 
     [[nodiscard]] ReverseLogicalLines<Cell> logicalLinesReverseFrom(LineOffset offset)
     {
-        return ReverseLogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()), offset, _lines };
+        auto const top = boxed_cast<LineOffset>(-inMemoryHistoryLineCount());
+        return ReverseLogicalLines<Cell> { top, std::max(offset, top), _lines };
     }
 
     // {{{ buffer manipulation
@@ -727,6 +848,10 @@ class Grid
 
     // {{{ Rendering API
     /// Renders the full screen by passing every grid cell to the callback.
+    ///
+    /// Before rendering a line, the renderer is asked to reuse that line as rendered before
+    /// by passing it the line's generation (see Line<Cell>::generation()), and is told about
+    /// every line that has been rendered, along with the line's generation.
     template <typename RendererT>
     [[nodiscard]] RenderPassHints render(
         RendererT&& render,
@@ -786,6 +911,16 @@ class Grid
             return CellLocation { lineOffset, columnOffset };
         }
 
+        if (line.isAttributedBuffer())
+        {
+            if (line.empty())
+                return CellLocation { lineOffset, ColumnOffset(0) };
+
+            auto const& attributed = line.attributedBuffer();
+            auto const columnOffset = ColumnOffset::cast_from(attributed.usedColumns - 1);
+            return CellLocation { lineOffset, columnOffset };
+        }
+
         auto const& inflatedLine = line.cells();
         auto columnOffset = ColumnOffset::cast_from(_pageSize.columns - 1);
         while (columnOffset > ColumnOffset(0) && inflatedLine[unbox<size_t>(columnOffset)].empty())
@@ -799,6 +934,18 @@ class Grid
     }
 
   private:
+    [[nodiscard]] LineCount inMemoryHistoryLineCount() const noexcept { return _linesUsed - _pageSize.lines; }
+
+    /// @returns the maximum number of history lines in memory, or std::nullopt if unlimited.
+    [[nodiscard]] std::optional<LineCount> inMemoryHistoryLimit() const noexcept
+    {
+        if (auto const* maxLineCount = std::get_if<LineCount>(&_historyLimit))
+            return *maxLineCount;
+        if (auto const* diskBacked = std::get_if<InfiniteDiskBacked>(&_historyLimit))
+            return diskBacked->inMemoryLineCount;
+        return std::nullopt;
+    }
+
     CellLocation growLines(LineCount newHeight, CellLocation cursor);
     void appendNewLines(LineCount count, GraphicsAttributes attr);
     void clampHistory();
@@ -806,18 +953,94 @@ class Grid
     // {{{ buffer helpers
     void resizeBuffers(PageSize newSize)
     {
-        auto const newTotalLineCount = historyLineCount() + newSize.lines;
+        auto const newTotalLineCount = inMemoryHistoryLineCount() + newSize.lines;
         _lines.resize(unbox<size_t>(newTotalLineCount));
         _pageSize = newSize;
+        assignCellArena();
     }
 
     void rezeroBuffers() noexcept { _lines.rezero(); }
 
+    /// Grows the ring buffer by at least @p count unused lines right below the main page.
+    void growBuffers(LineCount count);
+
+    /// Packs the oldest hot history lines into compressed chunks, as long as more than
+    /// the cold history distance of them are hot.
+    void packColdHistory();
+
+    /// Packs the @p count history lines starting at @p top into a compressed chunk,
+    /// skipping any line that is cold already or cannot be packed.
+    void packHistoryLines(LineOffset top, LineCount count);
+
+    /// Moves the history lines in memory older than the ones reflowed right away on resize
+    /// to the unreflowed history lines.
+    void deferHistoryReflow();
+
+    /// Packs the history lines reflowed on top of the @p previousLineCount history lines reflowed before
+    /// into compressed chunks, as far as these are beyond the cold history distance.
+    void packReflowedHistory(LineCount previousLineCount);
+
+    /// Drops the @p count oldest unreflowed history lines, moving them to the history file if any.
+    void dropUnreflowedHistory(LineCount count);
+
+    /// Drops as many of the oldest unreflowed history lines as needed for @p count more history lines
+    /// to fit into memory.
+    void makeRoomForHistory(LineCount count);
+
+    /// Makes all lines allocate their cells from this grid's cell arena when inflated.
+    void assignCellArena() noexcept;
+
+    /// Creates or removes the history file, depending on the history limit.
+    void updateHistoryFile();
+
+    /// Appends the @p count lines starting at @p top to the history file.
+    void appendToHistoryFile(LineOffset top, LineCount count);
+
+    /// Drops the history file if writing to it has failed, keeping the history in memory from then on,
+    /// bounded by the number of lines the disk-backed history keeps in memory.
+    void dropFailedHistoryFile();
+
+    /// Moves the @p count oldest history lines in memory to the history file.
+    void spillHistory(LineCount count);
+
+    /// Moves the history lines in memory exceeding the disk-backed history's limit to the history file.
+    void spillExcessHistory();
+
+    /// @returns the line at the given index of the history file, read through a cache of recent lines.
+    ///
+    /// The line stays valid until the grid gets modified next, or releaseEvictedHistoryLines().
+    [[nodiscard]] Line<Cell> const& historyFileLineAt(size_t index) const;
+
+    /// @returns the history line not reflowed yet at the given index, resized to the page's width
+    ///          without reflowing it, read through a cache of recent lines.
+    ///
+    /// The line stays valid until the grid gets modified next, or releaseEvictedHistoryLines().
+    [[nodiscard]] Line<Cell> const& unreflowedHistoryLineAt(size_t index) const;
+
+    /// Moves the lines in the cache of unreflowed lines to the evicted ones, as the lines these
+    /// have been resized from are about to change.
+    void evictUnreflowedLineCache();
+
+    /// @returns the line at the given index of the history file, to be modified.
+    ///
+    /// As the history file is append-only, the line is kept in memory from then on.
+    [[nodiscard]] Line<Cell>& modifiableHistoryFileLineAt(size_t index);
+
+    void clearHistoryFileCache();
+
     void rotateBuffers(int offset) noexcept { _lines.rotate(offset); }
 
     void rotateBuffersLeft(LineCount count) noexcept { _lines.rotate_left(unbox<size_t>(count)); }
 
     void rotateBuffersRight(LineCount count) noexcept { _lines.rotate_right(unbox<size_t>(count)); }
+
+    /// Rotates the lines within the vertical @p margin up by @p count lines, or down if negative,
+    /// by rotating the whole ring buffer and moving back only the lines outside of the margin,
+    /// such that scrolling a large margin takes time by the few lines outside of it.
+    ///
+    /// @returns false, leaving all lines in place, if the ring buffer holds history lines that would
+    ///          be moved along, or if there are fewer lines within the margin than outside of it.
+    [[nodiscard]] bool rotateBuffersWithinMargin(Margin::Vertical margin, int count) noexcept;
     // }}}
 
     // private fields
@@ -827,6 +1050,9 @@ class Grid
     bool _reflowOnResize = false;
     MaxHistoryLineCount _historyLimit;
 
+    // Cells of inflated lines, outliving the lines.
+    std::unique_ptr<CellArena> _cellArena;
+
     // Number of lines is at least the sum of _maxHistoryLineCount + _pageSize.lines,
     // because shrinking the page height does not necessarily
     // have to resize the array (as optimization).
@@ -834,6 +1060,32 @@ class Grid
 
     // Number of lines used in the Lines buffer.
     LineCount _linesUsed;
+
+    // Number of most recent history lines not yet considered for packing into compressed chunks.
+    std::optional<LineCount> _coldHistoryDistance;
+    LineCount _hotHistoryLineCount {};
+
+    // Oldest history lines in memory not reflowed to the page's width yet, all of them being older than
+    // the history lines in _lines, and each one having the width it has been written or last reflowed with.
+    // The most recent one of these ends a logical line.
+    std::deque<Line<Cell>> _unreflowedLines;
+
+    // Oldest history lines, if the history is disk-backed, all of them being older than the ones in memory.
+    std::unique_ptr<HistoryFile> _historyFile;
+
+    // Lines recently read from the history file, each stored at its index modulo the cache size,
+    // such that any range of consecutive lines fitting into the cache is available at once.
+    mutable std::vector<std::pair<size_t, std::shared_ptr<Line<Cell> const>>> _historyFileCache;
+
+    // Unreflowed lines recently resized to the page's width, by their index modulo the cache size.
+    mutable std::vector<std::pair<size_t, std::shared_ptr<Line<Cell> const>>> _unreflowedLineCache;
+
+    // Lines replaced in the caches above since the grid has last been modified, such that reading
+    // a history line never invalidates another one read before.
+    mutable std::vector<std::shared_ptr<Line<Cell> const>> _evictedHistoryLines;
+
+    // Lines of the history file modified through lineAt(), kept in memory as the file is append-only.
+    std::unordered_map<size_t, Line<Cell>> _modifiedHistoryFileLines;
 };
 
 template <typename Cell>
@@ -879,29 +1131,41 @@ template <typename RendererT>
     for (int i = -*scrollOffset, e = i + *_pageSize.lines; i != e; ++i, ++y)
     {
         auto x = ColumnOffset(0);
-        Line<Cell> const& line = _lines[i];
+        Line<Cell> const& line = lineAt(LineOffset(i));
+        auto const generation = line.generation();
+        if (render.reuseLine(y, generation))
+            continue;
+
+        auto blinking = false;
         // NB: trivial liner rendering only works trivially if we don't do cell-based operations
         // on the text. Therefore, we only move to the trivial fast path here if we don't want to
         // highlight search matches.
         if (line.isTrivialBuffer() && highlightSearchMatches == HighlightSearchMatches::No)
         {
             auto const cellFlags = line.trivialBuffer().textAttributes.flags;
-            hints.containsBlinkingCells = hints.containsBlinkingCells || (CellFlags::Blinking & cellFlags)
-                                          || (CellFlags::RapidBlinking & cellFlags);
+            blinking = (CellFlags::Blinking & cellFlags) || (CellFlags::RapidBlinking & cellFlags);
             render.renderTrivialLine(line.trivialBuffer(), y);
         }
+        else if (line.isAttributedBuffer() && highlightSearchMatches == HighlightSearchMatches::No)
+        {
+            for (auto const& run: line.attributedBuffer().runs)
+                blinking = blinking || (CellFlags::Blinking & run.attributes.flags)
+                           || (CellFlags::RapidBlinking & run.attributes.flags);
+            render.renderAttributedLine(line.attributedBuffer(), y);
+        }
         else
         {
             render.startLine(y);
             for (Cell const& cell: line.cells())
             {
-                hints.containsBlinkingCells = hints.containsBlinkingCells
-                                              || (CellFlags::Blinking & cell.flags())
-                                              || (CellFlags::RapidBlinking & cell.flags());
+                blinking = blinking || (CellFlags::Blinking & cell.flags())
+                           || (CellFlags::RapidBlinking & cell.flags());
                 render.renderCell(cell, y, x++);
             }
             render.endLine();
         }
+        hints.containsBlinkingCells = hints.containsBlinkingCells || blinking;
+        render.lineRendered(y, generation, blinking);
     }
     render.finish();
     return hints;
@@ -11,6 +11,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtbackend/ColdLineChunk.h>
 #include <vtbackend/Grid.h>
 #include <vtbackend/cell/CellConfig.h>
 #include <vtbackend/primitives.h>
@@ -19,7 +20,11 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <random>
+#include <utility>
 
 using namespace terminal;
 using namespace std::string_literals;
@@ -144,6 +149,26 @@ Grid<Cell> setupGridForResizeTests2x3a3()
     return setupGridForResizeTests2x3xN(LineCount(3));
 }
 
+/// @returns the text of all logical lines of the grid, from its oldest history line on,
+///          without inflating any of these lines.
+std::vector<string> logicalLineTexts(Grid<Cell> const& grid)
+{
+    auto texts = std::vector<string> {};
+    for (int y = -grid.historyLineCount().as<int>(); y < grid.pageSize().lines.as<int>(); ++y)
+    {
+        auto const& line = grid.lineAt(LineOffset::cast_from(y));
+        auto text = line.toUtf8();
+        if (line.wrapped() && !texts.empty())
+            texts.back() += text;
+        else
+            texts.emplace_back(std::move(text));
+    }
+    for (auto& text: texts)
+        while (!text.empty() && text.back() == ' ')
+            text.pop_back();
+    return texts;
+}
+
 } // namespace
 
 TEST_CASE("Grid.setup", "[grid]")
@@ -850,6 +875,179 @@ TEST_CASE("Grid.reflow.tripple", "[grid]")
     }
 }
 
+TEST_CASE("Grid.resize.reflows_history_lazily", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10'000));
+    auto constexpr LineCountWritten = 3000;
+    for (int i = 0; i < LineCountWritten; ++i)
+    {
+        grid.setLineText(LineOffset(0), fmt::format("{:04}", i));
+        grid.scrollUp(LineCount(1));
+    }
+    auto const texts = logicalLineTexts(grid);
+
+    // Only the page and the history lines right above it are reflowed right away.
+    auto const cursor = CellLocation { LineOffset(1), ColumnOffset(0) };
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(3) }, cursor, false);
+    auto const unreflowedLineCount = grid.unreflowedHistoryLineCount();
+    REQUIRE(unreflowedLineCount > LineCount(0));
+
+    // Reading an unreflowed history line leaves it unreflowed, merely resized to the page's width.
+    auto const oldestLine = LineOffset(-grid.historyLineCount().as<int>());
+    CHECK(std::as_const(grid).lineAt(oldestLine).size() == ColumnCount(3));
+    CHECK(std::as_const(grid).lineText(oldestLine) == "000");
+    CHECK(grid.unreflowedHistoryLineCount() == unreflowedLineCount);
+
+    // Accessing an unreflowed history line for modification reflows it,
+    // such that it is modified like any other line.
+    auto const reflowedLineCount = grid.historyLineCount() - unreflowedLineCount;
+    auto const unreflowedLine = -boxed_cast<LineOffset>(reflowedLineCount) - LineOffset(10);
+    grid.lineAt(unreflowedLine).setMarked(true);
+    CHECK(grid.unreflowedHistoryLineCount() < unreflowedLineCount);
+    CHECK(grid.lineAt(unreflowedLine).size() == ColumnCount(3));
+    for (auto line = unreflowedLine - LineOffset(2000); line < unreflowedLine; ++line)
+        (void) grid.lineText(line);
+    CHECK(grid.lineAt(unreflowedLine).marked());
+
+    // Reflowing the remaining history keeps the offsets of the lines reflowed before.
+    auto const recentText = grid.lineText(LineOffset(-10));
+    grid.reflowAllHistory();
+    CHECK(grid.unreflowedHistoryLineCount() == LineCount(0));
+    CHECK(grid.lineText(LineOffset(-10)) == recentText);
+    CHECK(grid.lineAt(unreflowedLine).marked());
+    CHECK(logicalLineTexts(grid) == texts);
+
+    // Resizing over and over reflows the older history lines only once, to the final width.
+    for (int i = 0; i < 20; ++i)
+    {
+        auto const columns = ColumnCount(2 + i % 5);
+        (void) grid.resize(PageSize { LineCount(2), columns }, cursor, false);
+        CHECK(grid.lineText(LineOffset(-grid.historyLineCount().as<int>())).size() == unbox<size_t>(columns));
+    }
+    grid.reflowAllHistory();
+    CHECK(grid.unreflowedHistoryLineCount() == LineCount(0));
+    CHECK(logicalLineTexts(grid) == texts);
+}
+
+TEST_CASE("Grid.resize.reflows_history_lazily_within_limit", "[grid]")
+{
+    auto constexpr MaxHistoryLineCount = LineCount(2000);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, MaxHistoryLineCount);
+    for (int i = 0; i < 1500; ++i)
+    {
+        grid.setLineText(LineOffset(0), fmt::format("{:04}", i));
+        grid.scrollUp(LineCount(1));
+    }
+
+    // Reflowing into twice as many lines drops the oldest ones exceeding the history limit.
+    auto const cursor = CellLocation { LineOffset(1), ColumnOffset(0) };
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(2) }, cursor, false);
+    grid.reflowAllHistory();
+    CHECK(grid.unreflowedHistoryLineCount() == LineCount(0));
+    CHECK(grid.historyLineCount() == MaxHistoryLineCount);
+    CHECK(grid.lineText(LineOffset(-2)) == "14");
+    CHECK(grid.lineText(LineOffset(-1)) == "99");
+    CHECK(grid.lineText(LineOffset(-MaxHistoryLineCount.as<int>())) == "05");
+}
+
+TEST_CASE("Grid.resize.reflows_history_in_parallel", "[grid]")
+{
+    // Grids with random line lengths and wraps, with and without cold history, and with a history limit
+    // to be reached or not, are reflowed alike by one thread as by many.
+    for (auto const seed: { 1u, 2u, 3u, 4u })
+    {
+        auto const maxHistoryLineCount = LineCount(seed % 2 ? 6000 : 100'000);
+        auto const setupRandomGrid = [&]() {
+            auto random = std::mt19937 { seed };
+            auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(16) }, true, maxHistoryLineCount);
+            if (seed > 2)
+                grid.setColdHistoryDistance(LineCount(100));
+            for (int i = 0; i < 5000; ++i)
+            {
+                auto const text = fmt::format("{}", i);
+                grid.setLineText(LineOffset(0), text + string(random() % (16 - text.size() + 1), 'x'));
+                grid.lineAt(LineOffset(0)).setWrapped(random() % 3 != 0);
+                grid.scrollUp(LineCount(1));
+            }
+            auto const cursor = CellLocation { LineOffset(2), ColumnOffset(0) };
+            for (int i = 0; i < 3; ++i)
+                (void) grid.resize(PageSize { LineCount(3), ColumnCount(3 + random() % 20) }, cursor, false);
+            return grid;
+        };
+
+        auto serialGrid = setupRandomGrid();
+        auto parallelGrid = setupRandomGrid();
+        REQUIRE(parallelGrid.unreflowedHistoryLineCount() > LineCount(4096));
+        serialGrid.reflowAllHistory(1);
+        parallelGrid.reflowAllHistory(4);
+
+        CHECK(parallelGrid.unreflowedHistoryLineCount() == LineCount(0));
+        REQUIRE(parallelGrid.historyLineCount() == serialGrid.historyLineCount());
+        for (int y = -serialGrid.historyLineCount().as<int>(); y < 3; ++y)
+        {
+            INFO(fmt::format("seed {}, line {}", seed, y));
+            auto const& serialLine = serialGrid.lineAt(LineOffset::cast_from(y));
+            auto const& parallelLine = parallelGrid.lineAt(LineOffset::cast_from(y));
+            CHECK(parallelLine.toUtf8() == serialLine.toUtf8());
+            CHECK(parallelLine.flags() == serialLine.flags());
+            CHECK(parallelLine.cellArena() == parallelGrid.lineAt(LineOffset(0)).cellArena());
+        }
+    }
+}
+
+TEST_CASE("Grid.resize.keeps_trivial_lines", "[grid]")
+{
+    auto const width = ColumnCount(8);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), width }, true, LineCount(100'000));
+    auto const sgr = GraphicsAttributes {};
+
+    // Logical lines of plain text, with some of these written at once and others in pieces.
+    for (int i = 0; i < 3000; ++i)
+    {
+        auto columns = std::vector<string> {};
+        for (auto const ch: fmt::format("{}:", i))
+            columns.emplace_back(1, ch);
+        for (int k = 0; k < i % 20; ++k)
+            columns.emplace_back(i % 7 ? "x" : "\u00E4");
+
+        auto buffer = crispy::BufferObject<char>::create(2 * columns.size());
+        for (size_t begin = 0; begin < columns.size(); begin += unbox<size_t>(width))
+        {
+            if (i % 2)
+                buffer = crispy::BufferObject<char>::create(2 * unbox<size_t>(width));
+            auto const offset = buffer->bytesUsed();
+            auto const end = std::min(columns.size(), begin + unbox<size_t>(width));
+            for (auto k = begin; k < end; ++k)
+            {
+                buffer->writeAtEnd(columns[k]);
+                buffer->advance(columns[k].size());
+            }
+            auto const text = buffer->ref(offset, buffer->bytesUsed() - offset);
+            auto const usedColumns = ColumnCount::cast_from(end - begin);
+            auto const flags = LineFlags::Wrappable | (begin ? LineFlags::Wrapped : LineFlags::None);
+            grid.lineAt(LineOffset(0)) =
+                Line<Cell>(flags, TrivialLineBuffer { width, sgr, sgr, HyperlinkId {}, usedColumns, text });
+            grid.scrollUp(LineCount(1));
+        }
+    }
+    auto const texts = logicalLineTexts(grid);
+
+    // Reflowing cuts and joins the text of the lines, rather than inflating them.
+    auto const cursor = CellLocation { LineOffset(1), ColumnOffset(0) };
+    for (auto const columns: { ColumnCount(5), ColumnCount(13), ColumnCount(8) })
+    {
+        (void) grid.resize(PageSize { LineCount(2), columns }, cursor, false);
+        grid.reflowAllHistory();
+
+        auto inflatedLineCount = 0;
+        for (int y = -grid.historyLineCount().as<int>(); y < 2; ++y)
+            if (!grid.lineAt(LineOffset::cast_from(y)).isTrivialBuffer())
+                ++inflatedLineCount;
+        CHECK(inflatedLineCount == 0);
+        CHECK(logicalLineTexts(grid) == texts);
+    }
+}
+
 TEST_CASE("Grid infinite", "[grid]")
 {
     auto grid_finite = Grid<Cell>(PageSize { LineCount(2), ColumnCount(8) }, true, LineCount(0));
@@ -870,6 +1068,331 @@ TEST_CASE("Grid infinite", "[grid]")
     REQUIRE(grid_infinite.lineText(LineOffset(-98)) == "ABCDEFGH");
 }
 
+TEST_CASE("Grid.scrollUp.history_grows_on_demand", "[grid]")
+{
+    // History lines are only allocated as lines scroll into history, up to the history limit.
+    auto constexpr MaxHistoryLineCount = LineCount(10);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(3) }, true, MaxHistoryLineCount);
+    for (int i = 0; i < 15; ++i)
+    {
+        grid.setLineText(LineOffset(1), fmt::format("{:>3}", i));
+        grid.scrollUp(LineCount(1));
+        CHECK(grid.historyLineCount() == std::min(LineCount(i + 1), MaxHistoryLineCount));
+        CHECK(grid.lineText(LineOffset(0)) == fmt::format("{:>3}", i));
+        CHECK(grid.lineText(LineOffset(1)) == "   ");
+    }
+
+    for (int i = 1; i <= *MaxHistoryLineCount; ++i)
+        CHECK(grid.lineText(LineOffset(-i)) == fmt::format("{:>3}", 14 - i));
+
+    // Growing the page takes lines that were never allocated before.
+    auto const cursor = CellLocation { LineOffset(0), ColumnOffset(0) };
+    (void) grid.resize(PageSize { LineCount(5), ColumnCount(3) }, cursor, false);
+    CHECK(grid.historyLineCount() == MaxHistoryLineCount);
+    CHECK(grid.lineText(LineOffset(0)) == " 14");
+    CHECK(grid.lineText(LineOffset(-1)) == " 13");
+    CHECK(grid.lineText(LineOffset(-10)) == "  4");
+}
+
+TEST_CASE("Grid.mainPage.straddles_segments", "[grid]")
+{
+    // The grid's lines are stored in segments of 256 lines, so the page is not contiguous in memory
+    // once it straddles a segment boundary, or wraps around the end of the ring.
+    auto const pageSize = PageSize { LineCount(20), ColumnCount(3) };
+    auto grid = Grid<Cell>(pageSize, false, LineCount(1000));
+    for (int i = 0; i < 1300; ++i)
+    {
+        grid.setLineText(LineOffset(19), fmt::format("{:>3}", i % 1000));
+        grid.scrollUp(LineCount(1));
+
+        auto const page = grid.mainPage();
+        REQUIRE(page.size() == unbox<size_t>(pageSize.lines));
+        for (int y = 0; y < *pageSize.lines; ++y)
+            REQUIRE(&page[static_cast<size_t>(y)] == &grid.lineAt(LineOffset(y)));
+    }
+
+    auto expected = std::vector<std::string>();
+    for (int y = 0; y < *pageSize.lines; ++y)
+    {
+        expected.emplace_back(fmt::format("{:>3}", y));
+        grid.setLineText(LineOffset(y), expected.back());
+    }
+
+    // Scrolling down the full page resets the lines scrolled in, and no others.
+    grid.scrollDown(LineCount(3), GraphicsAttributes {}, grid.margin());
+    std::rotate(expected.begin(), expected.end() - 3, expected.end());
+    std::fill(expected.begin(), expected.begin() + 3, "   ");
+    for (int y = 0; y < *pageSize.lines; ++y)
+        CHECK(grid.lineText(LineOffset(y)) == expected[static_cast<size_t>(y)]);
+}
+
+TEST_CASE("Grid.scrollUp.within_margin", "[grid]")
+{
+    // Without history lines, scrolling within a margin rotates the whole ring buffer,
+    // which must leave the lines outside of the margin, and the history, as they were.
+    auto const pageSize = PageSize { LineCount(8), ColumnCount(3) };
+    auto const margins = std::array { std::pair { 1, 6 }, std::pair { 0, 5 }, std::pair { 2, 7 } };
+    for (auto const historyLineCount: { 0, 3 })
+    {
+        for (auto const [top, bottom]: margins)
+        {
+            for (int n = 1; n <= bottom - top + 1; ++n)
+            {
+                auto grid = Grid<Cell>(pageSize, false, LineCount(10));
+                for (int i = 0; i < historyLineCount; ++i)
+                {
+                    grid.setLineText(LineOffset(0), fmt::format("h{:>2}", i));
+                    grid.scrollUp(LineCount(1));
+                }
+                auto expected = std::vector<std::string>();
+                for (int y = 0; y < *pageSize.lines; ++y)
+                {
+                    expected.emplace_back(fmt::format("{:>3}", y));
+                    grid.setLineText(LineOffset(y), expected.back());
+                }
+
+                auto const margin = Margin { Margin::Vertical { LineOffset(top), LineOffset(bottom) },
+                                             Margin::Horizontal { ColumnOffset(0), ColumnOffset(2) } };
+                INFO(fmt::format("history {}, margin {}..{}, n {}", historyLineCount, top, bottom, n));
+
+                auto const region = std::next(expected.begin(), top);
+                auto const height = bottom - top + 1;
+
+                grid.scrollUp(LineCount(n), GraphicsAttributes {}, margin);
+                std::rotate(region, region + n, region + height);
+                std::fill(region + height - n, region + height, "   ");
+                for (int y = 0; y < *pageSize.lines; ++y)
+                    CHECK(grid.lineText(LineOffset(y)) == expected[static_cast<size_t>(y)]);
+
+                grid.scrollDown(LineCount(n), GraphicsAttributes {}, margin);
+                std::rotate(region, region + height - n, region + height);
+                std::fill(region, region + n, "   ");
+                for (int y = 0; y < *pageSize.lines; ++y)
+                    CHECK(grid.lineText(LineOffset(y)) == expected[static_cast<size_t>(y)]);
+
+                REQUIRE(grid.historyLineCount() == LineCount(historyLineCount));
+                for (int i = 0; i < historyLineCount; ++i)
+                    CHECK(grid.lineText(LineOffset(i - historyLineCount)) == fmt::format("h{:>2}", i));
+            }
+        }
+    }
+}
+
+TEST_CASE("Grid.scrollUp.within_margin_with_history", "[grid]")
+{
+    // With history lines in the ring buffer, or more lines than the page left from a cleared history,
+    // rotating the whole ring buffer would move these along, thus the lines within the margin are moved
+    // one by one instead. The same goes for left/right margins, whose outside cells stay in place.
+    auto const pageSize = PageSize { LineCount(8), ColumnCount(3) };
+    for (auto const clearHistory: { false, true })
+    {
+        for (auto const left: { 0, 1 })
+        {
+            auto grid = Grid<Cell>(pageSize, false, LineCount(10));
+            for (int i = 0; i < 5; ++i)
+            {
+                grid.setLineText(LineOffset(0), fmt::format("h{:>2}", i));
+                grid.scrollUp(LineCount(1));
+            }
+            if (clearHistory)
+                grid.clearHistory();
+            auto const historyLineCount = clearHistory ? 0 : 5;
+            for (int y = 0; y < *pageSize.lines; ++y)
+                grid.setLineText(LineOffset(y), fmt::format("{}{}{}", y, y, y));
+
+            auto const margin = Margin { Margin::Vertical { LineOffset(1), LineOffset(6) },
+                                         Margin::Horizontal { ColumnOffset(left), ColumnOffset(2) } };
+            INFO(fmt::format("history {}, left margin {}", historyLineCount, left));
+
+            grid.scrollUp(LineCount(2), GraphicsAttributes {}, margin);
+            auto const scrolled = [&](int y, int from) {
+                auto const insideWidth = static_cast<size_t>(3 - left);
+                auto const outside = std::string(static_cast<size_t>(left), static_cast<char>('0' + y));
+                return outside + std::string(insideWidth, from < 0 ? ' ' : static_cast<char>('0' + from));
+            };
+            CHECK(grid.lineText(LineOffset(0)) == "000");
+            for (int y = 1; y <= 4; ++y)
+                CHECK(grid.lineText(LineOffset(y)) == scrolled(y, y + 2));
+            for (int y = 5; y <= 6; ++y)
+                CHECK(grid.lineText(LineOffset(y)) == scrolled(y, -1));
+            CHECK(grid.lineText(LineOffset(7)) == "777");
+
+            REQUIRE(grid.historyLineCount() == LineCount(historyLineCount));
+            for (int i = 0; i < historyLineCount; ++i)
+                CHECK(grid.lineText(LineOffset(i - historyLineCount)) == fmt::format("h{:>2}", i));
+        }
+    }
+}
+
+TEST_CASE("Grid.scrollUp.packs_cold_history", "[grid]")
+{
+    auto constexpr ColdHistoryDistance = LineCount(10);
+    auto const chunkLineCount = static_cast<int>(ColdLineChunk::MaxLines);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(1000));
+    grid.setColdHistoryDistance(ColdHistoryDistance);
+
+    auto const lineCount = *ColdHistoryDistance + 2 * chunkLineCount + 5;
+    for (int i = 0; i < lineCount; ++i)
+    {
+        grid.setLineText(LineOffset(0), fmt::format("{:04}", i));
+        grid.scrollUp(LineCount(1));
+    }
+    REQUIRE(grid.historyLineCount() == LineCount(lineCount));
+
+    // The oldest lines have been packed chunk by chunk, keeping at least the distance of lines hot.
+    auto const coldLineCount = 2 * chunkLineCount;
+    for (int i = 0; i < lineCount; ++i)
+    {
+        INFO(fmt::format("history line {}", i));
+        auto const& line = grid.lineAt(LineOffset(i - lineCount));
+        CHECK(line.isColdBuffer() == (i < coldLineCount));
+    }
+
+    // Reading cold lines preserves all of their contents, yet keeps them packed.
+    auto const& constGrid = grid;
+    for (int i = 0; i < lineCount; ++i)
+    {
+        INFO(fmt::format("history line {}", i));
+        CHECK(constGrid.lineText(LineOffset(i - lineCount)) == fmt::format("{:04}", i));
+        CHECK(constGrid.lineAt(LineOffset(i - lineCount)).isColdBuffer() == (i < coldLineCount));
+    }
+
+    // Modifying a cold line unpacks it for good.
+    grid.setLineText(LineOffset(-lineCount), "abcd");
+    CHECK_FALSE(grid.lineAt(LineOffset(-lineCount)).isColdBuffer());
+    CHECK(grid.lineText(LineOffset(-lineCount)) == "abcd");
+    CHECK(grid.lineAt(LineOffset(1 - lineCount)).isColdBuffer());
+
+    grid.clearHistory();
+    CHECK(grid.historyLineCount() == LineCount(0));
+}
+
+TEST_CASE("Grid.scrollUp.disk_backed_history", "[grid]")
+{
+    auto constexpr InMemoryLineCount = LineCount(5);
+    auto grid = Grid<Cell>(
+        PageSize { LineCount(2), ColumnCount(4) }, true, InfiniteDiskBacked { InMemoryLineCount });
+
+    // Lines beyond the ones kept in memory are moved to disk as they scroll out of memory.
+    auto const lineCount = 3000;
+    for (int i = 0; i < lineCount; ++i)
+    {
+        grid.setLineText(LineOffset(0), fmt::format("{:>4}", i));
+        grid.scrollUp(LineCount(1));
+    }
+    REQUIRE(grid.historyLineCount() == LineCount(lineCount));
+    CHECK(grid.diskHistoryLineCount() == LineCount(lineCount) - InMemoryLineCount);
+
+    // Lines on disk are read back one by one, in any order.
+    for (int i = 0; i < lineCount; ++i)
+        CHECK(grid.lineText(LineOffset(i - lineCount)) == fmt::format("{:>4}", i));
+    for (int i = lineCount - 1; i >= 0; i -= 7)
+        CHECK(grid.lineText(LineOffset(i - lineCount)) == fmt::format("{:>4}", i));
+
+    // Line flags are kept as well.
+    grid.lineAt(LineOffset(-1)).setMarked(true);
+    for (int i = 0; i < *InMemoryLineCount; ++i)
+        grid.scrollUp(LineCount(1));
+    CHECK(grid.lineAt(LineOffset(-1 - *InMemoryLineCount)).marked());
+    CHECK_FALSE(grid.lineAt(LineOffset(-2 - *InMemoryLineCount)).marked());
+
+    // Lines on disk keep their modifications, and stay valid while reading any other ones.
+    auto const top = -grid.historyLineCount().as<int>();
+    grid.lineAt(LineOffset(top)).setMarked(true);
+    auto const& second = std::as_const(grid).lineAt(LineOffset(top + 1));
+    for (int i = 0; i < lineCount; ++i)
+        CHECK(std::as_const(grid).lineText(LineOffset(top + i)) == fmt::format("{:>4}", i));
+    CHECK(second.toUtf8() == "   1");
+    CHECK(std::as_const(grid).lineAt(LineOffset(top)).marked());
+    CHECK_FALSE(second.marked());
+
+    // Resizing moves lines exceeding the ones kept in memory to disk as well.
+    auto const cursor = CellLocation { LineOffset(1), ColumnOffset(0) };
+    (void) grid.resize(PageSize { LineCount(1), ColumnCount(6) }, cursor, false);
+    CHECK(grid.diskHistoryLineCount() == grid.historyLineCount() - InMemoryLineCount);
+    CHECK(grid.lineText(LineOffset(-grid.historyLineCount().as<int>())) == "   0  ");
+
+    grid.clearHistory();
+    CHECK(grid.historyLineCount() == LineCount(0));
+    CHECK(grid.diskHistoryLineCount() == LineCount(0));
+}
+
+TEST_CASE("Grid.compactBufferObjects", "[grid]")
+{
+    auto constexpr BufferSize = size_t(4096);
+    auto constexpr CompactionInterval = 8;
+    auto constexpr LineCountWritten = 1000;
+    auto const width = ColumnCount(8);
+    auto grid = Grid<Cell>(PageSize { LineCount(2), width }, false, LineCount(100));
+    auto pool = crispy::BufferObjectPool<char>(BufferSize);
+    auto const sgr = GraphicsAttributes {};
+
+    // Each buffer object is filled with output that is gone right away (such as a progress bar),
+    // except for a single line that survives in the history, and thus keeps the buffer object alive.
+    for (int i = 0; i < LineCountWritten; ++i)
+    {
+        auto const text = fmt::format("{:>8}", i);
+        if (i % 3 == 0)
+            grid.setLineText(LineOffset(0), text);
+        else
+        {
+            auto buffer = pool.allocateBufferObject();
+            auto const transient = std::string(buffer->capacity() - text.size(), '.');
+            buffer->writeAtEnd(transient);
+            buffer->advance(transient.size());
+            buffer->writeAtEnd(text);
+            buffer->advance(text.size());
+            auto const fragment = buffer->ref(transient.size(), text.size());
+            auto const trivial = TrivialLineBuffer { width, sgr, sgr, HyperlinkId {}, width, fragment };
+            grid.lineAt(LineOffset(0)) = Line<Cell>(LineFlags::None, trivial);
+        }
+        grid.scrollUp(LineCount(1));
+
+        if (i % CompactionInterval == CompactionInterval - 1)
+            (void) grid.compactBufferObjects(0.125f);
+    }
+
+    // Compacting returns the buffer objects to the pool, rather than having it create new ones.
+    CHECK(pool.createdBuffers() <= 2 * CompactionInterval);
+
+    auto const usage = grid.bufferObjectUsage();
+    CHECK(usage.liveBytes <= unbox<size_t>(grid.historyLineCount()) * unbox<size_t>(width));
+    CHECK(usage.pinnedBytes < 2 * BufferSize);
+
+    for (int i = 1; i <= unbox<int>(grid.historyLineCount()); ++i)
+        CHECK(grid.lineText(LineOffset(-i)) == fmt::format("{:>8}", LineCountWritten - i));
+}
+
+TEST_CASE("Grid.cellArena", "[grid]")
+{
+    auto constexpr PageLineCount = 4;
+    auto grid = Grid<Cell>(PageSize { LineCount(PageLineCount), ColumnCount(8) }, false, LineCount(0));
+
+    // Overwriting lines inflates them, and clearing them resets them to trivial lines again.
+    auto const redraw = [&]() {
+        for (auto y = LineOffset(0); y < LineOffset(PageLineCount); ++y)
+            grid.lineAt(y).fill(ColumnOffset(0), GraphicsAttributes {}, "ABCDEFGH");
+        for (auto y = LineOffset(0); y < LineOffset(PageLineCount); ++y)
+            grid.lineAt(y).reset(LineFlags::None, GraphicsAttributes {});
+    };
+
+    redraw();
+    auto const heapAllocations = grid.cellArenaStats().heapAllocations;
+    CHECK(grid.cellArenaStats().allocations == PageLineCount);
+
+    // Redrawing reuses the cells freed by resetting the lines, rather than allocating new ones.
+    for (int i = 0; i < 100; ++i)
+        redraw();
+    CHECK(grid.cellArenaStats().allocations == 101 * PageLineCount);
+    CHECK(grid.cellArenaStats().heapAllocations == heapAllocations);
+
+    // Cells of a width no longer in use are freed by resizing.
+    (void) grid.resize(PageSize { LineCount(PageLineCount), ColumnCount(10) }, CellLocation {}, false);
+    CHECK(grid.cellArenaStats().slabBytes == 0);
+    grid.lineAt(LineOffset(0)).fill(ColumnOffset(0), GraphicsAttributes {}, "ABCDEFGHIJ");
+    CHECK(grid.cellArenaStats().slabBytes == 10 * sizeof(Cell));
+}
+
 TEST_CASE("Grid resize with wrap", "[grid]")
 {
     auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(5) }, true, LineCount(0));
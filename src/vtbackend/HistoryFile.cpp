@@ -0,0 +1,259 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/ColdLineChunk.h>
+#include <vtbackend/HistoryFile.h>
+#include <vtbackend/logging.h>
+
+#include <crispy/BufferObject.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using std::nullopt;
+using std::optional;
+
+namespace terminal
+{
+
+namespace
+{
+    // Each record consists of its size (u32, not counting itself), the line flags (u8),
+    // and the line serialized by serializeLines().
+
+    constexpr size_t RecordHeaderSize = sizeof(uint32_t);
+
+    // Number of bytes to collect before writing them to the file.
+    constexpr size_t FlushThreshold = 64 * 1024;
+
+    // Granularity of the windows of the file being mapped for reading.
+    constexpr uint64_t WindowSize = 1024 * 1024;
+
+    std::string lastErrorString()
+    {
+        return std::error_code(errno, std::system_category()).message();
+    }
+
+    bool writeAt([[maybe_unused]] int fd,
+                 [[maybe_unused]] uint8_t const* data,
+                 [[maybe_unused]] size_t size,
+                 [[maybe_unused]] uint64_t offset)
+    {
+#if !defined(_WIN32)
+        while (size != 0)
+        {
+            auto const n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+} // namespace
+
+std::unique_ptr<HistoryFile> HistoryFile::create()
+{
+#if !defined(_WIN32)
+    auto ec = std::error_code {};
+    auto const tempDirectory = std::filesystem::temp_directory_path(ec);
+    if (ec)
+    {
+        errorlog()("Failed to locate temporary directory for disk-backed history. {}", ec.message());
+        return nullptr;
+    }
+
+    auto directory = (tempDirectory / "contour-history-XXXXXX").string();
+    if (!::mkdtemp(directory.data()))
+    {
+        errorlog()("Failed to create directory for disk-backed history. {}", lastErrorString());
+        return nullptr;
+    }
+
+    auto const path = directory + "/history";
+    auto const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    auto const error = lastErrorString();
+    ::unlink(path.c_str());
+    ::rmdir(directory.c_str());
+
+    if (fd < 0)
+    {
+        errorlog()("Failed to create file for disk-backed history. {}", error);
+        return nullptr;
+    }
+
+    return std::unique_ptr<HistoryFile>(new HistoryFile(fd));
+#else
+    errorlog()("Disk-backed history is not supported on this platform.");
+    return nullptr;
+#endif
+}
+
+HistoryFile::~HistoryFile()
+{
+    unmap();
+#if !defined(_WIN32)
+    ::close(_fd);
+#endif
+}
+
+void HistoryFile::append(LineFlags flags, PackedLineBuffer const& line)
+{
+    if (_failed)
+        return;
+
+    auto const block = serializeLines(gsl::span<PackedLineBuffer const>(&line, 1));
+    auto const recordSize = static_cast<uint32_t>(1 + block.size());
+
+    if (_lineCount % IndexStride == 0)
+        _index.push_back(size());
+
+    auto const offset = _pending.size();
+    _pending.resize(offset + RecordHeaderSize + recordSize);
+    std::memcpy(_pending.data() + offset, &recordSize, RecordHeaderSize);
+    _pending[offset + RecordHeaderSize] = static_cast<uint8_t>(flags);
+    std::memcpy(_pending.data() + offset + RecordHeaderSize + 1, block.data(), block.size());
+    ++_lineCount;
+
+    if (_pending.size() >= FlushThreshold)
+        flush();
+}
+
+void HistoryFile::flush()
+{
+    if (!writeAt(_fd, _pending.data(), _pending.size(), _flushedSize))
+    {
+        // The pending records stay readable, but no more are collected, as these would pile up
+        // in memory for as long as the file cannot be written to. The grid drops the file then.
+        errorlog()("Failed to write disk-backed history. {}", lastErrorString());
+        _failed = true;
+        return;
+    }
+
+    _flushedSize += _pending.size();
+    _pending.clear();
+}
+
+optional<HistoryFileLine> HistoryFile::read(size_t index) const
+{
+    if (index >= _lineCount)
+        return nullopt;
+
+    auto offset = _index[index / IndexStride];
+    for (auto skip = index % IndexStride; skip != 0; --skip)
+    {
+        auto const* header = map(offset, RecordHeaderSize);
+        if (!header)
+            return nullopt;
+        auto recordSize = uint32_t { 0 };
+        std::memcpy(&recordSize, header, RecordHeaderSize);
+        offset += RecordHeaderSize + recordSize;
+    }
+
+    auto const* header = map(offset, RecordHeaderSize);
+    if (!header)
+        return nullopt;
+    auto recordSize = uint32_t { 0 };
+    std::memcpy(&recordSize, header, RecordHeaderSize);
+
+    auto const* record = map(offset + RecordHeaderSize, recordSize);
+    if (!record)
+        return nullopt;
+
+    // Copy out the serialized line only, such that the line does not keep the mapping alive.
+    auto const blockSize = size_t { recordSize } - 1;
+    auto block = crispy::BufferObject<char>::create(blockSize);
+    std::memcpy(block->data(), record + 1, blockSize);
+    block->advance(blockSize);
+
+    return HistoryFileLine { static_cast<LineFlags>(record[0]), deserializeLine(std::move(block), 0) };
+}
+
+void HistoryFile::clear()
+{
+    unmap();
+    _pending.clear();
+    _index.clear();
+    _lineCount = 0;
+    _failed = false;
+
+    if (_flushedSize != 0)
+    {
+#if !defined(_WIN32)
+        if (::ftruncate(_fd, 0) != 0)
+            errorlog()("Failed to truncate disk-backed history. {}", lastErrorString());
+#endif
+        _flushedSize = 0;
+    }
+}
+
+uint8_t const* HistoryFile::map(uint64_t offset, size_t count) const
+{
+    // Records are written as a whole, and thus never span both, the file and the pending records.
+    if (offset >= _flushedSize)
+        return _pending.data() + (offset - _flushedSize);
+
+    if (!_window || offset < _windowOffset || offset + count > _windowOffset + _windowSize)
+    {
+        unmap();
+#if !defined(_WIN32)
+        auto const begin = offset & ~(WindowSize - 1);
+        auto const end = std::min(_flushedSize, std::max(begin + WindowSize, offset + count));
+        auto* window = ::mmap(nullptr, end - begin, PROT_READ, MAP_SHARED, _fd, static_cast<off_t>(begin));
+        if (window == MAP_FAILED)
+        {
+            errorlog()("Failed to map disk-backed history. {}", lastErrorString());
+            return nullptr;
+        }
+        _window = static_cast<uint8_t const*>(window);
+        _windowOffset = begin;
+        _windowSize = end - begin;
+#else
+        return nullptr;
+#endif
+    }
+
+    return _window + (offset - _windowOffset);
+}
+
+void HistoryFile::unmap() const noexcept
+{
+    if (!_window)
+        return;
+
+#if !defined(_WIN32)
+    ::munmap(const_cast<uint8_t*>(_window), _windowSize);
+#endif
+    _window = nullptr;
+    _windowOffset = 0;
+    _windowSize = 0;
+}
+
+} // namespace terminal
@@ -0,0 +1,107 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vtbackend/Line.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace terminal
+{
+
+/// A line as read back from a HistoryFile.
+struct HistoryFileLine
+{
+    LineFlags flags;
+    PackedLineBuffer buffer;
+};
+
+/**
+ * Append-only file of history lines, the disk-backed tier of the grid's history.
+ *
+ * Each line is serialized (see serializeLines()) into a record of its own, and every
+ * IndexStride'th record's file offset is kept in memory, such that reading a line
+ * only maps the part of the file holding it and skips over a few records.
+ *
+ * The file is created in a private temporary directory and unlinked right away,
+ * such that it never outlives the terminal.
+ */
+class HistoryFile
+{
+  public:
+    /// Number of records per index entry.
+    static constexpr size_t IndexStride = 16;
+
+    /// Creates an empty history file.
+    ///
+    /// @returns nullptr if the file could not be created.
+    [[nodiscard]] static std::unique_ptr<HistoryFile> create();
+
+    HistoryFile(HistoryFile const&) = delete;
+    HistoryFile(HistoryFile&&) = delete;
+    HistoryFile& operator=(HistoryFile const&) = delete;
+    HistoryFile& operator=(HistoryFile&&) = delete;
+    ~HistoryFile();
+
+    /// @returns the number of lines stored.
+    [[nodiscard]] size_t lineCount() const noexcept { return _lineCount; }
+
+    /// @returns the number of bytes stored.
+    [[nodiscard]] uint64_t size() const noexcept { return _flushedSize + _pending.size(); }
+
+    /// @returns true if writing to the file has failed, after which no more lines are stored.
+    [[nodiscard]] bool failed() const noexcept { return _failed; }
+
+    /// Appends the given line, as the most recent one, unless writing to the file has failed before.
+    void append(LineFlags flags, PackedLineBuffer const& line);
+
+    /// Reads the line at the given index, with index 0 being the oldest line.
+    ///
+    /// @returns std::nullopt if the line could not be read.
+    [[nodiscard]] std::optional<HistoryFileLine> read(size_t index) const;
+
+    /// Removes all lines, truncating the file.
+    void clear();
+
+  private:
+    explicit HistoryFile(int fd) noexcept: _fd { fd } {}
+
+    /// Writes all pending records to the file.
+    void flush();
+
+    /// @returns pointer to @p count bytes of stored records at the given file offset.
+    [[nodiscard]] uint8_t const* map(uint64_t offset, size_t count) const;
+    void unmap() const noexcept;
+
+    int _fd = -1;
+    size_t _lineCount = 0;
+    uint64_t _flushedSize = 0;
+    bool _failed = false;
+
+    // Records not yet written to the file.
+    std::vector<uint8_t> _pending;
+
+    // File offsets of every IndexStride'th record.
+    std::vector<uint64_t> _index;
+
+    // Window of the file that has been mapped last.
+    mutable uint8_t const* _window = nullptr;
+    mutable uint64_t _windowOffset = 0;
+    mutable size_t _windowSize = 0;
+};
+
+} // namespace terminal
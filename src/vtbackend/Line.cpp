@@ -11,17 +11,30 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtbackend/ColdLineChunk.h>
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Line.h>
+#include <vtbackend/cell/PodCell.h>
 #include <vtbackend/primitives.h>
 
+#include <crispy/LRUCache.h>
+
 #include <unicode/grapheme_segmenter.h>
 #include <unicode/utf8.h>
 #include <unicode/width.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <type_traits>
+
 using std::get;
+using std::get_if;
 using std::holds_alternative;
 using std::min;
+using std::nullopt;
+using std::optional;
+using std::string_view;
 
 namespace terminal
 {
@@ -39,6 +52,11 @@ typename Line<Cell>::InflatedBuffer Line<Cell>::reflow(ColumnCount newColumnCoun
             case Comparison::Less:;
         }
     }
+    else if (isAttributedBuffer() && newColumnCount >= attributedBuffer().usedColumns)
+    {
+        attributedBuffer().displayWidth = newColumnCount;
+        return {};
+    }
     auto& buffer = inflatedBuffer();
     // TODO: Efficiently handle TrivialBuffer-case.
     switch (crispy::strongCompare(newColumnCount, size()))
@@ -103,6 +121,11 @@ inline void Line<Cell>::resize(ColumnCount count)
             buffer.displayWidth = count;
             return;
         }
+        if (isAttributedBuffer() && count >= attributedBuffer().usedColumns)
+        {
+            attributedBuffer().displayWidth = count;
+            return;
+        }
     }
     inflatedBuffer().resize(unbox<size_t>(count));
 }
@@ -131,6 +154,21 @@ std::string Line<Cell>::toUtf8() const
         return str;
     }
 
+    if (isAttributedBuffer())
+    {
+        auto const& lineBuffer = attributedBuffer();
+        auto str = std::string {};
+        for (auto const& run: lineBuffer.runs)
+        {
+            str += run.text.view();
+            for (auto i = displayWidthOf(run.text.view()); i < run.columns; ++i)
+                str += ' ';
+        }
+        for (auto i = lineBuffer.usedColumns; i < lineBuffer.displayWidth; ++i)
+            str += ' ';
+        return str;
+    }
+
     std::string str;
     for (Cell const& cell: inflatedBuffer())
     {
@@ -168,71 +206,572 @@ std::string Line<Cell>::toUtf8Trimmed(bool stripLeadingSpaces, bool stripTrailin
     return output;
 }
 
+namespace
+{
+    /// Appends the cells for the given UTF-8 text, all sharing the same attributes and hyperlink.
+    template <typename Cell>
+    void appendCells(InflatedLineBuffer<Cell>& columns,
+                     std::string_view text,
+                     GraphicsAttributes const& attributes,
+                     HyperlinkId hyperlink,
+                     ColumnCount displayWidth)
+    {
+        static constexpr char32_t ReplacementCharacter { 0xFFFD };
+
+        auto lastChar = char32_t { 0 };
+        auto utf8DecoderState = unicode::utf8_decoder_state {};
+        auto gapPending = 0;
+
+        for (char const ch: text)
+        {
+            unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(ch));
+            if (holds_alternative<unicode::Incomplete>(r))
+                continue;
+
+            auto const nextChar = holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value
+                                                                         : ReplacementCharacter;
+
+            if (unicode::grapheme_segmenter::breakable(lastChar, nextChar))
+            {
+                while (gapPending > 0)
+                {
+                    columns.emplace_back(Cell { attributes, hyperlink });
+                    --gapPending;
+                }
+                auto const charWidth = unicode::width(nextChar);
+                columns.emplace_back(Cell {});
+                columns.back().setHyperlink(hyperlink);
+                columns.back().write(attributes, nextChar, static_cast<uint8_t>(charWidth));
+                gapPending = charWidth - 1;
+            }
+            else
+            {
+                Cell& prevCell = columns.back();
+                auto const extendedWidth = prevCell.appendCharacter(nextChar);
+                if (extendedWidth > 0)
+                {
+                    auto const cellsAvailable = *displayWidth - static_cast<int>(columns.size()) + 1;
+                    auto const n = min(extendedWidth, cellsAvailable);
+                    for (int i = 1; i < n; ++i)
+                    {
+                        columns.emplace_back(Cell { attributes });
+                        columns.back().setHyperlink(hyperlink);
+                    }
+                }
+            }
+            lastChar = nextChar;
+        }
+
+        while (gapPending > 0)
+        {
+            columns.emplace_back(Cell { attributes, hyperlink });
+            --gapPending;
+        }
+    }
+} // namespace
+
 template <typename Cell>
-InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
+InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input, CellArena* arena)
 {
-    static constexpr char32_t ReplacementCharacter { 0xFFFD };
+    auto columns = InflatedLineBuffer<Cell>(CellAllocator<Cell>(arena));
+    columns.reserve(unbox<size_t>(input.displayWidth));
+
+    appendCells(columns, input.text.view(), input.textAttributes, input.hyperlink, input.displayWidth);
+
+    assert(columns.size() == unbox<size_t>(input.usedColumns));
+
+    while (columns.size() < unbox<size_t>(input.displayWidth))
+        columns.emplace_back(Cell { input.fillAttributes });
+
+    return columns;
+}
 
-    auto columns = InflatedLineBuffer<Cell> {};
+template <typename Cell>
+InflatedLineBuffer<Cell> inflate(AttributedLineBuffer const& input, CellArena* arena)
+{
+    auto columns = InflatedLineBuffer<Cell>(CellAllocator<Cell>(arena));
     columns.reserve(unbox<size_t>(input.displayWidth));
 
+    for (auto const& run: input.runs)
+    {
+        auto const runEnd = columns.size() + unbox<size_t>(run.columns);
+        appendCells(columns, run.text.view(), run.attributes, run.hyperlink, input.displayWidth);
+        while (columns.size() < runEnd)
+            columns.emplace_back(Cell { run.attributes, run.hyperlink });
+    }
+
+    assert(columns.size() == unbox<size_t>(input.usedColumns));
+
+    while (columns.size() < unbox<size_t>(input.displayWidth))
+        columns.emplace_back(Cell { input.fillAttributes });
+
+    return columns;
+}
+
+namespace
+{
+    /// Invokes @p visit with the byte offset, column and width of each grapheme cluster in the given
+    /// UTF-8 text, the same way appendCells() would lay them out, until @p visit returns false.
+    template <typename Visitor>
+    void walkGraphemeClusters(std::string_view text, Visitor visit)
+    {
+        static constexpr char32_t ReplacementCharacter { 0xFFFD };
+
+        auto column = 0;
+        auto codepointBegin = size_t { 0 };
+        auto lastChar = char32_t { 0 };
+        auto utf8DecoderState = unicode::utf8_decoder_state {};
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            unicode::ConvertResult const r =
+                unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(text[i]));
+            if (holds_alternative<unicode::Incomplete>(r))
+                continue;
+
+            auto const nextChar = holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value
+                                                                         : ReplacementCharacter;
+            if (unicode::grapheme_segmenter::breakable(lastChar, nextChar))
+            {
+                auto const charWidth = static_cast<int>(unicode::width(nextChar));
+                if (!visit(codepointBegin, column, charWidth))
+                    return;
+                column += charWidth;
+            }
+            lastChar = nextChar;
+            codepointBegin = i + 1;
+        }
+    }
+
+    bool isAscii(std::string_view text) noexcept
+    {
+        return std::all_of(text.begin(), text.end(), [](char ch) { return static_cast<uint8_t>(ch) < 0x80; });
+    }
+} // namespace
+
+ColumnCount displayWidthOf(std::string_view text) noexcept
+{
+    if (isAscii(text))
+        return ColumnCount::cast_from(text.size());
+
+    auto width = 0;
+    walkGraphemeClusters(text, [&](size_t, int column, int charWidth) {
+        width = column + charWidth;
+        return true;
+    });
+    return ColumnCount(width);
+}
+
+size_t graphemeClusterOffsetAt(std::string_view text, ColumnOffset column) noexcept
+{
+    if (isAscii(text))
+        return unbox<size_t>(column) < text.size() ? unbox<size_t>(column) : std::string_view::npos;
+
+    auto result = std::string_view::npos;
+    walkGraphemeClusters(text, [&](size_t offset, int clusterColumn, int) {
+        if (clusterColumn == *column)
+            result = offset;
+        return clusterColumn < *column;
+    });
+    return result;
+}
+
+std::vector<TrivialLineBuffer> reflow(TrivialLineBuffer const& input, ColumnCount newColumnCount)
+{
+    auto const text = input.text.view();
+    auto lines = std::vector<TrivialLineBuffer> {};
+    auto const addLine = [&](size_t begin, size_t end, ColumnCount usedColumns) {
+        lines.emplace_back(TrivialLineBuffer {
+            newColumnCount,
+            input.textAttributes,
+            input.fillAttributes,
+            input.hyperlink,
+            usedColumns,
+            crispy::BufferFragment { input.text.owner(), text.substr(begin, end - begin) } });
+    };
+
+    // US-ASCII text takes one column per byte.
+    if (isAscii(text) && text.size() == unbox<size_t>(input.usedColumns))
+    {
+        auto const columns = unbox<size_t>(newColumnCount);
+        auto begin = size_t { 0 };
+        for (; text.size() - begin > columns; begin += columns)
+            addLine(begin, begin + columns, newColumnCount);
+        addLine(begin, text.size(), ColumnCount::cast_from(text.size() - begin));
+        return lines;
+    }
+
+    auto lineBegin = size_t { 0 };
+    auto lineColumn = 0;
+    auto column = 0;
+    auto codepointBegin = size_t { 0 };
     auto lastChar = char32_t { 0 };
     auto utf8DecoderState = unicode::utf8_decoder_state {};
-    auto gapPending = 0;
-
-    for (char const ch: input.text.view())
+    for (size_t i = 0; i < text.size(); ++i)
     {
-        unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(ch));
+        unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(text[i]));
         if (holds_alternative<unicode::Incomplete>(r))
             continue;
+        if (!holds_alternative<unicode::Success>(r))
+            return {}; // Invalid UTF-8 is shown as replacement characters, taking cell-level access.
 
-        auto const nextChar =
-            holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value : ReplacementCharacter;
-
+        auto const nextChar = get<unicode::Success>(r).value;
         if (unicode::grapheme_segmenter::breakable(lastChar, nextChar))
         {
-            while (gapPending > 0)
+            auto const charWidth = static_cast<int>(unicode::width(nextChar));
+            if (column + charWidth > lineColumn + *newColumnCount)
             {
-                columns.emplace_back(Cell { input.textAttributes, input.hyperlink });
-                --gapPending;
+                if (column != lineColumn + *newColumnCount)
+                    return {}; // A wide character would be cut in half.
+                addLine(lineBegin, codepointBegin, newColumnCount);
+                lineBegin = codepointBegin;
+                lineColumn = column;
             }
-            auto const charWidth = unicode::width(nextChar);
-            columns.emplace_back(Cell {});
-            columns.back().setHyperlink(input.hyperlink);
-            columns.back().write(input.textAttributes, nextChar, static_cast<uint8_t>(charWidth));
-            gapPending = charWidth - 1;
+            column += charWidth;
         }
-        else
+        else if (nextChar == 0xFE0F)
+            return {}; // The emoji presentation selector widens the grapheme cluster it is appended to.
+
+        lastChar = nextChar;
+        codepointBegin = i + 1;
+    }
+
+    if (ColumnCount::cast_from(column) != input.usedColumns)
+        return {};
+
+    addLine(lineBegin, text.size(), ColumnCount::cast_from(column - lineColumn));
+    return lines;
+}
+
+template <typename Cell>
+bool Line<Cell>::tryAppendText(ColumnOffset column,
+                               GraphicsAttributes const& attributes,
+                               HyperlinkId hyperlink,
+                               crispy::BufferFragment<char> text,
+                               ColumnCount columns)
+{
+    if (isInflatedBuffer())
+        return false;
+
+    auto const usedColumns = isTrivialBuffer() ? trivialBuffer().usedColumns : attributedBuffer().usedColumns;
+    if (boxed_cast<ColumnCount>(column) < usedColumns || boxed_cast<ColumnCount>(column) + columns > size())
+        return false; // Overwriting columns requires cell-level access.
+
+    // Appending needs at most two more runs, one for the gap and one for the text.
+    auto const runCount = isTrivialBuffer() ? size_t { 1 } : attributedBuffer().runs.size();
+    if (runCount + 2 > AttributedBuffer::MaxRuns)
+        return false;
+
+    // Lines colorized column by column are given up on early, rather than inflated at MaxRuns anyway.
+    if (runCount >= AttributedBuffer::MinRuns
+        && unbox<size_t>(boxed_cast<ColumnCount>(column) + columns)
+               < (runCount + 1) * AttributedBuffer::MinAverageRunColumns)
+        return false;
+
+    if (isTrivialBuffer())
+    {
+        auto const& trivial = trivialBuffer();
+        auto attributed =
+            AttributedBuffer { trivial.displayWidth, trivial.fillAttributes, trivial.usedColumns };
+        if (trivial.usedColumns > ColumnCount(0))
+            attributed.runs.emplace_back(AttributedLineRun {
+                trivial.usedColumns, trivial.textAttributes, trivial.hyperlink, trivial.text });
+        _storage = std::move(attributed);
+    }
+
+    auto& buffer = attributedBuffer();
+    auto const gap = boxed_cast<ColumnCount>(column) - buffer.usedColumns;
+    if (gap > ColumnCount(0))
+        buffer.runs.emplace_back(AttributedLineRun { gap, buffer.fillAttributes });
+
+    auto* const lastRun = buffer.runs.empty() ? nullptr : &buffer.runs.back();
+    if (lastRun && !lastRun->text.empty() && lastRun->attributes == attributes
+        && lastRun->hyperlink == hyperlink && lastRun->text.owner() == text.owner()
+        && lastRun->text.data() + lastRun->text.size() == text.data())
+    {
+        // Contiguous text of the same attributes, such as split by the parser, extends the last run.
+        lastRun->text.growBy(text.size());
+        lastRun->columns += columns;
+    }
+    else
+        buffer.runs.emplace_back(AttributedLineRun { columns, attributes, hyperlink, std::move(text) });
+
+    buffer.usedColumns = boxed_cast<ColumnCount>(column) + columns;
+    return true;
+}
+
+namespace
+{
+    template <typename Cell>
+    bool sameCell(Cell const& a, Cell const& b)
+    {
+        return a.width() == b.width() && a.flags() == b.flags() && a.hyperlink() == b.hyperlink()
+               && a.foregroundColor() == b.foregroundColor() && a.backgroundColor() == b.backgroundColor()
+               && a.underlineColor() == b.underlineColor() && a.codepoints() == b.codepoints()
+               && !a.imageFragment() && !b.imageFragment();
+    }
+
+    /// Reconstructs runs of equally attributed text from the given cells.
+    ///
+    /// @returns the runs, or std::nullopt if they would not inflate into the very same cells again.
+    template <typename Cell>
+    optional<AttributedLineBuffer> packCells(InflatedLineBuffer<Cell> const& cells)
+    {
+        struct Run
+        {
+            ColumnCount columns;
+            GraphicsAttributes attributes;
+            HyperlinkId hyperlink;
+            size_t textSize = 0;
+            bool blankTail = false; // whether the run ends with empty cells
+        };
+
+        auto text = std::string {};
+        auto runs = std::vector<Run> {};
+        for (size_t i = 0; i < cells.size();)
         {
-            Cell& prevCell = columns.back();
-            auto const extendedWidth = prevCell.appendCharacter(nextChar);
-            if (extendedWidth > 0)
+            auto const& cell = cells[i];
+            auto const attributes = GraphicsAttributes {
+                cell.foregroundColor(), cell.backgroundColor(), cell.underlineColor(), cell.flags()
+            };
+            auto* run = runs.empty() ? nullptr : &runs.back();
+            auto const sameAttributes =
+                run && run->attributes == attributes && run->hyperlink == cell.hyperlink();
+
+            if (cell.empty())
             {
-                auto const cellsAvailable = *input.displayWidth - static_cast<int>(columns.size()) + 1;
-                auto const n = min(extendedWidth, cellsAvailable);
-                for (int i = 1; i < n; ++i)
-                {
-                    columns.emplace_back(Cell { input.textAttributes });
-                    columns.back().setHyperlink(input.hyperlink);
-                }
+                if (!sameAttributes)
+                    run = &runs.emplace_back(Run { ColumnCount(0), attributes, cell.hyperlink() });
+                run->columns += ColumnCount(1);
+                run->blankTail = true;
+                ++i;
+                continue;
             }
+
+            auto const width = std::max<size_t>(cell.width(), 1);
+            if (i + width > cells.size())
+                return nullopt;
+
+            if (!sameAttributes || run->blankTail)
+                run = &runs.emplace_back(Run { ColumnCount(0), attributes, cell.hyperlink() });
+            auto const utf8 = cell.toUtf8();
+            text += utf8;
+            run->textSize += utf8.size();
+            run->columns += ColumnCount::cast_from(width);
+            i += width;
         }
-        lastChar = nextChar;
+
+        auto const displayWidth = ColumnCount::cast_from(cells.size());
+        auto const textBuffer = crispy::BufferObject<char>::create(text.size());
+        std::copy(text.begin(), text.end(), textBuffer->data());
+        textBuffer->advance(text.size());
+
+        auto packed = AttributedLineBuffer { displayWidth, GraphicsAttributes {}, displayWidth };
+        packed.runs.reserve(runs.size());
+        auto check = InflatedLineBuffer<Cell> {};
+        check.reserve(cells.size());
+        auto textOffset = size_t { 0 };
+        for (auto const& run: runs)
+        {
+            auto const runText = textBuffer->ref(textOffset, run.textSize);
+            textOffset += run.textSize;
+
+            // Verify the run inflates into the cells it has been reconstructed from.
+            auto const runEnd = check.size() + unbox<size_t>(run.columns);
+            appendCells(check, runText.view(), run.attributes, run.hyperlink, displayWidth);
+            if (check.size() > runEnd)
+                return nullopt;
+            while (check.size() < runEnd)
+                check.emplace_back(Cell { run.attributes, run.hyperlink });
+
+            packed.runs.emplace_back(
+                AttributedLineRun { run.columns, run.attributes, run.hyperlink, runText });
+        }
+
+        for (size_t i = 0; i < cells.size(); ++i)
+            if (!sameCell(cells[i], check[i]))
+                return nullopt;
+
+        return packed;
     }
+} // namespace
+
+template <typename Cell>
+optional<PackedLineBuffer> Line<Cell>::pack() const
+{
+    if (auto const* trivial = get_if<TrivialBuffer>(&_storage))
+        return PackedLineBuffer { *trivial };
+
+    if (auto const* attributed = get_if<AttributedBuffer>(&_storage))
+        return PackedLineBuffer { *attributed };
+
+    if (auto const* cells = get_if<InflatedBuffer>(&_storage))
+        if (auto packed = packCells(*cells))
+            return PackedLineBuffer { std::move(*packed) };
+
+    return nullopt;
+}
+
+template <typename Cell>
+PackedLineBuffer Line<Cell>::packLossy() const
+{
+    if (auto const* cold = get_if<ColdBuffer>(&_storage))
+        return cold->chunk->unpack(cold->index);
+
+    if (auto packed = pack())
+        return std::move(*packed);
+
+    // Keep the text of the cells only, dropping their attributes, hyperlinks, and images.
+    auto const& cells = get<InflatedBuffer>(_storage);
+    auto usedColumns = cells.size();
+    while (usedColumns != 0 && cells[usedColumns - 1].empty())
+        --usedColumns;
 
-    while (gapPending > 0)
+    auto text = std::string {};
+    auto column = size_t { 0 };
+    while (column < usedColumns)
     {
-        columns.emplace_back(Cell { input.textAttributes, input.hyperlink });
-        --gapPending;
+        auto const& cell = cells[column];
+        if (cell.empty())
+        {
+            text += ' ';
+            ++column;
+        }
+        else
+        {
+            text += cell.toUtf8();
+            column += std::max<size_t>(cell.width(), 1);
+        }
     }
 
-    assert(columns.size() == unbox<size_t>(input.usedColumns));
+    auto const textBuffer = crispy::BufferObject<char>::create(text.size());
+    std::copy(text.begin(), text.end(), textBuffer->data());
+    textBuffer->advance(text.size());
 
-    while (columns.size() < unbox<size_t>(input.displayWidth))
-        columns.emplace_back(Cell { input.fillAttributes });
+    auto buffer = TrivialLineBuffer { ColumnCount::cast_from(cells.size()), GraphicsAttributes {} };
+    buffer.usedColumns = ColumnCount::cast_from(std::min(column, cells.size()));
+    buffer.text = textBuffer->ref(0, text.size());
+    return buffer;
+}
 
-    return columns;
+template <typename Cell>
+void Line<Cell>::unpackColdBuffer()
+{
+    auto const& cold = get<ColdBuffer>(_storage);
+    auto unpacked = cold.chunk->unpack(cold.index);
+    std::visit([this](auto& buffer) { setBuffer(std::move(buffer)); }, unpacked);
+}
+
+namespace
+{
+    /// Identifies a cold line by the chunk it has been packed into, and its index therein.
+    struct ColdLineKey
+    {
+        ColdLineChunk const* chunk;
+        uint32_t index;
+
+        bool operator==(ColdLineKey const&) const noexcept = default;
+    };
+
+    struct ColdLineKeyHash
+    {
+        size_t operator()(ColdLineKey const& key) const noexcept
+        {
+            return std::hash<ColdLineChunk const*> {}(key.chunk) ^ (size_t(key.index) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    /// A cold line's unpacked storage, keeping its chunk (and thus the key's address) alive.
+    template <typename Cell>
+    struct UnpackedColdLine
+    {
+        std::shared_ptr<ColdLineChunk const> chunk;
+        LineStorage<Cell> storage;
+        std::optional<InflatedLineBuffer<Cell>> inflated {};
+        uint64_t cellExtrasCollection = 0; // At the time the storage has been inflated.
+    };
+
+    /// @returns the number of times the extra data of cells may have been released.
+    ///
+    /// Cells in the cache below are not seen by any grid, and therefore must be inflated again after that.
+    template <typename Cell>
+    uint64_t cellExtrasCollectionCount() noexcept
+    {
+        if constexpr (std::is_same_v<Cell, PodCell>)
+            return PodCellExtras::get().collectionCount();
+        else
+            return 0;
+    }
+
+    /// Bounds the number of cold lines kept unpacked per thread, about a few screens full of history.
+    constexpr auto UnpackedColdLineCacheCapacity = size_t { 1024 };
+
+    /// Unpacked cold lines no longer in the calling thread's cache, kept until releaseEvictedColdLines().
+    thread_local auto evictedColdLines = std::vector<std::shared_ptr<void const>> {};
+
+    template <typename Cell>
+    UnpackedColdLine<Cell>& unpackedColdLine(ColdLineBuffer const& cold)
+    {
+        using Entry = std::shared_ptr<UnpackedColdLine<Cell>>;
+        thread_local auto cache =
+            crispy::LRUCache<ColdLineKey, Entry, ColdLineKeyHash> { UnpackedColdLineCacheCapacity };
+
+        auto const unpack = [&]() {
+            return std::make_shared<UnpackedColdLine<Cell>>(UnpackedColdLine<Cell> {
+                cold.chunk,
+                std::visit([](auto&& buffer) { return LineStorage<Cell> { std::move(buffer) }; },
+                           cold.chunk->unpack(cold.index)) });
+        };
+
+        auto const key = ColdLineKey { cold.chunk.get(), cold.index };
+        if (auto* entry = cache.try_get(key))
+        {
+            if ((*entry)->inflated && (*entry)->cellExtrasCollection != cellExtrasCollectionCount<Cell>())
+            {
+                evictedColdLines.emplace_back(std::move(*entry));
+                *entry = unpack();
+            }
+            return **entry;
+        }
+
+        if (cache.size() == cache.capacity())
+            evictedColdLines.emplace_back(std::move(std::prev(cache.end())->value));
+        return *cache.emplace(key, unpack());
+    }
+} // namespace
+
+void releaseEvictedColdLines() noexcept
+{
+    evictedColdLines.clear();
+}
+
+template <typename Cell>
+typename Line<Cell>::Storage const& Line<Cell>::unpackedColdBuffer(ColdBuffer const& cold)
+{
+    return unpackedColdLine<Cell>(cold).storage;
+}
+
+template <typename Cell>
+typename Line<Cell>::InflatedBuffer const& Line<Cell>::inflatedColdBuffer() const
+{
+    // Inflated on the heap rather than the grid's arena, as the cache may outlive the grid.
+    auto& entry = unpackedColdLine<Cell>(get<ColdBuffer>(_storage));
+    if (!entry.inflated)
+    {
+        entry.cellExtrasCollection = cellExtrasCollectionCount<Cell>();
+        if (auto const* trivial = get_if<TrivialBuffer>(&entry.storage))
+            entry.inflated = inflate<Cell>(*trivial, nullptr);
+        else
+            entry.inflated = inflate<Cell>(get<AttributedBuffer>(entry.storage), nullptr);
+    }
+    return *entry.inflated;
+}
+
+uint64_t nextLineGeneration() noexcept
+{
+    static std::atomic<uint64_t> nextGeneration = 1;
+    return nextGeneration.fetch_add(1, std::memory_order_relaxed);
 }
+
 } // end namespace terminal
 
 #include <vtbackend/cell/CompactCell.h>
@@ -240,3 +779,17 @@ template class terminal::Line<terminal::CompactCell>;
 
 #include <vtbackend/cell/SimpleCell.h>
 template class terminal::Line<terminal::SimpleCell>;
+
+#include <vtbackend/cell/PodCell.h>
+template class terminal::Line<terminal::PodCell>;
+
+namespace terminal
+{
+// Called by the inline members of Line<Cell>, which may get inlined into Line.cpp entirely.
+template InflatedLineBuffer<CompactCell> inflate(TrivialLineBuffer const&, CellArena*);
+template InflatedLineBuffer<CompactCell> inflate(AttributedLineBuffer const&, CellArena*);
+template InflatedLineBuffer<SimpleCell> inflate(TrivialLineBuffer const&, CellArena*);
+template InflatedLineBuffer<SimpleCell> inflate(AttributedLineBuffer const&, CellArena*);
+template InflatedLineBuffer<PodCell> inflate(TrivialLineBuffer const&, CellArena*);
+template InflatedLineBuffer<PodCell> inflate(AttributedLineBuffer const&, CellArena*);
+} // namespace terminal
@@ -16,6 +16,7 @@
 #include <vtbackend/CellUtil.h>
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Hyperlink.h>
+#include <vtbackend/cell/CellArena.h>
 #include <vtbackend/primitives.h>
 
 #include <crispy/BufferObject.h>
@@ -28,6 +29,8 @@
 #include <gsl/span_ext>
 
 #include <iterator>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <variant>
@@ -75,20 +78,109 @@ struct TrivialLineBuffer
     }
 };
 
+/**
+ * Consecutive columns of an AttributedLineBuffer, all sharing the same SGR attributes and hyperlink.
+ *
+ * The text may cover fewer columns than the run, in which case the remaining columns are blank.
+ */
+struct AttributedLineRun
+{
+    ColumnCount columns;
+    GraphicsAttributes attributes;
+    HyperlinkId hyperlink {};
+    crispy::BufferFragment<char> text {};
+};
+
+/**
+ * Line storage with a short list of runs of columns, each run sharing the same SGR attributes.
+ *
+ * Colorized output (such as ls, grep, compiler diagnostics, or prompts) usually changes SGR attributes
+ * a few times per line while only ever appending to it. This keeps such lines from being inflated.
+ */
+struct AttributedLineBuffer
+{
+    /// Maximum number of runs before the line gets inflated.
+    static constexpr size_t MaxRuns = 32;
+
+    /// Number of runs a line always keeps uninflated, however narrow these are.
+    static constexpr size_t MinRuns = 4;
+
+    /// Minimum average number of columns per run for lines of more than MinRuns runs to stay uninflated,
+    /// as text changing its attributes every other column is written faster into cells right away.
+    static constexpr size_t MinAverageRunColumns = 3;
+
+    ColumnCount displayWidth;
+    GraphicsAttributes fillAttributes;
+
+    ColumnCount usedColumns {};
+    std::vector<AttributedLineRun> runs {};
+};
+
+template <typename Cell>
+using InflatedLineBuffer = std::vector<Cell, CellAllocator<Cell>>;
+
+class ColdLineChunk;
+
+/**
+ * Line storage of a history line that has been packed into a ColdLineChunk, together with its neighbours.
+ *
+ * Reading the line's contents unpacks it into a bounded cache, keeping the line packed,
+ * whereas the line is unpacked again as soon as its contents are modified.
+ */
+struct ColdLineBuffer
+{
+    ColumnCount displayWidth;
+    std::shared_ptr<ColdLineChunk const> chunk;
+    uint32_t index = 0; // index of the line within the chunk
+};
+
+/// Line storage that can be packed into (and unpacked from) a ColdLineChunk.
+using PackedLineBuffer = std::variant<TrivialLineBuffer, AttributedLineBuffer>;
+
+/// Unpacks a TrivialLineBuffer into an InflatedLineBuffer<Cell>, with its cells allocated
+/// from the given arena, or the heap if none is given.
 template <typename Cell>
-using InflatedLineBuffer = std::vector<Cell>;
+InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input, CellArena* arena = nullptr);
 
-/// Unpacks a TrivialLineBuffer into an InflatedLineBuffer<Cell>.
+/// Unpacks an AttributedLineBuffer into an InflatedLineBuffer<Cell>, with its cells allocated
+/// from the given arena, or the heap if none is given.
 template <typename Cell>
-InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input);
+InflatedLineBuffer<Cell> inflate(AttributedLineBuffer const& input, CellArena* arena = nullptr);
+
+/// Reflows a TrivialLineBuffer into TrivialLineBuffers of @p newColumnCount columns each, all of these
+/// referring to slices of the input's text, cut at grapheme cluster boundaries.
+///
+/// @returns the reflowed buffers, or none if a wide character would have to be cut in half.
+std::vector<TrivialLineBuffer> reflow(TrivialLineBuffer const& input, ColumnCount newColumnCount);
+
+/// @returns the number of columns the given UTF-8 text occupies when written into cells.
+ColumnCount displayWidthOf(std::string_view text) noexcept;
+
+/// @returns the byte offset of the grapheme cluster starting at @p column of the given UTF-8 text,
+///          or std::string_view::npos if none starts there, such as past the end of the text or
+///          on the second column of a wide character.
+size_t graphemeClusterOffsetAt(std::string_view text, ColumnOffset column) noexcept;
+
+/// @returns a line generation never handed out before, see Line<Cell>::generation().
+uint64_t nextLineGeneration() noexcept;
+
+/// Releases the cold lines unpacked on the calling thread that have been evicted from its cache since.
+///
+/// Any reference into a cold line's contents read on the calling thread before may be invalidated,
+/// thus this is called only where none of these is held, such as before processing the next input.
+void releaseEvictedColdLines() noexcept;
 
 template <typename Cell>
-using LineStorage = std::variant<TrivialLineBuffer, InflatedLineBuffer<Cell>>;
+using LineStorage =
+    std::variant<TrivialLineBuffer, AttributedLineBuffer, InflatedLineBuffer<Cell>, ColdLineBuffer>;
 
 /**
  * Line<Cell> API.
  *
- * TODO: Use custom allocator for ensuring cache locality of Cells to sibling lines.
+ * The cells of an inflated line are allocated from the line's cell arena (see setCellArena()),
+ * which is owned by the grid. The cell arena sticks to the line object rather than to its
+ * contents, such that assigning contents to a grid's line keeps allocating from the grid's arena.
+ *
  * TODO: Make the line optimization work.
  */
 template <typename Cell>
@@ -98,11 +190,27 @@ class Line
     Line() = default;
     Line(Line const&) = default;
     Line(Line&&) noexcept = default;
-    Line& operator=(Line const&) = default;
-    Line& operator=(Line&&) noexcept = default;
+
+    Line& operator=(Line const& other)
+    {
+        _storage = other._storage;
+        _flags = other._flags;
+        _generation = other._generation;
+        return *this;
+    }
+
+    Line& operator=(Line&& other) noexcept
+    {
+        _storage = std::move(other._storage);
+        _flags = other._flags;
+        _generation = other._generation;
+        return *this;
+    }
 
     using TrivialBuffer = TrivialLineBuffer;
+    using AttributedBuffer = AttributedLineBuffer;
     using InflatedBuffer = InflatedLineBuffer<Cell>;
+    using ColdBuffer = ColdLineBuffer;
     using Storage = LineStorage<Cell>;
     using value_type = Cell;
     using iterator = typename InflatedBuffer::iterator;
@@ -114,18 +222,43 @@ class Line
     {
     }
 
-    Line(LineFlags flags, InflatedBuffer buffer):
+    Line(LineFlags flags, AttributedBuffer buffer):
         _storage { std::move(buffer) }, _flags { static_cast<unsigned>(flags) }
     {
     }
 
+    Line(LineFlags flags, InflatedBuffer buffer):
+        _cellArena { buffer.get_allocator().arena() },
+        _storage { std::move(buffer) },
+        _flags { static_cast<unsigned>(flags) }
+    {
+    }
+
+    /// Sets the arena to allocate the cells from whenever this line gets inflated.
+    ///
+    /// The arena must outlive this line, as well as any copy of it.
+    void setCellArena(CellArena* arena) noexcept { _cellArena = arena; }
+    [[nodiscard]] CellArena* cellArena() const noexcept { return _cellArena; }
+
+    /// Identifies the contents of this line, until this line gets modified.
+    ///
+    /// Renderers compare it against the generation of the line they rendered before, in order to
+    /// only render lines again that have changed since. Copies of a line, such as the lines moved
+    /// by scrolling, share the generation of the line they have been copied from.
+    [[nodiscard]] uint64_t generation() const noexcept
+    {
+        if (!_generation)
+            _generation = nextLineGeneration();
+        return _generation;
+    }
+
     void reset(LineFlags flags, GraphicsAttributes attributes) noexcept
     {
         _flags = static_cast<unsigned>(flags);
-        if (isTrivialBuffer())
+        if (std::holds_alternative<TrivialBuffer>(_storage))
             trivialBuffer().reset(attributes);
         else
-            setBuffer(TrivialBuffer { ColumnCount::cast_from(inflatedBuffer().size()), attributes });
+            setBuffer(TrivialBuffer { size(), attributes });
     }
 
     void reset(LineFlags flags, GraphicsAttributes attributes, ColumnCount count) noexcept
@@ -158,6 +291,14 @@ class Line
         if (isTrivialBuffer())
             return trivialBuffer().text.empty();
 
+        if (isAttributedBuffer())
+        {
+            for (auto const& run: attributedBuffer().runs)
+                if (!run.text.empty())
+                    return false;
+            return true;
+        }
+
         for (auto const& cell: inflatedBuffer())
             if (!cell.empty())
                 return false;
@@ -192,8 +333,12 @@ class Line
 
     [[nodiscard]] ColumnCount size() const noexcept
     {
+        if (auto const* cold = std::get_if<ColdBuffer>(&_storage))
+            return cold->displayWidth;
         if (isTrivialBuffer())
             return trivialBuffer().displayWidth;
+        else if (isAttributedBuffer())
+            return attributedBuffer().displayWidth;
         else
             return ColumnCount::cast_from(inflatedBuffer().size());
     }
@@ -228,8 +373,26 @@ class Line
         {
             Require(ColumnOffset(0) <= column);
             Require(column < ColumnOffset::cast_from(size()));
-            return unbox<size_t>(column) >= trivialBuffer().text.size()
-                   || trivialBuffer().text[column.as<size_t>()] == 0x20;
+            auto const text = trivialBuffer().text.view();
+            auto const offset = graphemeClusterOffsetAt(text, column);
+            return offset == std::string_view::npos || text[offset] == 0x20;
+        }
+        if (isAttributedBuffer())
+        {
+            Require(ColumnOffset(0) <= column);
+            Require(column < ColumnOffset::cast_from(size()));
+            auto runStart = ColumnOffset(0);
+            for (auto const& run: attributedBuffer().runs)
+            {
+                if (column < runStart + boxed_cast<ColumnOffset>(run.columns))
+                {
+                    auto const text = run.text.view();
+                    auto const offset = graphemeClusterOffsetAt(text, column - runStart);
+                    return offset == std::string_view::npos || text[offset] == 0x20;
+                }
+                runStart += boxed_cast<ColumnOffset>(run.columns);
+            }
+            return true;
         }
         return inflatedBuffer().at(unbox<size_t>(column)).empty();
     }
@@ -302,22 +465,76 @@ class Line
     [[nodiscard]] InflatedBuffer& inflatedBuffer();
     [[nodiscard]] InflatedBuffer const& inflatedBuffer() const;
 
-    [[nodiscard]] TrivialBuffer& trivialBuffer() noexcept { return std::get<TrivialBuffer>(_storage); }
-    [[nodiscard]] TrivialBuffer const& trivialBuffer() const noexcept
+    [[nodiscard]] TrivialBuffer& trivialBuffer() noexcept
     {
+        unpack();
+        _generation = 0;
         return std::get<TrivialBuffer>(_storage);
     }
+    [[nodiscard]] TrivialBuffer const& trivialBuffer() const noexcept
+    {
+        return std::get<TrivialBuffer>(contents());
+    }
+
+    [[nodiscard]] AttributedBuffer& attributedBuffer() noexcept
+    {
+        unpack();
+        _generation = 0;
+        return std::get<AttributedBuffer>(_storage);
+    }
+    [[nodiscard]] AttributedBuffer const& attributedBuffer() const noexcept
+    {
+        return std::get<AttributedBuffer>(contents());
+    }
 
+    // The storage type tests look at the unpacked contents of a cold line, such that
+    // reading the contents of a cold line works the same as for any other line.
     [[nodiscard]] bool isTrivialBuffer() const noexcept
     {
-        return std::holds_alternative<TrivialBuffer>(_storage);
+        return std::holds_alternative<TrivialBuffer>(contents());
+    }
+    [[nodiscard]] bool isAttributedBuffer() const noexcept
+    {
+        return std::holds_alternative<AttributedBuffer>(contents());
     }
     [[nodiscard]] bool isInflatedBuffer() const noexcept
     {
-        return !std::holds_alternative<TrivialBuffer>(_storage);
+        return std::holds_alternative<InflatedBuffer>(contents());
+    }
+    [[nodiscard]] bool isColdBuffer() const noexcept { return std::holds_alternative<ColdBuffer>(_storage); }
+
+    /// @returns this line's contents in a form to be packed into a ColdLineChunk,
+    ///          or std::nullopt if this line is cold already or cannot be packed without loss
+    ///          (such as lines showing images).
+    [[nodiscard]] std::optional<PackedLineBuffer> pack() const;
+
+    /// @returns this line's contents like pack() does, but with only the text kept
+    ///          for lines that cannot be packed without loss.
+    [[nodiscard]] PackedLineBuffer packLossy() const;
+
+    /// Appends text to a trivial or attributed line at the given column, without inflating the line.
+    ///
+    /// Columns between the line's used columns and @p column are left blank.
+    ///
+    /// @param column     column to start writing at, must not be left to the line's used columns.
+    /// @param attributes graphics attributes of the text
+    /// @param hyperlink  hyperlink of the text
+    /// @param text       text covering exactly @p columns columns
+    /// @param columns    number of columns covered by @p text
+    ///
+    /// @retval true  the text has been appended to the line
+    /// @retval false the line is or would need to be inflated, and was left unchanged.
+    [[nodiscard]] bool tryAppendText(ColumnOffset column,
+                                     GraphicsAttributes const& attributes,
+                                     HyperlinkId hyperlink,
+                                     crispy::BufferFragment<char> text,
+                                     ColumnCount columns);
+
+    void setBuffer(Storage buffer) noexcept
+    {
+        _storage = std::move(buffer);
+        _generation = 0;
     }
-
-    void setBuffer(Storage buffer) noexcept { _storage = std::move(buffer); }
 
     // Tests if the given text can be matched in this line at the exact given start column.
     [[nodiscard]] bool matchTextAt(std::u32string_view text, ColumnOffset startColumn) const noexcept
@@ -447,8 +664,42 @@ class Line
     }
 
   private:
+    /// Unpacks a cold line into the storage it has been packed from, in order to modify it.
+    void unpack()
+    {
+        if (isColdBuffer())
+            unpackColdBuffer();
+    }
+    void unpackColdBuffer();
+
+    /// @returns this line's storage, or for a cold line, its unpacked storage.
+    ///
+    /// Cold lines are unpacked into a bounded per-thread cache rather than into the line itself,
+    /// such that reading the history does not unpack all of it for good. Lines evicted from the cache
+    /// are kept until releaseEvictedColdLines(), such that the returned reference stays valid until then.
+    [[nodiscard]] Storage const& contents() const
+    {
+        if (auto const* cold = std::get_if<ColdBuffer>(&_storage))
+            return unpackedColdBuffer(*cold);
+        return _storage;
+    }
+    static Storage const& unpackedColdBuffer(ColdBuffer const& cold);
+
+    /// @returns the cells of a cold line, inflated within the cache of unpacked cold lines.
+    [[nodiscard]] InflatedBuffer const& inflatedColdBuffer() const;
+
+    /// Inflates this line's storage, unless inflated already.
+    ///
+    /// As opposed to inflatedBuffer(), the generation only changes if the storage gets replaced.
+    InflatedBuffer& inflatedStorage();
+
+    CellArena* _cellArena = nullptr;
     Storage _storage;
     unsigned _flags = 0;
+
+    // Changes whenever the storage is modified or replaced, as rendered lines refer to the text of
+    // trivial and attributed storage. Assigned lazily by generation(), with 0 meaning not assigned.
+    mutable uint64_t _generation = 0;
 };
 
 constexpr LineFlags operator|(LineFlags a, LineFlags b) noexcept
@@ -467,17 +718,29 @@ constexpr LineFlags operator&(LineFlags a, LineFlags b) noexcept
 }
 
 template <typename Cell>
-inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedBuffer()
+inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedStorage()
 {
+    unpack();
     if (std::holds_alternative<TrivialBuffer>(_storage))
-        _storage = inflate<Cell>(std::get<TrivialBuffer>(_storage));
+        setBuffer(inflate<Cell>(std::get<TrivialBuffer>(_storage), _cellArena));
+    else if (std::holds_alternative<AttributedBuffer>(_storage))
+        setBuffer(inflate<Cell>(std::get<AttributedBuffer>(_storage), _cellArena));
     return std::get<InflatedBuffer>(_storage);
 }
 
+template <typename Cell>
+inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedBuffer()
+{
+    _generation = 0;
+    return inflatedStorage();
+}
+
 template <typename Cell>
 inline typename Line<Cell>::InflatedBuffer const& Line<Cell>::inflatedBuffer() const
 {
-    return const_cast<Line<Cell>*>(this)->inflatedBuffer();
+    if (isColdBuffer())
+        return inflatedColdBuffer();
+    return const_cast<Line<Cell>*>(this)->inflatedStorage();
 }
 
 } // namespace terminal
@@ -11,6 +11,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtbackend/ColdLineChunk.h>
 #include <vtbackend/Line.h>
 #include <vtbackend/cell/CellConfig.h>
 
@@ -18,6 +19,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <cstring>
+#include <utility>
+#include <vector>
+
 using namespace std;
 
 using namespace terminal;
@@ -90,6 +95,259 @@ TEST_CASE("Line.reflow", "[Line]")
     CHECK(line_trivial.isInflatedBuffer());
 }
 
+TEST_CASE("Line.tryAppendText", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(10);
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd("abcdefgh"sv);
+
+    auto sgr = GraphicsAttributes {};
+    sgr.foregroundColor = Color::Indexed(IndexedColor::Red);
+    auto sgr2 = GraphicsAttributes {};
+    sgr2.foregroundColor = Color::Indexed(IndexedColor::Green);
+    auto const fillSGR = GraphicsAttributes {};
+
+    auto const bufferFragment = bufferObject->ref(0, 3);
+    auto const trivial =
+        TrivialLineBuffer { DisplayWidth, sgr, fillSGR, HyperlinkId {}, ColumnCount(3), bufferFragment };
+    auto line = Line<Cell>(LineFlags::None, trivial);
+    REQUIRE(line.isTrivialBuffer());
+
+    // Text of different attributes, separated by a gap.
+    REQUIRE(line.tryAppendText(
+        ColumnOffset(5), sgr2, HyperlinkId {}, bufferObject->ref(3, 2), ColumnCount(2)));
+    REQUIRE(line.isAttributedBuffer());
+    CHECK(line.attributedBuffer().runs.size() == 3);
+
+    // Contiguous text of the same attributes extends the last run.
+    REQUIRE(line.tryAppendText(
+        ColumnOffset(7), sgr2, HyperlinkId {}, bufferObject->ref(5, 1), ColumnCount(1)));
+    CHECK(line.attributedBuffer().runs.size() == 3);
+    CHECK(line.attributedBuffer().usedColumns == ColumnCount(8));
+    CHECK(line.toUtf8() == "abc  def  ");
+
+    // Overwriting already used columns or exceeding the line is not supported.
+    CHECK_FALSE(line.tryAppendText(
+        ColumnOffset(6), sgr, HyperlinkId {}, bufferObject->ref(6, 1), ColumnCount(1)));
+    CHECK_FALSE(line.tryAppendText(
+        ColumnOffset(9), sgr, HyperlinkId {}, bufferObject->ref(6, 2), ColumnCount(2)));
+    CHECK(line.isAttributedBuffer());
+
+    auto const inflated = inflate<Cell>(line.attributedBuffer());
+    REQUIRE(inflated.size() == unbox<size_t>(DisplayWidth));
+    CHECK(inflated[0].toUtf8() == "a");
+    CHECK(inflated[0].foregroundColor() == sgr.foregroundColor);
+    CHECK(inflated[3].toUtf8().empty());
+    CHECK(inflated[3].foregroundColor() == fillSGR.foregroundColor);
+    CHECK(inflated[5].toUtf8() == "d");
+    CHECK(inflated[7].toUtf8() == "f");
+    CHECK(inflated[7].foregroundColor() == sgr2.foregroundColor);
+    CHECK(inflated[9].foregroundColor() == fillSGR.foregroundColor);
+}
+
+TEST_CASE("Line.tryAppendText.narrow_runs", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(80);
+    auto pool = BufferObjectPool<char>(128);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(std::string(unbox<size_t>(DisplayWidth), 'x'));
+
+    auto red = GraphicsAttributes {};
+    red.foregroundColor = Color::Indexed(IndexedColor::Red);
+    auto green = GraphicsAttributes {};
+    green.foregroundColor = Color::Indexed(IndexedColor::Green);
+
+    // Text colorized column by column is given up on after a few runs.
+    auto line = Line<Cell>(LineFlags::None, TrivialLineBuffer { DisplayWidth, GraphicsAttributes {} });
+    auto column = 0;
+    while (line.tryAppendText(ColumnOffset(column),
+                              column % 2 ? red : green,
+                              HyperlinkId {},
+                              bufferObject->ref(static_cast<size_t>(column), 1),
+                              ColumnCount(1)))
+        ++column;
+    CHECK(column == static_cast<int>(AttributedLineBuffer::MinRuns));
+
+    // Colorized words, separated by uncolorized spaces, are not.
+    auto words = Line<Cell>(LineFlags::None, TrivialLineBuffer { DisplayWidth, GraphicsAttributes {} });
+    for (column = 0; column + 8 <= unbox<int>(DisplayWidth); column += 8)
+    {
+        REQUIRE(words.tryAppendText(ColumnOffset(column),
+                                    column % 16 ? red : green,
+                                    HyperlinkId {},
+                                    bufferObject->ref(static_cast<size_t>(column), 7),
+                                    ColumnCount(7)));
+        REQUIRE(words.tryAppendText(ColumnOffset(column + 7),
+                                    GraphicsAttributes {},
+                                    HyperlinkId {},
+                                    bufferObject->ref(static_cast<size_t>(column + 7), 1),
+                                    ColumnCount(1)));
+    }
+    CHECK(words.isAttributedBuffer());
+}
+
+TEST_CASE("Line.tryAppendText.Unicode", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(10);
+    auto const text = unicode::convert_to<char>(U"\u00E4\u2705 x"sv); // 5 bytes, 4 columns, then " x"
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(text);
+
+    auto const sgr = GraphicsAttributes {};
+    auto sgr2 = GraphicsAttributes {};
+    sgr2.foregroundColor = Color::Indexed(IndexedColor::Red);
+    auto const emptyLine = TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, ColumnCount(0), {} };
+    auto line = Line<Cell>(LineFlags::None, emptyLine);
+    REQUIRE(line.tryAppendText(
+        ColumnOffset(0), sgr, HyperlinkId {}, bufferObject->ref(0, 5), ColumnCount(3)));
+    REQUIRE(line.tryAppendText(
+        ColumnOffset(3), sgr2, HyperlinkId {}, bufferObject->ref(5, 2), ColumnCount(2)));
+    REQUIRE(line.isAttributedBuffer());
+
+    // Columns are located by display width, not by byte offset into the text.
+    CHECK(!line.cellEmptyAt(ColumnOffset(0)));
+    CHECK(!line.cellEmptyAt(ColumnOffset(1)));
+    CHECK(line.cellEmptyAt(ColumnOffset(2))); // second half of the wide character
+    CHECK(line.cellEmptyAt(ColumnOffset(3)));
+    CHECK(!line.cellEmptyAt(ColumnOffset(4)));
+    CHECK(line.cellEmptyAt(ColumnOffset(5)));
+    CHECK(line.toUtf8() == text + "     ");
+
+    // Runs wider than their text are padded by the columns missing, not the bytes.
+    auto padded = Line<Cell>(LineFlags::None, emptyLine);
+    REQUIRE(padded.tryAppendText(
+        ColumnOffset(0), sgr, HyperlinkId {}, bufferObject->ref(0, 2), ColumnCount(2)));
+    REQUIRE(padded.tryAppendText(
+        ColumnOffset(2), sgr2, HyperlinkId {}, bufferObject->ref(6, 1), ColumnCount(1)));
+    CHECK(padded.toUtf8() == "\u00E4 x       ");
+    CHECK(!padded.cellEmptyAt(ColumnOffset(2)));
+}
+
+TEST_CASE("Line.generation", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(10);
+    auto pool = BufferObjectPool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd("abc"sv);
+
+    auto const sgr = GraphicsAttributes {};
+    auto const trivial =
+        TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, ColumnCount(3), bufferObject->ref(0, 3) };
+    auto line = Line<Cell>(LineFlags::None, trivial);
+
+    // Reading a line keeps its generation.
+    auto const generation = line.generation();
+    CHECK(generation != 0);
+    CHECK(line.toUtf8() == "abc       ");
+    CHECK(line.generation() == generation);
+
+    // Copies and moves of a line share its generation.
+    auto copy = line;
+    CHECK(copy.generation() == generation);
+    auto moved = Line<Cell>();
+    moved = std::move(copy);
+    CHECK(moved.generation() == generation);
+
+    // Inflating a line changes its generation, as rendered lines may refer to its text.
+    auto const& constLine = line;
+    (void) constLine.cells();
+    auto const inflatedGeneration = line.generation();
+    CHECK(inflatedGeneration != generation);
+    (void) constLine.cells();
+    CHECK(line.generation() == inflatedGeneration);
+
+    // Modifying a line changes its generation.
+    line.useCellAt(ColumnOffset(1)).write(sgr, U'X', 1);
+    CHECK(line.generation() != inflatedGeneration);
+    CHECK(moved.generation() == generation);
+
+    auto const writtenGeneration = line.generation();
+    line.reset(LineFlags::None, sgr);
+    CHECK(line.generation() != writtenGeneration);
+}
+
+TEST_CASE("Line.pack", "[Line]")
+{
+    auto sgr = GraphicsAttributes {};
+    sgr.foregroundColor = Color::Indexed(IndexedColor::Red);
+
+    SECTION("trivial")
+    {
+        auto pool = BufferObjectPool<char>(16);
+        auto bufferObject = pool.allocateBufferObject();
+        bufferObject->writeAtEnd("abc"sv);
+        auto const fillSGR = GraphicsAttributes {};
+        auto const trivial = TrivialLineBuffer {
+            ColumnCount(5), sgr, fillSGR, HyperlinkId {}, ColumnCount(3), bufferObject->ref(0, 3)
+        };
+        auto line = Line<Cell>(LineFlags::Wrappable, trivial);
+
+        auto const packed = vector { line.pack().value() };
+        line.setBuffer(ColdLineBuffer { line.size(), ColdLineChunk::create(packed), 0 });
+        CHECK(line.isColdBuffer());
+        CHECK(line.size() == ColumnCount(5));
+
+        // Unpacking restores the line's storage type, and its text no longer refers to the PTY buffer.
+        REQUIRE(line.isTrivialBuffer());
+        CHECK(line.toUtf8() == "abc  ");
+        CHECK(line.trivialBuffer().textAttributes == sgr);
+        CHECK(line.trivialBuffer().text.owner() != bufferObject);
+        CHECK(line.wrappable());
+    }
+
+    SECTION("inflated")
+    {
+        auto cells = InflatedLineBuffer<Cell>(8);
+        cells[0].write(sgr, 'a', 1);
+        cells[1].write(sgr, 'b', 1);
+        cells[3].write(GraphicsAttributes {}, U'\u4E2D', 2); // wide character covering columns 3 and 4
+        cells[5].write(sgr, 'c', 1);
+        auto line = Line<Cell>(LineFlags::None, cells);
+
+        auto const packed = vector { line.pack().value() };
+        line.setBuffer(ColdLineBuffer { line.size(), ColdLineChunk::create(packed), 0 });
+        CHECK(line.isColdBuffer());
+
+        auto const& unpacked = line.inflatedBuffer();
+        REQUIRE(unpacked.size() == cells.size());
+        for (size_t i = 0; i < cells.size(); ++i)
+        {
+            INFO(fmt::format("column {}", i));
+            CHECK(unpacked[i].toUtf8() == cells[i].toUtf8());
+            CHECK(unpacked[i].width() == cells[i].width());
+            CHECK(unpacked[i].empty() == cells[i].empty());
+            CHECK(unpacked[i].foregroundColor() == cells[i].foregroundColor());
+        }
+    }
+
+    SECTION("evicted")
+    {
+        // Many more cold lines than kept unpacked are read while holding on to the first one's contents.
+        auto lines = vector<Line<Cell>> {};
+        for (auto i = 0; i < 4096; ++i)
+        {
+            auto buffer = BufferObject<char>::create(8);
+            buffer->writeAtEnd(fmt::format("{:>4}", i));
+            auto const trivial =
+                TrivialLineBuffer { ColumnCount(4), sgr, GraphicsAttributes {}, HyperlinkId {}, ColumnCount(4),
+                                    buffer->ref(0, 4) };
+            auto const packed = vector<PackedLineBuffer> { trivial };
+            lines.emplace_back(LineFlags::None, trivial)
+                .setBuffer(ColdLineBuffer { ColumnCount(4), ColdLineChunk::create(packed), 0 });
+        }
+
+        auto const& first = std::as_const(lines.front()).trivialBuffer();
+        auto const& firstCells = std::as_const(lines.front()).inflatedBuffer();
+        for (auto const& line: lines)
+            CHECK(line.trivialBuffer().text.size() == 4);
+        CHECK(first.text.view() == "   0");
+        CHECK(firstCells[3].toUtf8() == "0");
+        releaseEvictedColdLines();
+    }
+}
+
 TEST_CASE("Line.inflate", "[Line]")
 {
     auto constexpr testText = "0123456789ABCDEF"sv;
@@ -227,3 +485,120 @@ TEST_CASE("Line.inflate.Unicode.FamilyEmoji", "[Line]")
     REQUIRE(cell.backgroundColor() == fillSGR.backgroundColor);
     REQUIRE(cell.underlineColor() == fillSGR.underlineColor);
 }
+
+TEST_CASE("Line.PodCell", "[Line]")
+{
+    auto const sgr = GraphicsAttributes { Color::Indexed(1), Color::Indexed(2), Color::Indexed(3) };
+    auto const hyperlink = HyperlinkId(7);
+
+    auto cells = std::vector<PodCell>(4);
+    cells[0].write(sgr, U'A', 1, hyperlink);
+    cells[1].write(sgr, U'B', 1, hyperlink);
+    cells[2].write(GraphicsAttributes {}, U'\U0001F468', 2);
+    CHECK(cells[2].appendCharacter(U'\u200D') == 0);
+    CHECK(cells[2].appendCharacter(U'\U0001F469') == 0);
+
+    // Cells with equal extra data share the same entry.
+    auto const extrasCount = PodCellExtras::get().size();
+    cells[3].write(sgr, U'C', 1, hyperlink);
+    CHECK(PodCellExtras::get().size() == extrasCount);
+
+    // Shifting cells is a plain memmove(), carrying along their extra data.
+    std::memmove(cells.data(), cells.data() + 1, 3 * sizeof(PodCell));
+    CHECK(cells[0].toUtf8() == "B");
+    CHECK(cells[0].underlineColor() == Color::Indexed(3));
+    CHECK(cells[0].hyperlink() == hyperlink);
+    CHECK(cells[1].codepoints() == U"\U0001F468\u200D\U0001F469");
+    CHECK(cells[1].width() == 2);
+    CHECK(cells[1].underlineColor() == DefaultColor());
+
+    // Writing text drops the grapheme cluster's tail.
+    cells[1].write(sgr, U'D', 1);
+    CHECK(cells[1].codepointCount() == 1);
+    CHECK(cells[1].underlineColor() == Color::Indexed(3));
+
+    cells[0].reset();
+    CHECK(cells[0].empty());
+    CHECK(cells[0].hyperlink() == HyperlinkId {});
+    CHECK(cells[0].underlineColor() == DefaultColor());
+}
+
+TEST_CASE("PodCellExtras.collect", "[Line]")
+{
+    auto& extras = PodCellExtras::get();
+    auto cells = std::vector<PodCell>(2);
+    extras.addRoot(&cells, [&](PodCellExtras::Marker& marker) {
+        for (auto const& cell: cells)
+            cell.markExtra(marker);
+    });
+
+    auto sgr = GraphicsAttributes {};
+    sgr.underlineColor = RGBColor(0x123456);
+    cells[0].write(sgr, U'A', 1, HyperlinkId(42));
+
+    // Entries of cells no longer around are released, whereas the ones still referred to are kept.
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        auto transient = PodCell {};
+        transient.write(GraphicsAttributes {}, U'B', 1, HyperlinkId(1000 + i));
+    }
+    auto const sizeBefore = extras.size();
+    extras.collect();
+    CHECK(extras.size() <= sizeBefore - 100);
+    CHECK(cells[0].underlineColor() == Color(RGBColor(0x123456)));
+    CHECK(cells[0].hyperlink() == HyperlinkId(42));
+
+    // Released indices are reused rather than growing the table.
+    auto const sizeAfter = extras.size();
+    cells[1].write(GraphicsAttributes {}, U'C', 1, HyperlinkId(2000));
+    CHECK(extras.size() == sizeAfter + 1);
+    CHECK(cells[1].hyperlink() == HyperlinkId(2000));
+    CHECK(cells[0].hyperlink() == HyperlinkId(42));
+
+    extras.removeRoot(&cells);
+}
+
+TEST_CASE("PodCellAttributes", "[Line]")
+{
+    auto& attributes = PodCellAttributes::get();
+    auto cells = std::vector<PodCell>(3);
+    PodCellExtras::get().addRoot(&cells, [&](PodCellExtras::Marker& marker) {
+        for (auto const& cell: cells)
+            cell.markExtra(marker);
+    });
+    PodCellExtras::get().collect();
+
+    auto sgr = GraphicsAttributes {};
+    sgr.foregroundColor = RGBColor(0x102030);
+    sgr.flags = CellFlags::Bold;
+    cells[0].write(sgr, U'A', 1);
+    CHECK(cells[0].attributesId() != PodCellAttributes::DefaultId);
+    CHECK(cells[0].attributes() == sgr);
+
+    // Cells with equal graphics attributes share the same id.
+    cells[1].write(sgr, U'B', 1);
+    CHECK(cells[1].attributesId() == cells[0].attributesId());
+
+    // Graphics attributes not fitting into the full table are kept with the cell.
+    auto transient = PodCell {};
+    for (uint32_t i = 0; attributes.size() < PodCellAttributes::ExtraId - 1; ++i)
+        transient.write(GraphicsAttributes { RGBColor(i), RGBColor(0xFFFFFF) }, U'x', 1);
+    sgr.backgroundColor = Color::Indexed(4);
+    cells[2].write(sgr, U'C', 1, HyperlinkId(3));
+    CHECK(cells[2].attributesId() == PodCellAttributes::ExtraId);
+    CHECK(cells[2].attributes() == sgr);
+    CHECK(cells[2].hyperlink() == HyperlinkId(3));
+
+    // Collecting releases the ids no longer referred to, after which the cell gets an id again.
+    PodCellExtras::get().collect();
+    CHECK(attributes.size() <= 2);
+    cells[2].setUnderlineColor(Color::Indexed(5));
+    CHECK(cells[2].attributesId() != PodCellAttributes::ExtraId);
+    CHECK(cells[2].backgroundColor() == Color::Indexed(4));
+    CHECK(cells[2].underlineColor() == Color::Indexed(5));
+    CHECK(cells[2].hyperlink() == HyperlinkId(3));
+    CHECK(cells[0].attributes() == cells[1].attributes());
+    CHECK(cells[0].foregroundColor() == Color(RGBColor(0x102030)));
+
+    PodCellExtras::get().removeRoot(&cells);
+}
@@ -0,0 +1,106 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/Metrics.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <ostream>
+
+using std::pair;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal
+{
+
+namespace
+{
+    string jsonEscape(string_view text)
+    {
+        auto result = string {};
+        for (char const ch: text)
+        {
+            switch (ch)
+            {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20)
+                        result += fmt::format("\\u{:04x}", static_cast<unsigned>(ch));
+                    else
+                        result += ch;
+                    break;
+            }
+        }
+        return result;
+    }
+} // namespace
+
+vector<pair<FunctionDefinition const*, uint64_t>> Metrics::ordered() const
+{
+    auto vec = vector<pair<FunctionDefinition const*, uint64_t>> {};
+    for (size_t i = 0; i < functionCounts.size(); ++i)
+        if (functionCounts[i])
+            vec.emplace_back(&functions()[i], functionCounts[i]);
+
+    std::stable_sort(
+        vec.begin(), vec.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+    return vec;
+}
+
+void Metrics::inspect(std::ostream& os) const
+{
+    os << "VT metrics:\n";
+    os << fmt::format("text bytes (bulk)    : {}\n", textBytes);
+    os << fmt::format("text codepoints      : {}\n", textCodepoints);
+    os << fmt::format("C0 control codes     : {}\n", controlCodes);
+    os << fmt::format("CSI parser fallbacks : {}\n", csiFallbacks);
+    os << fmt::format("unknown sequences    : {}\n", unknownSequences);
+    for (auto const& [function, count]: ordered())
+        os << fmt::format("{:>20} : {:<12} {}\n", count, function->mnemonic, *function);
+}
+
+string Metrics::toJson() const
+{
+    auto json = fmt::format("{{\n"
+                            "  \"textBytes\": {},\n"
+                            "  \"textCodepoints\": {},\n"
+                            "  \"controlCodes\": {},\n"
+                            "  \"csiFallbacks\": {},\n"
+                            "  \"unknownSequences\": {},\n"
+                            "  \"functions\": [",
+                            textBytes,
+                            textCodepoints,
+                            controlCodes,
+                            csiFallbacks,
+                            unknownSequences);
+
+    auto first = true;
+    for (auto const& [function, count]: ordered())
+    {
+        json += fmt::format("{}\n    {{ \"mnemonic\": \"{}\", \"function\": \"{}\", \"count\": {} }}",
+                            first ? "" : ",",
+                            jsonEscape(function->mnemonic),
+                            jsonEscape(fmt::format("{}", *function)),
+                            count);
+        first = false;
+    }
+
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+} // namespace terminal
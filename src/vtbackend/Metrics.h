@@ -13,39 +13,56 @@
  */
 #pragma once
 
-#include <vtbackend/Sequencer.h> // Sequence
+#include <vtbackend/Functions.h>
 
-#include <algorithm>
-#include <map>
+#include <array>
+#include <cstdint>
+#include <iosfwd>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace terminal
 {
 
 /// Used for collecting VT sequence usage metrics.
+///
+/// Collecting is cheap enough to be always enabled: every counter is a plain integer,
+/// only ever updated by the thread running the VT parser.
+/// Other threads must only look at a copy, such as returned by Terminal::metrics().
 struct Metrics
 {
-    // XXX Too bad the key is a string.
-    std::map<std::string, uint64_t> sequences;
+    /// Number of invocations per function, indexed by functionIndex().
+    std::array<uint64_t, functions().size()> functionCounts {};
 
-    void operator()(Sequence const& seq) { sequences[seq.text()]++; }
+    /// Number of VT sequences that did not match any function.
+    uint64_t unknownSequences = 0;
 
-    /// @returns an ordered list of collected metrics, with highest frequencey first.
-    [[nodiscard]] std::vector<std::pair<std::string, uint64_t>> ordered() const
+    /// Number of text bytes processed in bulk.
+    uint64_t textBytes = 0;
+
+    /// Number of text codepoints processed one by one, i.e. not in bulk.
+    uint64_t textCodepoints = 0;
+
+    /// Number of C0 control codes executed.
+    uint64_t controlCodes = 0;
+
+    /// Number of CSI sequences parsed by the parser's state machine rather than its fast path.
+    uint64_t csiFallbacks = 0;
+
+    void countFunction(FunctionDefinition const& function) noexcept
     {
-        std::vector<std::pair<std::string, uint64_t>> vec;
-        for (auto const& [name, freq]: sequences)
-            vec.emplace_back(name, freq);
-
-        std::sort(vec.begin(), vec.end(), [](auto const& a, auto const& b) {
-            if (a.second > b.second)
-                return true;
-            if (a.second == b.second)
-                return a.first > b.first;
-            return false;
-        });
-        return vec;
+        ++functionCounts[functionIndex(function)];
     }
+
+    /// @returns an ordered list of invoked functions, with highest frequency first.
+    [[nodiscard]] std::vector<std::pair<FunctionDefinition const*, uint64_t>> ordered() const;
+
+    /// Writes a human readable summary of the collected metrics.
+    void inspect(std::ostream& os) const;
+
+    /// @returns the collected metrics as a JSON document.
+    [[nodiscard]] std::string toJson() const;
 };
 
 } // namespace terminal
@@ -64,6 +64,7 @@ class MockTerm: public Terminal::Events
         mockPty().appendStdOutBuffer(text);
         while (mockPty().isStdoutDataAvailable())
             terminal.processInputOnce();
+        terminal.waitUntilApplied();
     }
 
     void writeToScreen(std::u32string_view text) { writeToScreen(unicode::convert_to<char>(text)); }
@@ -82,6 +83,8 @@ class MockTerm: public Terminal::Events
         settings.pageSize = pageSize;
         settings.maxHistoryLineCount = maxHistoryLineCount;
         settings.ptyReadBufferSize = ptyReadBufferSize;
+        // Allows running the very same tests against the two-stage parse/apply pipeline.
+        settings.pipelinedParsing = getenv("PIPELINED_PARSING") != nullptr;
         return settings;
     }
 
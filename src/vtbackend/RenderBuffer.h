@@ -21,6 +21,8 @@
 
 #include <vtrasterizer/RenderTarget.h>
 
+#include <crispy/BufferObject.h>
+
 #include <atomic>
 #include <chrono>
 #include <mutex>
@@ -60,6 +62,7 @@ struct RenderCell
 struct RenderLine
 {
     std::string_view text;
+    crispy::BufferFragment<char> textBuffer; // Keeps the text alive for as long as the line is rendered.
     LineOffset lineOffset;
     ColumnCount usedColumns;
     ColumnCount displayWidth;
@@ -74,10 +77,28 @@ struct RenderCursor
     int width = 1;
 };
 
+/**
+ * Describes which cells and lines of a RenderBuffer a single grid line has been rendered into,
+ * such that the next frame can copy them over rather than rendering that grid line again.
+ */
+struct RenderBufferRow
+{
+    /// Generation of the rendered grid line, or 0 if the rendered row must not be reused.
+    ///
+    /// @see Line<Cell>::generation()
+    uint64_t generation = 0;
+
+    size_t firstCell = 0;
+    size_t cellCount = 0;
+    size_t firstLine = 0;
+    size_t lineCount = 0;
+};
+
 struct RenderBuffer
 {
     std::vector<RenderCell> cells {};
     std::vector<RenderLine> lines {};
+    std::vector<RenderBufferRow> rows {};
     std::optional<RenderCursor> cursor {};
     uint64_t frameID {};
 
@@ -85,6 +106,7 @@ struct RenderBuffer
     {
         cells.clear();
         lines.clear();
+        rows.clear();
         cursor.reset();
     }
 };
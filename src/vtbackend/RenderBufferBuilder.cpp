@@ -16,12 +16,15 @@
 #include <vtbackend/Color.h>
 #include <vtbackend/ColorPalette.h>
 #include <vtbackend/RenderBufferBuilder.h>
+#include <vtbackend/cell/PodCell.h>
 
 #include <crispy/utils.h>
 
 #include <unicode/convert.h>
 #include <unicode/utf8_grapheme_segmenter.h>
 
+#include <type_traits>
+
 using namespace std;
 
 namespace terminal
@@ -62,21 +65,14 @@ namespace
             .distinct();
     }
 
+    /// @param sgrColors the colors resolved from the cell's graphics attributes.
     RGBColorPair makeColors(ColorPalette const& colorPalette,
-                            CellFlags cellFlags,
-                            bool reverseVideo,
-                            Color foregroundColor,
-                            Color backgroundColor,
+                            RGBColorPair sgrColors,
                             bool selected,
                             bool isCursor,
                             bool isCursorLine,
-                            bool isHighlighted,
-                            bool blink,
-                            bool rapidBlink) noexcept
+                            bool isHighlighted) noexcept
     {
-        auto sgrColors = CellUtil::makeColors(
-            colorPalette, cellFlags, reverseVideo, foregroundColor, backgroundColor, blink, rapidBlink);
-
         if (isCursorLine)
             sgrColors = makeRGBColorPair(sgrColors, colorPalette.normalModeCursorline);
 
@@ -122,7 +118,8 @@ RenderBufferBuilder<Cell>::RenderBufferBuilder(Terminal const& terminal,
                                                HighlightSearchMatches highlightSearchMatches,
                                                InputMethodData inputMethodData,
                                                optional<CellLocation> theCursorPosition,
-                                               bool includeSelection):
+                                               bool includeSelection,
+                                               RenderBuffer const* previousFrame):
     _output { output },
     _terminal { terminal },
     _cursorPosition { theCursorPosition },
@@ -130,7 +127,8 @@ RenderBufferBuilder<Cell>::RenderBufferBuilder(Terminal const& terminal,
     _reverseVideo { theReverseVideo },
     _highlightSearchMatches { highlightSearchMatches },
     _inputMethodData { std::move(inputMethodData) },
-    _includeSelection { includeSelection }
+    _includeSelection { includeSelection },
+    _previousFrame { previousFrame }
 {
     output.frameID = terminal.lastFrameID();
 
@@ -252,6 +250,13 @@ RGBColorPair RenderBufferBuilder<Cell>::makeColorsForCell(CellLocation gridPosit
                                                           CellFlags cellFlags,
                                                           Color foregroundColor,
                                                           Color backgroundColor) const noexcept
+{
+    return makeColorsForCell(gridPosition, makeSgrColors(cellFlags, foregroundColor, backgroundColor));
+}
+
+template <typename Cell>
+RGBColorPair RenderBufferBuilder<Cell>::makeColorsForCell(CellLocation gridPosition,
+                                                          RGBColorPair sgrColors) const noexcept
 {
     auto const hasCursor = _cursorPosition && gridPosition == *_cursorPosition;
 
@@ -265,20 +270,72 @@ RGBColorPair RenderBufferBuilder<Cell>::makeColorsForCell(CellLocation gridPosit
     auto const selected =
         _includeSelection && _terminal.isSelected(CellLocation { gridPosition.line, gridPosition.column });
     auto const highlighted = _terminal.isHighlighted(CellLocation { gridPosition.line, gridPosition.column });
-    auto const blink = _terminal.blinkState();
-    auto const rapidBlink = _terminal.rapidBlinkState();
 
     return makeColors(_terminal.colorPalette(),
-                      cellFlags,
-                      _reverseVideo,
-                      foregroundColor,
-                      backgroundColor,
+                      sgrColors,
                       selected,
                       paintCursor,
                       _useCursorlineColoring,
-                      highlighted,
-                      blink,
-                      rapidBlink);
+                      highlighted);
+}
+
+template <typename Cell>
+RGBColorPair RenderBufferBuilder<Cell>::makeSgrColors(CellFlags cellFlags,
+                                                      Color foregroundColor,
+                                                      Color backgroundColor) const noexcept
+{
+    // Palette, reverse video and blink states do not change within a frame,
+    // so the colors only depend on the graphics attributes.
+    auto hash = uint32_t { 2166136261u }; // FNV-1a
+    auto const key =
+        std::array { static_cast<uint32_t>(cellFlags), foregroundColor.content, backgroundColor.content };
+    for (auto const value: key)
+    {
+        hash ^= value;
+        hash *= 16777619u;
+    }
+    auto& entry = _sgrColors[hash % _sgrColors.size()];
+    if (entry.used && entry.flags == cellFlags && entry.foregroundColor == foregroundColor
+        && entry.backgroundColor == backgroundColor)
+        return entry.colors;
+
+    auto const colors = CellUtil::makeColors(_terminal.colorPalette(),
+                                             cellFlags,
+                                             _reverseVideo,
+                                             foregroundColor,
+                                             backgroundColor,
+                                             _terminal.blinkState(),
+                                             _terminal.rapidBlinkState());
+    entry = SgrColors { true, cellFlags, foregroundColor, backgroundColor, colors };
+    return colors;
+}
+
+template <typename Cell>
+RGBColorPair RenderBufferBuilder<Cell>::makeSgrColors(Cell const& cell) const noexcept
+{
+    if constexpr (std::is_same_v<Cell, PodCell>)
+    {
+        // The cell refers to its graphics attributes by id, so colors are resolved once per id and frame.
+        if (auto const id = cell.attributesId(); id != PodCellAttributes::ExtraId)
+        {
+            if (id >= _sgrColorsById.size())
+                _sgrColorsById.resize(id + 1);
+            auto& colors = _sgrColorsById[id];
+            if (!colors)
+            {
+                auto const& attributes = cell.attributes();
+                colors = CellUtil::makeColors(_terminal.colorPalette(),
+                                              attributes.flags,
+                                              _reverseVideo,
+                                              attributes.foregroundColor,
+                                              attributes.backgroundColor,
+                                              _terminal.blinkState(),
+                                              _terminal.rapidBlinkState());
+            }
+            return *colors;
+        }
+    }
+    return makeSgrColors(cell.flags(), cell.foregroundColor(), cell.backgroundColor());
 }
 
 template <typename Cell>
@@ -309,6 +366,7 @@ RenderLine RenderBufferBuilder<Cell>::createRenderLine(TrivialLineBuffer const&
     renderLine.usedColumns = lineBuffer.usedColumns;
     renderLine.displayWidth = _terminal.pageSize().columns;
     renderLine.text = lineBuffer.text.view();
+    renderLine.textBuffer = lineBuffer.text;
     renderLine.textAttributes = createRenderAttributes(gridPosition, lineBuffer.textAttributes);
     renderLine.fillAttributes = createRenderAttributes(gridPosition, lineBuffer.fillAttributes);
 
@@ -331,6 +389,76 @@ bool RenderBufferBuilder<Cell>::gridLineContainsCursor(LineOffset lineOffset) co
     return false;
 }
 
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::lineContainsCursor(LineOffset lineOffset) const noexcept
+{
+    return gridLineContainsCursor(lineOffset)
+           || (_cursorPosition
+               && _terminal.viewport().translateGridToScreenCoordinate(_cursorPosition->line) == lineOffset);
+}
+
+template <typename Cell>
+RenderBufferRow const* RenderBufferBuilder<Cell>::findPreviousRow(LineOffset line, uint64_t generation)
+{
+    auto const& rows = _previousFrame->rows;
+
+    auto const index = unbox<size_t>(_baseLine + line);
+    if (index < rows.size() && rows[index].generation == generation)
+        return &rows[index];
+
+    // The grid line has either changed or been moved to another line, such as by scrolling.
+    if (!_previousRowsIndexed)
+    {
+        for (size_t i = 0; i < rows.size(); ++i)
+            if (rows[i].generation)
+                _previousRows.emplace(rows[i].generation, i);
+        _previousRowsIndexed = true;
+    }
+
+    if (auto const i = _previousRows.find(generation); i != _previousRows.end())
+        return &rows[i->second];
+
+    return nullptr;
+}
+
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::reuseLine(LineOffset line, uint64_t generation)
+{
+    _lineFirstCell = _output.cells.size();
+    _lineFirstLine = _output.lines.size();
+
+    if (!_previousFrame || lineContainsCursor(line))
+        return false;
+
+    auto const* row = findPreviousRow(line, generation);
+    if (!row)
+        return false;
+
+    // The rendered cells and lines of a grid line do not depend on the lines rendered before,
+    // so they can be copied over as they are, only moved to the line they are rendered at now.
+    for (size_t i = row->firstCell; i != row->firstCell + row->cellCount; ++i)
+        _output.cells.emplace_back(_previousFrame->cells[i]).position.line = _baseLine + line;
+
+    for (size_t i = row->firstLine; i != row->firstLine + row->lineCount; ++i)
+        _output.lines.emplace_back(_previousFrame->lines[i]).lineOffset = line;
+
+    lineRendered(line, generation, false);
+    return true;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::lineRendered(LineOffset line, uint64_t generation, bool blinking)
+{
+    // Blinking cells and the cursor change their colors over time without the grid line changing.
+    auto const reusable = !blinking && !lineContainsCursor(line);
+
+    _output.rows.emplace_back(RenderBufferRow { reusable ? generation : 0,
+                                                _lineFirstCell,
+                                                _output.cells.size() - _lineFirstCell,
+                                                _lineFirstLine,
+                                                _output.lines.size() - _lineFirstLine });
+}
+
 template <typename Cell>
 void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineOffset)
 {
@@ -378,28 +506,70 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
                    lineBuffer.text.view(),
                    true);
 
-    // {{{ fill the remaining empty cells
-    for (auto columnOffset = textMargin; columnOffset < pageColumnsEnd; ++columnOffset)
+    // fill the remaining empty cells
+    renderBlankCells(lineOffset, textMargin, pageColumnsEnd, lineBuffer.fillAttributes);
+
+    auto const backIndex = _output.cells.size() - 1;
+
+    _output.cells[frontIndex].groupStart = true;
+    _output.cells[backIndex].groupEnd = true;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::renderAttributedLine(AttributedLineBuffer const& lineBuffer,
+                                                     LineOffset lineOffset)
+{
+    // Same as for trivial lines, the cursor line is rendered without cursor line coloring.
+    _useCursorlineColoring = false;
+
+    auto const frontIndex = _output.cells.size();
+    auto const pageColumnsEnd = boxed_cast<ColumnOffset>(_terminal.pageSize().columns);
+
+    _searchPatternOffset = 0;
+    auto runStart = ColumnOffset(0);
+    for (AttributedLineRun const& run: lineBuffer.runs)
+    {
+        auto const runEnd = min(runStart + boxed_cast<ColumnOffset>(run.columns), pageColumnsEnd);
+        auto const textEnd =
+            runStart
+            + boxed_cast<ColumnOffset>(renderUtf8Text(
+                CellLocation { lineOffset, runStart }, run.attributes, run.text.view(), true));
+        renderBlankCells(lineOffset, textEnd, runEnd, run.attributes);
+        runStart = runEnd;
+    }
+
+    renderBlankCells(lineOffset, runStart, pageColumnsEnd, lineBuffer.fillAttributes);
+
+    if (frontIndex == _output.cells.size())
+        return;
+
+    auto const backIndex = _output.cells.size() - 1;
+
+    _output.cells[frontIndex].groupStart = true;
+    _output.cells[backIndex].groupEnd = true;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::renderBlankCells(LineOffset lineOffset,
+                                                 ColumnOffset from,
+                                                 ColumnOffset to,
+                                                 GraphicsAttributes const& attributes)
+{
+    for (auto columnOffset = from; columnOffset < to; ++columnOffset)
     {
         auto const pos = CellLocation { lineOffset, columnOffset };
         auto const gridPosition = _terminal.viewport().translateScreenToGridCoordinate(pos);
-        auto renderAttributes = createRenderAttributes(gridPosition, lineBuffer.fillAttributes);
+        auto renderAttributes = createRenderAttributes(gridPosition, attributes);
 
         _output.cells.emplace_back(makeRenderCellExplicit(_terminal.colorPalette(),
                                                           char32_t { 0 },
-                                                          lineBuffer.fillAttributes.flags,
+                                                          attributes.flags,
                                                           renderAttributes.foregroundColor,
                                                           renderAttributes.backgroundColor,
-                                                          lineBuffer.fillAttributes.underlineColor,
+                                                          attributes.underlineColor,
                                                           _baseLine + lineOffset,
                                                           columnOffset));
     }
-    // }}}
-
-    auto const backIndex = _output.cells.size() - 1;
-
-    _output.cells[frontIndex].groupStart = true;
-    _output.cells[backIndex].groupEnd = true;
 }
 
 template <typename Cell>
@@ -621,8 +791,7 @@ void RenderBufferBuilder<Cell>::renderCell(Cell const& screenCell, LineOffset li
     if (tryRenderInputMethodEditor(screenPosition, gridPosition))
         return;
 
-    auto /*const*/ [fg, bg] = makeColorsForCell(
-        gridPosition, screenCell.flags(), screenCell.foregroundColor(), screenCell.backgroundColor());
+    auto /*const*/ [fg, bg] = makeColorsForCell(gridPosition, makeSgrColors(screenCell));
 
     _prevWidth = screenCell.width();
     _prevHasCursor = _cursorPosition && gridPosition == *_cursorPosition;
@@ -679,3 +848,6 @@ template class terminal::RenderBufferBuilder<terminal::CompactCell>;
 
 #include <vtbackend/cell/SimpleCell.h>
 template class terminal::RenderBufferBuilder<terminal::SimpleCell>;
+
+#include <vtbackend/cell/PodCell.h>
+template class terminal::RenderBufferBuilder<terminal::PodCell>;
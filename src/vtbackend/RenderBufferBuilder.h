@@ -4,7 +4,10 @@
 #include <vtbackend/Terminal.h>
 #include <vtbackend/primitives.h>
 
+#include <array>
 #include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace terminal
 {
@@ -23,7 +26,23 @@ class RenderBufferBuilder
                         HighlightSearchMatches highlightSearchMatches,
                         InputMethodData inputMethodData,
                         std::optional<CellLocation> theCursorPosition,
-                        bool includeSelection);
+                        bool includeSelection,
+                        RenderBuffer const* previousFrame = nullptr);
+
+    /// Copies the given grid line over from the previous frame, if it has been rendered there
+    /// (possibly at another line, such as before scrolling) and has not changed since.
+    ///
+    /// This call is made for every line, before rendering it.
+    ///
+    /// @param line       screen line to render the grid line at
+    /// @param generation generation of the grid line to render
+    ///
+    /// @retval true  the line has been copied over and is not to be rendered.
+    /// @retval false the line is to be rendered, followed by a call to lineRendered().
+    [[nodiscard]] bool reuseLine(LineOffset line, uint64_t generation);
+
+    /// Records the cells and lines the given grid line has been rendered into, for the next frame to reuse.
+    void lineRendered(LineOffset line, uint64_t generation, bool blinking);
 
     /// Renders a single grid cell.
     /// This call is guaranteed to be invoked sequencially, from top line
@@ -46,6 +65,14 @@ class RenderBufferBuilder
     /// @see renderCell
     void renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineOffset);
 
+    /// Renders an attributed line, run by run.
+    ///
+    /// This call is guaranteed to be invoked sequencially from page top
+    /// to page bottom for every attributed line in order.
+    ///
+    /// @see renderTrivialLine
+    void renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineOffset);
+
     /// This call is guaranteed to be invoked when the the full page has been rendered.
     void finish() noexcept {}
 
@@ -89,6 +116,14 @@ class RenderBufferBuilder
                                                  CellFlags cellFlags,
                                                  Color foregroundColor,
                                                  Color backgroundColor) const noexcept;
+    [[nodiscard]] RGBColorPair makeColorsForCell(CellLocation, RGBColorPair sgrColors) const noexcept;
+
+    /// Resolves the colors of the given graphics attributes, before taking cursor, selection
+    /// and highlighting into account.
+    [[nodiscard]] RGBColorPair makeSgrColors(CellFlags cellFlags,
+                                             Color foregroundColor,
+                                             Color backgroundColor) const noexcept;
+    [[nodiscard]] RGBColorPair makeSgrColors(Cell const& cell) const noexcept;
 
     [[nodiscard]] RenderLine createRenderLine(TrivialLineBuffer const& lineBuffer,
                                               LineOffset lineOffset) const;
@@ -98,6 +133,12 @@ class RenderBufferBuilder
 
     [[nodiscard]] bool tryRenderInputMethodEditor(CellLocation screenPosition, CellLocation gridPosition);
 
+    /// Renders the blank cells in the columns [from, to) of the given line.
+    void renderBlankCells(LineOffset lineOffset,
+                          ColumnOffset from,
+                          ColumnOffset to,
+                          GraphicsAttributes const& attributes);
+
     ColumnCount renderUtf8Text(CellLocation screenPosition,
                                GraphicsAttributes attributes,
                                std::string_view text,
@@ -111,6 +152,12 @@ class RenderBufferBuilder
     /// on the given line offset.
     [[nodiscard]] bool gridLineContainsCursor(LineOffset screenLineOffset) const noexcept;
 
+    /// Tests if the given screen line offset contains the cursor, including the cursor's input method
+    /// preedit string, such that the line must not be reused from or for another frame.
+    [[nodiscard]] bool lineContainsCursor(LineOffset screenLineOffset) const noexcept;
+
+    [[nodiscard]] RenderBufferRow const* findPreviousRow(LineOffset line, uint64_t generation);
+
     // clang-format off
     enum class State { Gap, Sequence };
     // clang-format on
@@ -123,8 +170,17 @@ class RenderBufferBuilder
     HighlightSearchMatches _highlightSearchMatches;
     InputMethodData _inputMethodData;
     bool _includeSelection;
+    RenderBuffer const* _previousFrame;
     ColumnCount _inputMethodSkipColumns = ColumnCount(0);
 
+    // Cells and lines of the output the line being rendered starts at.
+    size_t _lineFirstCell = 0;
+    size_t _lineFirstLine = 0;
+
+    // Rows of the previous frame by generation, to find the lines moved since. Built on first use.
+    std::unordered_map<uint64_t, size_t> _previousRows;
+    bool _previousRowsIndexed = false;
+
     int _prevWidth = 0;
     bool _prevHasCursor = false;
     State _state = State::Gap;
@@ -134,6 +190,21 @@ class RenderBufferBuilder
 
     // Offset into the search pattern that has been already matched.
     size_t _searchPatternOffset = 0;
+
+    // Direct-mapped cache of the colors resolved for the graphics attributes seen in this frame,
+    // as a screen mostly uses only a few dozen distinct graphics attributes.
+    struct SgrColors
+    {
+        bool used = false;
+        CellFlags flags {};
+        Color foregroundColor {};
+        Color backgroundColor {};
+        RGBColorPair colors {};
+    };
+    mutable std::array<SgrColors, 64> _sgrColors {};
+
+    // Colors resolved in this frame by id of the graphics attributes, for cells referring to them by id.
+    mutable std::vector<std::optional<RGBColorPair>> _sgrColorsById;
 };
 
 } // namespace terminal
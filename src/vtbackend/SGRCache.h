@@ -0,0 +1,93 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vtbackend/GraphicsAttributes.h>
+#include <vtbackend/Sequence.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace terminal
+{
+
+/// Small direct-mapped cache of recently seen SGR parameter lists and their precompiled
+/// GraphicsAttributesDelta.
+///
+/// Colorized output (compilers, ls, diffs, ...) tends to repeat the same handful of SGRs
+/// over and over again, so most SGRs do not need to be parsed twice.
+class SGRCache
+{
+  public:
+    static constexpr size_t Capacity = 64;
+
+    /// @returns the cached delta for the given SGR parameters or nullptr if not cached.
+    [[nodiscard]] GraphicsAttributesDelta const* find(SequenceParameters const& parameters) const noexcept
+    {
+        auto const& entry = _entries[slotOf(parameters)];
+        if (entry.used && matches(entry, parameters))
+            return &entry.delta;
+        return nullptr;
+    }
+
+    /// Caches the given delta for the given SGR parameters, evicting any previous entry in its slot.
+    GraphicsAttributesDelta const& insert(SequenceParameters const& parameters,
+                                          GraphicsAttributesDelta const& delta) noexcept
+    {
+        auto const values = parameters.range();
+        auto& entry = _entries[slotOf(parameters)];
+        entry.used = true;
+        entry.count = static_cast<uint8_t>(values.size());
+        entry.subParameterMask = parameters.subParameterMask();
+        std::copy(values.begin(), values.end(), entry.values.begin());
+        entry.delta = delta;
+        return entry.delta;
+    }
+
+  private:
+    struct Entry
+    {
+        bool used = false;
+        uint8_t count = 0;
+        uint16_t subParameterMask = 0;
+        SequenceParameters::Storage values {};
+        GraphicsAttributesDelta delta {};
+    };
+
+    [[nodiscard]] static bool matches(Entry const& entry, SequenceParameters const& parameters) noexcept
+    {
+        auto const values = parameters.range();
+        return entry.count == values.size() && entry.subParameterMask == parameters.subParameterMask()
+               && std::equal(values.begin(), values.end(), entry.values.begin());
+    }
+
+    [[nodiscard]] static size_t slotOf(SequenceParameters const& parameters) noexcept
+    {
+        // FNV-1a over the parameter values and their sub-parameter structure.
+        auto hash = uint32_t { 2166136261u };
+        auto const mix = [&](uint32_t value) {
+            hash ^= value;
+            hash *= 16777619u;
+        };
+        mix(parameters.subParameterMask());
+        for (auto const value: parameters.range())
+            mix(value);
+        return hash % Capacity;
+    }
+
+    std::array<Entry, Capacity> _entries {};
+};
+
+} // namespace terminal
@@ -43,6 +43,7 @@
 #include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <variant>
 
 using namespace std::string_view_literals;
@@ -75,7 +76,6 @@ using std::ostringstream;
 using std::pair;
 using std::prev;
 using std::ref;
-using std::rotate;
 using std::shared_ptr;
 using std::string;
 using std::string_view;
@@ -372,7 +372,7 @@ string_view Screen<Cell>::tryEmplaceChars(string_view chars, size_t cellCount) n
         if (currentLine().empty())
         {
             auto const numberOfBytesEmplaced = emplaceCharsIntoCurrentLine(chars, cellCount);
-            _terminal.currentPtyBuffer()->advanceHotEndUntil(chars.data() + numberOfBytesEmplaced);
+            _terminal.retainPtyBufferUntil(chars.data() + numberOfBytesEmplaced);
             chars.remove_prefix(numberOfBytesEmplaced);
             assert(chars.empty());
         }
@@ -387,11 +387,25 @@ string_view Screen<Cell>::tryEmplaceChars(string_view chars, size_t cellCount) n
         lineBuffer.text.growBy(chars.size());
         lineBuffer.usedColumns += ColumnCount::cast_from(cellCount);
         advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
-        _terminal.currentPtyBuffer()->advanceHotEndUntil(chars.data() + chars.size());
+        _terminal.retainPtyBufferUntil(chars.data() + chars.size());
         chars.remove_prefix(chars.size());
         return chars;
     }
 
+    // Append the chars with their own graphics attributes (and possibly after a gap),
+    // such that colorized output does not inflate the line.
+    auto const cellsEmplaced = ColumnCount::cast_from(cellCount);
+    if (currentLine().tryAppendText(_cursor.position.column,
+                                    _cursor.graphicsRendition,
+                                    _cursor.hyperlink,
+                                    crispy::BufferFragment { _terminal.currentPtyBuffer(), chars },
+                                    cellsEmplaced))
+    {
+        advanceCursorAfterWrite(cellsEmplaced);
+        _terminal.retainPtyBufferUntil(chars.data() + chars.size());
+        chars.remove_prefix(chars.size());
+    }
+
     return chars;
 }
 
@@ -420,10 +434,7 @@ size_t Screen<Cell>::emplaceCharsIntoCurrentLine(string_view chars, size_t cellC
     {
         // Transforming chars input from UTF-8 to UTF-32 even though right now it should only
         // be containing US-ASCII, but soon it'll be any arbitrary textual Unicode codepoints.
-        for (char const ch: chars)
-        {
-            _state.parser.printUtf8Byte(ch);
-        }
+        writeTextCodepointwise(chars);
     }
     return chars.size();
 }
@@ -452,18 +463,126 @@ void Screen<Cell>::writeText(string_view text, size_t cellCount)
     if (VTTraceSequenceLog)
         VTTraceSequenceLog()("text({} bytes, {} cells): \"{}\"", text.size(), cellCount, escape(text));
 #endif
-    assert(cellCount <= static_cast<size_t>(pageSize().columns.value - _cursor.position.column.value));
+    // Counted here rather than by the parser, which may run on a thread of its own.
+    _terminal.state().instructionCounter += text.size();
+
+    if (cellCount > static_cast<size_t>(pageSize().columns.value - _cursor.position.column.value))
+    {
+        // Only printable US-ASCII text may exceed the current line, see Terminal::maxBulkAsciiTextLength().
+        assert(cellCount == text.size());
+        writeTextLines(text);
+        return;
+    }
 
     text = tryEmplaceChars(text, cellCount);
     if (text.empty())
         return;
 
     // Making use of the optimized code path for the input characters did NOT work, so we need to first
-    // convert UTF-8 to UTF-32 codepoints (reusing the logic in VT parser) and pass these codepoints
-    // to the grapheme cluster processor.
+    // convert UTF-8 to UTF-32 codepoints and pass these codepoints to the grapheme cluster processor.
+    writeTextCodepointwise(text);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::writeTextLines(string_view text)
+{
+    auto const pageWidth = unbox<size_t>(pageSize().columns);
+    while (!text.empty())
+    {
+        text = tryEmplaceLines(text);
+        if (text.empty())
+            break;
+
+        // Write the remainder of the current line (or the last partial line) the usual way.
+        crlfIfWrapPending();
+        auto const count = std::min(text.size(), pageWidth - unbox<size_t>(_cursor.position.column));
+        writeText(text.substr(0, count), count);
+        text.remove_prefix(count);
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+string_view Screen<Cell>::tryEmplaceLines(string_view text) noexcept
+{
+    // Whole lines are overwritten entirely, so their previous contents do not matter.
+    if (!_cursor.wrapPending || !_cursor.autoWrap || !isFullHorizontalMargins()
+        || !_cursor.charsets.isSelected(CharsetId::USASCII))
+        return text;
+
+    auto const top = margin().vertical.from;
+    auto const bottom = margin().vertical.to;
+    if (_cursor.position.line < top || bottom < _cursor.position.line)
+        return text;
+
+    auto const pageWidth = unbox<size_t>(pageSize().columns);
+    auto const lineCount = std::min(text.size() / pageWidth, unbox<size_t>(bottom - top) + 1);
+    if (lineCount == 0)
+        return text;
+
+    // Make room for all lines with a single scroll rather than one per line feed.
+    auto wrappable = currentLine().wrappable();
+    auto firstLine = _cursor.position.line + 1;
+    if (auto const linesBelow = unbox<size_t>(bottom - _cursor.position.line); lineCount > linesBelow)
+    {
+        auto const scrollCount = LineCount::cast_from(lineCount - linesBelow);
+        scrollUp(scrollCount, _cursor.graphicsRendition, margin());
+        firstLine = firstLine - boxed_cast<LineOffset>(scrollCount);
+    }
 
-    for (char const ch: text)
-        _state.parser.printUtf8Byte(ch);
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        auto& line = _grid.lineAt(firstLine + LineOffset::cast_from(i));
+        line.setBuffer(TrivialLineBuffer { pageSize().columns,
+                                           _cursor.graphicsRendition,
+                                           _cursor.graphicsRendition,
+                                           _cursor.hyperlink,
+                                           pageSize().columns,
+                                           crispy::BufferFragment { _terminal.currentPtyBuffer(),
+                                                                    text.substr(0, pageWidth) } });
+        if (wrappable)
+            line.setFlag(LineFlags::Wrappable | LineFlags::Wrapped, true);
+        wrappable = line.wrappable();
+        text.remove_prefix(pageWidth);
+    }
+
+    _cursor.position.line = firstLine + LineOffset::cast_from(lineCount - 1);
+    _cursor.position.column = boxed_cast<ColumnOffset>(pageSize().columns) - 1;
+    _cursor.wrapPending = true;
+    updateCursorIterator();
+    _terminal.retainPtyBufferUntil(text.data());
+    return text;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::writeTextCodepointwise(string_view text)
+{
+    auto* const pipeline = _terminal.applyingSequencePipeline();
+    if (!pipeline)
+    {
+        // Reusing the logic in VT parser, which also keeps track of the preceding graphic character.
+        for (char const ch: text)
+            _state.parser.printUtf8Byte(ch);
+        return;
+    }
+
+    // The VT parser is busy on the parser stage's thread, so convert here.
+    for (char32_t const codepoint: unicode::convert_to<char32_t>(text))
+    {
+        writeTextInternal(codepoint);
+        pipeline->setPrecedingGraphicCharacter(codepoint);
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+char32_t Screen<Cell>::precedingGraphicCharacter() const noexcept
+{
+    if (auto const* pipeline = _terminal.applyingSequencePipeline())
+        return pipeline->precedingGraphicCharacter();
+    return _state.parser.precedingGraphicCharacter();
 }
 
 template <typename Cell>
@@ -501,6 +620,7 @@ void Screen<Cell>::writeText(char32_t codepoint)
         VTTraceSequenceLog()("char: \'{}\'", unicode::convert_to<char>(codepoint));
 #endif
 
+    _terminal.state().instructionCounter++;
     return writeTextInternal(codepoint);
 }
 
@@ -594,6 +714,7 @@ std::string Screen<Cell>::screenshot(function<string(LineOffset)> const& postLin
 {
     auto result = std::stringstream {};
     auto writer = VTWriter(result);
+    writer.setHyperlinkStorage(&_state.hyperlinks);
 
     for (int const line: ::ranges::views::iota(0, *_settings.pageSize.lines))
     {
@@ -927,9 +1048,8 @@ void Screen<Cell>::eraseCharacters(ColumnCount n)
         _settings.pageSize.columns - boxed_cast<ColumnCount>(realCursorPosition().column);
     auto const clampedN = unbox<long>(clamp(n, ColumnCount(1), columnsAvailable));
 
-    auto& line = currentLine();
-    for (int i = 0; i < clampedN; ++i)
-        line.useCellAt(_cursor.position.column + i).reset(_cursor.graphicsRendition);
+    auto cells = currentLine().useRange(_cursor.position.column, ColumnCount::cast_from(clampedN));
+    fill(cells.begin(), cells.end(), Cell { _cursor.graphicsRendition });
 }
 
 // {{{ DECSEL
@@ -1168,14 +1288,15 @@ void Screen<Cell>::insertChars(LineOffset lineOffset, ColumnCount columnsToInser
         _grid.lineAt(lineOffset).inflatedBuffer().begin() + *margin().horizontal.to - sanitizedN + 1;
     auto column2 = _grid.lineAt(lineOffset).inflatedBuffer().begin() + *margin().horizontal.to + 1;
 
-    rotate(column0, column1, column2);
+    // The cells shifted out are overwritten anyway, so move rather than rotate,
+    // which is a single memmove() for trivially copyable cells.
+    std::move_backward(column0, column1, column2);
 
-    for (Cell& cell:
-         _grid.lineAt(lineOffset)
-             .useRange(boxed_cast<ColumnOffset>(_cursor.position.column), ColumnCount::cast_from(sanitizedN)))
-    {
-        cell.write(_cursor.graphicsRendition, L' ', 1);
-    }
+    auto blank = Cell {};
+    blank.write(_cursor.graphicsRendition, L' ', 1);
+    auto cells = _grid.lineAt(lineOffset).useRange(boxed_cast<ColumnOffset>(_cursor.position.column),
+                                                   ColumnCount::cast_from(sanitizedN));
+    fill(cells.begin(), cells.end(), blank);
 }
 
 template <typename Cell>
@@ -1311,20 +1432,18 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::deleteChars(LineOffset lineOffset, ColumnOffset column, ColumnCount columnsToDelete)
 {
-    auto& line = _grid.lineAt(lineOffset);
-    auto lineBuffer = line.cells();
+    auto& lineBuffer = _grid.lineAt(lineOffset).inflatedBuffer();
 
-    Cell* left = const_cast<Cell*>(lineBuffer.data() + column.as<size_t>());
-    Cell* right = const_cast<Cell*>(lineBuffer.data() + *margin().horizontal.to + 1);
+    Cell* left = lineBuffer.data() + column.as<size_t>();
+    Cell* right = lineBuffer.data() + *margin().horizontal.to + 1;
     long const n = min(columnsToDelete.as<long>(), static_cast<long>(std::distance(left, right)));
     Cell* mid = left + n;
 
-    rotate(left, mid, right);
+    std::move(mid, right, left);
 
-    for (Cell& cell: gsl::make_span(right - n, right))
-    {
-        cell.write(_cursor.graphicsRendition, L' ', 1);
-    }
+    auto blank = Cell {};
+    blank.write(_cursor.graphicsRendition, L' ', 1);
+    fill(right - n, right, blank);
 }
 
 template <typename Cell>
@@ -1502,6 +1621,9 @@ void Screen<Cell>::captureBuffer(LineCount lineCount, bool logicalLines)
 
     auto capturedBuffer = std::string();
 
+    // The lines captured are read through the const grid, which does not reflow these on its own.
+    _grid.reflowHistory(logicalLines ? _grid.historyLineCount() : lineCount);
+
     // TODO: when capturing lineCount < screenSize.lines, start at the lowest non-empty line.
     auto const relativeStartLine =
         logicalLines ? _grid.computeLogicalLineNumberFromBottom(LineCount::cast_from(lineCount))
@@ -1533,10 +1655,10 @@ void Screen<Cell>::captureBuffer(LineCount lineCount, bool logicalLines)
 
     for (LineOffset line = startLine; line <= bottomLine; ++line)
     {
-        if (logicalLines && _grid.lineAt(line).wrapped() && !capturedBuffer.empty())
+        auto const& lineBuffer = std::as_const(_grid).lineAt(line);
+        if (logicalLines && lineBuffer.wrapped() && !capturedBuffer.empty())
             capturedBuffer.pop_back();
 
-        auto const& lineBuffer = _grid.lineAt(line);
         auto lineCellsTrimmed = lineBuffer.trim_blank_right();
         if (lineCellsTrimmed.empty())
         {
@@ -2245,13 +2367,20 @@ void Screen<Cell>::inspect(std::string const& message, std::ostream& os) const
     os << fmt::format("cursor position      : {}\n", _cursor);
     os << fmt::format("vertical margins     : {}\n", margin().vertical);
     os << fmt::format("horizontal margins   : {}\n", margin().horizontal);
+    auto const bufferObjectUsage = grid().bufferObjectUsage();
+    os << fmt::format("text buffer objects  : {} live, {} pinned in {} buffer objects\n",
+                      crispy::humanReadableBytes(bufferObjectUsage.liveBytes),
+                      crispy::humanReadableBytes(bufferObjectUsage.pinnedBytes),
+                      bufferObjectUsage.bufferCount);
     os << gridInfoLine(grid());
 
     hline();
     os << screenshot([this](LineOffset lineNo) -> string {
         // auto const absoluteLine = _grid.toAbsoluteLine(lineNo);
         return fmt::format("{} {:>4}: {}",
-                           _grid.lineAt(lineNo).isTrivialBuffer() ? "|" : ":",
+                           _grid.lineAt(lineNo).isTrivialBuffer()      ? "|"
+                           : _grid.lineAt(lineNo).isAttributedBuffer() ? "!"
+                                                                       : ":",
                            lineNo.value,
                            _grid.lineAt(lineNo).flags());
     });
@@ -2607,14 +2736,40 @@ namespace impl
             return Color {};
         }
 
-        template <typename Target>
-        CRISPY_REQUIRES((CellConcept<Target> || std::is_same_v<Target, Terminal>) )
-        ApplyResult applySGR(Target& target, Sequence const& seq, size_t parameterStart, size_t parameterEnd)
+        /// Collects a single graphics rendition change into a GraphicsAttributesDelta.
+        struct SGRDeltaBuilder
         {
+            GraphicsAttributesDelta delta {};
+
+            void setGraphicsRendition(GraphicsRendition rendition) noexcept
+            {
+                if (rendition == GraphicsRendition::Reset)
+                {
+                    delta.resetAll();
+                    return;
+                }
+
+                // Every rendition clears some flags and then sets some flags,
+                // which can be told apart by applying it to no flags and to all flags.
+                auto const set = CellUtil::makeCellFlags(rendition, CellFlags::None);
+                auto const clear = ~CellUtil::makeCellFlags(rendition, ~CellFlags::None);
+                delta.changeFlags(clear, set);
+            }
+
+            void setForegroundColor(Color color) noexcept { delta.foregroundColor = color; }
+            void setBackgroundColor(Color color) noexcept { delta.backgroundColor = color; }
+            void setUnderlineColor(Color color) noexcept { delta.underlineColor = color; }
+        };
+
+        /// Parses the given SGR parameters into a single GraphicsAttributesDelta.
+        GraphicsAttributesDelta parseSGR(Sequence const& seq, size_t parameterStart, size_t parameterEnd)
+        {
+            auto target = SGRDeltaBuilder {};
+
             if (parameterStart == parameterEnd)
             {
                 target.setGraphicsRendition(GraphicsRendition::Reset);
-                return ApplyResult::Ok;
+                return target.delta;
             }
 
             for (size_t i = parameterStart; i < parameterEnd; ++i)
@@ -2710,7 +2865,21 @@ namespace impl
                     default: break; // TODO: logInvalidCSI("Invalid SGR number: {}", seq.param(i));
                 }
             }
-            return ApplyResult::Ok;
+            return target.delta;
+        }
+
+        template <typename Cell>
+        CRISPY_REQUIRES(CellConcept<Cell>)
+        void applyGraphicsAttributes(Cell& cell, GraphicsAttributesDelta const& delta) noexcept
+        {
+            // Resetting a cell's graphics rendition only ever resets its flags but not its colors.
+            cell.resetFlags(delta.applyTo(cell.flags()));
+            if (delta.foregroundColor)
+                cell.setForegroundColor(*delta.foregroundColor);
+            if (delta.backgroundColor)
+                cell.setBackgroundColor(*delta.backgroundColor);
+            if (delta.underlineColor)
+                cell.setUnderlineColor(*delta.underlineColor);
         }
 
         template <typename Cell>
@@ -2804,7 +2973,7 @@ namespace impl
         template <typename Cell>
         ApplyResult setOrRequestDynamicColor(Sequence const& seq, Screen<Cell>& screen, DynamicColorName name)
         {
-            auto const& value = seq.intermediateCharacters();
+            auto const value = seq.dataString();
             if (value == "?")
                 screen.requestDynamicColor(name);
             else if (auto color = parseColor(value); color.has_value())
@@ -2854,13 +3023,13 @@ namespace impl
         template <typename Cell>
         ApplyResult RCOLPAL(Sequence const& seq, Screen<Cell>& screen)
         {
-            if (seq.intermediateCharacters().empty())
+            if (seq.dataString().empty())
             {
                 screen.colorPalette() = screen.defaultColorPalette();
                 return ApplyResult::Ok;
             }
 
-            auto const index = crispy::to_integer<10, uint8_t>(seq.intermediateCharacters());
+            auto const index = crispy::to_integer<10, uint8_t>(seq.dataString());
             if (!index.has_value())
                 return ApplyResult::Invalid;
 
@@ -2872,7 +3041,7 @@ namespace impl
         ApplyResult SETCOLPAL(Sequence const& seq, Terminal& terminal)
         {
             bool const ok = queryOrSetColorPalette(
-                seq.intermediateCharacters(),
+                seq.dataString(),
                 [&](uint8_t index) {
                     auto const color = terminal.colorPalette().palette.at(index);
                     terminal.reply("\033]4;{};rgb:{:04x}/{:04x}/{:04x}\033\\",
@@ -2903,7 +3072,7 @@ namespace impl
         {
             // [read]  OSC 60 ST
             // [write] OSC 60 ; size ; regular ; bold ; italic ; bold italic ST
-            auto const& params = seq.intermediateCharacters();
+            auto const params = seq.dataString();
             auto const splits = crispy::split(params, ';');
             auto const param = [&](unsigned index) -> string_view {
                 if (index < splits.size())
@@ -2943,7 +3112,7 @@ namespace impl
 
         ApplyResult setFont(Sequence const& seq, Terminal& terminal)
         {
-            auto const& params = seq.intermediateCharacters();
+            auto const params = seq.dataString();
             auto const splits = crispy::split(params, ';');
 
             if (splits.size() != 1)
@@ -2967,7 +3136,7 @@ namespace impl
         ApplyResult clipboard(Sequence const& seq, Terminal& terminal)
         {
             // Only setting clipboard contents is supported, not reading.
-            auto const& params = seq.intermediateCharacters();
+            auto const params = seq.dataString();
             if (auto const splits = crispy::split(params, ';'); splits.size() == 2 && splits[0] == "c")
             {
                 terminal.copyToClipboard(crispy::base64::decode(splits[1]));
@@ -2980,7 +3149,7 @@ namespace impl
         template <typename Cell>
         ApplyResult NOTIFY(Sequence const& seq, Screen<Cell>& screen)
         {
-            auto const& value = seq.intermediateCharacters();
+            auto const value = seq.dataString();
             if (auto const splits = crispy::split(value, ';'); splits.size() == 3 && splits[0] == "notify")
             {
                 screen.notify(string(splits[1]), string(splits[2]));
@@ -2993,8 +3162,7 @@ namespace impl
         template <typename Cell>
         ApplyResult SETCWD(Sequence const& seq, Screen<Cell>& screen)
         {
-            string const& url = seq.intermediateCharacters();
-            screen.setCurrentWorkingDirectory(url);
+            screen.setCurrentWorkingDirectory(string(seq.dataString()));
             return ApplyResult::Ok;
         }
 
@@ -3022,11 +3190,11 @@ namespace impl
         template <typename Cell>
         ApplyResult HYPERLINK(Sequence const& seq, Screen<Cell>& screen)
         {
-            auto const& value = seq.intermediateCharacters();
+            auto const value = seq.dataString();
             // hyperlink_OSC ::= OSC '8' ';' params ';' URI
             // params := pair (':' pair)*
             // pair := TEXT '=' TEXT
-            if (auto const pos = value.find(';'); pos != Sequence::Intermediaries::npos)
+            if (auto const pos = value.find(';'); pos != string_view::npos)
             {
                 auto const paramsStr = value.substr(0, pos);
                 auto const params = parseSubParamKeyValuePairs(paramsStr);
@@ -3036,7 +3204,7 @@ namespace impl
                     id = p->second;
 
                 if (pos + 1 != value.size())
-                    screen.hyperlink(id, value.substr(pos + 1));
+                    screen.hyperlink(id, string(value.substr(pos + 1)));
                 else
                     screen.hyperlink(string { id }, string {});
 
@@ -3296,9 +3464,16 @@ void Screen<Cell>::processSequence(Sequence const& seq)
 
     _terminal.state().instructionCounter++;
     if (FunctionDefinition const* funcSpec = seq.functionDefinition(); funcSpec != nullptr)
+    {
+        _state.sequencer.metrics().countFunction(*funcSpec);
         applyAndLog(*funcSpec, seq);
-    else if (VTParserLog)
-        VTParserLog()("Unknown VT sequence: {}", seq);
+    }
+    else
+    {
+        _state.sequencer.metrics().unknownSequences++;
+        if (VTParserLog)
+            VTParserLog()("Unknown VT sequence: {}", seq);
+    }
 }
 
 template <typename Cell>
@@ -3397,15 +3572,10 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
             auto const left = ColumnOffset(seq.param_or(1, *origin.column + 1) - 1);
             auto const bottom = LineOffset(seq.param_or(2, *pageSize().lines) - 1);
             auto const right = ColumnOffset(seq.param_or(3, *pageSize().columns) - 1);
+            auto const delta = impl::parseSGR(seq, 4, seq.parameterCount());
             for (auto row = top; row <= bottom; ++row)
-            {
                 for (auto column = left; column <= right; ++column)
-                {
-                    auto& cell = at(row, column);
-                    impl::applySGR(cell, seq, 4, seq.parameterCount());
-                    // Maybe move setGraphicsRendition to Screen::cursor() ?
-                }
-            }
+                    impl::applyGraphicsAttributes(at(row, column), delta);
         }
         break;
         case DECCRA: {
@@ -3614,7 +3784,14 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case SCOSC: saveCursor(); break;
         case SD: scrollDown(seq.param_or<LineCount>(0, LineCount { 1 })); break;
         case SETMARK: setMark(); break;
-        case SGR: return impl::applySGR(_terminal, seq, 0, seq.parameterCount());
+        case SGR: {
+            auto const* delta = _state.sgrCache.find(seq.parameters());
+            if (!delta)
+                delta =
+                    &_state.sgrCache.insert(seq.parameters(), impl::parseSGR(seq, 0, seq.parameterCount()));
+            _terminal.applyGraphicsRendition(*delta);
+        }
+        break;
         case SM: {
             ApplyResult r = ApplyResult::Ok;
             crispy::for_each(crispy::times(seq.parameterCount()), [&](size_t i) {
@@ -3672,11 +3849,11 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case DECPS: _terminal.playSound(seq.parameters()); break;
         // OSC
         case SETTITLE:
-            //(not supported) ChangeIconTitle(seq.intermediateCharacters());
-            _terminal.setWindowTitle(seq.intermediateCharacters());
+            //(not supported) ChangeIconTitle(seq.dataString());
+            _terminal.setWindowTitle(seq.dataString());
             return ApplyResult::Ok;
         case SETICON: return ApplyResult::Ok; // NB: Silently ignore!
-        case SETWINTITLE: _terminal.setWindowTitle(seq.intermediateCharacters()); break;
+        case SETWINTITLE: _terminal.setWindowTitle(seq.dataString()); break;
         case SETXPROP: return ApplyResult::Unsupported;
         case SETCOLPAL: return impl::SETCOLPAL(seq, _terminal);
         case RCOLPAL: return impl::RCOLPAL(seq, *this);
@@ -3846,6 +4023,9 @@ optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText, Cell
     if (searchText.empty())
         return nullopt;
 
+    // Logical lines span the history lines in memory reflowed to the page's width only.
+    _grid.reflowAllHistory();
+
     // First try match at start location.
     if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
         return startPosition;
@@ -3871,6 +4051,9 @@ optional<CellLocation> Screen<Cell>::searchReverse(std::u32string_view searchTex
     if (searchText.empty())
         return nullopt;
 
+    // Logical lines span the history lines in memory reflowed to the page's width only.
+    _grid.reflowAllHistory();
+
     // First try match at start location.
     if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
         return startPosition;
@@ -3904,3 +4087,6 @@ template class terminal::Screen<terminal::CompactCell>;
 
 #include <vtbackend/cell/SimpleCell.h>
 template class terminal::Screen<terminal::SimpleCell>;
+
+#include <vtbackend/cell/PodCell.h>
+template class terminal::Screen<terminal::PodCell>;
@@ -90,6 +90,9 @@ class ScreenBase: public SequenceHandler
     virtual void moveCursorTo(LineOffset line, ColumnOffset column) = 0; // CUP
     virtual void updateCursorIterator() noexcept = 0;
 
+    /// Applies a VT sequence whose function definition has already been resolved.
+    virtual void applyAndLog(FunctionDefinition const& function, Sequence const& seq) = 0;
+
     [[nodiscard]] virtual std::optional<CellLocation> search(std::u32string_view searchText,
                                                              CellLocation startPosition) = 0;
     [[nodiscard]] virtual std::optional<CellLocation> searchReverse(std::u32string_view searchText,
@@ -568,6 +571,17 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
             TrivialLineBuffer const& lineBuffer = line.trivialBuffer();
             return lineBuffer.hyperlink;
         }
+        if (line.isAttributedBuffer())
+        {
+            auto runEnd = ColumnOffset(0);
+            for (AttributedLineRun const& run: line.attributedBuffer().runs)
+            {
+                runEnd += boxed_cast<ColumnOffset>(run.columns);
+                if (position.column < runEnd)
+                    return run.hyperlink;
+            }
+            return HyperlinkId {};
+        }
         return at(position).hyperlink();
     }
 
@@ -580,12 +594,9 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     void resetInstructionCounter() noexcept { _state.instructionCounter = 0; }
     [[nodiscard]] uint64_t instructionCounter() const noexcept { return _state.instructionCounter; }
-    [[nodiscard]] char32_t precedingGraphicCharacter() const noexcept
-    {
-        return _state.parser.precedingGraphicCharacter();
-    }
+    [[nodiscard]] char32_t precedingGraphicCharacter() const noexcept;
 
-    void applyAndLog(FunctionDefinition const& function, Sequence const& seq);
+    void applyAndLog(FunctionDefinition const& function, Sequence const& seq) override;
     [[nodiscard]] ApplyResult apply(FunctionDefinition const& function, Sequence const& seq);
 
     void fail(std::string const& message) const override;
@@ -600,12 +611,25 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
   private:
     void writeTextInternal(char32_t codepoint);
 
+    /// Writes the given UTF-8 text codepoint by codepoint, for when it cannot be emplaced in bulk.
+    void writeTextCodepointwise(std::string_view text);
+
     /// Attempts to emplace the given character sequence into the current cursor position, assuming
     /// that the current line is either empty or trivial and the input character sequence is contiguous.
     ///
     /// @returns the string view of the UTF-8 text that could not be emplaced.
     std::string_view tryEmplaceChars(std::string_view chars, size_t cellCount) noexcept;
     size_t emplaceCharsIntoCurrentLine(std::string_view chars, size_t cellCount) noexcept;
+
+    /// Writes the given printable US-ASCII text that exceeds the current line,
+    /// wrapping it onto the following lines just like auto-wrap would.
+    void writeTextLines(std::string_view text);
+
+    /// Attempts to emplace as many whole lines of the given US-ASCII text as possible
+    /// right below the current line, scrolling at most once, assuming a wrap is pending.
+    ///
+    /// @returns the string view of the text that could not be emplaced.
+    std::string_view tryEmplaceLines(std::string_view text) noexcept;
     [[nodiscard]] bool isContiguousToCurrentLine(std::string_view continuationChars) const noexcept;
     void advanceCursorAfterWrite(ColumnCount n) noexcept;
 
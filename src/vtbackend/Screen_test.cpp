@@ -71,10 +71,13 @@ struct TextRenderBuilder
 {
     std::string text;
 
+    bool reuseLine(LineOffset, uint64_t) { return false; }
+    void lineRendered(LineOffset, uint64_t, bool) {}
     void startLine(LineOffset lineOffset);
     void renderCell(PrimaryScreenCell const& cell, LineOffset lineOffset, ColumnOffset columnOffset);
     void endLine();
     void renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineOffset);
+    void renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineOffset);
     void finish();
 };
 
@@ -103,6 +106,19 @@ void TextRenderBuilder::renderTrivialLine(TrivialLineBuffer const& lineBuffer, L
     text += '\n';
 }
 
+void TextRenderBuilder::renderAttributedLine(AttributedLineBuffer const& lineBuffer, LineOffset lineOffset)
+{
+    if (!*lineOffset)
+        text.clear();
+
+    for (auto const& run: lineBuffer.runs)
+    {
+        text += run.text.view();
+        text.append(unbox<size_t>(run.columns) - run.text.size(), ' ');
+    }
+    text += '\n';
+}
+
 void TextRenderBuilder::finish()
 {
 }
@@ -657,6 +673,35 @@ TEST_CASE("AppendChar_AutoWrap_LF", "[screen]")
     REQUIRE(screen.logicalCursorPosition() == CellLocation { LineOffset(1), ColumnOffset(1) });
 }
 
+TEST_CASE("AppendChar_AutoWrap.LongLine", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(4) }, LineCount(5) };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.terminal.setMode(DECMode::AutoWrap, true);
+
+    mock.writeToScreen("12\r\n");
+    mock.writeToScreen("ABCDEFGHIJKLMNOPQR");
+    logScreenText(screen);
+    CHECK(screen.grid().lineText(LineOffset(-3)) == "12  ");
+    CHECK(screen.grid().lineText(LineOffset(-2)) == "ABCD");
+    CHECK(screen.grid().lineText(LineOffset(-1)) == "EFGH");
+    CHECK(screen.grid().lineText(LineOffset(0)) == "IJKL");
+    CHECK(screen.grid().lineText(LineOffset(1)) == "MNOP");
+    CHECK(screen.grid().lineText(LineOffset(2)) == "QR  ");
+    CHECK(screen.logicalCursorPosition() == CellLocation { LineOffset(2), ColumnOffset(2) });
+
+    CHECK_FALSE(screen.grid().lineAt(LineOffset(-2)).wrapped());
+    for (auto const line: { -1, 0, 1, 2 })
+    {
+        CHECK(screen.grid().lineAt(LineOffset(line)).wrapped());
+        CHECK(screen.grid().lineAt(LineOffset(line)).isTrivialBuffer());
+    }
+
+    mock.writeToScreen("STUVW");
+    CHECK(screen.grid().lineText(LineOffset(1)) == "QRST");
+    CHECK(screen.grid().lineText(LineOffset(2)) == "UVW ");
+}
+
 TEST_CASE("Screen.isLineVisible", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(1), ColumnCount(2) }, LineCount(5) };
@@ -3567,6 +3612,41 @@ TEST_CASE("Sixel.AutoScroll-1", "[screen]")
     // Um, we could actually test more precise here by validating the grid cell contents.
 }
 
+TEST_CASE("SGR", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(10) } };
+    auto const& sgr = [&]() -> GraphicsAttributes const& {
+        return mock.terminal.primaryScreen().cursor().graphicsRendition;
+    };
+
+    // Applying the same SGRs twice, as the second time is served from cache.
+    for (auto round = 0; round < 2; ++round)
+    {
+        INFO(fmt::format("round {}", round));
+
+        mock.writeToScreen("\033[38;2;10;20;30;48;5;17;1;4:3;58:5:42m");
+        CHECK(sgr().foregroundColor == Color(RGBColor(10, 20, 30)));
+        CHECK(sgr().backgroundColor == Color(IndexedColor(17)));
+        CHECK(sgr().underlineColor == Color(IndexedColor(42)));
+        CHECK(sgr().flags == (CellFlags::Bold | CellFlags::CurlyUnderlined));
+
+        // Later parameters override earlier ones.
+        mock.writeToScreen("\033[24;5;6;22;3;91m");
+        CHECK(sgr().foregroundColor == Color(BrightColor::Red));
+        CHECK(sgr().backgroundColor == Color(IndexedColor(17)));
+        CHECK(sgr().flags == (CellFlags::RapidBlinking | CellFlags::Italic));
+
+        // Reset discards everything before it, but not after it.
+        mock.writeToScreen("\033[31;7;0;4m");
+        CHECK(sgr().foregroundColor == Color(DefaultColor()));
+        CHECK(sgr().backgroundColor == Color(DefaultColor()));
+        CHECK(sgr().flags == CellFlags::Underline);
+
+        mock.writeToScreen("\033[m");
+        CHECK(sgr() == GraphicsAttributes {});
+    }
+}
+
 TEST_CASE("DECSTR", "[screen]")
 {
     // Create a 10x3x5 grid and render a 7x5 image causing one a line-scroll by one.
@@ -20,7 +20,10 @@
 #include <gsl/span>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -76,6 +79,9 @@ class SequenceParameters
     [[nodiscard]] constexpr bool empty() const noexcept { return _count == 0; }
     [[nodiscard]] constexpr size_t count() const noexcept { return _count; }
 
+    /// Bit mask of the parameters being sub-parameters, as tested by isSubParameter().
+    [[nodiscard]] constexpr uint16_t subParameterMask() const noexcept { return _subParameterTest; }
+
     [[nodiscard]] std::string subParameterBitString() const
     {
         return fmt::format("{:016b}: ", _subParameterTest);
@@ -202,8 +208,85 @@ class SequenceParameterBuilder
     Storage::iterator _currentParameter;
 };
 
+/**
+ * Fixed-capacity inline storage for the intermediate characters of a VT sequence.
+ *
+ * Characters beyond the capacity are dropped. Only sequences with at most one intermediate
+ * character map to a function, so dropping excess characters does not change the outcome.
+ */
+class SequenceIntermediates
+{
+  public:
+    static constexpr size_t Capacity = 4; // NOLINT(readability-identifier-naming)
+
+    constexpr void push_back(char ch) noexcept
+    {
+        if (_size < Capacity)
+            _chars[_size++] = ch;
+    }
+
+    constexpr void append(std::string_view chars) noexcept
+    {
+        for (char const ch: chars)
+            push_back(ch);
+    }
+
+    constexpr void clear() noexcept { _size = 0; }
+
+    [[nodiscard]] constexpr bool empty() const noexcept { return _size == 0; }
+    [[nodiscard]] constexpr size_t size() const noexcept { return _size; }
+    [[nodiscard]] constexpr char operator[](size_t index) const noexcept { return _chars[index]; }
+
+    [[nodiscard]] constexpr std::string_view view() const noexcept
+    {
+        return std::string_view(_chars.data(), _size);
+    }
+
+    constexpr operator std::string_view() const noexcept { return view(); }
+
+  private:
+    std::array<char, Capacity> _chars {};
+    uint8_t _size = 0;
+};
+
+/**
+ * Allocator of a Sequence's data string, counting its allocations,
+ * such that tests can verify that processing sequences does not allocate in steady state.
+ */
+template <typename T>
+struct SequenceDataAllocator
+{
+    using value_type = T;
+
+    static inline std::atomic<size_t> allocations = 0; // NOLINT(readability-identifier-naming)
+
+    SequenceDataAllocator() noexcept = default;
+
+    template <typename U>
+    SequenceDataAllocator(SequenceDataAllocator<U> const& /*other*/) noexcept
+    {
+    }
+
+    [[nodiscard]] T* allocate(size_t n)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::allocator<T> {}.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T> {}.deallocate(p, n); }
+
+    template <typename U>
+    [[nodiscard]] bool operator==(SequenceDataAllocator<U> const& /*other*/) const noexcept
+    {
+        return true;
+    }
+};
+
 /**
  * Helps constructing VT functions as they're being parsed by the VT parser.
+ *
+ * A Sequence does not allocate in steady state: intermediate characters are stored inline,
+ * and the data string (holding OSC payloads) retains its capacity when being cleared.
  */
 class Sequence
 {
@@ -211,8 +294,8 @@ class Sequence
     size_t constexpr static MaxOscLength = 512; // NOLINT(readability-identifier-naming)
 
     using Parameter = uint16_t;
-    using Intermediaries = std::string;
-    using DataString = std::string;
+    using Intermediaries = SequenceIntermediates;
+    using DataString = std::basic_string<char, std::char_traits<char>, SequenceDataAllocator<char>>;
     using Parameters = SequenceParameters;
 
   private:
@@ -250,7 +333,7 @@ class Sequence
         _leaderSymbol = 0;
         _intermediateCharacters.clear();
         _finalChar = 0;
-        _dataString.clear();
+        _dataString.clear(); // Retains the capacity for subsequent sequences.
     }
 
     void setCategory(FunctionCategory cat) noexcept { _category = cat; }
@@ -258,9 +341,16 @@ class Sequence
     [[nodiscard]] Intermediaries& intermediateCharacters() noexcept { return _intermediateCharacters; }
     void setFinalChar(char ch) noexcept { _finalChar = ch; }
 
-    [[nodiscard]] DataString const& dataString() const noexcept { return _dataString; }
+    /// @returns the data string, such as the payload of an OSC sequence (without its numeric code).
+    [[nodiscard]] std::string_view dataString() const noexcept { return _dataString; }
     [[nodiscard]] DataString& dataString() noexcept { return _dataString; }
 
+    /// @returns the number of heap allocations of the data strings of all sequences so far.
+    [[nodiscard]] static size_t dataStringAllocations() noexcept
+    {
+        return SequenceDataAllocator<char>::allocations.load(std::memory_order_relaxed);
+    }
+
     /// @returns this VT-sequence into a human readable string form.
     [[nodiscard]] std::string text() const;
 
@@ -295,9 +385,9 @@ class Sequence
     // accessors
     //
     [[nodiscard]] FunctionCategory category() const noexcept { return _category; }
-    [[nodiscard]] Intermediaries const& intermediateCharacters() const noexcept
+    [[nodiscard]] std::string_view intermediateCharacters() const noexcept
     {
-        return _intermediateCharacters;
+        return _intermediateCharacters.view();
     }
     [[nodiscard]] char leaderSymbol() const noexcept { return _leaderSymbol; }
     [[nodiscard]] char finalChar() const noexcept { return _finalChar; }
@@ -0,0 +1,258 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/SequencePipeline.h>
+#include <vtbackend/Terminal.h>
+#include <vtbackend/logging.h>
+
+#include <crispy/overloaded.h>
+
+#include <unicode/convert.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace terminal
+{
+
+namespace
+{
+    // Holds the data strings of many queued sequences, each at most Sequence::MaxOscLength long.
+    constexpr auto PayloadBufferSize = size_t { 16 * 1024 };
+
+    [[nodiscard]] bool isAscii(std::string_view text) noexcept
+    {
+        return std::all_of(
+            text.begin(), text.end(), [](char ch) { return static_cast<uint8_t>(ch) < 0x80; });
+    }
+} // namespace
+
+SequencePipeline::SequencePipeline(Terminal& terminal, size_t capacity):
+    _terminal { terminal },
+    _payloadPool { PayloadBufferSize },
+    _queue { capacity },
+    _applyThread { [this]() { applyLoop(); } }
+{
+    _sequence.dataString().reserve(Sequence::MaxOscLength);
+}
+
+SequencePipeline::~SequencePipeline()
+{
+    {
+        auto const _ = std::lock_guard { _parserStageLock };
+        _queue.push(StopCommand {});
+        _queue.publish();
+    }
+    _applyThread.join();
+}
+
+// {{{ parser stage
+void SequencePipeline::parseFragment(crispy::BufferObjectPtr<char> const& buffer, std::string_view chunk)
+{
+    auto const _ = std::lock_guard { _parserStageLock };
+
+    _parserBuffer = buffer;
+    _terminal.state().parser.parseFragment(chunk);
+
+    // Text commands reference the chunk, so subsequent PTY reads must not overwrite it.
+    buffer->advanceHotEndUntil(chunk.data() + chunk.size());
+
+    _queue.publish();
+}
+
+void SequencePipeline::waitUntilApplied()
+{
+    auto const _ = std::lock_guard { _parserStageLock };
+    _queue.waitUntilConsumed();
+}
+
+void SequencePipeline::unhook(std::unique_ptr<ParserExtension> hookedParser)
+{
+    _queue.push(UnhookCommand { std::move(hookedParser) });
+}
+
+char32_t SequencePipeline::parserPrecedingGraphicCharacter() const noexcept
+{
+    return _terminal.state().parser.precedingGraphicCharacter();
+}
+
+void SequencePipeline::executeControlCode(char controlCode)
+{
+    _queue.push(ControlCodeCommand { controlCode });
+}
+
+void SequencePipeline::processSequence(Sequence const& sequence)
+{
+    if (sequence.category() == FunctionCategory::DCS)
+    {
+        // Hooking a DCS installs the parser extension the parser stage is about to feed,
+        // so it has to take effect right away rather than whenever the apply stage gets to it.
+        _queue.waitUntilConsumed();
+        auto const _ = std::lock_guard { _terminal };
+        _terminal.activeDisplay().processSequence(sequence);
+        return;
+    }
+
+    auto const* function = sequence.functionDefinition();
+    if (function)
+        _terminal.state().sequencer.metrics().countFunction(*function);
+    else
+        _terminal.state().sequencer.metrics().unknownSequences++;
+
+    auto intermediateCharacters = Sequence::Intermediaries {};
+    intermediateCharacters.append(sequence.intermediateCharacters());
+
+    _queue.push(SequenceCommand { function,
+                                  sequence.category(),
+                                  sequence.leaderSymbol(),
+                                  sequence.finalChar(),
+                                  intermediateCharacters,
+                                  sequence.parameters(),
+                                  storeDataString(sequence.dataString()),
+                                  parserPrecedingGraphicCharacter() });
+}
+
+crispy::BufferFragment<char> SequencePipeline::storeDataString(std::string_view data)
+{
+    if (data.empty())
+        return {};
+
+    if (!_payloadBuffer || _payloadBuffer->bytesAvailable() < data.size())
+        _payloadBuffer = _payloadPool.allocateBufferObject();
+
+    auto const payload = _payloadBuffer->writeAtEnd(data);
+    _payloadBuffer->advance(data.size());
+    return crispy::BufferFragment { _payloadBuffer, payload };
+}
+
+void SequencePipeline::writeText(char32_t codepoint)
+{
+    _queue.push(CodepointCommand { codepoint, parserPrecedingGraphicCharacter() });
+}
+
+void SequencePipeline::writeText(std::string_view codepoints, size_t cellCount)
+{
+    _queue.push(TextCommand {
+        crispy::BufferFragment { _parserBuffer, codepoints }, cellCount, parserPrecedingGraphicCharacter() });
+}
+// }}}
+
+// {{{ apply stage
+void SequencePipeline::applyLoop()
+{
+    while (!_stopped)
+    {
+        _queue.waitForData();
+        {
+            auto const _ = std::lock_guard { _terminal };
+            _applying = true;
+            _queue.consume(BatchSize, [this](Command& command) { apply(command); });
+            _applying = false;
+        }
+
+        if (!_stopped && !_terminal.isModeEnabled(DECMode::BatchedRendering))
+            _terminal.screenUpdated();
+    }
+}
+
+void SequencePipeline::apply(Command& command)
+{
+    std::visit(overloaded {
+                   [this](ControlCodeCommand const& c) {
+                       _terminal.activeDisplay().executeControlCode(c.controlCode);
+                   },
+                   [this](CodepointCommand const& c) {
+                       _precedingGraphicCharacter = c.precedingGraphicCharacter;
+                       _terminal.activeDisplay().writeText(c.codepoint);
+                   },
+                   [this](TextCommand& c) {
+                       applyText(c);
+                       // Release our reference, so that the buffer object can be recycled.
+                       c.text = {};
+                   },
+                   [this](SequenceCommand& c) { applySequence(c); },
+                   [](UnhookCommand& c) {
+                       c.hookedParser->finalize();
+                       c.hookedParser.reset();
+                   },
+                   [this](StopCommand const&) { _stopped = true; },
+               },
+               command);
+}
+
+void SequencePipeline::applySequence(SequenceCommand& command)
+{
+    _precedingGraphicCharacter = command.precedingGraphicCharacter;
+
+    _sequence.clearExceptParameters();
+    _sequence.setCategory(command.category);
+    _sequence.setLeader(command.leaderSymbol);
+    _sequence.setFinalChar(command.finalChar);
+    _sequence.intermediateCharacters() = command.intermediateCharacters;
+    _sequence.parameters() = command.parameters;
+    _sequence.dataString().assign(command.dataString.view());
+
+    // Release our reference, so that the payload buffer object can be recycled.
+    command.dataString = {};
+
+    if (command.function)
+        _terminal.activeDisplay().applyAndLog(*command.function, _sequence);
+    else if (VTParserLog)
+        VTParserLog()("Unknown VT sequence: {}", _sequence);
+}
+
+void SequencePipeline::applyText(TextCommand const& command)
+{
+    auto& screen = _terminal.activeDisplay();
+    auto text = command.text.view();
+
+    _textBuffer = command.text.owner();
+    _precedingGraphicCharacter = command.precedingGraphicCharacter;
+
+    // The parser stage does not know how much room is left in the current line,
+    // so the run has to be split up here, just like the parser would have done it.
+    if (auto const maxWidth = _terminal.maxBulkTextSequenceWidth(); maxWidth && command.cellCount <= maxWidth)
+        screen.writeText(text, command.cellCount);
+    else if (isAscii(text) && text.size() <= _terminal.maxBulkAsciiTextLength())
+        screen.writeText(text, text.size()); // Wrapped onto the following lines by the screen.
+    else if (isAscii(text))
+    {
+        while (!text.empty())
+        {
+            if (auto const width = std::min(_terminal.maxBulkTextSequenceWidth(), text.size()); width != 0)
+            {
+                screen.writeText(text.substr(0, width), width);
+                text.remove_prefix(width);
+            }
+            else
+            {
+                screen.writeText(static_cast<char32_t>(text.front()));
+                text.remove_prefix(1);
+            }
+        }
+    }
+    else
+    {
+        for (char32_t const codepoint: unicode::convert_to<char32_t>(text))
+        {
+            screen.writeText(codepoint);
+            _precedingGraphicCharacter = codepoint;
+        }
+    }
+
+    _textBuffer.reset();
+    _precedingGraphicCharacter = command.precedingGraphicCharacter;
+}
+// }}}
+
+} // namespace terminal
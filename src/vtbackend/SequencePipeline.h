@@ -0,0 +1,180 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vtbackend/Functions.h>
+#include <vtbackend/Sequence.h>
+
+#include <vtparser/ParserExtension.h>
+
+#include <crispy/BufferObject.h>
+#include <crispy/SPSCQueue.h>
+
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <variant>
+
+namespace terminal
+{
+
+class Terminal;
+
+/// Two-stage parse/apply pipeline.
+///
+/// The parser stage runs on the thread reading from the PTY. Instead of mutating the screen right away,
+/// it translates the VT stream into a compact stream of commands (text runs referencing the PTY buffer,
+/// C0 control codes, and VT sequences with their FunctionDefinition already resolved).
+/// These are handed over through a lock-free single-producer/single-consumer queue to the apply stage,
+/// a dedicated thread executing the commands against the active display, holding the terminal lock
+/// only once per batch rather than for the whole PTY read.
+///
+/// The parser stage never reads screen state, so everything the screen would have asked the parser
+/// (such as the preceding graphic character) is captured along with the command.
+/// Only DCS hooks synchronize both stages, as the installed parser extension is needed right away.
+class SequencePipeline final: public SequenceHandler
+{
+  public:
+    /// Maximum number of grid cells a single text command spans.
+    static constexpr size_t MaxTextRunWidth = 1024;
+
+    /// Maximum number of commands applied while holding the terminal lock once.
+    static constexpr size_t BatchSize = 256;
+
+    explicit SequencePipeline(Terminal& terminal, size_t capacity = 4096);
+    ~SequencePipeline() override;
+
+    SequencePipeline(SequencePipeline const&) = delete;
+    SequencePipeline(SequencePipeline&&) = delete;
+    SequencePipeline& operator=(SequencePipeline const&) = delete;
+    SequencePipeline& operator=(SequencePipeline&&) = delete;
+
+    // {{{ parser stage
+    /// Parses the given chunk of VT stream, which must reside in the given buffer object,
+    /// and hands the resulting commands over to the apply stage.
+    void parseFragment(crispy::BufferObjectPtr<char> const& buffer, std::string_view chunk);
+
+    /// Waits until the apply stage has executed all commands handed over so far.
+    void waitUntilApplied();
+
+    /// Blocks the parser stage for as long as the returned lock is held.
+    [[nodiscard]] std::unique_lock<std::mutex> lockParserStage()
+    {
+        return std::unique_lock { _parserStageLock };
+    }
+
+    /// Hands the parser extension of a finished DCS over to the apply stage to be finalized there.
+    void unhook(std::unique_ptr<ParserExtension> hookedParser);
+
+    // SequenceHandler overrides, invoked by the Sequencer.
+    void executeControlCode(char controlCode) override;
+    void processSequence(Sequence const& sequence) override;
+    void writeText(char32_t codepoint) override;
+    void writeText(std::string_view codepoints, size_t cellCount) override;
+    // }}}
+
+    // {{{ apply stage
+    /// Tests whether the apply stage is currently executing commands (while holding the terminal lock).
+    [[nodiscard]] bool applying() const noexcept { return _applying; }
+
+    /// @returns the buffer object holding the text currently being applied.
+    [[nodiscard]] crispy::BufferObjectPtr<char> const& textBuffer() const noexcept { return _textBuffer; }
+
+    /// @returns the preceding graphic character, as the parser stage saw it for the current command.
+    [[nodiscard]] char32_t precedingGraphicCharacter() const noexcept { return _precedingGraphicCharacter; }
+    void setPrecedingGraphicCharacter(char32_t codepoint) noexcept { _precedingGraphicCharacter = codepoint; }
+    // }}}
+
+  private:
+    struct CodepointCommand
+    {
+        char32_t codepoint;
+        char32_t precedingGraphicCharacter;
+    };
+
+    struct TextCommand
+    {
+        crispy::BufferFragment<char> text;
+        size_t cellCount;
+        char32_t precedingGraphicCharacter;
+    };
+
+    struct ControlCodeCommand
+    {
+        char controlCode;
+    };
+
+    /// A VT sequence, with its data string (if any) stored out of line in a payload buffer object,
+    /// such that queueing it never allocates.
+    struct SequenceCommand
+    {
+        FunctionDefinition const* function;
+        FunctionCategory category;
+        char leaderSymbol;
+        char finalChar;
+        Sequence::Intermediaries intermediateCharacters;
+        Sequence::Parameters parameters;
+        crispy::BufferFragment<char> dataString;
+        char32_t precedingGraphicCharacter;
+    };
+
+    struct UnhookCommand
+    {
+        std::unique_ptr<ParserExtension> hookedParser;
+    };
+
+    struct StopCommand
+    {
+    };
+
+    using Command = std::variant<ControlCodeCommand,
+                                 CodepointCommand,
+                                 TextCommand,
+                                 SequenceCommand,
+                                 UnhookCommand,
+                                 StopCommand>;
+
+    [[nodiscard]] char32_t parserPrecedingGraphicCharacter() const noexcept;
+
+    /// Copies the given data string into the current payload buffer object.
+    [[nodiscard]] crispy::BufferFragment<char> storeDataString(std::string_view data);
+
+    void applyLoop();
+    void apply(Command& command);
+    void applyText(TextCommand const& command);
+    void applySequence(SequenceCommand& command);
+
+    Terminal& _terminal;
+
+    // Declared ahead of the queue, as queued commands hold on to the buffer objects of this pool.
+    crispy::BufferObjectPool<char> _payloadPool;
+
+    crispy::SPSCQueue<Command> _queue;
+
+    // parser stage
+    std::mutex _parserStageLock;
+    crispy::BufferObjectPtr<char> _parserBuffer;
+    crispy::BufferObjectPtr<char> _payloadBuffer;
+
+    // apply stage
+    bool _applying = false;
+    bool _stopped = false;
+    crispy::BufferObjectPtr<char> _textBuffer;
+    char32_t _precedingGraphicCharacter = 0;
+    Sequence _sequence; // reassembled from each SequenceCommand, reusing its data string's capacity
+    std::thread _applyThread;
+};
+
+} // namespace terminal
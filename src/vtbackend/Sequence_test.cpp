@@ -11,12 +11,19 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtbackend/MockTerm.h>
 #include <vtbackend/Sequence.h>
 
+#include <vtpty/MockPty.h>
+
+#include <fmt/format.h>
+
 #include <catch2/catch.hpp>
 
+#include <string>
 #include <string_view>
 
+using terminal::SequenceIntermediates;
 using terminal::SequenceParameterBuilder;
 using terminal::SequenceParameters;
 using namespace std::string_view_literals;
@@ -136,3 +143,56 @@ TEST_CASE("SequenceParameterBuilder.complex.2")
     INFO(parameters.subParameterBitString());
     CHECK(parameters.str() == "0;12::34:56;7;89");
 }
+
+TEST_CASE("SequenceIntermediates")
+{
+    auto intermediates = SequenceIntermediates {};
+    CHECK(intermediates.empty());
+
+    intermediates.push_back(' ');
+    CHECK(intermediates.size() == 1);
+    CHECK(intermediates.view() == " "sv);
+
+    intermediates.append("$!\"");
+    CHECK(intermediates.view() == " $!\""sv);
+
+    // Excess characters are dropped.
+    intermediates.push_back('#');
+    CHECK(intermediates.size() == SequenceIntermediates::Capacity);
+    CHECK(intermediates.view() == " $!\""sv);
+
+    intermediates.clear();
+    CHECK(intermediates.empty());
+}
+
+TEST_CASE("Sequence.allocation_free")
+{
+    // Mimmicks the bench-headless sgr and cup workloads, plus a short OSC.
+    auto frame = std::string {};
+    for (int line = 1; line <= 24; ++line)
+        for (int column = 1; column + 8 <= 80; column += 8)
+            frame += fmt::format("\033[{};{}H\033[1;38;5;{}m\033[48:2::{}:{}:{}m\033[m",
+                                 line,
+                                 column,
+                                 (line * 80 + column) % 256,
+                                 line,
+                                 column,
+                                 line + column);
+    frame += "\033]2;title\033\\";
+
+    auto mock = terminal::MockTerm { terminal::ColumnCount(80), terminal::LineCount(24) };
+
+    // Warm up, so that all lazily grown state is in place.
+    mock.terminal.writeToScreen(frame);
+    mock.terminal.writeToScreen(frame);
+
+    auto const allocationsBefore = terminal::Sequence::dataStringAllocations();
+    mock.terminal.writeToScreen(frame);
+    CHECK(terminal::Sequence::dataStringAllocations() - allocationsBefore == 0);
+    CHECK(mock.terminal.windowTitle() == "title");
+
+    // Whereas a data string growing beyond its capacity does allocate.
+    auto sequence = terminal::Sequence {};
+    sequence.dataString().append(std::string(terminal::Sequence::MaxOscLength, 'x'));
+    CHECK(terminal::Sequence::dataStringAllocations() - allocationsBefore == 1);
+}
@@ -12,6 +12,7 @@
  * limitations under the License.
  */
 #include <vtbackend/Screen.h>
+#include <vtbackend/SequencePipeline.h>
 #include <vtbackend/Sequencer.h>
 #include <vtbackend/SixelParser.h>
 #include <vtbackend/Terminal.h>
@@ -32,6 +33,8 @@ namespace terminal
 
 Sequencer::Sequencer(Terminal& terminal): _terminal { terminal }, _parameterBuilder { _sequence.parameters() }
 {
+    // Reserve up front, so that collecting OSC payloads never needs to grow the data string.
+    _sequence.dataString().reserve(Sequence::MaxOscLength);
 }
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
@@ -43,7 +46,7 @@ void Sequencer::error(std::string_view errorString)
 
 void Sequencer::print(char32_t codepoint)
 {
-    _terminal.state().instructionCounter++;
+    _metrics.textCodepoints++;
     _terminal.sequenceHandler().writeText(codepoint);
 }
 
@@ -51,15 +54,19 @@ size_t Sequencer::print(string_view chars, size_t cellCount)
 {
     assert(!chars.empty());
 
-    _terminal.state().instructionCounter += chars.size();
+    _metrics.textBytes += chars.size();
     _terminal.sequenceHandler().writeText(chars, cellCount);
 
+    if (_terminal.activeSequencePipeline())
+        return SequencePipeline::MaxTextRunWidth;
+
     return _terminal.settings().pageSize.columns.as<size_t>()
            - _terminal.currentScreen().cursor().position.column.as<size_t>();
 }
 
 void Sequencer::execute(char controlCode)
 {
+    _metrics.controlCodes++;
     _terminal.sequenceHandler().executeControlCode(controlCode);
 }
 
@@ -101,67 +108,101 @@ void Sequencer::dispatchESC(char finalChar)
 
 void Sequencer::dispatchCSI(char finalChar)
 {
+    // Reaching here means that the parser's CSI fast path did not apply.
+    _metrics.csiFallbacks++;
     _sequence.setCategory(FunctionCategory::CSI);
     _sequence.setFinalChar(finalChar);
     handleSequence();
 }
 
+void Sequencer::dispatchCSI(ParsedCSI const& csi)
+{
+    clear();
+    _sequence.setCategory(FunctionCategory::CSI);
+    _sequence.setLeader(csi.leader);
+    for (size_t i = 0; i < csi.parameterCount; ++i)
+    {
+        if (i != 0)
+        {
+            if (csi.isSubParameter(i))
+                _parameterBuilder.nextSubParameter();
+            else
+                _parameterBuilder.nextParameter();
+        }
+        _parameterBuilder.set(csi.parameters[i]);
+    }
+    _sequence.intermediateCharacters().append(csi.intermediates);
+    _sequence.setFinalChar(csi.finalChar);
+    handleSequence();
+}
+
 void Sequencer::startOSC()
 {
     _sequence.setCategory(FunctionCategory::OSC);
 }
 
-void Sequencer::putOSC(char ch)
+void Sequencer::putOSC(std::string_view chars)
 {
-    if (_sequence.intermediateCharacters().size() + 1 < Sequence::MaxOscLength)
-        _sequence.intermediateCharacters().push_back(ch);
+    // Excess characters beyond MaxOscLength are silently dropped.
+    auto& data = _sequence.dataString();
+    if (data.size() + 1 < Sequence::MaxOscLength)
+        data.append(chars.substr(0, Sequence::MaxOscLength - 1 - data.size()));
 }
 
 void Sequencer::dispatchOSC()
 {
-    auto const [code, skipCount] = parser::extractCodePrefix(_sequence.intermediateCharacters());
+    auto const [code, skipCount] = parser::extractCodePrefix(_sequence.dataString());
     _parameterBuilder.set(static_cast<Sequence::Parameter>(code));
-    _sequence.intermediateCharacters().erase(0, skipCount);
+    _sequence.dataString().erase(0, skipCount);
     handleSequence();
     clear();
 }
 
 void Sequencer::hook(char finalChar)
 {
-    _terminal.state().instructionCounter++;
     _sequence.setCategory(FunctionCategory::DCS);
     _sequence.setFinalChar(finalChar);
 
     handleSequence();
 }
 
-void Sequencer::put(char ch)
+void Sequencer::put(std::string_view chars)
 {
     if (_hookedParser)
-        _hookedParser->pass(ch);
+        _hookedParser->pass(chars);
 }
 
 void Sequencer::unhook()
 {
-    if (_hookedParser)
+    if (!_hookedParser)
+        return;
+
+    if (auto* pipeline = _terminal.activeSequencePipeline())
     {
-        _hookedParser->finalize();
-        _hookedParser.reset();
+        // Finalizing touches the screen, which is up to the apply stage.
+        pipeline->unhook(std::move(_hookedParser));
+        return;
     }
+
+    _hookedParser->finalize();
+    _hookedParser.reset();
 }
 
 size_t Sequencer::maxBulkTextSequenceWidth() const noexcept
 {
-    if (!_terminal.isPrimaryScreen())
-        return 0;
+    // The screen is owned by the apply stage, which will split up text runs as needed.
+    if (_terminal.activeSequencePipeline())
+        return SequencePipeline::MaxTextRunWidth;
 
-    if (!_terminal.primaryScreen().currentLine().isTrivialBuffer())
-        return 0;
+    return _terminal.maxBulkTextSequenceWidth();
+}
+
+size_t Sequencer::maxBulkAsciiTextLength() const noexcept
+{
+    if (_terminal.activeSequencePipeline())
+        return SequencePipeline::MaxTextRunWidth;
 
-    assert(_terminal.currentScreen().margin().horizontal.to
-           >= _terminal.currentScreen().cursor().position.column);
-    return unbox<size_t>(_terminal.currentScreen().margin().horizontal.to
-                         - _terminal.currentScreen().cursor().position.column);
+    return _terminal.maxBulkAsciiTextLength();
 }
 
 void Sequencer::handleSequence()
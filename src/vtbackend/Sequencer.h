@@ -15,6 +15,7 @@
 
 #include <vtbackend/Functions.h>
 #include <vtbackend/Image.h>
+#include <vtbackend/Metrics.h>
 #include <vtbackend/Sequence.h>
 #include <vtbackend/SixelParser.h>
 #include <vtbackend/primitives.h>
@@ -151,17 +152,18 @@ class Sequencer
     void paramSubSeparator() noexcept;
     void dispatchESC(char finalChar);
     void dispatchCSI(char finalChar);
+    void dispatchCSI(ParsedCSI const& csi);
     void startOSC();
-    void putOSC(char ch);
+    void putOSC(std::string_view chars);
     void dispatchOSC();
     void hook(char finalChar);
-    void put(char ch);
+    void put(std::string_view chars);
     void unhook();
     void startAPC() {}
-    void putAPC(char) {}
+    void putAPC(std::string_view) {}
     void dispatchAPC() {}
     void startPM() {}
-    void putPM(char) {}
+    void putPM(std::string_view) {}
     void dispatchPM() {}
 
     void hookParser(std::unique_ptr<ParserExtension> parserExtension) noexcept
@@ -170,6 +172,13 @@ class Sequencer
     }
 
     [[nodiscard]] size_t maxBulkTextSequenceWidth() const noexcept;
+    [[nodiscard]] size_t maxBulkAsciiTextLength() const noexcept;
+
+    /// @returns the VT sequence usage metrics collected so far.
+    ///
+    /// These must only be updated by the thread running the VT parser.
+    [[nodiscard]] Metrics& metrics() noexcept { return _metrics; }
+    [[nodiscard]] Metrics const& metrics() const noexcept { return _metrics; }
 
   private:
     void handleSequence();
@@ -182,6 +191,8 @@ class Sequencer
 
     std::unique_ptr<ParserExtension> _hookedParser;
     std::unique_ptr<SixelImageBuilder> _sixelImageBuilder;
+
+    Metrics _metrics;
 };
 
 // {{{ inlines
@@ -6,6 +6,7 @@
 #include <vtbackend/primitives.h>
 
 #include <chrono>
+#include <optional>
 
 namespace terminal
 {
@@ -54,6 +55,8 @@ struct Settings
     //
     // This value must be integer-devisable by 16.
     size_t ptyReadBufferSize = 4096;
+    // Parses the PTY output on the reading thread while a separate thread applies it to the screen.
+    bool pipelinedParsing = false;
     std::u32string wordDelimiters;
     Modifier mouseProtocolBypassModifier = Modifier::Shift;
     Modifier mouseBlockSelectionModifier = Modifier::Control;
@@ -66,6 +69,11 @@ struct Settings
     struct PrimaryScreen
     {
         bool allowReflowOnResize = true;
+
+        // Number of history lines right above the main page that are kept as they are.
+        // History lines beyond are packed into compressed chunks, and unpacked again on access.
+        // std::nullopt keeps all history lines as they are.
+        std::optional<LineCount> coldHistoryDistance = LineCount(1000);
     };
     PrimaryScreen primaryScreen;
 
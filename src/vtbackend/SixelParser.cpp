@@ -348,9 +348,9 @@ void SixelParser::leaveState()
     }
 }
 
-void SixelParser::pass(char ch)
+void SixelParser::pass(std::string_view chars)
 {
-    parse(ch);
+    parseFragment(chars);
 }
 
 void SixelParser::finalize()
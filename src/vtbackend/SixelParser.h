@@ -106,7 +106,7 @@ class SixelParser: public ParserExtension
     }
 
     // ParserExtension overrides
-    void pass(char ch) override;
+    void pass(std::string_view chars) override;
     void finalize() override;
 
   private:
@@ -35,6 +35,7 @@
 #include <chrono>
 #include <csignal>
 #include <iostream>
+#include <limits>
 #include <utility>
 #include <variant>
 
@@ -116,6 +117,17 @@ namespace // {{{ helpers
         return 0;
     }
 
+    // Number of buffer objects the PTY buffer pool creates (rather than recycles) before the
+    // text buffer objects referred to by the grids get compacted.
+    constexpr size_t BufferObjectCompactionInterval = 8;
+
+    // Buffer objects with less than this fraction of their bytes still referred to get compacted.
+    constexpr float BufferObjectCompactionLoadFactor = 0.125f;
+
+    // Number of history lines left unreflowed by resizing to be reflowed at once whenever the PTY
+    // has nothing to read, keeping the terminal locked for no longer than a millisecond or so.
+    constexpr auto IdleReflowLineCount = LineCount(500);
+
     constexpr CellLocation raiseToMinimum(CellLocation location, LineOffset minimumLine) noexcept
     {
         return CellLocation { std::max(location.line, minimumLine), location.column };
@@ -159,6 +171,7 @@ Terminal::Terminal(Events& eventListener,
     _refreshInterval { _settings.refreshRate }
 {
     _state.savedColorPalettes.reserve(MaxColorPaletteSaveStackSize);
+    _primaryScreen.grid().setColdHistoryDistance(_settings.primaryScreen.coldHistoryDistance);
 #if 0
     hardReset();
 #else
@@ -168,6 +181,22 @@ Terminal::Terminal(Events& eventListener,
     setMode(DECMode::TextReflow, true);
     setMode(DECMode::SixelCursorNextToGraphic, true);
 #endif
+
+    if (_settings.pipelinedParsing)
+        _sequencePipeline = std::make_unique<SequencePipeline>(*this);
+
+    PodCellExtras::get().addRoot(this, [this](PodCellExtras::Marker& marker) {
+        auto const _ = std::lock_guard { *this };
+        _primaryScreen.grid().markCellExtras(marker);
+        _alternateScreen.grid().markCellExtras(marker);
+        _hostWritableStatusLineScreen.grid().markCellExtras(marker);
+        _indicatorStatusScreen.grid().markCellExtras(marker);
+    });
+}
+
+Terminal::~Terminal()
+{
+    PodCellExtras::get().removeRoot(this);
 }
 
 void Terminal::setRefreshRate(RefreshRate refreshRate)
@@ -196,11 +225,45 @@ Pty::ReadResult Terminal::readFromPty()
             PtyInLog()("Only {} bytes left in TBO. Allocating new buffer from pool.",
                        _currentPtyBuffer->bytesAvailable());
         _currentPtyBuffer = _ptyBufferPool.allocateBufferObject();
+        compactBufferObjectsIfNeeded();
+    }
+
+    // Reclaims extra cell data no longer in use by any terminal, locking each one in turn.
+    PodCellExtras::get().collectIfRequested();
+
+    // No cold line's contents are referred to in between processing the input read.
+    releaseEvictedColdLines();
+
+    // History lines left unreflowed by resizing are reflowed bit by bit while the PTY has nothing
+    // to read, polling it in between rather than waiting for it.
+    if (_historyReflowPending)
+    {
+        auto result = _pty->read(*_currentPtyBuffer, std::chrono::milliseconds(0), _ptyReadBufferSize);
+        if (result.idle)
+            _historyReflowPending = reflowHistoryWhileIdle();
+        return result;
     }
 
     return _pty->read(*_currentPtyBuffer, timeout, _ptyReadBufferSize);
 }
 
+bool Terminal::reflowHistoryWhileIdle()
+{
+    auto const _ = std::lock_guard { *this };
+    auto& grid = _primaryScreen.grid();
+
+    // The lines scrolled into view are reflowed first, being rendered resized rather than reflowed until
+    // then, and reflowing may leave fewer history lines to scroll to than before.
+    if (isPrimaryScreen())
+        grid.reflowHistory(boxed_cast<LineCount>(_viewport.scrollOffset()));
+    grid.reflowMoreHistory(IdleReflowLineCount);
+    grid.releaseEvictedHistoryLines();
+    if (isPrimaryScreen() && boxed_cast<LineCount>(_viewport.scrollOffset()) > grid.historyLineCount())
+        _viewport.scrollToTop();
+
+    return grid.unreflowedHistoryLineCount() > LineCount(0);
+}
+
 void Terminal::setExecutionMode(ExecutionMode mode)
 {
     auto _ = std::unique_lock(_state.breakMutex);
@@ -245,17 +308,17 @@ bool Terminal::processInputOnce()
 
     auto const readResult = readFromPty();
 
-    if (!readResult)
+    if (!readResult.data)
     {
-        if (errno == EINTR || errno == EAGAIN)
+        if (readResult.idle)
             return true;
 
         TerminalLog()("PTY read failed. {}", strerror(errno));
         _pty->close();
         return false;
     }
-    string_view const buf = get<0>(*readResult);
-    _state.usingStdoutFastPipe = get<1>(*readResult);
+    string_view const buf = get<0>(*readResult.data);
+    _state.usingStdoutFastPipe = get<1>(*readResult.data);
 
     if (buf.empty())
     {
@@ -264,6 +327,16 @@ bool Terminal::processInputOnce()
         return true;
     }
 
+    if (auto* pipeline = activeSequencePipeline())
+    {
+        // The apply stage takes care of the screen, including notifying about its updates.
+        pipeline->parseFragment(_currentPtyBuffer, buf);
+        return true;
+    }
+
+    if (_sequencePipeline)
+        _sequencePipeline->waitUntilApplied();
+
     {
         auto const _ = std::lock_guard { *this };
         _state.parser.parseFragment(buf);
@@ -279,6 +352,48 @@ bool Terminal::processInputOnce()
     return true;
 }
 
+void Terminal::waitUntilApplied()
+{
+    if (_sequencePipeline)
+        _sequencePipeline->waitUntilApplied();
+}
+
+Metrics Terminal::metrics() const
+{
+    // The metrics are updated by the parser stage if pipelined, or while holding the terminal lock otherwise.
+    auto parserStageLock = std::unique_lock<std::mutex> {};
+    if (_sequencePipeline)
+        parserStageLock = _sequencePipeline->lockParserStage();
+
+    auto const _ = std::lock_guard { *this };
+    return _state.sequencer.metrics();
+}
+
+size_t Terminal::maxBulkTextSequenceWidth() const noexcept
+{
+    if (!isPrimaryScreen())
+        return 0;
+
+    if (_primaryScreen.currentLine().isInflatedBuffer())
+        return 0;
+
+    assert(currentScreen().margin().horizontal.to >= currentScreen().cursor().position.column);
+    return unbox<size_t>(currentScreen().margin().horizontal.to - currentScreen().cursor().position.column);
+}
+
+size_t Terminal::maxBulkAsciiTextLength() const noexcept
+{
+    auto const width = maxBulkTextSequenceWidth();
+    auto const& screen = currentScreen();
+    auto const fullHorizontalMargins =
+        screen.margin().horizontal.to.value + 1 == _settings.pageSize.columns.value;
+    if (!width || !screen.cursor().autoWrap || !fullHorizontalMargins)
+        return width;
+
+    // Long lines are wrapped onto the following lines by the screen in one go.
+    return std::numeric_limits<size_t>::max();
+}
+
 // {{{ RenderBuffer synchronization
 void Terminal::breakLoopAndRefreshRenderBuffer()
 {
@@ -418,6 +533,39 @@ void Terminal::fillRenderBuffer(RenderBuffer& output, bool includeSelection)
     fillRenderBufferInternal(output, includeSelection);
 }
 
+RenderBuffer const* Terminal::reusableRenderBuffer(RenderBuffer const& output,
+                                                   bool includeSelection,
+                                                   bool hoveringHyperlink)
+{
+    auto const& colors = colorPalette();
+
+    auto state = RenderReuseState {};
+    state.reusable = !(includeSelection && _selection) && !_highlightRange && !hoveringHyperlink
+                     && _state.searchMode.pattern.empty() && inputHandler().mode() == ViMode::Insert;
+    state.screenType = _state.screenType;
+    state.scrollOffset = _viewport.scrollOffset();
+    state.pageSize = pageSize();
+    state.reverseVideo = isModeEnabled(DECMode::ReverseVideo);
+    state.useBrightColors = colors.useBrightColors;
+    state.palette = colors.palette;
+    state.defaultForeground = colors.defaultForeground;
+    state.defaultBackground = colors.defaultBackground;
+    state.hyperlinkDecoration = colors.hyperlinkDecoration.normal;
+
+    auto const reusable = state.reusable && state == _lastRenderReuseState;
+    _lastRenderReuseState = state;
+    if (!reusable)
+        return nullptr;
+
+    // Only the frame rendered last can be reused, which is the front buffer, unless swapping failed.
+    // Its frame ID has been assigned before the frame ID got incremented for the frame to be rendered now.
+    for (auto const& buffer: _renderBuffer.buffers)
+        if (&buffer != &output && buffer.frameID == _lastFrameID - 1)
+            return &buffer;
+
+    return nullptr;
+}
+
 void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelection)
 {
     verifyState();
@@ -428,6 +576,9 @@ void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelect
     _screenDirty = false;
     ++_lastFrameID;
 
+    // Rendered lines keep their text alive themselves, thus none of it is referred to in between frames.
+    releaseEvictedColdLines();
+
 #if defined(CONTOUR_PERF_STATS)
     if (TerminalLog)
         TerminalLog()("{}: Refreshing render buffer.\n", _lastFrameID.load());
@@ -445,6 +596,9 @@ void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelect
                                             : nullopt)
                                      : state().viCommands.cursorPosition };
 
+    auto const* previousFrame =
+        reusableRenderBuffer(output, includeSelection, hoveringHyperlinkGuard.href != nullptr);
+
     if (isPrimaryScreen())
         _lastRenderPassHints =
             _primaryScreen.render(RenderBufferBuilder<PrimaryScreenCell> { *this,
@@ -454,7 +608,8 @@ void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelect
                                                                            HighlightSearchMatches::Yes,
                                                                            _inputMethodData,
                                                                            theCursorPosition,
-                                                                           includeSelection },
+                                                                           includeSelection,
+                                                                           previousFrame },
                                   _viewport.scrollOffset(),
                                   highlightSearchMatches);
     else
@@ -466,7 +621,8 @@ void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelect
                                                                                HighlightSearchMatches::Yes,
                                                                                _inputMethodData,
                                                                                theCursorPosition,
-                                                                               includeSelection },
+                                                                               includeSelection,
+                                                                               previousFrame },
                                     _viewport.scrollOffset(),
                                     highlightSearchMatches);
 
@@ -936,8 +1092,14 @@ void Terminal::flushInput()
 
 void Terminal::writeToScreen(string_view vtStream)
 {
+    auto* const pipeline = activeSequencePipeline();
+    if (!pipeline)
+        waitUntilApplied();
+
     {
-        auto const l = std::lock_guard { *this };
+        auto l = std::unique_lock { *this, std::defer_lock };
+        if (!pipeline)
+            l.lock();
         while (!vtStream.empty())
         {
             if (_currentPtyBuffer->bytesAvailable() < 64
@@ -946,16 +1108,44 @@ void Terminal::writeToScreen(string_view vtStream)
             auto const chunk =
                 vtStream.substr(0, std::min(vtStream.size(), _currentPtyBuffer->bytesAvailable()));
             vtStream.remove_prefix(chunk.size());
-            _state.parser.parseFragment(_currentPtyBuffer->writeAtEnd(chunk));
+            auto const data = _currentPtyBuffer->writeAtEnd(chunk);
+            if (pipeline)
+                pipeline->parseFragment(_currentPtyBuffer, string_view(data.data(), data.size()));
+            else
+                _state.parser.parseFragment(data);
         }
     }
 
+    compactBufferObjectsIfNeeded();
+
+    if (pipeline)
+    {
+        // Callers expect their text to be on the screen when we return,
+        // and the apply stage takes care of notifying about screen updates.
+        pipeline->waitUntilApplied();
+        return;
+    }
+
     if (!_state.modes.enabled(DECMode::BatchedRendering))
     {
         screenUpdated();
     }
 }
 
+void Terminal::compactBufferObjectsIfNeeded()
+{
+    // The pool creating new buffer objects rather than recycling released ones means that
+    // the grids keep more and more of them alive, possibly by only a few lines each.
+    if (_ptyBufferPool.createdBuffers() < _ptyBuffersCreatedAtCompaction + BufferObjectCompactionInterval)
+        return;
+
+    _ptyBuffersCreatedAtCompaction = _ptyBufferPool.createdBuffers();
+
+    auto const _ = std::lock_guard { *this };
+    _primaryScreen.grid().compactBufferObjects(BufferObjectCompactionLoadFactor);
+    _alternateScreen.grid().compactBufferObjects(BufferObjectCompactionLoadFactor);
+}
+
 string_view Terminal::lockedWriteToPtyBuffer(string_view data)
 {
     if (_currentPtyBuffer->bytesAvailable() < 64 && _currentPtyBuffer->bytesAvailable() < data.size())
@@ -1646,6 +1836,11 @@ void Terminal::setGraphicsRendition(GraphicsRendition rendition)
             CellUtil::makeCellFlags(rendition, _currentScreen.get().cursor().graphicsRendition.flags);
 }
 
+void Terminal::applyGraphicsRendition(GraphicsAttributesDelta const& delta)
+{
+    delta.applyTo(_currentScreen.get().cursor().graphicsRendition);
+}
+
 void Terminal::setForegroundColor(Color color)
 {
     _currentScreen.get().cursor().graphicsRendition.foregroundColor = color;
@@ -1776,6 +1971,12 @@ void Terminal::applyPageSizeToMainDisplay(ScreenType screenType)
     {
         case ScreenType::Primary:
             _primaryScreen.applyPageSizeToMainDisplay(mainDisplayPageSize);
+            // Wakes up the PTY reader for reflowing the history lines left unreflowed while idle.
+            if (_primaryScreen.grid().unreflowedHistoryLineCount() > LineCount(0))
+            {
+                _historyReflowPending = true;
+                _pty->wakeupReader();
+            }
             break;
         case ScreenType::Alternate:
             _alternateScreen.applyPageSizeToMainDisplay(mainDisplayPageSize);
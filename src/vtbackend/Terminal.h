@@ -15,10 +15,12 @@
 
 #include <vtbackend/InputGenerator.h>
 #include <vtbackend/InputHandler.h>
+#include <vtbackend/Metrics.h>
 #include <vtbackend/RenderBuffer.h>
 #include <vtbackend/ScreenEvents.h>
 #include <vtbackend/Selector.h>
 #include <vtbackend/Sequence.h>
+#include <vtbackend/SequencePipeline.h>
 #include <vtbackend/Settings.h>
 #include <vtbackend/TerminalState.h>
 #include <vtbackend/ViInputHandler.h>
@@ -139,7 +141,7 @@ class Terminal
              std::unique_ptr<Pty> pty,
              Settings factorySettings,
              std::chrono::steady_clock::time_point now /* = std::chrono::steady_clock::now()*/);
-    ~Terminal() = default;
+    ~Terminal();
 
     void start();
 
@@ -170,6 +172,7 @@ class Terminal
     void moveCursorTo(LineOffset line, ColumnOffset column);
 
     void setGraphicsRendition(GraphicsRendition rendition);
+    void applyGraphicsRendition(GraphicsAttributesDelta const& delta);
     void setForegroundColor(Color color);
     void setBackgroundColor(Color color);
     void setUnderlineColor(Color color);
@@ -392,7 +395,10 @@ class Terminal
         // TODO(pr) avoid double-switch by introducing a `SequenceHandler& sequenceHandler` member.
         switch (_state.executionMode)
         {
-            case ExecutionMode::Normal: return activeDisplay();
+            case ExecutionMode::Normal:
+                if (_sequencePipeline)
+                    return *_sequencePipeline;
+                return activeDisplay();
             case ExecutionMode::BreakAtEmptyQueue:
             case ExecutionMode::Waiting: [[fallthrough]];
             case ExecutionMode::SingleStep: return _traceHandler;
@@ -562,6 +568,16 @@ class Terminal
 
     bool processInputOnce();
 
+    /// @returns a snapshot of the VT sequence usage metrics collected so far.
+    ///
+    /// Must not be called while holding the terminal lock.
+    [[nodiscard]] Metrics metrics() const;
+
+    /// Waits until all of the VT stream processed so far has been applied to the screen.
+    ///
+    /// This only makes a difference with pipelined parsing enabled, where the screen lags behind.
+    void waitUntilApplied();
+
     void markScreenDirty() noexcept { _screenDirty = true; }
 
     [[nodiscard]] uint64_t lastFrameID() const noexcept { return _lastFrameID.load(); }
@@ -627,11 +643,54 @@ class Terminal
     void applyPageSizeToCurrentBuffer();
     void applyPageSizeToMainDisplay(ScreenType screenType);
 
+    /// @returns the buffer object holding the text currently being written to the screen.
     [[nodiscard]] crispy::BufferObjectPtr<char> currentPtyBuffer() const noexcept
     {
+        if (auto const* pipeline = applyingSequencePipeline())
+            return pipeline->textBuffer();
         return _currentPtyBuffer;
     }
 
+    /// Keeps subsequent PTY reads from overwriting the current PTY buffer up to the given end,
+    /// as the text up to there is now referenced by the grid.
+    void retainPtyBufferUntil(char const* end) noexcept
+    {
+        // The parser stage of the sequence pipeline already retains all it hands over.
+        if (!applyingSequencePipeline())
+            _currentPtyBuffer->advanceHotEndUntil(end);
+    }
+
+    /// Compacts the text buffer objects referred to by the grids (see Grid::compactBufferObjects()),
+    /// if the PTY buffer pool had to create a number of new buffer objects since the last time.
+    void compactBufferObjectsIfNeeded();
+
+    /// Reflows the history lines scrolled into view and the next few ones left unreflowed by resizing
+    /// the primary screen, on the terminal thread rather than when reading the grid for rendering.
+    ///
+    /// @returns whether any history lines are left unreflowed still.
+    bool reflowHistoryWhileIdle();
+
+    /// @returns the maximum number of cells the parser may pass to the screen as one text run.
+    [[nodiscard]] size_t maxBulkTextSequenceWidth() const noexcept;
+
+    /// @returns the maximum number of printable US-ASCII characters the parser may pass to the screen
+    ///          as one text run, possibly spanning multiple lines.
+    [[nodiscard]] size_t maxBulkAsciiTextLength() const noexcept;
+
+    /// @returns the sequence pipeline if pipelined parsing is enabled and currently in use, nullptr otherwise.
+    [[nodiscard]] SequencePipeline* activeSequencePipeline() const noexcept
+    {
+        // Queried by the parser stage, while the execution mode is changed by the GUI thread.
+        auto const mode = _state.executionMode.load(std::memory_order_acquire);
+        return mode == ExecutionMode::Normal ? _sequencePipeline.get() : nullptr;
+    }
+
+    /// @returns the sequence pipeline if the caller is running within its apply stage, nullptr otherwise.
+    [[nodiscard]] SequencePipeline* applyingSequencePipeline() const noexcept
+    {
+        return _sequencePipeline && _sequencePipeline->applying() ? _sequencePipeline.get() : nullptr;
+    }
+
     [[nodiscard]] terminal::SelectionHelper& selectionHelper() noexcept { return _selectionHelper; }
 
     [[nodiscard]] Selection::OnSelectionUpdated selectionUpdatedHelper()
@@ -692,6 +751,9 @@ class Terminal
   private:
     void mainLoop();
     void fillRenderBufferInternal(RenderBuffer& output, bool includeSelection);
+    RenderBuffer const* reusableRenderBuffer(RenderBuffer const& output,
+                                             bool includeSelection,
+                                             bool hoveringHyperlink);
     void updateIndicatorStatusLine();
     void updateCursorVisibilityState() const noexcept;
     void updateCursorHoveringState();
@@ -746,6 +808,8 @@ class Terminal
     // {{{ PTY and PTY read buffer management
     crispy::BufferObjectPool<char> _ptyBufferPool;
     crispy::BufferObjectPtr<char> _currentPtyBuffer;
+    size_t _ptyBuffersCreatedAtCompaction = 0;
+    std::atomic<bool> _historyReflowPending = false;
     size_t _ptyReadBufferSize;
     std::unique_ptr<Pty> _pty;
     // }}}
@@ -807,12 +871,36 @@ class Terminal
     RenderDoubleBuffer _renderBuffer {};
     std::atomic<uint64_t> _lastFrameID = 0;
     RenderPassHints _lastRenderPassHints {};
+
+    /// Everything besides the grid lines that rendering a line depends on, which therefore has to
+    /// match the previous frame's in order to copy over the lines that have not changed since.
+    struct RenderReuseState
+    {
+        /// False if selection, highlighting, search matches, the vi mode cursor line or a hovered
+        /// hyperlink are shown, which are not accounted for by the grid lines' generations.
+        bool reusable = false;
+        ScreenType screenType = ScreenType::Primary;
+        ScrollOffset scrollOffset {};
+        PageSize pageSize {};
+        bool reverseVideo = false;
+        bool useBrightColors = false;
+        ColorPalette::Palette palette {};
+        RGBColor defaultForeground {};
+        RGBColor defaultBackground {};
+        RGBColor hyperlinkDecoration {};
+
+        bool operator==(RenderReuseState const&) const = default;
+    };
+    RenderReuseState _lastRenderReuseState {};
     // }}}
 
     InputMethodData _inputMethodData {};
     std::atomic<HyperlinkId> _hoveringHyperlinkId = HyperlinkId {};
     std::atomic<bool> _renderBufferUpdateEnabled = true; // for "Synchronized Updates" feature
     std::optional<HighlightRange> _highlightRange = std::nullopt;
+
+    // Declared last, so that its apply stage is stopped before anything it operates on is destroyed.
+    std::unique_ptr<SequencePipeline> _sequencePipeline;
 };
 
 } // namespace terminal
@@ -20,6 +20,7 @@
 #include <vtbackend/Hyperlink.h>
 #include <vtbackend/InputGenerator.h>
 #include <vtbackend/InputHandler.h>
+#include <vtbackend/SGRCache.h>
 #include <vtbackend/ScreenEvents.h> // ScreenType
 #include <vtbackend/Sequencer.h>
 #include <vtbackend/Settings.h>
@@ -210,6 +211,8 @@ struct TerminalState
 
     Sequencer sequencer;
     parser::Parser<Sequencer, false> parser;
+    SGRCache sgrCache;
+    // Only touched while applying to the screen, so never by the parser stage of a SequencePipeline.
     uint64_t instructionCounter = 0;
 
     InputGenerator inputGenerator {};
@@ -431,3 +431,106 @@ TEST_CASE("Terminal.TextSelection", "[terminal]")
     mock.terminal.sendMouseReleaseEvent(Modifier::None, MouseButton::Left, pixelCoordinate, uiHandledHint);
     CHECK(mock.terminal.extractSelectionText().empty());
 }
+
+TEST_CASE("Terminal.metrics", "[terminal]")
+{
+    auto mock = MockTerm { PageSize { LineCount(4), ColumnCount(10) } };
+    mock.writeToScreen("\033[2;3H\033[31mHello\r\n\033[m\033[1;1H");
+
+    auto const metrics = mock.terminal.metrics();
+    auto const countOf = [&](terminal::FunctionDefinition const& f) {
+        auto const i = std::find(terminal::functions().begin(), terminal::functions().end(), f);
+        REQUIRE(i != terminal::functions().end());
+        return metrics.functionCounts[terminal::functionIndex(*i)];
+    };
+
+    CHECK(countOf(terminal::CUP) == 2);
+    CHECK(countOf(terminal::SGR) == 2);
+    CHECK(metrics.textBytes + metrics.textCodepoints == 5);
+    CHECK(metrics.controlCodes == 2);
+    CHECK(metrics.unknownSequences == 0);
+
+    auto const json = metrics.toJson();
+    CHECK(json.find(R"("mnemonic": "CUP")") != std::string::npos);
+    CHECK(json.find(R"("textBytes": )") != std::string::npos);
+}
+
+TEST_CASE("Terminal.RenderBufferReusesUnchangedLines", "[terminal]")
+{
+    // The lines not changed since the previous frame are copied over rather than rendered,
+    // which must yield the same render buffer as a terminal rendering all lines.
+    auto mock = MockTerm { PageSize { LineCount(5), ColumnCount(10) }, LineCount(10) };
+    auto reference = MockTerm { PageSize { LineCount(5), ColumnCount(10) }, LineCount(10) };
+
+    auto const write = [&](std::string_view text) {
+        mock.writeToScreen(text);
+        reference.writeToScreen(text);
+    };
+
+    auto const checkRenderBuffer = [&]() {
+        mock.terminal.refreshRenderBuffer();
+        auto expected = terminal::RenderBuffer {};
+        reference.terminal.fillRenderBuffer(expected, true);
+
+        auto const actualRef = mock.terminal.renderBuffer();
+        auto const& actual = actualRef.get();
+        REQUIRE(actual.cells.size() == expected.cells.size());
+        for (size_t i = 0; i < expected.cells.size(); ++i)
+        {
+            INFO(fmt::format("cell {} at {}", i, expected.cells[i].position));
+            CHECK(actual.cells[i].codepoints == expected.cells[i].codepoints);
+            CHECK(actual.cells[i].position == expected.cells[i].position);
+            CHECK(actual.cells[i].attributes.foregroundColor == expected.cells[i].attributes.foregroundColor);
+            CHECK(actual.cells[i].attributes.backgroundColor == expected.cells[i].attributes.backgroundColor);
+            CHECK(actual.cells[i].groupStart == expected.cells[i].groupStart);
+            CHECK(actual.cells[i].groupEnd == expected.cells[i].groupEnd);
+        }
+        REQUIRE(actual.lines.size() == expected.lines.size());
+        for (size_t i = 0; i < expected.lines.size(); ++i)
+        {
+            CHECK(actual.lines[i].text == expected.lines[i].text);
+            CHECK(actual.lines[i].lineOffset == expected.lines[i].lineOffset);
+        }
+    };
+
+    write("\033[31mred\033[m\r\n"
+          "plain\r\n"
+          "\033[1;32mgreen\033[m\r\n"
+          "\033[4;1H$ ");
+    checkRenderBuffer();
+
+    SECTION("unchanged")
+    {
+        checkRenderBuffer();
+    }
+
+    SECTION("single line changed")
+    {
+        write("\033[s\033[2;3HAI\033[u");
+        checkRenderBuffer();
+    }
+
+    SECTION("cursor moved")
+    {
+        write("ls\r\n");
+        checkRenderBuffer();
+    }
+
+    SECTION("scrolled")
+    {
+        write("\033[5;1H\r\n\r\n\033[44mblue\033[m");
+        checkRenderBuffer();
+    }
+
+    SECTION("scrolled within margins")
+    {
+        write("\033[2;4r\033[4;1H\r\n\033[r");
+        checkRenderBuffer();
+    }
+
+    SECTION("color palette changed")
+    {
+        write("\033]4;1;rgb:00/ff/00\033\\");
+        checkRenderBuffer();
+    }
+}
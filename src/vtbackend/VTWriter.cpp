@@ -13,7 +13,10 @@
  */
 #include <vtbackend/VTWriter.h>
 
+#include <algorithm>
+#include <array>
 #include <numeric>
+#include <utility>
 
 using std::string;
 using std::string_view;
@@ -87,6 +90,7 @@ string VTWriter::sgrFlush(vector<unsigned> const& sgr)
 
 void VTWriter::sgrAddExplicit(unsigned n)
 {
+    _currentAttributes.reset();
     if (n == 0)
     {
         _currentForegroundColor = DefaultColor();
@@ -99,6 +103,7 @@ void VTWriter::sgrAddExplicit(unsigned n)
 
 void VTWriter::sgrAdd(unsigned n)
 {
+    _currentAttributes.reset();
     if (n == 0)
     {
         _sgr.clear();
@@ -199,36 +204,177 @@ void VTWriter::setBackgroundColor(Color color)
     }
 }
 
+void VTWriter::setUnderlineColor(Color color)
+{
+    _currentUnderlineColor = color;
+    switch (color.type())
+    {
+        case ColorType::Default: sgrAdd(59); break;
+        case ColorType::Indexed: sgrAdd(58, 5, static_cast<unsigned>(color.index())); break;
+        case ColorType::Bright: sgrAdd(58, 5, 8 + static_cast<unsigned>(getBrightColor(color))); break;
+        case ColorType::RGB:
+            // clang-format off
+            sgrAdd(58, 2, static_cast<unsigned>(color.rgb().red),
+                          static_cast<unsigned>(color.rgb().green),
+                          static_cast<unsigned>(color.rgb().blue));
+            // clang-format on
+            break;
+        case ColorType::Undefined: break;
+    }
+}
+
+namespace
+{
+    /// Appends the SGR parameters selecting the given color, with @p base being 30 for the foreground,
+    /// 40 for the background and 50 for the underline color.
+    void appendColorParameters(string& sgr, unsigned base, Color color)
+    {
+        switch (color.type())
+        {
+            case ColorType::Indexed:
+                if (static_cast<unsigned>(color.index()) < 8 && base != 50)
+                    sgr += fmt::format(";{}", base + static_cast<unsigned>(color.index()));
+                else
+                    sgr += fmt::format(";{};5;{}", base + 8, static_cast<unsigned>(color.index()));
+                break;
+            case ColorType::Bright:
+                if (base != 50)
+                    sgr += fmt::format(";{}", base + 60 + static_cast<unsigned>(getBrightColor(color)));
+                else
+                    sgr += fmt::format(";58;5;{}", 8 + static_cast<unsigned>(getBrightColor(color)));
+                break;
+            case ColorType::RGB:
+                sgr += fmt::format(";{};2;{};{};{}",
+                                   base + 8,
+                                   static_cast<unsigned>(color.rgb().red),
+                                   static_cast<unsigned>(color.rgb().green),
+                                   static_cast<unsigned>(color.rgb().blue));
+                break;
+            case ColorType::Default:
+            case ColorType::Undefined: break;
+        }
+    }
+} // namespace
+
+void VTWriter::setGraphicsAttributes(GraphicsAttributes const& attributes)
+{
+    if (_currentAttributes == attributes)
+        return;
+
+    sgrFlush();
+
+    auto constexpr Masks = std::array {
+        std::pair { CellFlags::Bold, "1" },
+        std::pair { CellFlags::Faint, "2" },
+        std::pair { CellFlags::Italic, "3" },
+        std::pair { CellFlags::Underline, "4" },
+        std::pair { CellFlags::Blinking, "5" },
+        std::pair { CellFlags::RapidBlinking, "6" },
+        std::pair { CellFlags::Inverse, "7" },
+        std::pair { CellFlags::Hidden, "8" },
+        std::pair { CellFlags::CrossedOut, "9" },
+        std::pair { CellFlags::DoublyUnderlined, "4:2" },
+        std::pair { CellFlags::CurlyUnderlined, "4:3" },
+        std::pair { CellFlags::DottedUnderline, "4:4" },
+        std::pair { CellFlags::DashedUnderline, "4:5" },
+        std::pair { CellFlags::Framed, "51" },
+        std::pair { CellFlags::Overline, "53" },
+    };
+
+    // Starting off with a reset, as the previously selected attributes are not known to the receiver.
+    auto sgr = string { "\033[0" };
+    for (auto const& [flag, parameter]: Masks)
+        if (attributes.flags & flag)
+            sgr += fmt::format(";{}", parameter);
+    appendColorParameters(sgr, 30, attributes.foregroundColor);
+    appendColorParameters(sgr, 40, attributes.backgroundColor);
+    appendColorParameters(sgr, 50, attributes.underlineColor);
+    sgr += 'm';
+    _writer(sgr.data(), sgr.size());
+
+    _lastSGR.clear();
+    _currentAttributes = attributes;
+    _currentForegroundColor = attributes.foregroundColor;
+    _currentBackgroundColor = attributes.backgroundColor;
+    _currentUnderlineColor = attributes.underlineColor;
+}
+
+void VTWriter::setHyperlink(HyperlinkId hyperlink)
+{
+    if (!_hyperlinks || hyperlink == _currentHyperlink)
+        return;
+
+    if (auto const info = _hyperlinks->hyperlinkById(hyperlink))
+    {
+        if (info->userId.empty())
+            write(fmt::format("\033]8;;{}\033\\", info->uri));
+        else
+            write(fmt::format("\033]8;id={};{}\033\\", info->userId, info->uri));
+        _currentHyperlink = hyperlink;
+    }
+    else if (!!_currentHyperlink)
+    {
+        write("\033]8;;\033\\");
+        _currentHyperlink = HyperlinkId {};
+    }
+}
+
 template <typename Cell>
 void VTWriter::write(Line<Cell> const& line)
 {
+    auto const writeFill = [&](GraphicsAttributes const& attributes, ColumnCount columns) {
+        if (columns <= ColumnCount(0))
+            return;
+        setGraphicsAttributes(attributes);
+        write(string(unbox<size_t>(columns), ' '));
+    };
+
     if (line.isTrivialBuffer())
     {
         TrivialLineBuffer const& lineBuffer = line.trivialBuffer();
-        setForegroundColor(lineBuffer.textAttributes.foregroundColor);
-        setBackgroundColor(lineBuffer.textAttributes.backgroundColor);
-        // TODO: hyperlinks, underlineColor and other flags (curly underline etc.)
-        write(line.toUtf8());
-        // TODO: Write fill columns.
+        setHyperlink(lineBuffer.hyperlink);
+        setGraphicsAttributes(lineBuffer.textAttributes);
+        write(lineBuffer.text.view());
+        setHyperlink(HyperlinkId {});
+        writeFill(lineBuffer.fillAttributes, lineBuffer.displayWidth - lineBuffer.usedColumns);
+    }
+    else if (line.isAttributedBuffer())
+    {
+        AttributedLineBuffer const& lineBuffer = line.attributedBuffer();
+        for (AttributedLineRun const& run: lineBuffer.runs)
+        {
+            setHyperlink(run.hyperlink);
+            setGraphicsAttributes(run.attributes);
+            write(run.text.view());
+            if (auto const padding = run.columns - displayWidthOf(run.text.view()); padding > ColumnCount(0))
+                write(string(unbox<size_t>(padding), ' '));
+        }
+        setHyperlink(HyperlinkId {});
+        writeFill(lineBuffer.fillAttributes, lineBuffer.displayWidth - lineBuffer.usedColumns);
     }
     else
     {
+        auto pendingWidth = 0; // Columns still covered by the last written wide character.
         for (Cell const& cell: line.inflatedBuffer())
         {
-            if (cell.flags() & CellFlags::Bold)
-                sgrAdd(GraphicsRendition::Bold);
-            else
-                sgrAdd(GraphicsRendition::Normal);
+            if (pendingWidth > 0 && !cell.codepointCount())
+            {
+                --pendingWidth;
+                continue;
+            }
 
-            setForegroundColor(cell.foregroundColor());
-            setBackgroundColor(cell.backgroundColor());
-            // TODO: other flags (such as underline), hyperlinks, image fragments.
+            setHyperlink(cell.hyperlink());
+            setGraphicsAttributes(GraphicsAttributes {
+                cell.foregroundColor(), cell.backgroundColor(), cell.underlineColor(), cell.flags() });
+            // TODO: image fragments.
 
             if (!cell.codepointCount())
                 write(' ');
             else
                 write(cell.toUtf8());
+            pendingWidth = std::max(static_cast<int>(cell.width()), 1) - 1;
         }
+        setHyperlink(HyperlinkId {});
     }
 
     sgrAdd(GraphicsRendition::Reset);
@@ -241,3 +387,6 @@ template void terminal::VTWriter::write<terminal::CompactCell>(Line<CompactCell>
 
 #include <vtbackend/cell/SimpleCell.h>
 template void terminal::VTWriter::write<terminal::SimpleCell>(Line<SimpleCell> const&);
+
+#include <vtbackend/cell/PodCell.h>
+template void terminal::VTWriter::write<terminal::PodCell>(Line<PodCell> const&);
@@ -14,6 +14,8 @@
 #pragma once
 
 #include <vtbackend/Color.h>
+#include <vtbackend/GraphicsAttributes.h>
+#include <vtbackend/Hyperlink.h>
 #include <vtbackend/Line.h>
 #include <vtbackend/primitives.h>
 
@@ -22,6 +24,7 @@
 #include <fmt/format.h>
 
 #include <functional>
+#include <optional>
 #include <ostream>
 #include <sstream>
 #include <vector>
@@ -58,6 +61,16 @@ class VTWriter
     void sgrAdd(GraphicsRendition m);
     void setForegroundColor(Color color);
     void setBackgroundColor(Color color);
+    void setUnderlineColor(Color color);
+
+    /// Writes an SGR selecting exactly the given attributes, unless they are already selected.
+    void setGraphicsAttributes(GraphicsAttributes const& attributes);
+
+    /// Opens the given hyperlink (OSC 8), closing the previously opened one, if any.
+    ///
+    /// Hyperlinks are only written if a HyperlinkStorage has been set to resolve them.
+    void setHyperlink(HyperlinkId hyperlink);
+    void setHyperlinkStorage(HyperlinkStorage const* hyperlinks) noexcept { _hyperlinks = hyperlinks; }
 
     void sgrAddExplicit(unsigned n);
 
@@ -81,6 +94,9 @@ class VTWriter
     Color _currentForegroundColor = DefaultColor();
     Color _currentUnderlineColor = DefaultColor();
     Color _currentBackgroundColor = DefaultColor();
+    std::optional<GraphicsAttributes> _currentAttributes;
+    HyperlinkStorage const* _hyperlinks = nullptr;
+    HyperlinkId _currentHyperlink {};
 };
 
 template <typename... T>
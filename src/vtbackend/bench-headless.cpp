@@ -12,11 +12,14 @@
  * limitations under the License.
  */
 
+#include <vtbackend/Functions.h>
 #include <vtbackend/MockTerm.h>
 #include <vtbackend/Terminal.h>
 #include <vtbackend/cell/CellConfig.h>
 #include <vtbackend/logging.h>
 
+#include <vtparser/GroundScanner.h>
+
 #include <vtpty/MockViewPty.h>
 
 #include <crispy/App.h>
@@ -25,13 +28,24 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <random>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <libtermbench/termbench.h>
 
+#if defined(__linux__)
+    #include <unistd.h>
+#endif
+
 using namespace std;
 
 namespace
@@ -49,6 +63,200 @@ std::string createText(size_t bytes)
     return text;
 }
 
+/// @returns the resident set size of this process in bytes, or 0 if unknown on this platform.
+size_t residentSetSize()
+{
+#if defined(__linux__)
+    auto statm = std::ifstream("/proc/self/statm");
+    auto totalPages = size_t { 0 };
+    auto residentPages = size_t { 0 };
+    if (statm >> totalPages >> residentPages)
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+/// Mimmicks full screen redraws of TUI applications, that mostly consist of
+/// cursor positioning (CUP) and SGR sequences with only a few bytes of text in between.
+class CursorPositioningTest: public contour::termbench::Test
+{
+  public:
+    CursorPositioningTest():
+        contour::termbench::Test("cup_sgr", "Cursor positioning and SGR dense screen redraws")
+    {
+    }
+
+    void setup(size_t columns, size_t lines) override
+    {
+        _frame.clear();
+        for (size_t line = 1; line <= lines; ++line)
+        {
+            for (size_t column = 1; column + 8 <= columns; column += 8)
+            {
+                auto const color = (line * columns + column) % 256;
+                _frame += fmt::format("\033[{};{}H\033[1;38;5;{}m{:>6}\033[m", line, column, color, column);
+            }
+        }
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            buffer.write(_frame);
+    }
+
+  private:
+    std::string _frame;
+};
+
+/// Mimmicks colorized output of compilers, ls, or diffs, that repeat the same handful of SGRs,
+/// mixing indexed and truecolor foreground/background colors, underline styles and colors.
+class SGRMixTest: public contour::termbench::Test
+{
+  public:
+    SGRMixTest(): contour::termbench::Test("sgr_mix", "SGR dense lines of fg/bg/truecolor/underline mixes") {}
+
+    void setup(size_t columns, size_t lines) override
+    {
+        // clang-format off
+        auto constexpr Styles = std::array {
+            "\033[1;31m",                           // error
+            "\033[1;35m",                           // warning
+            "\033[38;5;208;48;5;236m",              // indexed fg/bg
+            "\033[38;2;255;128;0m",                 // truecolor fg
+            "\033[38;2;200;200;200;48;2;30;30;60m", // truecolor fg/bg
+            "\033[4:3;58:2::255:0:0m",              // curly underline with underline color
+            "\033[1;4;58;5;196m",                   // bold underlined with indexed underline color
+            "\033[7;94m",                           // inverse bright blue
+        };
+        // clang-format on
+
+        _frame.clear();
+        for (size_t line = 0; line < lines; ++line)
+        {
+            for (size_t column = 0; column + 8 < columns; column += 8)
+                _frame += fmt::format("{}{:<7}\033[m ", Styles[(line + column / 8) % Styles.size()], column);
+            _frame += "\r\n";
+        }
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            buffer.write(_frame);
+    }
+
+  private:
+    std::string _frame;
+};
+
+/// Mimmicks text colorized column by column, such as by lolcat, scrolling line by line.
+class SGRRainbowTest: public contour::termbench::Test
+{
+  public:
+    SGRRainbowTest():
+        contour::termbench::Test("sgr_rainbow", "Scrolling lines of text with a truecolor per column")
+    {
+    }
+
+    void setup(size_t columns, size_t lines) override
+    {
+        _frame.clear();
+        for (size_t line = 0; line < lines; ++line)
+        {
+            for (size_t column = 0; column + 1 < columns; ++column)
+            {
+                auto const hue = (line + column) * 7 % 256;
+                _frame += fmt::format("\033[38;2;{};{};{}m{}",
+                                      hue,
+                                      255 - hue,
+                                      (hue * 3) % 256,
+                                      static_cast<char>('a' + column % 26));
+            }
+            _frame += "\033[m\r\n";
+        }
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            buffer.write(_frame);
+    }
+
+  private:
+    std::string _frame;
+};
+
+/// Sends large clipboard payloads (OSC 52), 10 MB of base64 encoded data per sequence.
+class ClipboardTest: public contour::termbench::Test
+{
+  public:
+    ClipboardTest(): contour::termbench::Test("osc52", "OSC 52 clipboard sequences with 10 MB payload") {}
+
+    void setup(size_t, size_t) override
+    {
+        auto constexpr PayloadSize = 10 * 1024 * 1024;
+        auto constexpr Alphabet = std::string_view {
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+        };
+
+        _sequence = "\033]52;c;";
+        _sequence.reserve(_sequence.size() + PayloadSize + 1);
+        for (size_t i = 0; i < PayloadSize; ++i)
+            _sequence += Alphabet[i % Alphabet.size()];
+        _sequence += '\a';
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            buffer.write(_sequence);
+    }
+
+  private:
+    std::string _sequence;
+};
+
+/// Sends sixel images (DECSIXEL) of 800x600 pixels, using a few colors per sixel band.
+class SixelTest: public contour::termbench::Test
+{
+  public:
+    SixelTest(): contour::termbench::Test("sixel", "Sixel images of 800x600 pixels") {}
+
+    void setup(size_t, size_t) override
+    {
+        auto constexpr Width = 800;
+        auto constexpr Bands = 600 / 6;
+        auto constexpr ColorCount = 8;
+
+        _image = "\033Pq\"1;1;800;600";
+        for (auto color = 0; color < ColorCount; ++color)
+            _image += fmt::format("#{};2;{};{};{}", color, color * 12, 100 - color * 12, 50);
+
+        for (auto band = 0; band < Bands; ++band)
+        {
+            for (auto color = 0; color < ColorCount; ++color)
+            {
+                _image += fmt::format("#{}", color);
+                for (auto x = 0; x < Width; ++x)
+                    _image += static_cast<char>('?' + ((x + band + color) % 64));
+                _image += '$';
+            }
+            _image += '-';
+        }
+        _image += "\033\\";
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            buffer.write(_image);
+    }
+
+  private:
+    std::string _image;
+};
+
 } // namespace
 
 struct BenchOptions
@@ -57,13 +265,20 @@ struct BenchOptions
     bool manyLines = false;
     bool longLines = false;
     bool sgr = false;
+    bool sgrMix = false;
+    bool sgrRainbow = false;
     bool binary = false;
+    bool cursorPositioning = false;
+    bool clipboard = false;
+    bool sixel = false;
+    bool scalarScanner = false;
 };
 
 template <typename Writer>
 int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
 {
-    if (!(options.binary || options.longLines || options.manyLines || options.sgr))
+    if (!(options.binary || options.longLines || options.manyLines || options.sgr || options.sgrMix
+          || options.sgrRainbow || options.cursorPositioning || options.clipboard || options.sixel))
     {
         cout << "No test cases specified. Defaulting to: cat, long, sgr.\n";
         options.manyLines = true;
@@ -71,7 +286,13 @@ int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
         options.sgr = true;
     }
 
-    auto const titleText = fmt::format("Running benchmark: {} (test size: {} MB)", title, options.testSizeMB);
+    if (options.scalarScanner)
+        terminal::parser::selectGroundScanner(terminal::parser::GroundScannerKind::Scalar);
+
+    auto const titleText = fmt::format("Running benchmark: {} (test size: {} MB, text scanner: {})",
+                                       title,
+                                       options.testSizeMB,
+                                       terminal::parser::groundScannerKind());
 
     cout << titleText << '\n' << string(titleText.size(), '=') << '\n';
 
@@ -95,9 +316,24 @@ int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
         tbp.add(contour::termbench::tests::sgr_fgbg_lines());
     }
 
+    if (options.sgrMix)
+        tbp.add(std::make_unique<SGRMixTest>());
+
+    if (options.sgrRainbow)
+        tbp.add(std::make_unique<SGRRainbowTest>());
+
     if (options.binary)
         tbp.add(contour::termbench::tests::binary());
 
+    if (options.cursorPositioning)
+        tbp.add(std::make_unique<CursorPositioningTest>());
+
+    if (options.clipboard)
+        tbp.add(std::make_unique<ClipboardTest>());
+
+    if (options.sixel)
+        tbp.add(std::make_unique<SixelTest>());
+
     tbp.runAll();
 
     cout << '\n';
@@ -129,6 +365,15 @@ class ContourHeadlessBench: public crispy::App
         link("bench-headless.parser", bind(&ContourHeadlessBench::benchParserOnly, this));
         link("bench-headless.grid", bind(&ContourHeadlessBench::benchGrid, this));
         link("bench-headless.pty", bind(&ContourHeadlessBench::benchPTY));
+        link("bench-headless.dispatch", bind(&ContourHeadlessBench::benchDispatch));
+        link("bench-headless.startup", bind(&ContourHeadlessBench::benchStartup));
+        link("bench-headless.lines", bind(&ContourHeadlessBench::benchLines));
+        link("bench-headless.history", bind(&ContourHeadlessBench::benchHistory, this));
+        link("bench-headless.redraw", bind(&ContourHeadlessBench::benchRedraw));
+        link("bench-headless.cells", bind(&ContourHeadlessBench::benchCells));
+        link("bench-headless.render", bind(&ContourHeadlessBench::benchRender));
+        link("bench-headless.resize", bind(&ContourHeadlessBench::benchResize));
+        link("bench-headless.scroll-region", bind(&ContourHeadlessBench::benchScrollRegion));
         link("bench-headless.meta", bind(&ContourHeadlessBench::showMetaInfo));
 
         char const* logFilterString = getenv("LOG");
@@ -146,7 +391,19 @@ class ContourHeadlessBench: public crispy::App
             CLI::Option { "cat", CLI::Value { false }, "Enable cat-style short-line ASCII stream test." },
             CLI::Option { "long", CLI::Value { false }, "Enable long-line ASCII stream test." },
             CLI::Option { "sgr", CLI::Value { false }, "Enable SGR stream test." },
+            CLI::Option { "sgr-mix",
+                          CLI::Value { false },
+                          "Enable SGR stream test mixing fg/bg/truecolor/underline colors." },
+            CLI::Option { "sgr-rainbow",
+                          CLI::Value { false },
+                          "Enable SGR stream test of scrolling lines with a truecolor per column." },
             CLI::Option { "binary", CLI::Value { false }, "Enable binary stream test." },
+            CLI::Option { "cup", CLI::Value { false }, "Enable cursor positioning and SGR dense stream test." },
+            CLI::Option { "osc52", CLI::Value { false }, "Enable OSC 52 clipboard stream test (10 MB payloads)." },
+            CLI::Option { "sixel", CLI::Value { false }, "Enable Sixel image stream test." },
+            CLI::Option { "scalar-scanner",
+                          CLI::Value { false },
+                          "Use the scalar ground state text scanner instead of the SIMD one." },
         };
 
         return CLI::Command {
@@ -168,6 +425,41 @@ class ContourHeadlessBench: public crispy::App
                 CLI::Command {
                     "pty",
                     "Performs performance tests utilizing the underlying operating system's PTY only." },
+                CLI::Command { "dispatch",
+                               "Performs performance tests of looking up VT sequence function definitions." },
+                CLI::Command { "startup",
+                               "Measures time to first prompt and memory usage of idle terminals." },
+                CLI::Command { "lines",
+                               "Performs performance tests of sequential and random access to grid lines." },
+                CLI::Command {
+                    "history",
+                    "Measures memory per history line and latency of scrolling into history, "
+                    "with plain, packed, and disk-backed history lines.",
+                    CLI::OptionList {
+                        CLI::Option { "lines", CLI::Value { 200'000u }, "Number of history lines.", "COUNT" },
+                        CLI::Option { "stream",
+                                      CLI::Value { 0u },
+                                      "Streams into a disk-backed history for the given number of seconds.",
+                                      "SECONDS" },
+                    } },
+                CLI::Command { "redraw",
+                               "Measures throughput and cell allocations of full-screen redraws, "
+                               "such as by htop or vim." },
+                CLI::Command { "cells",
+                               "Compares the cell types on inserting, deleting and erasing characters, "
+                               "and scrolling within margins." },
+                CLI::Command { "render",
+                               "Measures the time to build the render buffer of a page of syntax highlighted "
+                               "text, with all lines, the cursor line only, or a few lines changed per "
+                               "frame." },
+                CLI::Command { "resize",
+                               "Measures the latency of resizing the window over and over with a large "
+                               "history, the time to reflow the history left unreflowed thereafter, the "
+                               "memory of a plain text history before and after reflowing it, and the "
+                               "speedup of reflowing a million history lines on multiple threads." },
+                CLI::Command { "scroll-region",
+                               "Measures the time to scroll lines within a top/bottom margin of 3..N-2, "
+                               "such as by vim, less or tmux, on pages of growing heights." },
             }
         };
     }
@@ -177,6 +469,7 @@ class ContourHeadlessBench: public crispy::App
         // Show any interesting meta information.
         fmt::print("SimpleCell  : {} bytes\n", sizeof(terminal::SimpleCell));
         fmt::print("CompactCell : {} bytes\n", sizeof(terminal::CompactCell));
+        fmt::print("PodCell     : {} bytes\n", sizeof(terminal::PodCell));
         fmt::print("CellExtra   : {} bytes\n", sizeof(terminal::CellExtra));
         fmt::print("CellFlags   : {} bytes\n", sizeof(terminal::CellFlags));
         fmt::print("Color       : {} bytes\n", sizeof(terminal::Color));
@@ -191,7 +484,13 @@ class ContourHeadlessBench: public crispy::App
         opts.manyLines = parameters().boolean(prefix + "cat");
         opts.longLines = parameters().boolean(prefix + "long");
         opts.sgr = parameters().boolean(prefix + "sgr");
+        opts.sgrMix = parameters().boolean(prefix + "sgr-mix");
+        opts.sgrRainbow = parameters().boolean(prefix + "sgr-rainbow");
         opts.binary = parameters().boolean(prefix + "binary");
+        opts.cursorPositioning = parameters().boolean(prefix + "cup");
+        opts.clipboard = parameters().boolean(prefix + "osc52");
+        opts.sixel = parameters().boolean(prefix + "sixel");
+        opts.scalarScanner = parameters().boolean(prefix + "scalar-scanner");
         return opts;
     }
 
@@ -255,9 +554,9 @@ class ContourHeadlessBench: public crispy::App
             while (!pty.isClosed())
             {
                 auto const readResult = pty.read(*bufferObject, std::chrono::seconds(2), PtyReadSize);
-                if (!readResult)
+                if (!readResult.data)
                     break;
-                auto const dataChunk = get<string_view>(readResult.value());
+                auto const dataChunk = get<string_view>(readResult.data.value());
                 if (dataChunk.empty())
                     break;
                 bytesTransferred += dataChunk.size();
@@ -306,6 +605,646 @@ class ContourHeadlessBench: public crispy::App
         return EXIT_SUCCESS;
     }
 
+    static int benchDispatch()
+    {
+        using std::chrono::steady_clock;
+        using terminal::FunctionCategory;
+        using terminal::FunctionSelector;
+
+        // Roughly mimmicks the sequence mix of TUI applications,
+        // with cursor positioning and SGR being the most frequent ones.
+        // clang-format off
+        auto const mix = std::array {
+            FunctionSelector { FunctionCategory::CSI, 0, 2, 0, 'H' },   // CUP
+            FunctionSelector { FunctionCategory::CSI, 0, 1, 0, 'm' },   // SGR
+            FunctionSelector { FunctionCategory::CSI, 0, 3, 0, 'm' },   // SGR
+            FunctionSelector { FunctionCategory::CSI, 0, 2, 0, 'H' },   // CUP
+            FunctionSelector { FunctionCategory::CSI, 0, 0, 0, 'm' },   // SGR
+            FunctionSelector { FunctionCategory::CSI, 0, 5, 0, 'm' },   // SGR
+            FunctionSelector { FunctionCategory::CSI, 0, 0, 0, 'K' },   // EL
+            FunctionSelector { FunctionCategory::CSI, 0, 1, 0, 'C' },   // CUF
+            FunctionSelector { FunctionCategory::CSI, 0, 2, 0, 'H' },   // CUP
+            FunctionSelector { FunctionCategory::CSI, 0, 1, 0, 'm' },   // SGR
+            FunctionSelector { FunctionCategory::CSI, '?', 1, 0, 'l' }, // DECRM
+            FunctionSelector { FunctionCategory::CSI, '?', 1, 0, 'h' }, // DECSM
+            FunctionSelector { FunctionCategory::CSI, 0, 2, 0, 'r' },   // DECSTBM
+            FunctionSelector { FunctionCategory::CSI, 0, 1, ' ', 'q' }, // DECSCUSR
+            FunctionSelector { FunctionCategory::ESC, 0, 0, 0, 'M' },   // RI
+            FunctionSelector { FunctionCategory::ESC, 0, 0, 0, '7' },   // DECSC
+            FunctionSelector { FunctionCategory::ESC, 0, 0, 0, '8' },   // DECRC
+            FunctionSelector { FunctionCategory::CSI, 0, 1, 0, 'J' },   // ED
+            FunctionSelector { FunctionCategory::OSC, 0, 8, 0, 0 },     // HYPERLINK
+            FunctionSelector { FunctionCategory::OSC, 0, 0, 0, 0 },     // SETTITLE
+        };
+        // clang-format on
+
+        auto constexpr Iterations = size_t { 100'000'000 };
+
+        fmt::print("Running function dispatch benchmark ...\n");
+        auto found = size_t { 0 };
+        auto const startTime = steady_clock::now();
+        for (size_t i = 0; i < Iterations; ++i)
+            found += terminal::select(mix[i % mix.size()]) != nullptr;
+        auto const elapsedTime = steady_clock::now() - startTime;
+
+        auto const nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime);
+        fmt::print("\n");
+        fmt::print("Function dispatch test\n");
+        fmt::print("======================\n\n");
+        fmt::print("Lookups                : {}\n", Iterations);
+        fmt::print("Functions found        : {}\n", found);
+        fmt::print("Test time              : {}.{:03} seconds\n",
+                   nsecs.count() / 1'000'000'000,
+                   (nsecs.count() / 1'000'000) % 1000);
+        fmt::print("Time per lookup        : {:.2f} ns\n",
+                   static_cast<double>(nsecs.count()) / static_cast<double>(Iterations));
+
+        return EXIT_SUCCESS;
+    }
+
+    static int benchStartup()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::LineCount;
+        using terminal::PageSize;
+
+        auto const pageSize = PageSize { LineCount(25), ColumnCount(80) };
+        auto const maxHistoryLineCount = LineCount(100'000);
+        auto constexpr Prompt = "\033[1;32muser@host\033[m:\033[1;34m~\033[m$ "sv;
+
+        fmt::print("Running startup benchmark (history size: {}) ...\n\n", maxHistoryLineCount);
+        fmt::print("{:>6} : {:>24} : {:>16}\n", "tabs", "time to first prompt/tab", "RSS per idle tab");
+        for (auto const tabCount: { 1, 10, 100 })
+        {
+            auto const rssBefore = residentSetSize();
+            auto const startTime = steady_clock::now();
+
+            auto tabs = std::vector<std::unique_ptr<terminal::MockTerm<>>> {};
+            for (int i = 0; i < tabCount; ++i)
+            {
+                tabs.emplace_back(std::make_unique<terminal::MockTerm<>>(pageSize, maxHistoryLineCount));
+                tabs.back()->writeToScreen(Prompt);
+            }
+
+            auto const elapsedTime = steady_clock::now() - startTime;
+            auto const rssAfter = residentSetSize();
+            auto const usecs = std::chrono::duration_cast<std::chrono::microseconds>(elapsedTime);
+            fmt::print("{:>6} : {:>21.3f} ms : {:>16}\n",
+                       tabCount,
+                       static_cast<double>(usecs.count()) / 1000.0 / tabCount,
+                       rssAfter > rssBefore
+                           ? crispy::humanReadableBytes(static_cast<long double>(rssAfter - rssBefore)
+                                                        / tabCount)
+                           : "n/a");
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Measures line access through the segmented grid line storage,
+    /// compared to a ring over a single contiguous vector.
+    static int benchLines()
+    {
+        using terminal::ColumnCount;
+        using terminal::GraphicsAttributes;
+        using terminal::LineFlags;
+        using terminal::TrivialLineBuffer;
+        using Line = terminal::Line<terminal::PrimaryScreenCell>;
+
+        auto constexpr LineCount = size_t { 100'000 };
+        auto constexpr Accesses = size_t { 100'000'000 };
+
+        auto randomOffsets = std::vector<long>(1 << 16);
+        auto rng = std::mt19937 { 42 };
+        auto dist = std::uniform_int_distribution<long> { -static_cast<long>(LineCount),
+                                                          static_cast<long>(LineCount) - 1 };
+        for (auto& offset: randomOffsets)
+            offset = dist(rng);
+
+        auto const measure = [&](string_view name, auto& lines) {
+            using std::chrono::steady_clock;
+            for (size_t i = 0; i < LineCount; ++i)
+                lines.emplace_back(LineFlags::None,
+                                   TrivialLineBuffer { ColumnCount(80), GraphicsAttributes {} });
+            lines.rotate_left(LineCount / 3);
+
+            auto checksum = size_t { 0 };
+            auto startTime = steady_clock::now();
+            for (size_t i = 0; i < Accesses; ++i)
+                checksum += unbox<size_t>(lines[static_cast<long>(i % LineCount)].size());
+            auto const sequential = steady_clock::now() - startTime;
+
+            startTime = steady_clock::now();
+            for (size_t i = 0; i < Accesses; ++i)
+                checksum += unbox<size_t>(lines[randomOffsets[i % randomOffsets.size()]].size());
+            auto const random = steady_clock::now() - startTime;
+
+            auto const nsPerAccess = [&](auto duration) {
+                auto const nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+                return static_cast<double>(nsecs.count()) / Accesses;
+            };
+            fmt::print("{:<12} : {:>10.3f} ns : {:>10.3f} ns  (checksum {})\n",
+                       name,
+                       nsPerAccess(sequential),
+                       nsPerAccess(random),
+                       checksum);
+        };
+
+        fmt::print("Running line access benchmark ({} lines, {} accesses) ...\n\n", LineCount, Accesses);
+        fmt::print("{:<12} : {:>13} : {:>13}\n", "storage", "sequential", "random");
+
+        auto segmented = terminal::Lines<terminal::PrimaryScreenCell> {};
+        measure("segmented", segmented);
+
+        auto contiguous = crispy::ring<Line> {};
+        measure("contiguous", contiguous);
+
+        return EXIT_SUCCESS;
+    }
+
+    int benchHistory()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::InfiniteDiskBacked;
+        using terminal::LineCount;
+        using terminal::LineOffset;
+        using terminal::MaxHistoryLineCount;
+        using terminal::PageSize;
+
+        auto const pageSize = PageSize { LineCount(25), ColumnCount(80) };
+        auto const historyLineCount = static_cast<int>(parameters().uint("bench-headless.history.lines"));
+        auto const streamDuration = std::chrono::seconds(parameters().uint("bench-headless.history.stream"));
+        auto constexpr BatchLineCount = 10'000;
+        auto constexpr PageInCount = 1000;
+
+        auto const nsecs = [](auto duration) {
+            using std::chrono::nanoseconds;
+            return static_cast<double>(std::chrono::duration_cast<nanoseconds>(duration).count());
+        };
+
+        struct Configuration
+        {
+            std::string_view name;
+            MaxHistoryLineCount historyLimit;
+            std::optional<LineCount> coldHistoryDistance;
+        };
+        auto const configurations = std::array {
+            Configuration { "plain", LineCount(historyLineCount), std::nullopt },
+            Configuration { "packed", LineCount(historyLineCount), LineCount(1000) },
+            Configuration { "disk", InfiniteDiskBacked {}, std::nullopt },
+        };
+
+        fmt::print("Running history benchmark ({} lines) ...\n\n", historyLineCount);
+        fmt::print("{:<8} : {:>14} : {:>16} : {:>16}\n",
+                   "history",
+                   "bytes per line",
+                   "write per line",
+                   "page-in");
+
+        for (auto const& configuration: configurations)
+        {
+            auto const rssBefore = residentSetSize();
+            auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(historyLineCount));
+            vt->terminal.setMaxHistoryLineCount(configuration.historyLimit);
+            auto& grid = vt->terminal.primaryScreen().grid();
+            grid.setColdHistoryDistance(configuration.coldHistoryDistance);
+
+            // Colorized output, such as from ls or compiler diagnostics.
+            auto writeTime = steady_clock::duration {};
+            auto text = std::string {};
+            for (int i = 0; i < historyLineCount; i += BatchLineCount)
+            {
+                text.clear();
+                for (int k = i; k < std::min(i + BatchLineCount, historyLineCount); ++k)
+                    text += fmt::format("\033[1;34mdir{0:06}\033[m  \033[32mfile{0:06}.txt\033[m  "
+                                        "some more plain text of line {0}\r\n",
+                                        k);
+                auto const startTime = steady_clock::now();
+                vt->writeToScreen(text);
+                writeTime += steady_clock::now() - startTime;
+            }
+            auto const rssAfter = residentSetSize();
+
+            // Pages in random pages of the history, such as when scrolling back.
+            auto rng = std::mt19937 { 42 };
+            auto dist = std::uniform_int_distribution<int> { *pageSize.lines, *grid.historyLineCount() };
+            auto checksum = size_t { 0 };
+            auto const startTime = steady_clock::now();
+            for (int i = 0; i < PageInCount; ++i)
+            {
+                auto const top = -dist(rng);
+                for (int y = 0; y < *pageSize.lines; ++y)
+                    checksum += grid.lineText(LineOffset(top + y)).size();
+            }
+            auto const pageInTime = steady_clock::now() - startTime;
+
+            auto const bytesPerLine = rssAfter > rssBefore
+                                          ? std::to_string((rssAfter - rssBefore) / historyLineCount)
+                                          : std::string("n/a");
+            fmt::print("{:<8} : {:>14} : {:>13.0f} ns : {:>13.1f} us  (checksum {})\n",
+                       configuration.name,
+                       bytesPerLine,
+                       nsecs(writeTime) / historyLineCount,
+                       nsecs(pageInTime) / 1000.0 / PageInCount,
+                       checksum);
+        }
+
+        if (streamDuration.count() == 0)
+            return EXIT_SUCCESS;
+
+        // Streams short lines into a disk-backed history, such as `yes` does, reporting memory usage.
+        fmt::print("\nStreaming into disk-backed history for {} seconds ...\n\n", streamDuration.count());
+        auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(0));
+        vt->terminal.setMaxHistoryLineCount(InfiniteDiskBacked {});
+        auto const& grid = vt->terminal.primaryScreen().grid();
+
+        auto text = std::string {};
+        for (int i = 0; i < BatchLineCount; ++i)
+            text += "y\r\n";
+
+        auto const startTime = steady_clock::now();
+        auto nextReport = startTime;
+        while (steady_clock::now() - startTime < streamDuration)
+        {
+            vt->writeToScreen(text);
+            if (auto const now = steady_clock::now(); now >= nextReport)
+            {
+                fmt::print("{:>6} s : {:>12} lines : {:>8} KB RSS\n",
+                           std::chrono::duration_cast<std::chrono::seconds>(now - startTime).count(),
+                           *grid.historyLineCount(),
+                           residentSetSize() / 1024);
+                nextReport += std::chrono::seconds(60);
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Redraws the full screen over and over, such as htop or vim do, making lines inflate
+    /// (by overwriting parts of them) and reset (by clearing the screen) in every frame.
+    static int benchRedraw()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::LineCount;
+        using terminal::PageSize;
+
+        auto const pageSize = PageSize { LineCount(50), ColumnCount(200) };
+        auto constexpr FrameCount = 2000;
+
+        auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(1000));
+        auto const& grid = vt->terminal.primaryScreen().grid();
+
+        auto frames = std::array<std::string, 2> {};
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            auto& frame = frames[i];
+            frame += "\033[H\033[2J";
+            for (int y = 1; y <= *pageSize.lines; ++y)
+            {
+                frame += fmt::format(
+                    "\033[{};1H\033[1;3{}m{:>6}\033[m \033[32mprocess-{:<20}\033[m", y, y % 8, y, i);
+                frame += std::string(120, ' ');
+                // Updates a field in the middle of the line, such as a CPU meter.
+                auto const load = static_cast<double>((y * 7 + static_cast<int>(i) * 13) % 1000) / 10.0;
+                frame += fmt::format("\033[{};30H\033[7m{:>5.1f}%\033[m", y, load);
+            }
+        }
+
+        auto const statsBefore = grid.cellArenaStats();
+        auto const startTime = steady_clock::now();
+        for (int i = 0; i < FrameCount; ++i)
+            vt->writeToScreen(frames[static_cast<size_t>(i) % frames.size()]);
+        auto const elapsed = steady_clock::now() - startTime;
+        auto const& statsAfter = grid.cellArenaStats();
+
+        auto const usecs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        fmt::print("Running redraw benchmark ({} frames of {}) ...\n\n", FrameCount, pageSize);
+        auto const perFrame = [](size_t count) {
+            return static_cast<double>(count) / FrameCount;
+        };
+        fmt::print("frames per second          : {:.0f}\n",
+                   FrameCount * 1'000'000.0 / static_cast<double>(usecs));
+        fmt::print("cell allocations per frame : {:.1f}\n",
+                   perFrame(statsAfter.allocations - statsBefore.allocations));
+        fmt::print("heap allocations per frame : {:.3f}\n",
+                   perFrame(statsAfter.heapAllocations - statsBefore.heapAllocations));
+        fmt::print("cell arena slabs           : {}\n", crispy::humanReadableBytes(statsAfter.slabBytes));
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Performs the bulk cell operations of ICH, DCH, ECH and scrolling within margins
+    /// on a page of the given cell type, such as done by editors with split windows.
+    template <typename Cell>
+    static void benchCellType(std::string_view name)
+    {
+        using std::chrono::steady_clock;
+        using namespace terminal;
+
+        auto const pageSize = PageSize { LineCount(50), ColumnCount(200) };
+        auto constexpr Iterations = 200;
+
+        auto grid = Grid<Cell>(pageSize, false, LineCount(0));
+        auto const sgr = GraphicsAttributes { Color::Indexed(2), Color::Indexed(4), DefaultColor() };
+        for (int y = 0; y < *pageSize.lines; ++y)
+            for (int x = 0; x < *pageSize.columns; ++x)
+                grid.useCellAt(LineOffset(y), ColumnOffset(x))
+                    .write(sgr, static_cast<char32_t>(U'a' + (x + y) % 26), 1);
+
+        auto blank = Cell {};
+        blank.write(sgr, U' ', 1);
+
+        auto const measure = [&](auto operation) {
+            auto const startTime = steady_clock::now();
+            for (int i = 0; i < Iterations; ++i)
+                for (int y = 0; y < *pageSize.lines; ++y)
+                    operation(grid.lineAt(LineOffset(y)).inflatedBuffer());
+            auto const nsecs =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - startTime);
+            return static_cast<double>(nsecs.count()) / static_cast<double>(Iterations * *pageSize.lines);
+        };
+
+        auto const insertChars = measure([&](auto& cells) {
+            std::move_backward(cells.begin() + 10, cells.end() - 8, cells.end());
+            std::fill_n(cells.begin() + 10, 8, blank);
+        });
+        auto const deleteChars = measure([&](auto& cells) {
+            std::move(cells.begin() + 18, cells.end(), cells.begin() + 10);
+            std::fill(cells.end() - 8, cells.end(), blank);
+        });
+        auto const eraseChars = measure([&](auto& cells) { std::fill(cells.begin(), cells.end(), blank); });
+
+        auto const margin = Margin { Margin::Vertical { LineOffset(0), LineOffset(*pageSize.lines - 1) },
+                                     Margin::Horizontal { ColumnOffset(0), ColumnOffset(99) } };
+        auto const startTime = steady_clock::now();
+        for (int i = 0; i < Iterations; ++i)
+            grid.scrollUp(LineCount(1), sgr, margin);
+        auto const scrollNsecs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - startTime);
+
+        fmt::print("{:<12} : {:>4} : {:>10.1f} : {:>10.1f} : {:>10.1f} : {:>10.1f}\n",
+                   name,
+                   sizeof(Cell),
+                   insertChars,
+                   deleteChars,
+                   eraseChars,
+                   static_cast<double>(scrollNsecs.count()) / Iterations / 1000.0);
+    }
+
+    static int benchCells()
+    {
+        fmt::print("Running cell type benchmark (200 columns, nanoseconds per line, "
+                   "microseconds per scroll of 50 lines inside a left margin) ...\n\n");
+        fmt::print("{:<12} : {:>4} : {:>10} : {:>10} : {:>10} : {:>10}\n",
+                   "cell type",
+                   "size",
+                   "ICH",
+                   "DCH",
+                   "ECH",
+                   "scroll");
+
+        benchCellType<terminal::CompactCell>("CompactCell");
+        benchCellType<terminal::SimpleCell>("SimpleCell");
+        benchCellType<terminal::PodCell>("PodCell");
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Builds the render buffer of a page of syntax highlighted text over and over,
+    /// such as when scrolling through source code in an editor.
+    static int benchRender()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::LineCount;
+        using terminal::PageSize;
+
+        auto const pageSize = PageSize { LineCount(50), ColumnCount(200) };
+        auto constexpr FrameCount = 2000;
+
+        auto page = std::string { "\033[H\033[2J" };
+        for (int y = 0; y < *pageSize.lines; ++y)
+        {
+            page += fmt::format("\033[{};1H", y + 1);
+            for (int x = 0; x < *pageSize.columns / 10; ++x)
+            {
+                auto const weight = (x + y) % 3 == 0 ? 1 : 22; // bold or normal
+                page += fmt::format("\033[{};3{}m{:<9}\033[m ", weight, (x * 7 + y) % 8, x);
+            }
+        }
+
+        fmt::print("Running render benchmark ({} frames of {}) ...\n\n", FrameCount, pageSize);
+
+        // Measures the render buffer build time only, with the given update applied before each frame.
+        auto const measure = [&](std::string_view title, auto&& update) {
+            auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(0));
+            vt->writeToScreen(page);
+            vt->writeToScreen(fmt::format("\033[{};1H$ ", *pageSize.lines));
+            vt->terminal.refreshRenderBuffer();
+
+            auto elapsed = steady_clock::duration {};
+            for (int i = 0; i < FrameCount; ++i)
+            {
+                update(*vt, i);
+                auto const startTime = steady_clock::now();
+                vt->terminal.refreshRenderBuffer();
+                elapsed += steady_clock::now() - startTime;
+            }
+
+            auto const usecs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            fmt::print("{:<32} : {:>7.1f} us per frame, {:.1f} ns per cell\n",
+                       title,
+                       static_cast<double>(usecs) / FrameCount,
+                       static_cast<double>(usecs) * 1000.0 / FrameCount
+                           / static_cast<double>(pageSize.area()));
+        };
+
+        measure("all lines changed", [&](auto& vt, int) { vt.writeToScreen(page); });
+        measure("shell prompt, blinking cursor", [](auto& vt, int i) {
+            vt.writeToScreen(i % 2 ? "\033[?25h" : "\033[?25l");
+        });
+        measure("top, updating 5 lines", [](auto& vt, int i) {
+            for (int y = 0; y < 5; ++y)
+                vt.writeToScreen(fmt::format("\033[{};1H\033[7m{:>5}%\033[m", y + 3, (i * 7 + y) % 100));
+        });
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Resizes the window step by step, such as when dragging its border, with a large history.
+    static int benchResize()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::LineCount;
+        using terminal::PageSize;
+
+        auto const pageSize = PageSize { LineCount(50), ColumnCount(120) };
+        auto constexpr HistoryLineCount = 100'000;
+        auto constexpr ResizeCount = 50;
+
+        auto const usecs = [](auto duration) {
+            using std::chrono::microseconds;
+            return static_cast<double>(std::chrono::duration_cast<microseconds>(duration).count());
+        };
+
+        // Output of varying line lengths, some of these wrapping.
+        auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(HistoryLineCount));
+        auto text = std::string {};
+        for (int i = 0; i < HistoryLineCount; ++i)
+        {
+            auto const tail = std::string(static_cast<size_t>(i % 150), 'x');
+            text += fmt::format("\033[32m{:06}\033[m {}\r\n", i, tail);
+        }
+        vt->writeToScreen(text);
+        auto& grid = vt->terminal.primaryScreen().grid();
+
+        fmt::print("Running resize benchmark ({} resizes of {} with {} history lines) ...\n\n",
+                   ResizeCount,
+                   pageSize,
+                   grid.historyLineCount());
+
+        auto latencies = std::vector<steady_clock::duration> {};
+        for (int i = 0; i < ResizeCount; ++i)
+        {
+            auto const columns = pageSize.columns - ColumnCount(i);
+            auto const startTime = steady_clock::now();
+            vt->terminal.resizeScreen(PageSize { pageSize.lines, columns });
+            latencies.emplace_back(steady_clock::now() - startTime);
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        auto const startTime = steady_clock::now();
+        auto const unreflowedLineCount = grid.unreflowedHistoryLineCount();
+        grid.reflowAllHistory();
+        auto const reflowTime = steady_clock::now() - startTime;
+
+        fmt::print("resize latency p50    : {:>10.1f} us\n", usecs(latencies[latencies.size() / 2]));
+        fmt::print("resize latency p99    : {:>10.1f} us\n", usecs(latencies[latencies.size() * 99 / 100]));
+        fmt::print("reflow of {:>7} lines: {:>10.1f} us ({} history lines thereafter)\n",
+                   *unreflowedLineCount,
+                   usecs(reflowTime),
+                   grid.historyLineCount());
+
+        // Memory of a history of plain text before and after reflowing it, which keeps its lines trivial.
+        auto const rssBefore = residentSetSize();
+        auto plainVT = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(HistoryLineCount));
+        auto plainText = std::string {};
+        for (int i = 0; i < HistoryLineCount; ++i)
+            plainText += fmt::format("{:06} {}\r\n", i, std::string(static_cast<size_t>(i % 150), 'x'));
+        plainVT->writeToScreen(plainText);
+        auto const rssWritten = residentSetSize();
+        plainVT->terminal.resizeScreen(PageSize { pageSize.lines, pageSize.columns - ColumnCount(37) });
+        auto& plainGrid = plainVT->terminal.primaryScreen().grid();
+        plainGrid.reflowAllHistory();
+        auto const rssResized = residentSetSize();
+
+        auto inflatedLineCount = 0;
+        for (int y = -*plainGrid.historyLineCount(); y < *pageSize.lines; ++y)
+            if (plainGrid.lineAt(terminal::LineOffset(y)).isInflatedBuffer())
+                ++inflatedLineCount;
+
+        auto const bytesPerLine = [&](size_t rss) {
+            if (rss <= rssBefore)
+                return std::string("n/a");
+            return std::to_string((rss - rssBefore) / HistoryLineCount);
+        };
+        fmt::print("\nbytes per plain text line: {} before resize, {} after ({} of {} lines inflated)\n",
+                   bytesPerLine(rssWritten),
+                   bytesPerLine(rssResized),
+                   inflatedLineCount,
+                   plainGrid.historyLineCount() + pageSize.lines);
+        plainVT.reset();
+
+        // Reflowing a million history lines at once, on one thread and on many.
+        auto constexpr LargeHistoryLineCount = 1'000'000;
+        auto largeText = std::string {};
+        for (int i = 0; i < LargeHistoryLineCount; ++i)
+        {
+            auto const tail = std::string(static_cast<size_t>(i % 150), 'x');
+            largeText += fmt::format("\033[32m{:07}\033[m {}\r\n", i, tail);
+        }
+        fmt::print("\n");
+        auto singleThreadedTime = steady_clock::duration {};
+        for (auto const threadCount: { 1u, 4u, 16u })
+        {
+            auto largeVT = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(LargeHistoryLineCount));
+            largeVT->writeToScreen(largeText);
+            largeVT->terminal.resizeScreen(PageSize { pageSize.lines, pageSize.columns - ColumnCount(17) });
+            auto& largeGrid = largeVT->terminal.primaryScreen().grid();
+            auto const largeUnreflowedLineCount = largeGrid.unreflowedHistoryLineCount();
+
+            auto const reflowStartTime = steady_clock::now();
+            largeGrid.reflowAllHistory(threadCount);
+            auto const largeReflowTime = steady_clock::now() - reflowStartTime;
+            if (threadCount == 1)
+                singleThreadedTime = largeReflowTime;
+
+            fmt::print("reflow of {} lines on {:>2} threads: {:>10.1f} us (speedup {:.2f}x)\n",
+                       largeUnreflowedLineCount,
+                       threadCount,
+                       usecs(largeReflowTime),
+                       usecs(singleThreadedTime) / usecs(largeReflowTime));
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /// Floods lines into a scrolling region leaving two lines above and below it, such as vim's
+    /// tab and status lines, on the alternate and primary screen, and with a left/right margin.
+    static int benchScrollRegion()
+    {
+        using std::chrono::steady_clock;
+        using terminal::ColumnCount;
+        using terminal::LineCount;
+        using terminal::PageSize;
+
+        auto constexpr LineCountPerRun = 200'000;
+        auto constexpr Columns = 120;
+
+        auto const measure = [](int height, string_view setup) {
+            auto const pageSize = PageSize { LineCount(height), ColumnCount(Columns) };
+            auto vt = std::make_unique<terminal::MockTerm<>>(pageSize, LineCount(10'000));
+
+            // Fills the primary screen's history, such that its ring buffer holds more than the page.
+            auto text = std::string {};
+            for (int i = 0; i < 10'000; ++i)
+                text += fmt::format("history line {}\r\n", i);
+            text += setup;
+            text += fmt::format("\033[3;{}r\033[{};1H", height - 2, height - 2);
+            vt->writeToScreen(text);
+
+            text.clear();
+            for (int i = 0; i < LineCountPerRun; ++i)
+                text += fmt::format("\033[32m{:06}\033[m scrolled line\r\n", i);
+
+            auto const startTime = steady_clock::now();
+            vt->writeToScreen(text);
+            auto const nsecs =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - startTime);
+            return static_cast<double>(nsecs.count()) / LineCountPerRun;
+        };
+
+        fmt::print("Running scroll region benchmark ({} lines into a margin of 3..N-2, {} columns, "
+                   "nanoseconds per line) ...\n\n",
+                   LineCountPerRun,
+                   Columns);
+        fmt::print("{:>6} : {:>12} : {:>12} : {:>12}\n", "lines", "alternate", "primary", "left/right");
+        for (auto const height: { 25, 100, 400, 1600 })
+        {
+            fmt::print("{:>6} : {:>12.1f} : {:>12.1f} : {:>12.1f}\n",
+                       height,
+                       measure(height, "\033[?1049h"),
+                       measure(height, ""),
+                       measure(height, fmt::format("\033[?1049h\033[?69h\033[5;{}s", Columns - 4)));
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     int benchParserOnly()
     {
         auto po = terminal::NullParserEvents {};
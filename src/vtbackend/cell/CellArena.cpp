@@ -0,0 +1,120 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/cell/CellArena.h>
+
+#include <crispy/assert.h>
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+namespace terminal
+{
+
+CellArena::~CellArena()
+{
+    for (auto const& [size, sizeClass]: _sizeClasses)
+        for (auto const& [data, slab]: sizeClass.slabs)
+            ::operator delete(data);
+}
+
+void* CellArena::allocate(size_t size)
+{
+    ++_stats.allocations;
+
+    if (size == 0 || size > MaxSlabLineSize)
+    {
+        ++_stats.heapAllocations;
+        return ::operator new(size);
+    }
+
+    auto& sizeClass = _sizeClasses[size];
+    if (sizeClass.available.empty())
+    {
+        auto const lineCount = sizeClass.nextSlabLineCount;
+        sizeClass.nextSlabLineCount = std::min(2 * lineCount, MaxSlabLineCount);
+
+        auto* const data = static_cast<std::byte*>(::operator new(lineCount * size));
+        sizeClass.slabs.emplace(data, Slab { lineCount });
+        sizeClass.available.push_back(data);
+        // Such that deallocate() never needs to allocate.
+        sizeClass.available.reserve(sizeClass.slabs.size());
+        ++_stats.heapAllocations;
+        _stats.slabBytes += lineCount * size;
+    }
+
+    // Hand out the first line not in use, such that lines allocated in sequence are adjacent.
+    auto* const data = sizeClass.available.back();
+    auto& slab = sizeClass.slabs.at(data);
+    auto const index = static_cast<size_t>(std::countr_one(slab.used));
+    slab.used |= uint64_t { 1 } << index;
+    if (slab.full())
+        sizeClass.available.pop_back();
+
+    return data + index * size;
+}
+
+void CellArena::deallocate(void* data, size_t size) noexcept
+{
+    if (size == 0 || size > MaxSlabLineSize)
+    {
+        ::operator delete(data);
+        return;
+    }
+
+    auto const sizeClass = _sizeClasses.find(size);
+    Require(sizeClass != _sizeClasses.end());
+
+    // The slab holding the line is the last one starting at or before it.
+    auto* const line = static_cast<std::byte*>(data);
+    auto slab = sizeClass->second.slabs.upper_bound(line);
+    Require(slab != sizeClass->second.slabs.begin());
+    --slab;
+
+    auto const index = static_cast<size_t>(line - slab->first) / size;
+    Require(index < slab->second.lineCount);
+
+    if (slab->second.full())
+        sizeClass->second.available.push_back(slab->first);
+    slab->second.used &= ~(uint64_t { 1 } << index);
+}
+
+void CellArena::releaseUnusedSlabs() noexcept
+{
+    for (auto i = _sizeClasses.begin(); i != _sizeClasses.end();)
+    {
+        auto& [size, sizeClass] = *i;
+        for (auto slab = sizeClass.slabs.begin(); slab != sizeClass.slabs.end();)
+        {
+            if (slab->second.used != 0)
+            {
+                ++slab;
+                continue;
+            }
+
+            _stats.slabBytes -= slab->second.lineCount * size;
+            sizeClass.available.erase(
+                std::find(sizeClass.available.begin(), sizeClass.available.end(), slab->first));
+            ::operator delete(slab->first);
+            slab = sizeClass.slabs.erase(slab);
+        }
+
+        if (sizeClass.slabs.empty())
+            i = _sizeClasses.erase(i);
+        else
+            ++i;
+    }
+}
+
+} // namespace terminal
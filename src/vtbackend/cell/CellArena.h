@@ -0,0 +1,156 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal
+{
+
+/**
+ * Allocates the cells of inflated lines, owned by the grid holding these lines.
+ *
+ * Full-screen applications redrawing the screen over and over make its lines inflate and
+ * reset to trivial lines over and over. Rather than allocating and freeing the cells of each
+ * line on the heap every time, freed cells are kept to be reused by the next line inflating
+ * with the same number of columns.
+ *
+ * Cells are carved out of slabs holding the cells of several lines of the same size, such that
+ * the cells of lines inflated one after another (such as the lines of a redrawn page) are laid out
+ * next to each other. The slabs of each size grow geometrically, up to MaxSlabLineCount lines each.
+ *
+ * An arena is used by the thread owning its grid only. Lines reflowed on other threads allocate
+ * their cells from the heap instead (see Grid::reflowAllHistory()).
+ */
+class CellArena
+{
+  public:
+    /// Maximum number of lines' cells per slab.
+    static constexpr size_t MaxSlabLineCount = 64;
+
+    /// Lines larger than this many bytes are allocated on the heap rather than from slabs.
+    static constexpr size_t MaxSlabLineSize = 64 * 1024;
+
+    struct Stats
+    {
+        /// Number of allocations served.
+        size_t allocations = 0;
+
+        /// Number of allocations served by the heap, that is, of slabs and of lines too large for slabs.
+        size_t heapAllocations = 0;
+
+        /// Number of bytes of all slabs.
+        size_t slabBytes = 0;
+    };
+
+    CellArena() = default;
+    CellArena(CellArena const&) = delete;
+    CellArena(CellArena&&) = delete;
+    CellArena& operator=(CellArena const&) = delete;
+    CellArena& operator=(CellArena&&) = delete;
+    ~CellArena();
+
+    [[nodiscard]] void* allocate(size_t size);
+    void deallocate(void* data, size_t size) noexcept;
+
+    /// Frees all slabs none of whose cells are in use, such as after resizing the grid.
+    void releaseUnusedSlabs() noexcept;
+
+    [[nodiscard]] Stats const& stats() const noexcept { return _stats; }
+
+  private:
+    struct Slab
+    {
+        size_t lineCount = 0;
+        uint64_t used = 0; // bit mask of the lines in use
+
+        [[nodiscard]] bool full() const noexcept
+        {
+            return lineCount == 64 ? used == ~uint64_t { 0 } : used == (uint64_t { 1 } << lineCount) - 1;
+        }
+    };
+
+    /// Slabs holding lines of the same size.
+    struct SizeClass
+    {
+        std::map<std::byte*, Slab> slabs;  // by address, to find the slab of freed lines
+        std::vector<std::byte*> available; // slabs with lines not in use
+        size_t nextSlabLineCount = 1;
+    };
+
+    std::unordered_map<size_t, SizeClass> _sizeClasses;
+    Stats _stats;
+};
+
+/// Allocator of the cells of an InflatedLineBuffer, using the given arena, or the heap if none is given.
+///
+/// Copies of the cells are allocated from the same arena, which therefore has to outlive them.
+template <typename T>
+class CellAllocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    CellAllocator() noexcept = default;
+    explicit CellAllocator(CellArena* arena) noexcept: _arena { arena } {}
+
+    template <typename U>
+    CellAllocator(CellAllocator<U> const& other) noexcept: _arena { other.arena() }
+    {
+    }
+
+    [[nodiscard]] CellArena* arena() const noexcept { return _arena; }
+
+    [[nodiscard]] T* allocate(size_t count)
+    {
+        if (!_arena)
+            return std::allocator<T> {}.allocate(count);
+        return static_cast<T*>(_arena->allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* data, size_t count) noexcept
+    {
+        if (!_arena)
+            std::allocator<T> {}.deallocate(data, count);
+        else
+            _arena->deallocate(data, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(CellAllocator<U> const& other) const noexcept
+    {
+        return _arena == other.arena();
+    }
+
+    template <typename U>
+    bool operator!=(CellAllocator<U> const& other) const noexcept
+    {
+        return _arena != other.arena();
+    }
+
+  private:
+    CellArena* _arena = nullptr;
+};
+
+} // namespace terminal
@@ -14,11 +14,15 @@
 #pragma once
 
 #include <vtbackend/cell/CompactCell.h>
+#include <vtbackend/cell/PodCell.h>
 #include <vtbackend/cell/SimpleCell.h>
 
 namespace terminal
 {
 
+// Each of CompactCell, SimpleCell and PodCell can be used for either screen.
+// See `bench-headless cells` for how they compare.
+
 /// Type of cell to be used with the primary screen.
 using PrimaryScreenCell = CompactCell;
 
@@ -72,8 +72,7 @@ struct CellExtra
 
 /// Grid cell with character and graphics rendition information.
 ///
-/// TODO(perf): ensure POD'ness so that we can SIMD-copy it.
-/// - Requires moving out CellExtra into Line<T>?
+/// @see PodCell for a trivially copyable cell, moving its extra data out into a side table.
 class CRISPY_PACKED CompactCell
 {
   public:
@@ -203,6 +202,8 @@ inline CompactCell& CompactCell::operator=(CompactCell const& v) noexcept
     _backgroundColor = v._backgroundColor;
     if (v._extra)
         createExtra(*v._extra);
+    else
+        _extra.reset();
     return *this;
 }
 // }}}
@@ -0,0 +1,315 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtbackend/cell/PodCell.h>
+
+#include <crispy/logstore.h>
+
+#include <unicode/convert.h>
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <utility>
+
+namespace terminal
+{
+
+namespace
+{
+    // Image fragments are created anew for every cell, so they are compared by what they show.
+    bool sameImageFragment(ImageFragment const* a, ImageFragment const* b) noexcept
+    {
+        if (!a || !b)
+            return a == b;
+        return &a->rasterizedImage() == &b->rasterizedImage() && a->offset() == b->offset();
+    }
+
+    void hashCombine(size_t& hash, size_t value) noexcept
+    {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    void hashAttributes(size_t& hash, GraphicsAttributes const& attributes) noexcept
+    {
+        hashCombine(hash, attributes.foregroundColor.content);
+        hashCombine(hash, attributes.backgroundColor.content);
+        hashCombine(hash, attributes.underlineColor.content);
+        hashCombine(hash, static_cast<size_t>(attributes.flags));
+    }
+} // namespace
+
+bool operator==(PodCellExtra const& a, PodCellExtra const& b) noexcept
+{
+    return a.codepoints == b.codepoints && a.attributes == b.attributes && a.hyperlink == b.hyperlink
+           && sameImageFragment(a.imageFragment.get(), b.imageFragment.get());
+}
+
+size_t PodCellExtras::Hash::operator()(PodCellExtra const* extra) const noexcept
+{
+    auto hash = std::hash<std::u32string_view> {}(extra->codepoints);
+    if (extra->attributes)
+        hashAttributes(hash, *extra->attributes);
+    hashCombine(hash, extra->hyperlink.value);
+    if (auto const* fragment = extra->imageFragment.get())
+    {
+        hashCombine(hash, std::hash<void const*> {}(&fragment->rasterizedImage()));
+        hashCombine(hash,
+                    static_cast<size_t>(*fragment->offset().line) << 32
+                        | static_cast<uint32_t>(*fragment->offset().column));
+    }
+    return hash;
+}
+
+PodCellExtras& PodCellExtras::get()
+{
+    static PodCellExtras extras;
+    return extras;
+}
+
+PodCellExtras::~PodCellExtras()
+{
+    for (auto& chunk: _chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+uint32_t PodCellExtras::intern(PodCellExtra extra)
+{
+    if (extra.empty())
+        return NoIndex;
+
+    auto const _ = std::lock_guard { _mutex };
+
+    auto const index = [&]() -> uint32_t {
+        if (auto const i = _indices.find(&extra); i != _indices.end())
+            return i->second;
+
+        auto index = uint32_t { NoIndex };
+        if (!_freeIndices.empty())
+        {
+            index = _freeIndices.back();
+            _freeIndices.pop_back();
+        }
+        else if (auto const size = _size.load(std::memory_order_relaxed); size < ChunkSize * ChunkCount)
+        {
+            auto& chunk = _chunks[size / ChunkSize];
+            if (!chunk.load(std::memory_order_relaxed))
+                chunk.store(new PodCellExtra[ChunkSize], std::memory_order_release);
+            index = static_cast<uint32_t>(size);
+            _size.store(size + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            if (!std::exchange(_reportedFull, true))
+                errorlog()("Extra cell data of all {} cells in use. Dropping further extra cell data.",
+                           ChunkSize * ChunkCount - 1);
+            _collectionRequested.store(true, std::memory_order_relaxed);
+            return NoIndex;
+        }
+
+        auto* entry = &_chunks[index / ChunkSize].load(std::memory_order_relaxed)[index % ChunkSize];
+        *entry = std::move(extra);
+        _indices.emplace(entry, index);
+        if (_liveCount.fetch_add(1, std::memory_order_relaxed) + 1 >= _collectionThreshold)
+            _collectionRequested.store(true, std::memory_order_relaxed);
+        return index;
+    }();
+
+    // Cells written while collecting may not have been seen by the roots' mark functions.
+    if (_collecting && index != NoIndex)
+    {
+        if (index >= _internedWhileCollecting.size())
+            _internedWhileCollecting.resize(index + 1);
+        _internedWhileCollecting[index] = true;
+    }
+
+    return index;
+}
+
+void PodCellExtras::addRoot(void const* root, MarkFunction mark)
+{
+    auto const _ = std::lock_guard { _rootsMutex };
+    _roots.emplace_back(root, std::move(mark));
+}
+
+void PodCellExtras::removeRoot(void const* root)
+{
+    auto const _ = std::lock_guard { _rootsMutex };
+    _roots.erase(std::remove_if(_roots.begin(), _roots.end(), [root](auto const& r) { return r.first == root; }),
+                 _roots.end());
+}
+
+void PodCellExtras::collect()
+{
+    auto const rootsLock = std::lock_guard { _rootsMutex };
+
+    // Graphics attributes interned from now on are kept, before ids remembered from before get dropped.
+    auto& attributes = PodCellAttributes::get();
+    attributes.beginCollection();
+
+    auto marker = Marker {};
+    marker._markedAttributes.assign(PodCellAttributes::ExtraId, false);
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _collectionRequested.store(false, std::memory_order_relaxed);
+        _collectionCount.fetch_add(1, std::memory_order_release);
+        _collecting = true;
+        _internedWhileCollecting.assign(_size.load(std::memory_order_relaxed), false);
+        marker._marked.assign(_size.load(std::memory_order_relaxed), false);
+    }
+
+    for (auto const& [root, mark]: _roots)
+        mark(marker);
+
+    attributes.sweep(marker._markedAttributes);
+
+    auto const _ = std::lock_guard { _mutex };
+    for (auto index = uint32_t { 1 }; index < marker._marked.size(); ++index)
+    {
+        auto& entry = _chunks[index / ChunkSize].load(std::memory_order_relaxed)[index % ChunkSize];
+        if (marker._marked[index] || _internedWhileCollecting[index] || entry.empty())
+            continue;
+        _indices.erase(&entry);
+        entry = PodCellExtra {};
+        _freeIndices.push_back(index);
+        _liveCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+    _collecting = false;
+    _internedWhileCollecting = {};
+    _collectionThreshold = std::max(MinCollectionThreshold, 2 * _liveCount.load(std::memory_order_relaxed));
+    _reportedFull = false;
+}
+
+PodCellAttributes& PodCellAttributes::get()
+{
+    static PodCellAttributes attributes;
+    return attributes;
+}
+
+PodCellAttributes::PodCellAttributes()
+{
+    _chunks[0].store(new GraphicsAttributes[ChunkSize], std::memory_order_release);
+}
+
+PodCellAttributes::~PodCellAttributes()
+{
+    for (auto& chunk: _chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+size_t PodCellAttributes::Hash::operator()(GraphicsAttributes const* attributes) const noexcept
+{
+    auto hash = size_t { 0 };
+    hashAttributes(hash, *attributes);
+    return hash;
+}
+
+std::optional<uint16_t> PodCellAttributes::internSlow(GraphicsAttributes const& attributes)
+{
+    auto const _ = std::lock_guard { _mutex };
+
+    auto const id = [&]() -> std::optional<uint16_t> {
+        if (auto const i = _ids.find(&attributes); i != _ids.end())
+            return i->second;
+
+        auto id = uint16_t { DefaultId };
+        if (!_freeIds.empty())
+        {
+            id = _freeIds.back();
+            _freeIds.pop_back();
+        }
+        else if (_size < ExtraId)
+        {
+            auto& chunk = _chunks[_size / ChunkSize];
+            if (!chunk.load(std::memory_order_relaxed))
+                chunk.store(new GraphicsAttributes[ChunkSize], std::memory_order_release);
+            id = static_cast<uint16_t>(_size++);
+        }
+        else
+        {
+            // Cells keep their graphics attributes in their extra data until the table is collected.
+            PodCellExtras::get().requestCollection();
+            return std::nullopt;
+        }
+
+        auto* entry = &_chunks[id / ChunkSize].load(std::memory_order_relaxed)[id % ChunkSize];
+        *entry = attributes;
+        _ids.emplace(entry, id);
+        if (_liveCount.fetch_add(1, std::memory_order_relaxed) + 1 >= _collectionThreshold)
+            PodCellExtras::get().requestCollection();
+        return id;
+    }();
+
+    if (_collecting && id)
+    {
+        if (*id >= _internedWhileCollecting.size())
+            _internedWhileCollecting.resize(*id + 1);
+        _internedWhileCollecting[*id] = true;
+    }
+
+    return id;
+}
+
+void PodCellAttributes::beginCollection()
+{
+    auto const _ = std::lock_guard { _mutex };
+    _collecting = true;
+    _internedWhileCollecting.assign(_size, false);
+}
+
+void PodCellAttributes::sweep(std::vector<bool> const& marked)
+{
+    auto const _ = std::lock_guard { _mutex };
+    for (auto id = uint16_t { 1 }; id < _size; ++id)
+    {
+        if (marked[id] || (id < _internedWhileCollecting.size() && _internedWhileCollecting[id]))
+            continue;
+        auto& entry = _chunks[id / ChunkSize].load(std::memory_order_relaxed)[id % ChunkSize];
+        if (auto const i = _ids.find(&entry); i != _ids.end() && i->second == id)
+        {
+            _ids.erase(i);
+            _freeIds.push_back(id);
+            _liveCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    _collecting = false;
+    _internedWhileCollecting = {};
+    _collectionThreshold =
+        std::clamp(2 * _liveCount.load(std::memory_order_relaxed), MinCollectionThreshold, size_t { ExtraId });
+}
+
+std::u32string PodCell::codepoints() const
+{
+    std::u32string s;
+    if (auto const ch = codepoint(0))
+    {
+        s += ch;
+        s += extra().codepoints;
+    }
+    return s;
+}
+
+std::string PodCell::toUtf8() const
+{
+    auto const ch = codepoint(0);
+    if (!ch)
+        return {};
+
+    std::string text;
+    text += unicode::convert_to<char>(ch);
+    for (char32_t const cp: extra().codepoints)
+        text += unicode::convert_to<char>(cp);
+    return text;
+}
+
+} // namespace terminal
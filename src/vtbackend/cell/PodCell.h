@@ -0,0 +1,694 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2022 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <vtbackend/CellFlags.h>
+#include <vtbackend/CellUtil.h>
+#include <vtbackend/Color.h>
+#include <vtbackend/GraphicsAttributes.h>
+#include <vtbackend/Hyperlink.h>
+#include <vtbackend/Image.h>
+#include <vtbackend/primitives.h>
+
+#include <crispy/times.h>
+
+#include <unicode/width.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal
+{
+
+/// Rarely needed extra cell data of a PodCell.
+///
+/// @see PodCellExtras
+struct PodCellExtra
+{
+    /// All codepoints of the cell's grapheme cluster but the first one.
+    std::u32string codepoints = {};
+
+    /// The cell's graphics attributes, if they did not fit into PodCellAttributes.
+    std::optional<GraphicsAttributes> attributes = std::nullopt;
+
+    /// With OSC-8 a hyperlink can be associated with a range of terminal cells.
+    HyperlinkId hyperlink = {};
+
+    /// Holds a reference to an image tile to be rendered (above the text, if any).
+    std::shared_ptr<ImageFragment> imageFragment = nullptr;
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return codepoints.empty() && !attributes && !hyperlink && !imageFragment;
+    }
+};
+
+bool operator==(PodCellExtra const& a, PodCellExtra const& b) noexcept;
+
+/**
+ * Process-wide side table of the extra data of all PodCell instances.
+ *
+ * Since a PodCell must remain trivially copyable, it cannot own its extra data,
+ * but refers to an immutable entry in this table by index instead.
+ * Entries are deduplicated, such that cells with equal extra data (such as all cells of a hyperlink,
+ * or all cells having the same underline color) share the same entry.
+ *
+ * As copies of the cells are not tracked, entries are reclaimed by marking and sweeping:
+ * the owners of cells (such as a terminal with its grids) register as roots, and collect()
+ * releases all entries not referred to by the cells of any root, along with the images they hold.
+ * Collecting is requested once the number of entries has doubled since the last collection.
+ */
+class PodCellExtras
+{
+  public:
+    /// Number of bits of a PodCell used for the index into this table.
+    static constexpr unsigned IndexBits = 23;
+
+    /// Index of no extra data.
+    static constexpr uint32_t NoIndex = 0;
+
+    /// Collects the indices of the entries (and ids of the graphics attributes) referred to
+    /// by the cells of all roots.
+    class Marker
+    {
+      public:
+        void mark(uint32_t index) noexcept
+        {
+            if (index < _marked.size())
+                _marked[index] = true;
+        }
+
+        void markAttributes(uint16_t id) noexcept
+        {
+            if (id < _markedAttributes.size())
+                _markedAttributes[id] = true;
+        }
+
+      private:
+        friend class PodCellExtras;
+        std::vector<bool> _marked;
+        std::vector<bool> _markedAttributes;
+    };
+
+    /// Marks the entries referred to by all cells of a root, while holding whatever lock guards these cells.
+    using MarkFunction = std::function<void(Marker&)>;
+
+    [[nodiscard]] static PodCellExtras& get();
+
+    PodCellExtras(PodCellExtras const&) = delete;
+    PodCellExtras(PodCellExtras&&) = delete;
+    PodCellExtras& operator=(PodCellExtras const&) = delete;
+    PodCellExtras& operator=(PodCellExtras&&) = delete;
+    ~PodCellExtras();
+
+    /// @returns the entry at the given index, which must not be NoIndex.
+    [[nodiscard]] PodCellExtra const& at(uint32_t index) const noexcept
+    {
+        return _chunks[index / ChunkSize].load(std::memory_order_acquire)[index % ChunkSize];
+    }
+
+    /// @returns index of the entry equal to @p extra, adding it if not present yet,
+    ///          or NoIndex if @p extra is empty, or the table is full (which is logged as an error).
+    [[nodiscard]] uint32_t intern(PodCellExtra extra);
+
+    /// @returns number of entries in use.
+    [[nodiscard]] size_t size() const noexcept { return _liveCount.load(std::memory_order_relaxed); }
+
+    /// Registers @p root, whose cells are marked by @p mark when collecting, until removeRoot() is called.
+    void addRoot(void const* root, MarkFunction mark);
+    void removeRoot(void const* root);
+
+    /// @returns whether enough entries have been added since the last collection to collect again.
+    [[nodiscard]] bool collectionRequested() const noexcept
+    {
+        return _collectionRequested.load(std::memory_order_relaxed);
+    }
+
+    /// Releases all entries not referred to by the cells of any root, making their indices available again,
+    /// and likewise for PodCellAttributes.
+    ///
+    /// Cells must not be kept outside of all roots across a collection, except when inflated again
+    /// after collectionCount() has changed.
+    /// Must not be called while holding any lock acquired by the roots' mark functions.
+    void collect();
+
+    void collectIfRequested()
+    {
+        if (collectionRequested())
+            collect();
+    }
+
+    void requestCollection() noexcept { _collectionRequested.store(true, std::memory_order_relaxed); }
+
+    /// @returns number of collections started so far.
+    [[nodiscard]] uint64_t collectionCount() const noexcept
+    {
+        return _collectionCount.load(std::memory_order_acquire);
+    }
+
+  private:
+    static constexpr size_t ChunkSize = 4096;
+    static constexpr size_t ChunkCount = (size_t { 1 } << IndexBits) / ChunkSize;
+
+    /// Minimum number of entries in use to request a collection.
+    static constexpr size_t MinCollectionThreshold = 65536;
+
+    struct Hash
+    {
+        size_t operator()(PodCellExtra const* extra) const noexcept;
+    };
+
+    struct Equal
+    {
+        bool operator()(PodCellExtra const* a, PodCellExtra const* b) const noexcept { return *a == *b; }
+    };
+
+    PodCellExtras() = default;
+
+    std::mutex _mutex;
+    std::array<std::atomic<PodCellExtra*>, ChunkCount> _chunks {};
+    std::atomic<size_t> _size = 1; // Index 0 is NoIndex.
+    std::atomic<size_t> _liveCount = 0;
+    std::unordered_map<PodCellExtra const*, uint32_t, Hash, Equal> _indices;
+    std::vector<uint32_t> _freeIndices;
+    size_t _collectionThreshold = MinCollectionThreshold;
+    bool _reportedFull = false;
+
+    // Entries interned while collecting, which are in use regardless of the roots' marks.
+    bool _collecting = false;
+    std::vector<bool> _internedWhileCollecting;
+
+    std::atomic<bool> _collectionRequested = false;
+    std::atomic<uint64_t> _collectionCount = 0;
+
+    // Guards the roots, and serializes collections.
+    std::mutex _rootsMutex;
+    std::vector<std::pair<void const*, MarkFunction>> _roots;
+};
+
+/**
+ * Process-wide table of the graphics attributes of all PodCell instances, each one having a 16-bit id.
+ *
+ * A screen mostly uses a few dozen distinct graphics attributes, so rather than keeping colors and flags
+ * inline, a cell refers to an immutable entry in this table by id, and colors can be resolved once per id.
+ * Entries are reclaimed along with the ones of PodCellExtras.
+ * Graphics attributes not fitting into the full table are kept in the cell's PodCellExtra instead.
+ */
+class PodCellAttributes
+{
+  public:
+    /// Number of bits of a PodCell used for the id into this table.
+    static constexpr unsigned IdBits = 16;
+
+    /// Id of the default graphics attributes.
+    static constexpr uint16_t DefaultId = 0;
+
+    /// Id of graphics attributes kept in the cell's PodCellExtra.
+    static constexpr uint16_t ExtraId = (1 << IdBits) - 1;
+
+    [[nodiscard]] static PodCellAttributes& get();
+
+    PodCellAttributes(PodCellAttributes const&) = delete;
+    PodCellAttributes(PodCellAttributes&&) = delete;
+    PodCellAttributes& operator=(PodCellAttributes const&) = delete;
+    PodCellAttributes& operator=(PodCellAttributes&&) = delete;
+    ~PodCellAttributes();
+
+    /// @returns the entry with the given id, which must not be ExtraId.
+    [[nodiscard]] GraphicsAttributes const& at(uint16_t id) const noexcept
+    {
+        return _chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+    }
+
+    /// @returns id of the entry equal to @p attributes, adding it if not present yet,
+    ///          or std::nullopt if the table is full.
+    [[nodiscard]] std::optional<uint16_t> intern(GraphicsAttributes const& attributes);
+
+    /// @returns number of entries in use, besides the default graphics attributes.
+    [[nodiscard]] size_t size() const noexcept { return _liveCount.load(std::memory_order_relaxed); }
+
+  private:
+    friend class PodCellExtras;
+
+    static constexpr size_t ChunkSize = 4096;
+    static constexpr size_t ChunkCount = (size_t { 1 } << IdBits) / ChunkSize;
+
+    /// Minimum number of entries in use to request a collection.
+    static constexpr size_t MinCollectionThreshold = 4096;
+
+    struct Hash
+    {
+        size_t operator()(GraphicsAttributes const* attributes) const noexcept;
+    };
+
+    struct Equal
+    {
+        bool operator()(GraphicsAttributes const* a, GraphicsAttributes const* b) const noexcept
+        {
+            return *a == *b;
+        }
+    };
+
+    PodCellAttributes();
+
+    [[nodiscard]] std::optional<uint16_t> internSlow(GraphicsAttributes const& attributes);
+
+    void beginCollection();
+    void sweep(std::vector<bool> const& marked);
+
+    std::mutex _mutex;
+    std::array<std::atomic<GraphicsAttributes*>, ChunkCount> _chunks {};
+    size_t _size = 1; // Id 0 is DefaultId.
+    std::atomic<size_t> _liveCount = 0;
+    std::unordered_map<GraphicsAttributes const*, uint16_t, Hash, Equal> _ids;
+    std::vector<uint16_t> _freeIds;
+    size_t _collectionThreshold = MinCollectionThreshold;
+
+    // Entries interned while collecting, which are in use regardless of the roots' marks.
+    bool _collecting = false;
+    std::vector<bool> _internedWhileCollecting;
+};
+
+inline std::optional<uint16_t> PodCellAttributes::intern(GraphicsAttributes const& attributes)
+{
+    if (attributes == GraphicsAttributes {})
+        return DefaultId;
+
+    // Consecutive cells are mostly written with the same graphics attributes.
+    // The id remembered must not outlive a collection, as it may not be referred to by any cell.
+    struct Interned
+    {
+        uint64_t collection = ~uint64_t { 0 };
+        GraphicsAttributes attributes {};
+        uint16_t id = DefaultId;
+    };
+    thread_local auto last = Interned {};
+
+    auto const collection = PodCellExtras::get().collectionCount();
+    if (last.collection == collection && last.attributes == attributes)
+        return last.id;
+
+    auto const id = internSlow(attributes);
+    if (id)
+        last = Interned { collection, attributes, *id };
+    return id;
+}
+
+/// Trivially copyable grid cell of 8 bytes.
+///
+/// Holds the primary codepoint and width inline, and refers to its graphics attributes in
+/// PodCellAttributes, and to rarely needed data (grapheme cluster tails, hyperlink, image fragment)
+/// in PodCellExtras.
+/// Since cells are trivially copyable, moving, copying and filling ranges of cells (such as for
+/// inserting, deleting or erasing characters, or scrolling within margins) compile down to
+/// memmove() and vectorized stores.
+class PodCell
+{
+  public:
+    // NOLINTNEXTLINE(readability-identifier-naming)
+    static uint8_t constexpr MaxCodepoints = 7;
+
+    PodCell() noexcept = default;
+    explicit PodCell(GraphicsAttributes attributes, HyperlinkId hyperlink = {}) noexcept;
+
+    void reset() noexcept;
+    void reset(GraphicsAttributes const& attributes) noexcept;
+    void reset(GraphicsAttributes const& attributes, HyperlinkId hyperlink) noexcept;
+
+    void write(GraphicsAttributes const& attributes, char32_t ch, uint8_t width) noexcept;
+    void write(GraphicsAttributes const& attributes,
+               char32_t ch,
+               uint8_t width,
+               HyperlinkId hyperlink) noexcept;
+
+    void writeTextOnly(char32_t ch, uint8_t width) noexcept;
+
+    [[nodiscard]] std::u32string codepoints() const;
+    [[nodiscard]] char32_t codepoint(size_t i) const noexcept;
+    [[nodiscard]] std::size_t codepointCount() const noexcept;
+
+    [[nodiscard]] uint8_t width() const noexcept { return static_cast<uint8_t>(get(WidthShift, WidthBits)); }
+    void setWidth(uint8_t width) noexcept;
+
+    [[nodiscard]] GraphicsAttributes const& attributes() const noexcept;
+
+    /// @returns id of the graphics attributes in PodCellAttributes, or PodCellAttributes::ExtraId.
+    [[nodiscard]] uint16_t attributesId() const noexcept
+    {
+        return static_cast<uint16_t>(get(AttributesShift, AttributesBits));
+    }
+
+    [[nodiscard]] CellFlags flags() const noexcept { return attributes().flags; }
+
+    [[nodiscard]] bool isFlagEnabled(CellFlags testFlags) const noexcept { return flags() & testFlags; }
+
+    void resetFlags() noexcept { resetFlags(CellFlags::None); }
+    void resetFlags(CellFlags flags) noexcept
+    {
+        modifyAttributes([flags](GraphicsAttributes& attributes) { attributes.flags = flags; });
+    }
+
+    [[nodiscard]] Color underlineColor() const noexcept { return attributes().underlineColor; }
+    void setUnderlineColor(Color color) noexcept
+    {
+        modifyAttributes([color](GraphicsAttributes& attributes) { attributes.underlineColor = color; });
+    }
+    [[nodiscard]] Color foregroundColor() const noexcept { return attributes().foregroundColor; }
+    void setForegroundColor(Color color) noexcept
+    {
+        modifyAttributes([color](GraphicsAttributes& attributes) { attributes.foregroundColor = color; });
+    }
+    [[nodiscard]] Color backgroundColor() const noexcept { return attributes().backgroundColor; }
+    void setBackgroundColor(Color color) noexcept
+    {
+        modifyAttributes([color](GraphicsAttributes& attributes) { attributes.backgroundColor = color; });
+    }
+
+    [[nodiscard]] std::shared_ptr<ImageFragment> imageFragment() const noexcept
+    {
+        return extra().imageFragment;
+    }
+    void setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage, CellLocation offset);
+
+    void setCharacter(char32_t codepoint) noexcept;
+    [[nodiscard]] int appendCharacter(char32_t codepoint) noexcept;
+    [[nodiscard]] std::string toUtf8() const;
+
+    [[nodiscard]] HyperlinkId hyperlink() const noexcept { return extra().hyperlink; }
+    void setHyperlink(HyperlinkId hyperlink);
+
+    [[nodiscard]] bool empty() const noexcept;
+
+    void setGraphicsRendition(GraphicsRendition sgr) noexcept;
+
+    /// Marks the extra data and graphics attributes this cell refers to as still in use.
+    void markExtra(PodCellExtras::Marker& marker) const noexcept
+    {
+        marker.mark(extraIndex());
+        marker.markAttributes(attributesId());
+    }
+
+  private:
+    // Layout of _bits:
+    //
+    // 63 62           47 46             24 23   21 20               0
+    //  │ │ attributes id │  extras index   │ width │     codepoint    │
+    //
+    static constexpr unsigned CodepointShift = 0;
+    static constexpr unsigned CodepointBits = 21;
+    static constexpr unsigned WidthShift = CodepointShift + CodepointBits;
+    static constexpr unsigned WidthBits = 3;
+    static constexpr unsigned ExtraShift = WidthShift + WidthBits;
+    static constexpr unsigned ExtraBits = PodCellExtras::IndexBits;
+    static constexpr unsigned AttributesShift = ExtraShift + ExtraBits;
+    static constexpr unsigned AttributesBits = PodCellAttributes::IdBits;
+
+    static_assert(AttributesShift + AttributesBits <= 64);
+
+    [[nodiscard]] uint32_t get(unsigned shift, unsigned bits) const noexcept
+    {
+        return static_cast<uint32_t>((_bits >> shift) & ((uint64_t { 1 } << bits) - 1));
+    }
+
+    void set(unsigned shift, unsigned bits, uint32_t value) noexcept
+    {
+        auto const mask = ((uint64_t { 1 } << bits) - 1) << shift;
+        _bits = (_bits & ~mask) | ((uint64_t { value } << shift) & mask);
+    }
+
+    [[nodiscard]] uint32_t extraIndex() const noexcept { return get(ExtraShift, ExtraBits); }
+    [[nodiscard]] PodCellExtra const& extra() const noexcept;
+
+    /// Replaces the extra data with the one modified by @p modify.
+    template <typename Modify>
+    void modifyExtra(Modify modify);
+
+    /// Drops grapheme cluster tail and image fragment, as done when writing text into the cell.
+    void clearTextExtra();
+
+    /// Replaces graphics attributes and hyperlink, dropping grapheme cluster tail and image fragment.
+    void setAttributes(GraphicsAttributes const& attributes, HyperlinkId hyperlink);
+
+    /// Replaces the graphics attributes with the ones modified by @p modify.
+    template <typename Modify>
+    void modifyAttributes(Modify modify);
+
+    uint64_t _bits = uint64_t { 1 } << WidthShift;
+};
+
+static_assert(sizeof(PodCell) == 8);
+static_assert(std::is_trivially_copyable_v<PodCell>);
+
+// {{{ impl: ctor's
+inline PodCell::PodCell(GraphicsAttributes attributes, HyperlinkId hyperlink) noexcept
+{
+    setAttributes(attributes, hyperlink);
+}
+// }}}
+// {{{ impl: extras
+inline PodCellExtra const& PodCell::extra() const noexcept
+{
+    static PodCellExtra const noExtra {};
+    if (auto const index = extraIndex(); index != PodCellExtras::NoIndex)
+        return PodCellExtras::get().at(index);
+    return noExtra;
+}
+
+template <typename Modify>
+inline void PodCell::modifyExtra(Modify modify)
+{
+    auto extra = this->extra();
+    modify(extra);
+    set(ExtraShift, ExtraBits, PodCellExtras::get().intern(std::move(extra)));
+}
+
+inline GraphicsAttributes const& PodCell::attributes() const noexcept
+{
+    if (auto const id = attributesId(); id != PodCellAttributes::ExtraId)
+        return PodCellAttributes::get().at(id);
+    return *extra().attributes;
+}
+
+inline void PodCell::setAttributes(GraphicsAttributes const& attributes, HyperlinkId hyperlink)
+{
+    auto const id = PodCellAttributes::get().intern(attributes);
+    set(AttributesShift, AttributesBits, id.value_or(PodCellAttributes::ExtraId));
+    auto const overflow = id ? std::optional<GraphicsAttributes> {} : std::optional { attributes };
+
+    if (extraIndex() == PodCellExtras::NoIndex)
+    {
+        if (!!hyperlink || overflow)
+            set(ExtraShift,
+                ExtraBits,
+                PodCellExtras::get().intern(PodCellExtra { {}, overflow, hyperlink, nullptr }));
+        return;
+    }
+
+    auto const& current = extra();
+    if (current.codepoints.empty() && !current.imageFragment && current.attributes == overflow
+        && current.hyperlink == hyperlink)
+        return;
+
+    set(ExtraShift, ExtraBits, PodCellExtras::get().intern(PodCellExtra { {}, overflow, hyperlink, nullptr }));
+}
+
+template <typename Modify>
+inline void PodCell::modifyAttributes(Modify modify)
+{
+    auto attributes = this->attributes();
+    modify(attributes);
+    if (auto const id = PodCellAttributes::get().intern(attributes))
+    {
+        if (attributesId() == PodCellAttributes::ExtraId)
+            modifyExtra([](PodCellExtra& extra) { extra.attributes.reset(); });
+        set(AttributesShift, AttributesBits, *id);
+    }
+    else
+    {
+        modifyExtra([&](PodCellExtra& extra) { extra.attributes = attributes; });
+        set(AttributesShift, AttributesBits, PodCellAttributes::ExtraId);
+    }
+}
+
+inline void PodCell::clearTextExtra()
+{
+    if (extraIndex() == PodCellExtras::NoIndex)
+        return;
+    auto const& current = extra();
+    if (current.codepoints.empty() && !current.imageFragment)
+        return;
+    modifyExtra([](PodCellExtra& extra) {
+        extra.codepoints.clear();
+        extra.imageFragment = {};
+    });
+}
+// }}}
+// {{{ impl: reset
+inline void PodCell::reset() noexcept
+{
+    *this = PodCell {};
+}
+
+inline void PodCell::reset(GraphicsAttributes const& attributes) noexcept
+{
+    *this = PodCell { attributes };
+}
+
+inline void PodCell::reset(GraphicsAttributes const& attributes, HyperlinkId hyperlink) noexcept
+{
+    *this = PodCell { attributes, hyperlink };
+}
+
+inline void PodCell::write(GraphicsAttributes const& attributes, char32_t ch, uint8_t width) noexcept
+{
+    write(attributes, ch, width, hyperlink());
+}
+
+inline void PodCell::write(GraphicsAttributes const& attributes,
+                           char32_t ch,
+                           uint8_t width,
+                           HyperlinkId hyperlink) noexcept
+{
+    set(CodepointShift, CodepointBits, static_cast<uint32_t>(ch));
+    setWidth(width);
+
+    // Writing text into a cell destroys the image fragment (as least for Sixels).
+    setAttributes(attributes, hyperlink);
+}
+
+inline void PodCell::writeTextOnly(char32_t ch, uint8_t width) noexcept
+{
+    set(CodepointShift, CodepointBits, static_cast<uint32_t>(ch));
+    setWidth(width);
+    if (extraIndex() != PodCellExtras::NoIndex && !extra().codepoints.empty())
+        modifyExtra([](PodCellExtra& extra) { extra.codepoints.clear(); });
+}
+// }}}
+// {{{ impl: character
+inline void PodCell::setWidth(uint8_t width) noexcept
+{
+    assert(width < MaxCodepoints);
+    set(WidthShift, WidthBits, width);
+}
+
+inline void PodCell::setCharacter(char32_t codepoint) noexcept
+{
+    set(CodepointShift, CodepointBits, static_cast<uint32_t>(codepoint));
+    clearTextExtra();
+    if (codepoint)
+        setWidth(static_cast<uint8_t>(std::max(unicode::width(codepoint), 1)));
+    else
+        setWidth(1);
+}
+
+inline int PodCell::appendCharacter(char32_t codepoint) noexcept
+{
+    assert(codepoint != 0);
+
+    if (extra().codepoints.size() < MaxCodepoints - 1)
+    {
+        modifyExtra([codepoint](PodCellExtra& extra) { extra.codepoints.push_back(codepoint); });
+        if (auto const diff = CellUtil::computeWidthChange(*this, codepoint))
+        {
+            setWidth(static_cast<uint8_t>(static_cast<int>(width()) + diff));
+            return diff;
+        }
+    }
+    return 0;
+}
+
+inline std::size_t PodCell::codepointCount() const noexcept
+{
+    if (!get(CodepointShift, CodepointBits))
+        return 0;
+    if (extraIndex() == PodCellExtras::NoIndex)
+        return 1;
+    return 1 + extra().codepoints.size();
+}
+
+inline char32_t PodCell::codepoint(size_t i) const noexcept
+{
+    if (i == 0)
+        return static_cast<char32_t>(get(CodepointShift, CodepointBits));
+
+    if (extraIndex() == PodCellExtras::NoIndex)
+        return 0;
+
+#if !defined(NDEBUG)
+    return extra().codepoints.at(i - 1);
+#else
+    return extra().codepoints[i - 1];
+#endif
+}
+// }}}
+// {{{ attrs
+inline void PodCell::setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage, CellLocation offset)
+{
+    auto fragment = std::make_shared<ImageFragment>(std::move(rasterizedImage), offset);
+    modifyExtra([&](PodCellExtra& extra) { extra.imageFragment = std::move(fragment); });
+}
+
+inline void PodCell::setHyperlink(HyperlinkId hyperlink)
+{
+    if (hyperlink != this->hyperlink())
+        modifyExtra([hyperlink](PodCellExtra& extra) { extra.hyperlink = hyperlink; });
+}
+
+inline bool PodCell::empty() const noexcept
+{
+    auto const ch = get(CodepointShift, CodepointBits);
+    return (ch == 0 || ch == 0x20) && (extraIndex() == PodCellExtras::NoIndex || !extra().imageFragment);
+}
+
+inline void PodCell::setGraphicsRendition(GraphicsRendition sgr) noexcept
+{
+    CellUtil::applyGraphicsRendition(sgr, *this);
+}
+// }}}
+
+} // namespace terminal
+
+namespace fmt // {{{
+{
+template <>
+struct formatter<terminal::PodCell>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(terminal::PodCell const& cell, FormatContext& ctx)
+    {
+        std::string codepoints;
+        for (auto const i: crispy::times(cell.codepointCount()))
+        {
+            if (i)
+                codepoints += ", ";
+            codepoints += fmt::format("{:02X}", static_cast<unsigned>(cell.codepoint(i)));
+        }
+        return fmt::format_to(ctx.out(), "(chars={}, width={})", codepoints, cell.width());
+    }
+};
+} // namespace fmt
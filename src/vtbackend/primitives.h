@@ -79,9 +79,16 @@ using ColumnOffset = crispy::boxed<int, detail::tags::ColumnOffset>;
 /// Special structure for inifinite history of Grid
 struct Infinite {};
 // clang-format on
+/// Special structure for infinite history of Grid, keeping only the most recent
+/// history lines in memory and appending any older line to a file on disk.
+struct InfiniteDiskBacked
+{
+    /// Number of most recent history lines kept in memory.
+    LineCount inMemoryLineCount = LineCount(10'000);
+};
 /// MaxHistoryLineCount represents type that are used to store number
 /// of lines that can be stored in history
-using MaxHistoryLineCount = std::variant<LineCount, Infinite>;
+using MaxHistoryLineCount = std::variant<LineCount, Infinite, InfiniteDiskBacked>;
 /// Represents the line offset relative to main-page top.
 ///
 /// *  0  is top-most line on main page
@@ -0,0 +1,198 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtparser/GroundScanner.h>
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define VTPARSER_SCANNER_SSE2 1
+    #if defined(__GNUC__) || defined(__clang__)
+        #define VTPARSER_SCANNER_AVX2 1
+    #endif
+#elif defined(__aarch64__)
+    #include <sse2neon/sse2neon.h>
+    #define VTPARSER_SCANNER_SSE2 1
+#endif
+
+namespace terminal::parser
+{
+
+namespace
+{
+    [[nodiscard]] constexpr bool isPrintableAscii(char ch) noexcept
+    {
+        auto const byte = static_cast<uint8_t>(ch);
+        return 0x20 <= byte && byte <= 0x7E;
+    }
+
+    [[nodiscard]] inline int countTrailingZeros(uint32_t value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(value);
+#else
+        int n = 0;
+        while (!(value & 1))
+        {
+            value >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+} // namespace
+
+namespace detail
+{
+    size_t scanPrintableAsciiScalar(char const* begin, char const* end) noexcept
+    {
+        auto const* input = begin;
+        while (input != end && isPrintableAscii(*input))
+            ++input;
+        return static_cast<size_t>(input - begin);
+    }
+
+#if defined(VTPARSER_SCANNER_SSE2)
+    size_t scanPrintableAsciiSSE2(char const* begin, char const* end) noexcept
+    {
+        // Interpreted as signed bytes, everything with the high bit set is negative.
+        // Thus a single signed "less than 0x20" covers both, C0 and non-ASCII bytes.
+        auto const space = _mm_set1_epi8(0x20);
+        auto const del = _mm_set1_epi8(0x7F);
+
+        auto const* input = begin;
+        while (end - input >= 16)
+        {
+            auto const batch = _mm_loadu_si128(reinterpret_cast<__m128i const*>(input));
+            auto const stop = _mm_or_si128(_mm_cmplt_epi8(batch, space), _mm_cmpeq_epi8(batch, del));
+            if (auto const mask = static_cast<uint32_t>(_mm_movemask_epi8(stop)); mask != 0)
+                return static_cast<size_t>(input - begin) + static_cast<size_t>(countTrailingZeros(mask));
+            input += 16;
+        }
+        return static_cast<size_t>(input - begin) + scanPrintableAsciiScalar(input, end);
+    }
+#else
+    size_t scanPrintableAsciiSSE2(char const* begin, char const* end) noexcept
+    {
+        return scanPrintableAsciiScalar(begin, end);
+    }
+#endif
+
+#if defined(VTPARSER_SCANNER_AVX2)
+    __attribute__((target("avx2"))) size_t scanPrintableAsciiAVX2(char const* begin, char const* end) noexcept
+    {
+        auto const space = _mm256_set1_epi8(0x20);
+        auto const del = _mm256_set1_epi8(0x7F);
+
+        auto const* input = begin;
+        while (end - input >= 32)
+        {
+            auto const batch = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(input));
+            auto const stop = _mm256_or_si256(_mm256_cmpgt_epi8(space, batch), _mm256_cmpeq_epi8(batch, del));
+            if (auto const mask = static_cast<uint32_t>(_mm256_movemask_epi8(stop)); mask != 0)
+                return static_cast<size_t>(input - begin) + static_cast<size_t>(countTrailingZeros(mask));
+            input += 32;
+        }
+        return static_cast<size_t>(input - begin) + scanPrintableAsciiSSE2(input, end);
+    }
+#else
+    size_t scanPrintableAsciiAVX2(char const* begin, char const* end) noexcept
+    {
+        return scanPrintableAsciiSSE2(begin, end);
+    }
+#endif
+} // namespace detail
+
+namespace
+{
+    using ScannerFunction = size_t (*)(char const*, char const*) noexcept;
+
+    [[nodiscard]] ScannerFunction scannerFunction(GroundScannerKind kind) noexcept
+    {
+        switch (kind)
+        {
+            case GroundScannerKind::AVX2: return &detail::scanPrintableAsciiAVX2;
+            case GroundScannerKind::SSE2: return &detail::scanPrintableAsciiSSE2;
+            case GroundScannerKind::Scalar: break;
+        }
+        return &detail::scanPrintableAsciiScalar;
+    }
+
+    [[nodiscard]] GroundScannerKind detectGroundScanner() noexcept
+    {
+        if (isGroundScannerSupported(GroundScannerKind::AVX2))
+            return GroundScannerKind::AVX2;
+        if (isGroundScannerSupported(GroundScannerKind::SSE2))
+            return GroundScannerKind::SSE2;
+        return GroundScannerKind::Scalar;
+    }
+
+    struct ScannerSelection
+    {
+        std::atomic<GroundScannerKind> kind;
+        std::atomic<ScannerFunction> function;
+
+        ScannerSelection() noexcept: kind { detectGroundScanner() }, function { scannerFunction(kind) } {}
+    };
+
+    ScannerSelection& scannerSelection() noexcept
+    {
+        static auto selection = ScannerSelection {};
+        return selection;
+    }
+} // namespace
+
+bool isGroundScannerSupported(GroundScannerKind kind) noexcept
+{
+    switch (kind)
+    {
+        case GroundScannerKind::Scalar: return true;
+        case GroundScannerKind::SSE2:
+#if defined(VTPARSER_SCANNER_SSE2)
+            return true;
+#else
+            return false;
+#endif
+        case GroundScannerKind::AVX2:
+#if defined(VTPARSER_SCANNER_AVX2)
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+GroundScannerKind groundScannerKind() noexcept
+{
+    return scannerSelection().kind.load(std::memory_order_relaxed);
+}
+
+bool selectGroundScanner(GroundScannerKind kind) noexcept
+{
+    if (!isGroundScannerSupported(kind))
+        return false;
+
+    auto& selection = scannerSelection();
+    selection.kind.store(kind, std::memory_order_relaxed);
+    selection.function.store(scannerFunction(kind), std::memory_order_relaxed);
+    return true;
+}
+
+size_t scanPrintableAscii(char const* begin, char const* end) noexcept
+{
+    return scannerSelection().function.load(std::memory_order_relaxed)(begin, end);
+}
+
+} // namespace terminal::parser
@@ -0,0 +1,91 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace terminal::parser
+{
+
+/// Implementations of the ground state text scanner.
+enum class GroundScannerKind : uint8_t
+{
+    /// Portable byte-by-byte implementation, always available.
+    Scalar,
+    /// 16 bytes per iteration, via SSE2 on x86-64 and via NEON (sse2neon) on AArch64.
+    SSE2,
+    /// 32 bytes per iteration, x86-64 only and only if supported by the CPU at runtime.
+    AVX2,
+};
+
+/// Scans the input for a run of printable US-ASCII characters (0x20..0x7E).
+///
+/// The run ends at the first C0 control character, DEL, or a byte with the high bit set
+/// (i.e. ESC or the start of a UTF-8 sequence).
+///
+/// @returns the number of leading bytes in [begin, end) that are printable US-ASCII.
+[[nodiscard]] size_t scanPrintableAscii(char const* begin, char const* end) noexcept;
+
+/// @returns the scanner implementation currently used by scanPrintableAscii().
+[[nodiscard]] GroundScannerKind groundScannerKind() noexcept;
+
+/// Overrides the runtime-detected scanner implementation, e.g. for benchmarking.
+///
+/// @returns false if the requested implementation is not supported on this machine,
+///          in which case the current selection is left untouched.
+bool selectGroundScanner(GroundScannerKind kind) noexcept;
+
+/// @returns true if the given scanner implementation is supported on this machine.
+[[nodiscard]] bool isGroundScannerSupported(GroundScannerKind kind) noexcept;
+
+namespace detail
+{
+    size_t scanPrintableAsciiScalar(char const* begin, char const* end) noexcept;
+    size_t scanPrintableAsciiSSE2(char const* begin, char const* end) noexcept;
+    size_t scanPrintableAsciiAVX2(char const* begin, char const* end) noexcept;
+} // namespace detail
+
+} // namespace terminal::parser
+
+// {{{ fmtlib support
+namespace fmt
+{
+
+template <>
+struct formatter<terminal::parser::GroundScannerKind>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+    template <typename FormatContext>
+    auto format(terminal::parser::GroundScannerKind value, FormatContext& ctx)
+    {
+        using Kind = terminal::parser::GroundScannerKind;
+        switch (value)
+        {
+            case Kind::Scalar: return fmt::format_to(ctx.out(), "scalar");
+            case Kind::SSE2: return fmt::format_to(ctx.out(), "SSE2");
+            case Kind::AVX2: return fmt::format_to(ctx.out(), "AVX2");
+        }
+        return fmt::format_to(ctx.out(), "({})", static_cast<unsigned>(value));
+    }
+};
+
+} // namespace fmt
+// }}}
@@ -0,0 +1,89 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vtparser/GroundScanner.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace std;
+using terminal::parser::GroundScannerKind;
+
+namespace
+{
+
+size_t scanWith(GroundScannerKind kind, string const& text)
+{
+    auto const* begin = text.data();
+    auto const* end = text.data() + text.size();
+    switch (kind)
+    {
+        case GroundScannerKind::Scalar: return terminal::parser::detail::scanPrintableAsciiScalar(begin, end);
+        case GroundScannerKind::SSE2: return terminal::parser::detail::scanPrintableAsciiSSE2(begin, end);
+        case GroundScannerKind::AVX2: return terminal::parser::detail::scanPrintableAsciiAVX2(begin, end);
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST_CASE("GroundScanner.stop_bytes")
+{
+    auto const kind = GENERATE(GroundScannerKind::Scalar, GroundScannerKind::SSE2, GroundScannerKind::AVX2);
+    if (!terminal::parser::isGroundScannerSupported(kind))
+        return;
+    INFO(fmt::format("scanner: {}", kind));
+
+    // Place each stop byte at every position of a text spanning multiple SIMD batches
+    // (including the scalar tail), and ensure the run ends right in front of it.
+    for (auto const stopByte: { '\x00', '\x07', '\t', '\n', '\r', '\x1B', '\x1F', '\x7F', '\x80', '\xC3', '\xFF' })
+    {
+        for (size_t position = 0; position < 70; ++position)
+        {
+            auto text = string(70, 'a');
+            text[position] = stopByte;
+            INFO(fmt::format("stop byte: {:02X} at {}", static_cast<uint8_t>(stopByte), position));
+            CHECK(scanWith(kind, text) == position);
+        }
+    }
+}
+
+TEST_CASE("GroundScanner.printable_only")
+{
+    auto const kind = GENERATE(GroundScannerKind::Scalar, GroundScannerKind::SSE2, GroundScannerKind::AVX2);
+    if (!terminal::parser::isGroundScannerSupported(kind))
+        return;
+    INFO(fmt::format("scanner: {}", kind));
+
+    auto text = string {};
+    for (char ch = 0x20; ch <= 0x7E; ++ch)
+        text += ch;
+
+    for (size_t length = 0; length <= text.size(); ++length)
+        CHECK(scanWith(kind, text.substr(0, length)) == length);
+}
+
+TEST_CASE("GroundScanner.select")
+{
+    auto const detected = terminal::parser::groundScannerKind();
+    REQUIRE(terminal::parser::isGroundScannerSupported(detected));
+
+    REQUIRE(terminal::parser::selectGroundScanner(GroundScannerKind::Scalar));
+    CHECK(terminal::parser::groundScannerKind() == GroundScannerKind::Scalar);
+    auto const text = "Hello, World!\r\n"s;
+    CHECK(terminal::parser::scanPrintableAscii(text.data(), text.data() + text.size()) == 13);
+
+    REQUIRE(terminal::parser::selectGroundScanner(detected));
+    CHECK(terminal::parser::groundScannerKind() == detected);
+}
@@ -12,6 +12,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <vtparser/GroundScanner.h>
 #include <vtparser/Parser.h>
 
 #include <crispy/assert.h>
@@ -21,6 +22,7 @@
 
 #include <unicode/utf8.h>
 
+#include <algorithm>
 #include <array>
 #include <cctype>
 #include <string_view>
@@ -332,11 +334,114 @@ constexpr ParserTable ParserTable::get() // {{{
     }
 
     // TODO: verify the above is correct (programatically as much as possible)
-    // TODO: see if we can reduce the preassure on L2 caches (is this even an issue?)
 
     return t;
 } // }}}
 
+/**
+ * Cache friendly representation of the ParserTable, as used by the parser at runtime.
+ *
+ * Bytes that behave identically in every state are first mapped to the same byte class,
+ * so that a single packed entry per (state, byte class) pair suffices. Each entry holds
+ * the resulting state along with all actions to be invoked for that input, in order.
+ * The whole table is about 2 KB in size and thus stays resident in the L1 cache.
+ */
+struct FusedParserTable
+{
+    static constexpr size_t MaxByteClasses = 32;
+
+    struct Entry
+    {
+        //! Resulting state, or State::Undefined if the input is not valid in the given state.
+        State nextState = State::Undefined;
+        //! Action to be invoked upon leaving the current state (only on transitions).
+        Action leave = Action::Undefined;
+        //! Action to be invoked for the input byte itself.
+        Action event = Action::Undefined;
+        //! Action to be invoked upon entering the next state (only on transitions).
+        Action enter = Action::Undefined;
+    };
+
+    //! Maps each input byte to its byte class.
+    std::array<uint8_t, 256> byteClasses {};
+
+    //! Number of distinct byte classes in use.
+    size_t byteClassCount = 0;
+
+    //! Fused state transition and action map from (State, byte class) to Entry.
+    std::array<std::array<Entry, MaxByteClasses>, std::numeric_limits<State>::size()> entries {};
+
+    [[nodiscard]] constexpr Entry const& lookup(State state, uint8_t input) const noexcept
+    {
+        return entries[static_cast<size_t>(state)][byteClasses[input]];
+    }
+
+    //! Builds the fused table from the given (uncompressed) state machine tables.
+    static constexpr FusedParserTable create(ParserTable const& table) noexcept;
+
+    //! Standard state machine tables parsing VT225 to VT525.
+    static constexpr FusedParserTable get() { return create(ParserTable::get()); }
+
+  private:
+    static constexpr bool sameByteClass(ParserTable const& table, uint8_t a, uint8_t b) noexcept
+    {
+        for (State s = std::numeric_limits<State>::min(); s <= std::numeric_limits<State>::max(); ++s)
+        {
+            auto const i = static_cast<size_t>(s);
+            if (table.transitions[i][a] != table.transitions[i][b] || table.events[i][a] != table.events[i][b])
+                return false;
+        }
+        return true;
+    }
+};
+
+constexpr FusedParserTable FusedParserTable::create(ParserTable const& table) noexcept // {{{
+{
+    auto t = FusedParserTable {};
+
+    // Assign byte classes, using the first byte of each class as its representative.
+    auto representatives = std::array<uint8_t, MaxByteClasses> {};
+    for (unsigned input = 0; input < 256; ++input)
+    {
+        auto const byte = static_cast<uint8_t>(input);
+        auto byteClass = size_t { 0 };
+        while (byteClass < t.byteClassCount && !sameByteClass(table, representatives[byteClass], byte))
+            ++byteClass;
+        if (byteClass == t.byteClassCount)
+            // NB: Exceeding MaxByteClasses is an out-of-bounds write and fails constant evaluation.
+            representatives[t.byteClassCount++] = byte;
+        t.byteClasses[input] = static_cast<uint8_t>(byteClass);
+    }
+
+    for (State s = std::numeric_limits<State>::min(); s <= std::numeric_limits<State>::max(); ++s)
+    {
+        auto const i = static_cast<size_t>(s);
+        for (size_t byteClass = 0; byteClass < t.byteClassCount; ++byteClass)
+        {
+            auto const byte = representatives[byteClass];
+            auto& entry = t.entries[i][byteClass];
+            if (auto const next = table.transitions[i][byte]; next != State::Undefined)
+            {
+                entry.nextState = next;
+                entry.leave = table.exitEvents[i];
+                entry.event = table.events[i][byte];
+                entry.enter = table.entryEvents[static_cast<size_t>(next)];
+            }
+            else if (table.events[i][byte] != Action::Undefined)
+            {
+                entry.nextState = s;
+                entry.event = table.events[i][byte];
+            }
+        }
+    }
+
+    return t;
+} // }}}
+
+/// State machine table as used by the parser at runtime.
+inline constexpr auto fusedParserTable = FusedParserTable::get();
+static_assert(fusedParserTable.byteClassCount <= FusedParserTable::MaxByteClasses);
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char const> data)
 {
@@ -354,7 +459,25 @@ void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char cons
                 break;
                 // clang-format on
             case ProcessKind::FallbackToFSM:
-                processOnceViaStateMachine(static_cast<uint8_t>(*input++));
+                if constexpr (!TraceStateChanges)
+                {
+                    if (_state == State::Ground && *input == '\033')
+                    {
+                        if (auto const processedCSI = parseCSI(input, end); processedCSI != 0)
+                        {
+                            input += processedCSI;
+                            break;
+                        }
+                    }
+                }
+                // Stay in the state machine until the current sequence has been processed.
+                do
+                {
+                    if (auto const processedString = parseBulkString(input, end); processedString != 0)
+                        input += processedString;
+                    else
+                        processOnceViaStateMachine(static_cast<uint8_t>(*input++));
+                } while (input != end && _state != State::Ground);
                 break;
         }
     }
@@ -363,21 +486,19 @@ void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char cons
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::processOnceViaStateMachine(uint8_t ch)
 {
-    auto const s = static_cast<size_t>(_state);
-    ParserTable static constexpr table = ParserTable::get();
-
-    if (auto const t = table.transitions[s][static_cast<uint8_t>(ch)]; t != State::Undefined)
+    auto const& entry = fusedParserTable.lookup(_state, ch);
+    if (entry.nextState == State::Undefined)
     {
-        // fmt::print("VTParser: Transitioning from {} to {}", _state, t);
-        handle(ActionClass::Leave, table.exitEvents[s], ch);
-        handle(ActionClass::Transition, table.events[s][static_cast<size_t>(ch)], ch);
-        _state = t;
-        handle(ActionClass::Enter, table.entryEvents[static_cast<size_t>(t)], ch);
-    }
-    else if (Action const a = table.events[s][ch]; a != Action::Undefined)
-        handle(ActionClass::Event, a, ch);
-    else
         _eventListener.error("Parser error: Unknown action for state/input pair.");
+        return;
+    }
+
+    if (entry.leave != Action::Undefined)
+        handle(ActionClass::Leave, entry.leave, ch);
+    handle(entry.nextState != _state ? ActionClass::Transition : ActionClass::Event, entry.event, ch);
+    _state = entry.nextState;
+    if (entry.enter != Action::Undefined)
+        handle(ActionClass::Enter, entry.enter, ch);
 }
 
 template <typename EventListener, bool TraceStateChanges>
@@ -392,6 +513,11 @@ auto Parser<EventListener, TraceStateChanges>::parseBulkText(char const* begin,
     if (!maxCharCount)
         return { ProcessKind::FallbackToFSM, 0 };
 
+    auto const maxAsciiCount = _eventListener.maxBulkAsciiTextLength();
+    if (_scanState.utf8.expectedLength == 0)
+        if (auto const processedByteCount = parseBulkAsciiText(begin, end, maxAsciiCount))
+            return { ProcessKind::ContinueBulk, processedByteCount };
+
     auto const chunk = std::string_view(input, static_cast<size_t>(std::distance(input, end)));
     auto const [cellCount, next, subStart, subEnd] = unicode::scan_for_text(_scanState, chunk, maxCharCount);
 
@@ -451,6 +577,156 @@ auto Parser<EventListener, TraceStateChanges>::parseBulkText(char const* begin,
     return { ProcessKind::ContinueBulk, static_cast<size_t>(std::distance(input, next)) };
 }
 
+template <typename EventListener, bool TraceStateChanges>
+size_t Parser<EventListener, TraceStateChanges>::parseBulkAsciiText(char const* begin,
+                                                                   char const* end,
+                                                                   size_t maxCharCount) noexcept
+{
+    auto textLength = std::min(scanPrintableAscii(begin, end), maxCharCount);
+
+    // A non-ASCII byte right after the run may start a combining character that has to join
+    // the grapheme cluster of the last ASCII character, so leave that one to the Unicode scanner.
+    if (textLength != 0 && begin + textLength != end && (static_cast<uint8_t>(begin[textLength]) & 0x80))
+        --textLength;
+
+    const auto* input = begin;
+    if (textLength != 0)
+    {
+        auto const text = std::string_view { input, textLength };
+#if defined(LIBTERMINAL_LOG_TRACE)
+        if (VTTraceParserLog)
+            VTTraceParserLog()("[ASCII] Scanned text: maxCharCount {}; bytes {}: \"{}\"",
+                               maxCharCount,
+                               textLength,
+                               crispy::escape(text));
+#endif
+        // US-ASCII text always occupies exactly one grid cell per byte.
+        _eventListener.print(text, textLength);
+        _scanState.lastCodepointHint = static_cast<char32_t>(text.back());
+        input += textLength;
+    }
+
+    // In ground state, CR, LF and TAB are nothing but an Execute event. Handling them here
+    // keeps (TEXT CR? LF)+ streams entirely out of the finite state machine.
+    while (input != end && (*input == '\n' || *input == '\r' || *input == '\t'))
+        _eventListener.execute(*input++);
+
+    return static_cast<size_t>(std::distance(begin, input));
+}
+
+template <typename EventListener, bool TraceStateChanges>
+size_t Parser<EventListener, TraceStateChanges>::parseBulkString(char const* begin, char const* end)
+{
+    auto const put = [state = _state]() {
+        switch (state)
+        {
+            case State::OSC_String: return Action::OSC_Put;
+            case State::APC_String: return Action::APC_Put;
+            case State::PM_String: return Action::PM_Put;
+            case State::DCS_PassThrough: return Action::Put;
+            default: return Action::Undefined;
+        }
+    }();
+    if (put == Action::Undefined)
+        return 0;
+
+    // Consume everything up to the next byte that would make the state machine
+    // do anything else than putting it into the control string (e.g. BEL, ESC, CAN),
+    // or passing it through to the hooked DCS handler.
+    const auto* input = begin;
+    while (input != end)
+    {
+        auto const& entry = fusedParserTable.lookup(_state, static_cast<uint8_t>(*input));
+        if (entry.event != put || entry.nextState != _state || entry.enter != Action::Undefined)
+            break;
+        ++input;
+    }
+
+    auto const chars = std::string_view(begin, static_cast<size_t>(input - begin));
+    if (chars.empty())
+        return 0;
+
+    switch (put)
+    {
+        case Action::OSC_Put: _eventListener.putOSC(chars); break;
+        case Action::APC_Put: _eventListener.putAPC(chars); break;
+        case Action::PM_Put: _eventListener.putPM(chars); break;
+        case Action::Put: _eventListener.put(chars); break;
+        default: break;
+    }
+
+    return chars.size();
+}
+
+template <typename EventListener, bool TraceStateChanges>
+size_t Parser<EventListener, TraceStateChanges>::parseCSI(char const* begin, char const* end)
+{
+    // Speculatively decodes a complete and well-formed `ESC [ leader? params intermediates? final`
+    // sequence straight from the input. Anything that would make the state machine execute,
+    // ignore, or error out on a byte - as well as sequences split across reads - is left to the
+    // state machine, by returning 0 without having emitted any event.
+
+    auto const isDigit = [](uint8_t ch) { return 0x30 <= ch && ch <= 0x39; };
+
+    if (end - begin < 3 || begin[1] != '[')
+        return 0;
+
+    auto const* const parametersBegin = begin + 2;
+    auto const* input = parametersBegin;
+    auto csi = ParsedCSI {};
+
+    if (auto const ch = static_cast<uint8_t>(*input); 0x3C <= ch && ch <= 0x3F)
+    {
+        csi.leader = static_cast<char>(ch);
+        ++input;
+    }
+
+    auto value = uint16_t { 0 };
+    auto hasParameters = false;
+    for (; input != end; ++input)
+    {
+        auto const ch = static_cast<uint8_t>(*input);
+        if (isDigit(ch))
+            value = static_cast<uint16_t>(value * 10 + (ch - '0'));
+        else if (ch == ';' || ch == ':')
+        {
+            if (ch == ':' && input == parametersBegin)
+                return 0; // CSI_Entry -> CSI_Ignore
+            if (csi.parameterCount + 1 == ParsedCSI::MaxParameters)
+                return 0; // too many parameters
+            csi.parameters[csi.parameterCount++] = value;
+            if (ch == ':')
+                csi.subParameterMask |= static_cast<uint16_t>(1 << csi.parameterCount);
+            value = 0;
+        }
+        else
+            break;
+        hasParameters = true;
+    }
+    if (hasParameters)
+        csi.parameters[csi.parameterCount++] = value;
+
+    auto const* const intermediatesBegin = input;
+    while (input != end && 0x20 <= static_cast<uint8_t>(*input) && static_cast<uint8_t>(*input) <= 0x2F)
+        ++input;
+
+    if (input == end)
+        return 0; // incomplete sequence
+
+    auto const finalChar = static_cast<uint8_t>(*input);
+    if (!(0x40 <= finalChar && finalChar <= 0x7E))
+        return 0;
+
+    csi.intermediates = std::string_view(intermediatesBegin, static_cast<size_t>(input - intermediatesBegin));
+    csi.finalChar = static_cast<char>(finalChar);
+    ++input;
+
+    _eventListener.dispatchCSI(csi);
+    handle(ActionClass::Enter, Action::GroundStart, finalChar);
+
+    return static_cast<size_t>(input - begin);
+}
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::printUtf8Byte(char ch)
 {
@@ -495,16 +771,16 @@ void Parser<EventListener, TraceStateChanges>::handle(ActionClass actionClass,
         case Action::CSI_Dispatch: _eventListener.dispatchCSI(ch); break;
         case Action::Print: printUtf8Byte(ch); break;
         case Action::OSC_Start: _eventListener.startOSC(); break;
-        case Action::OSC_Put: _eventListener.putOSC(ch); break;
+        case Action::OSC_Put: _eventListener.putOSC(std::string_view(&ch, 1)); break;
         case Action::OSC_End: _eventListener.dispatchOSC(); break;
         case Action::Hook: _eventListener.hook(ch); break;
-        case Action::Put: _eventListener.put(ch); break;
+        case Action::Put: _eventListener.put(std::string_view(&ch, 1)); break;
         case Action::Unhook: _eventListener.unhook(); break;
         case Action::APC_Start: _eventListener.startAPC(); break;
-        case Action::APC_Put: _eventListener.putAPC(ch); break;
+        case Action::APC_Put: _eventListener.putAPC(std::string_view(&ch, 1)); break;
         case Action::APC_End: _eventListener.dispatchAPC(); break;
         case Action::PM_Start: _eventListener.startPM(); break;
-        case Action::PM_Put: _eventListener.putPM(ch); break;
+        case Action::PM_Put: _eventListener.putPM(std::string_view(&ch, 1)); break;
         case Action::PM_End: _eventListener.dispatchPM(); break;
         case Action::Ignore:
         case Action::Undefined: break;
@@ -13,6 +13,8 @@
  */
 #pragma once
 
+#include <vtparser/ParserEvents.h>
+
 #include <crispy/overloaded.h>
 
 #include <unicode/convert.h>
@@ -553,7 +555,7 @@ class Parser
 
     /// Parses the input string in UTF-8 encoding and emits VT events while processing.
     /// With respect to text, only up to @c EventListener::maxBulkTextSequenceWidth() UTF-32 codepoints will
-    /// be processed.
+    /// be processed, or up to @c EventListener::maxBulkAsciiTextLength() for printable US-ASCII text.
     void parseFragment(gsl::span<char const> data);
 
     [[nodiscard]] State state() const noexcept { return _state; }
@@ -572,6 +574,9 @@ class Parser
     };
 
     std::tuple<ProcessKind, size_t> parseBulkText(char const* begin, char const* end) noexcept;
+    size_t parseBulkAsciiText(char const* begin, char const* end, size_t maxCharCount) noexcept;
+    size_t parseCSI(char const* begin, char const* end);
+    size_t parseBulkString(char const* begin, char const* end);
     void processOnceViaStateMachine(uint8_t ch);
 
     void handle(ActionClass actionClass, Action action, uint8_t codepoint);
@@ -13,12 +13,46 @@
  */
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <string_view>
 
 namespace terminal
 {
 
+/**
+ * A complete CSI sequence, as decoded in one go by the parser's CSI fast path.
+ *
+ * Parameters are stored the way SequenceParameterBuilder would have received them
+ * via paramDigit(), paramSeparator() and paramSubSeparator().
+ */
+struct ParsedCSI
+{
+    static constexpr size_t MaxParameters = 16;
+
+    /// Private marker (one of '<', '=', '>', '?'), or 0 if none.
+    char leader = 0;
+
+    /// Number of parameter fields, including empty ones (0 if no parameter bytes were given).
+    size_t parameterCount = 0;
+
+    /// Bit @c i is set if parameter @c i was introduced by a sub-parameter separator (':').
+    uint16_t subParameterMask = 0;
+
+    std::array<uint16_t, MaxParameters> parameters {};
+
+    /// Intermediate characters, referencing the parser's input buffer.
+    std::string_view intermediates {};
+
+    char finalChar = 0;
+
+    [[nodiscard]] constexpr bool isSubParameter(size_t index) const noexcept
+    {
+        return (subParameterMask & (1 << index)) != 0;
+    }
+};
+
 /**
  * Interface of all events that can be emitted by the Parser.
  *
@@ -58,6 +92,14 @@ class ParserEvents
      */
     [[nodiscard]] virtual size_t maxBulkTextSequenceWidth() const noexcept = 0;
 
+    /**
+     * Returns the number of printable US-ASCII characters that may be passed to print() at once.
+     *
+     * This is at least maxBulkTextSequenceWidth(), but may exceed the current line,
+     * in which case the text is wrapped onto the following lines by the receiver.
+     */
+    [[nodiscard]] virtual size_t maxBulkAsciiTextLength() const noexcept = 0;
+
     /**
      * The C0 or C1 control function should be executed, which may have any one of a variety of
      * effects, including changing the cursor position, suspending or resuming communications or
@@ -117,6 +159,14 @@ class ParserEvents
      */
     virtual void dispatchCSI(char function) = 0;
 
+    /**
+     * Dispatches a complete CSI sequence that has been decoded by the parser's fast path,
+     * without going through clear(), collectLeader(), param*(), collect() and dispatchCSI(char).
+     *
+     * This is semantically equivalent to receiving all of these events one by one.
+     */
+    virtual void dispatchCSI(ParsedCSI const& csi) = 0;
+
     /**
      * When the control function OSC (Operating System Command) is recognised,
      * this action initializes an external parser (the “OSC Handler”)
@@ -130,8 +180,10 @@ class ParserEvents
     /**
      * This action passes characters from the control string to the OSC Handler as they arrive.
      * There is therefore no need to buffer characters until the end of the control string is recognised.
+     *
+     * Contiguous characters are passed in as few calls as possible.
      */
-    virtual void putOSC(char value) = 0;
+    virtual void putOSC(std::string_view chars) = 0;
 
     /**
      * This action is called when the OSC string is terminated by ST, CAN, SUB or ESC,
@@ -153,8 +205,10 @@ class ParserEvents
      * This action passes characters from the data string part of a device control string to a
      * handler that has previously been selected by the hook action. C0 controls are also passed
      * to the handler.
+     *
+     * Contiguous characters are passed in as few calls as possible.
      */
-    virtual void put(char value) = 0;
+    virtual void put(std::string_view chars) = 0;
 
     /**
      * When a device control string is terminated by ST, CAN, SUB or ESC, this action calls the
@@ -164,11 +218,11 @@ class ParserEvents
     virtual void unhook() = 0;
 
     virtual void startAPC() = 0;
-    virtual void putAPC(char) = 0;
+    virtual void putAPC(std::string_view) = 0;
     virtual void dispatchAPC() = 0;
 
     virtual void startPM() = 0;
-    virtual void putPM(char) = 0;
+    virtual void putPM(std::string_view) = 0;
     virtual void dispatchPM() = 0;
 };
 
@@ -180,6 +234,7 @@ class NullParserEvents: public ParserEvents
     size_t print(std::string_view, size_t) override { return 0; }
     // clang-format off
     [[nodiscard]] size_t maxBulkTextSequenceWidth() const noexcept override { return std::numeric_limits<size_t>::max(); }
+    [[nodiscard]] size_t maxBulkAsciiTextLength() const noexcept override { return std::numeric_limits<size_t>::max(); }
     // clang-format on
     void execute(char) override {}
     void clear() override {}
@@ -191,17 +246,18 @@ class NullParserEvents: public ParserEvents
     void paramSubSeparator() override {}
     void dispatchESC(char) override {}
     void dispatchCSI(char) override {}
+    void dispatchCSI(ParsedCSI const&) override {}
     void startOSC() override {}
-    void putOSC(char) override {}
+    void putOSC(std::string_view) override {}
     void dispatchOSC() override {}
     void hook(char) override {}
-    void put(char) override {}
+    void put(std::string_view) override {}
     void unhook() override {}
     void startAPC() override {}
-    void putAPC(char) override {}
+    void putAPC(std::string_view) override {}
     void dispatchAPC() override {}
     void startPM() override {}
-    void putPM(char) override {}
+    void putPM(std::string_view) override {}
     void dispatchPM() override {}
 };
 
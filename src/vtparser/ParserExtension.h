@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <string>
+#include <string_view>
 
 namespace terminal
 {
@@ -16,7 +17,8 @@ class ParserExtension
   public:
     virtual ~ParserExtension() = default;
 
-    virtual void pass(char ch) = 0;
+    /// Passes the next contiguous chunk of the DCS payload to the extension.
+    virtual void pass(std::string_view chars) = 0;
     virtual void finalize() = 0;
 };
 
@@ -25,7 +27,7 @@ class SimpleStringCollector: public ParserExtension
   public:
     explicit SimpleStringCollector(std::function<void(std::string_view)> done): _done { std::move(done) } {}
 
-    void pass(char ch) override { _data.push_back(ch); }
+    void pass(std::string_view chars) override { _data.append(chars); }
 
     void finalize() override
     {
@@ -18,6 +18,9 @@
 
 #include <catch2/catch.hpp>
 
+#include <string>
+#include <vector>
+
 using namespace std;
 using namespace terminal;
 
@@ -38,14 +41,83 @@ class MockParserEvents: public terminal::NullParserEvents
     }
 
     void startAPC() override { apc += "{"; }
-    void putAPC(char ch) override { apc += ch; }
+    void putAPC(std::string_view chars) override { apc += chars; }
     void dispatchAPC() override { apc += "}"; }
 
     void startPM() override { pm += "{"; }
-    void putPM(char ch) override { pm += ch; }
+    void putPM(std::string_view chars) override { pm += chars; }
     void dispatchPM() override { pm += "}"; }
 };
 
+/// Records CSI sequences in a canonical form, regardless of whether they were received
+/// event by event via the state machine, or in one go via the CSI fast path.
+class CSIRecorder: public terminal::NullParserEvents
+{
+  public:
+    std::vector<std::string> sequences;
+    size_t fastPathCount = 0;
+
+    void clear() override
+    {
+        _leader = 0;
+        _parameters = { 0 };
+        _subParameters = { false };
+        _intermediates.clear();
+    }
+    void collectLeader(char leader) override { _leader = leader; }
+    void collect(char ch) override { _intermediates += ch; }
+    void paramDigit(char ch) override
+    {
+        _parameters.back() = static_cast<uint16_t>(_parameters.back() * 10 + (ch - '0'));
+    }
+    void paramSeparator() override
+    {
+        _parameters.push_back(0);
+        _subParameters.push_back(false);
+    }
+    void paramSubSeparator() override
+    {
+        _parameters.push_back(0);
+        _subParameters.push_back(true);
+    }
+    void dispatchCSI(char finalChar) override
+    {
+        // Mimmick SequenceParameterBuilder, which treats a single zero parameter as none.
+        if (_parameters.size() == 1 && _parameters[0] == 0)
+            _parameters.clear();
+        record(finalChar);
+    }
+    void dispatchCSI(ParsedCSI const& csi) override
+    {
+        ++fastPathCount;
+        clear();
+        _leader = csi.leader;
+        _parameters.assign(csi.parameters.begin(), csi.parameters.begin() + csi.parameterCount);
+        _subParameters.clear();
+        for (size_t i = 0; i < csi.parameterCount; ++i)
+            _subParameters.push_back(csi.isSubParameter(i));
+        if (_parameters.size() == 1 && _parameters[0] == 0)
+            _parameters.clear();
+        _intermediates = csi.intermediates;
+        record(csi.finalChar);
+    }
+
+  private:
+    void record(char finalChar)
+    {
+        auto text = fmt::format("CSI {}", _leader ? _leader : ' ');
+        for (size_t i = 0; i < _parameters.size(); ++i)
+            text += fmt::format("{}{}", i == 0 ? "" : _subParameters[i] ? ":" : ";", _parameters[i]);
+        text += fmt::format(" '{}' {}", _intermediates, finalChar);
+        sequences.emplace_back(std::move(text));
+    }
+
+    char _leader = 0;
+    std::vector<uint16_t> _parameters;
+    std::vector<bool> _subParameters;
+    std::string _intermediates;
+};
+
 TEST_CASE("Parser.utf8_single", "[Parser]")
 {
     MockParserEvents textListener;
@@ -78,3 +150,146 @@ TEST_CASE("Parser.APC")
     REQUIRE(listener.apc == "{Gi=1,a=q;}");
     REQUIRE(listener.text == "ABCDEF");
 }
+
+TEST_CASE("Parser.bulk_text_with_inline_controls")
+{
+    struct ExecuteRecorder: public MockParserEvents
+    {
+        void execute(char ch) override { text += ch; }
+    };
+    ExecuteRecorder listener;
+    auto p = parser::Parser<ParserEvents>(listener);
+    p.parseFragment("Hello,\tWorld!\r\nNext line\n\033[mTail\xC3\xB6\r\n"sv);
+    CHECK(p.state() == parser::State::Ground);
+    CHECK(listener.text == "Hello,\tWorld!\r\nNext line\nTail\xC3\xB6\r\n");
+}
+
+TEST_CASE("Parser.FusedParserTable")
+{
+    using parser::Action;
+    using parser::State;
+
+    auto constexpr table = parser::ParserTable::get();
+    auto constexpr fused = parser::FusedParserTable::get();
+
+    for (State s = std::numeric_limits<State>::min(); s <= std::numeric_limits<State>::max(); ++s)
+    {
+        auto const i = static_cast<size_t>(s);
+        for (unsigned byte = 0; byte < 256; ++byte)
+        {
+            INFO(fmt::format("state {}, byte 0x{:02X}", s, byte));
+            auto const& entry = fused.lookup(s, static_cast<uint8_t>(byte));
+            if (auto const next = table.transitions[i][byte]; next != State::Undefined)
+            {
+                CHECK(entry.nextState == next);
+                CHECK(entry.leave == table.exitEvents[i]);
+                CHECK(entry.event == table.events[i][byte]);
+                CHECK(entry.enter == table.entryEvents[static_cast<size_t>(next)]);
+            }
+            else if (table.events[i][byte] != Action::Undefined)
+            {
+                CHECK(entry.nextState == s);
+                CHECK(entry.leave == Action::Undefined);
+                CHECK(entry.event == table.events[i][byte]);
+                CHECK(entry.enter == Action::Undefined);
+            }
+            else
+                CHECK(entry.nextState == State::Undefined);
+        }
+    }
+}
+
+TEST_CASE("Parser.CSI_fast_path")
+{
+    auto const input = "\033[m\033[0m\033[1;31m\033[38:2::255:128:0m\033[;5H\033[12;34H"
+                       "\033[?25l\033[>c\033[ q\033[2 q\033[?2026$p\033[65535;65536X"
+                       "\033[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16m"
+                       // Malformed or otherwise special sequences that must be left to the FSM.
+                       "\033[:5m\033[1;?m\033[1 2m\033[1\n2H\033[1\x7Fm\033[?\033[3J"
+                       "\033[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17m"sv;
+
+    // Byte-by-byte feeding never presents a complete sequence to the fast path.
+    CSIRecorder fsmListener;
+    auto fsm = parser::Parser<ParserEvents>(fsmListener);
+    for (char const ch: input)
+        fsm.parseFragment(string_view(&ch, 1));
+    CHECK(fsmListener.fastPathCount == 0);
+
+    CSIRecorder fastListener;
+    auto fast = parser::Parser<ParserEvents>(fastListener);
+    fast.parseFragment(input);
+    CHECK(fastListener.fastPathCount == 13);
+
+    CHECK(fast.state() == parser::State::Ground);
+    REQUIRE(fastListener.sequences.size() == fsmListener.sequences.size());
+    for (size_t i = 0; i < fsmListener.sequences.size(); ++i)
+        CHECK(fastListener.sequences[i] == fsmListener.sequences[i]);
+}
+
+TEST_CASE("Parser.OSC_bulk")
+{
+    struct OSCRecorder: public NullParserEvents
+    {
+        std::vector<std::string> sequences;
+        size_t putCount = 0;
+
+        void startOSC() override { sequences.emplace_back(); }
+        void putOSC(std::string_view chars) override
+        {
+            ++putCount;
+            sequences.back() += chars;
+        }
+    };
+
+    auto const payload = std::string(100'000, 'A');
+    auto const input = fmt::format("\033]52;c;{}\a\033]2;Title ✅\033\\", payload);
+
+    OSCRecorder listener;
+    auto p = parser::Parser<ParserEvents>(listener);
+    p.parseFragment(input);
+    CHECK(p.state() == parser::State::Ground);
+    REQUIRE(listener.sequences.size() == 2);
+    CHECK(listener.sequences[0] == "52;c;" + payload);
+    CHECK(listener.sequences[1] == "2;Title ✅");
+    CHECK(listener.putCount == 2);
+
+    // Split across reads, the payload is delivered in (at most) one call per read.
+    OSCRecorder splitListener;
+    auto splitParser = parser::Parser<ParserEvents>(splitListener);
+    auto const splitPoint = input.size() / 2;
+    splitParser.parseFragment(std::string_view(input).substr(0, splitPoint));
+    splitParser.parseFragment(std::string_view(input).substr(splitPoint));
+    CHECK(splitListener.sequences == listener.sequences);
+    CHECK(splitListener.putCount == 3);
+}
+
+TEST_CASE("Parser.DCS_bulk")
+{
+    struct DCSRecorder: public NullParserEvents
+    {
+        std::string hooked;
+        std::string data;
+        size_t putCount = 0;
+        bool unhooked = false;
+
+        void hook(char finalChar) override { hooked += finalChar; }
+        void put(std::string_view chars) override
+        {
+            ++putCount;
+            data += chars;
+        }
+        void unhook() override { unhooked = true; }
+    };
+
+    // Sixel payload, including C0 controls that are to be passed through as well.
+    auto const payload = "#0;2;100;0;0#0~~~~!10~-\r\n??@@AA$"sv;
+
+    DCSRecorder listener;
+    auto p = parser::Parser<ParserEvents>(listener);
+    p.parseFragment(fmt::format("\033Pq{}\033\\", payload));
+    CHECK(p.state() == parser::State::Ground);
+    CHECK(listener.hooked == "q");
+    CHECK(listener.data == payload);
+    CHECK(listener.putCount == 1);
+    CHECK(listener.unhooked);
+}
@@ -146,13 +146,21 @@ Pty::ReadResult ConPty::read(crispy::BufferObject<char>& buffer,
                              size_t size)
 {
     // TODO: wait for timeout time at most AND got woken up upon wakeupReader() invokcation.
-    (void) timeout;
+    // As ConPTY does not support overlapped I/O, only polling without waiting is supported so far.
+    if (timeout == std::chrono::milliseconds(0))
+    {
+        DWORD available {};
+        if (!PeekNamedPipe(_input, nullptr, 0, nullptr, &available, nullptr))
+            return { nullopt, false };
+        if (available == 0)
+            return { nullopt, true };
+    }
 
     auto const n = static_cast<DWORD>(min(size, buffer.bytesAvailable()));
 
     DWORD nread {};
     if (!ReadFile(_input, buffer.hotEnd(), n, &nread, nullptr))
-        return nullopt;
+        return { nullopt, false };
 
     return { tuple { string_view { buffer.hotEnd(), nread }, false } };
 }
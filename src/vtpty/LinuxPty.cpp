@@ -344,7 +344,8 @@ Pty::ReadResult LinuxPty::read(crispy::BufferObject<char>& storage,
             return { tuple { x.value(), fd == _stdoutFastPipe.reader() } };
     }
 
-    return nullopt;
+    // Timing out, being woken up, and closing the stdout-fastpipe leave nothing to read for now.
+    return { nullopt, errno == EAGAIN || errno == EINTR };
 }
 
 int LinuxPty::write(char const* buf, size_t size)
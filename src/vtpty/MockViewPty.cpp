@@ -33,9 +33,9 @@ PtySlave& MockViewPty::slave() noexcept
     return _slave;
 }
 
-optional<tuple<string_view, bool>> MockViewPty::read(crispy::BufferObject<char>& storage,
-                                                     std::chrono::milliseconds /*timeout*/,
-                                                     size_t size)
+Pty::ReadResult MockViewPty::read(crispy::BufferObject<char>& storage,
+                                  std::chrono::milliseconds /*timeout*/,
+                                  size_t size)
 {
     auto const n = min(min(_outputBuffer.size(), storage.bytesAvailable()), size);
     auto result = storage.writeAtEnd(_outputBuffer.substr(0, n));
@@ -27,9 +27,9 @@ class MockViewPty: public Pty
     void setReadData(std::string_view data);
 
     PtySlave& slave() noexcept override;
-    [[nodiscard]] std::optional<std::tuple<std::string_view, bool>> read(crispy::BufferObject<char>& storage,
-                                                                         std::chrono::milliseconds timeout,
-                                                                         size_t size) override;
+    [[nodiscard]] ReadResult read(crispy::BufferObject<char>& storage,
+                                  std::chrono::milliseconds timeout,
+                                  size_t size) override;
     void wakeupReader() override;
     int write(char const* buf, size_t size) override;
     [[nodiscard]] PageSize pageSize() const noexcept override;
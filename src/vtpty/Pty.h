@@ -23,6 +23,7 @@
 #include <chrono>
 #include <optional>
 #include <string_view>
+#include <tuple>
 
 namespace terminal
 {
@@ -63,7 +64,15 @@ class PtySlaveDummy: public PtySlave
 class Pty
 {
   public:
-    using ReadResult = std::optional<std::tuple<std::string_view, bool>>;
+    struct ReadResult
+    {
+        /// The data read, and whether it has come through the stdout-fastpipe, if any has been read.
+        std::optional<std::tuple<std::string_view, bool>> data;
+
+        /// Whether nothing has been read merely because the timeout has passed, or because the reader
+        /// has been woken up (see wakeupReader()), rather than because reading has failed.
+        bool idle = false;
+    };
 
     virtual ~Pty() = default;
 
@@ -87,9 +96,8 @@ class Pty
     /// @param timeout Wait only for up to given timeout before giving up the blocking read attempt.
     /// @param size    The number of bytes to read at most, even if the storage has more bytes available.
     ///
-    /// @returns A view to the consumed buffer. The boolean in the ReadResult
-    ///          indicates whether or not this data was coming through
-    ///          the stdout-fastpipe.
+    /// @returns A view to the consumed buffer, if any data has been read. The boolean along with it
+    ///          indicates whether or not this data was coming through the stdout-fastpipe.
     [[nodiscard]] virtual ReadResult read(crispy::BufferObject<char>& storage,
                                           std::chrono::milliseconds timeout,
                                           size_t size) = 0;